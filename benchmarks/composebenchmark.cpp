@@ -0,0 +1,152 @@
+//==============================================================================
+// Name         : composebenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For Compositing A Large Atlas: Tree Order Versus
+//                The Sprite And Band Compose Modes, With And Without Huge Pages
+//==============================================================================
+
+#include <vector>                   // std::vector
+#include <chrono>                   // std::chrono
+#include <cstdio>                   // printf
+#include <cstdlib>                  // std::atoi
+#include <algorithm>                // std::sort, std::max
+#include <functional>               // std::function
+#include "binarytreealgorithm.h"    // BinaryTreeAlgorithm
+#include "blitkernels.h"            // blitkernels::Active
+#include "atlasbuffer.h"            // AtlasBuffer
+#include "compositor.h"             // Compositor
+#include "threadpool.h"             // ThreadPool
+#include "image.h"                  // Image
+
+
+//==============================================================================
+//! @brief Draw The Images In Binary Tree Order, Whole Images At A Time,
+//!        The Way DrawImages Walked The Tree Before The Compose Modes
+//==============================================================================
+static void DrawTreeOrder(Node* aNode, const std::vector<Image>& aImages, uint8_t* aAtlas, size_t aRowBytes)
+{
+    if (!aNode)
+        return;
+
+    if (aNode->imgID >= 0)
+        {
+        const Image& img = aImages[aNode->imgID];
+        const blitkernels::Kernels& kernels = blitkernels::Active();
+        const blitkernels::RowKernel blitRow = (img.channels == 4) ? kernels.copyRGBA : kernels.expandRGB;
+
+        uint8_t* dst = aAtlas + aNode->y * aRowBytes + 4 * static_cast<size_t>(aNode->x);
+        const uint8_t* src = img.data;
+        for (int y = 0; y < img.height; ++y, dst += aRowBytes, src += img.width * img.channels)
+            blitRow(dst, src, img.width);
+        }
+
+    DrawTreeOrder(aNode->rightChild, aImages, aAtlas, aRowBytes);
+    DrawTreeOrder(aNode->downChild, aImages, aAtlas, aRowBytes);
+}
+
+
+//==============================================================================
+//! @brief Time Allocating The Buffer Plus A First Compose (Cold), Then A Second Compose (Warm)
+//==============================================================================
+static void TimeMode(const char* aLabel, size_t aAtlasBytes, bool aHugePages,
+                     const std::function<void(uint8_t*)>& aCompose)
+{
+    auto start = std::chrono::steady_clock::now();
+    AtlasBuffer atlas(aAtlasBytes, aHugePages);
+    aCompose(atlas.Data());
+    std::chrono::duration<double, std::milli> cold = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    aCompose(atlas.Data());
+    std::chrono::duration<double, std::milli> warm = std::chrono::steady_clock::now() - start;
+
+    std::printf("%-28s %s %9.1f ms %9.1f ms %8.2f GB/s\n", aLabel, atlas.HugePages() ? "yes" : "no ",
+                cold.count(), warm.count(), aAtlasBytes / (warm.count() / 1e3) / 1e9);
+}
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: composebenchmark [image count] [threads]
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    const int imageCount = (argc > 1) ? std::atoi(argv[1]) : 1500;
+    ThreadPool threadPool((argc > 2) ? std::atoi(argv[2]) : 0);
+
+    // random opaque and translucent sprites between 16 and 400 pixels a side
+    unsigned seed = 12345;
+    std::vector<Image> images;
+    for (int i = 0; i < imageCount; ++i)
+        {
+        seed = seed * 1103515245 + 12345;
+        const int width = 16 + (seed >> 8) % 385;
+        seed = seed * 1103515245 + 12345;
+        const int height = 16 + (seed >> 8) % 385;
+        const int channels = (i % 2) ? 4 : 3;
+
+        uint8_t* data = new uint8_t[static_cast<size_t>(width) * height * channels];
+        for (size_t b = 0; b < static_cast<size_t>(width) * height * channels; ++b)
+            data[b] = static_cast<uint8_t>(b * 7 + i);
+        images.push_back(Image("sprite", width, height, data, channels));
+        }
+
+    // biggest side first, then pack like AtlasGenerator::Packing
+    std::sort(images.begin(), images.end(), [](const Image& aLeft, const Image& aRight)
+        { return std::max(aLeft.width, aLeft.height) > std::max(aRight.width, aRight.height); });
+
+    BinaryTreeAlgorithm packer;
+    packer.Init(images[0].width, images[0].height);
+    for (auto i = 0; i != images.size(); ++i)
+        {
+        if (Node* node = packer.Insert(images[i].width, images[i].height))
+            packer.SplitNode(node, images[i].width, images[i].height, i);
+        else
+            packer.GrowAtlasCanvas(images[i].width, images[i].height, i);
+        }
+
+    std::vector<Node*> pending(1, packer.rootNode());
+    while (!pending.empty())
+        {
+        Node* node = pending.back();
+        pending.pop_back();
+        if (!node)
+            continue;
+        if (node->imgID >= 0)
+            {
+            images[node->imgID].x = node->x;
+            images[node->imgID].y = node->y;
+            }
+        pending.push_back(node->downChild);
+        pending.push_back(node->rightChild);
+        }
+
+    const int width = packer.rootNode()->width;
+    const int height = packer.rootNode()->height;
+    const size_t rowBytes = 4 * static_cast<size_t>(width);
+    const size_t atlasBytes = rowBytes * height;
+    Compositor compositor(images, packer.FreeRects(), width, height);
+
+    std::printf("%d images, atlas %dx%d (%.0f MB), %u threads, %s kernels, %d-row bands\n\n",
+                imageCount, width, height, atlasBytes / 1048576.0, threadPool.ThreadCount(),
+                blitkernels::Active().name, compositor.BandHeight());
+    std::printf("%-28s %s %12s %12s %13s\n", "mode", "huge", "alloc+cold", "warm", "warm");
+
+    TimeMode("tree order, 1 thread", atlasBytes, false, [&](uint8_t* aAtlas)
+        { DrawTreeOrder(packer.rootNode(), images, aAtlas, rowBytes); });
+    TimeMode("sprites", atlasBytes, false, [&](uint8_t* aAtlas)
+        { compositor.DrawSprites(aAtlas, threadPool); });
+    TimeMode("bands", atlasBytes, false, [&](uint8_t* aAtlas)
+        { compositor.DrawBands(aAtlas, threadPool); });
+    TimeMode("sprites + huge pages", atlasBytes, true, [&](uint8_t* aAtlas)
+        { compositor.DrawSprites(aAtlas, threadPool); });
+    TimeMode("bands + huge pages", atlasBytes, true, [&](uint8_t* aAtlas)
+        { compositor.DrawBands(aAtlas, threadPool); });
+
+    for (Image& img : images)
+        delete[] img.data;
+
+    return 0;
+}
+
+// End Of File
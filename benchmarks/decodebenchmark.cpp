@@ -0,0 +1,173 @@
+//==============================================================================
+// Name         : decodebenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For Reading .png Images: libpng Versus The In-Tree
+//                Decoder, Checked Pixel For Pixel, Plus The Unfilter Kernels
+//==============================================================================
+
+#include <vector>                 // std::vector
+#include <string>                 // std::string
+#include <chrono>                 // std::chrono
+#include <cstdio>                 // printf
+#include <cstring>                // memcmp
+#include <algorithm>              // std::sort, std::min
+#include <stdexcept>              // std::exception
+#include <cstdlib>                // std::abs
+#include <dirent.h>               // DIR, dirent
+#include "pngutilities.h"         // ReadPNG
+#include "pngdecoder.h"           // TryReadPNG
+#include "pngfilters.h"           // pngfilters::ForIsa, FilterAdaptive
+
+
+//==============================================================================
+//! @brief Check Every Unfilter Kernel Undoes Every Filter, For RGB And RGBA Rows
+//==============================================================================
+static bool CheckUnfilters()
+{
+    const size_t rowBytes = 3 * 4 * 97;    // a whole number of RGB and of RGBA pixels
+    std::vector<uint8_t> prev(rowBytes), row(rowBytes), filtered(rowBytes);
+    unsigned seed = 777;
+    for (size_t i = 0; i < rowBytes; ++i)
+        {
+        seed = seed * 1103515245 + 12345;
+        prev[i] = static_cast<uint8_t>(seed >> 24);
+        row[i] = static_cast<uint8_t>(prev[i] + (seed >> 28));
+        }
+
+    const blitkernels::Isa isas[] = {blitkernels::Isa::Scalar, blitkernels::Isa::SSSE3,
+                                     blitkernels::Isa::AVX2, blitkernels::Isa::AVX512};
+    bool ok = true;
+    for (blitkernels::Isa isa : isas)
+        {
+        const pngfilters::Filters* filters = pngfilters::ForIsa(isa);
+        if (!filters)
+            continue;
+
+        for (int pixelBytes = 3; pixelBytes <= 4; ++pixelBytes)
+            for (int type = pngfilters::kNone; type < pngfilters::kFilterCount; ++type)
+                {
+                // filter with the scalar formulas, written for any pixel size by hand
+                for (size_t i = 0; i < rowBytes; ++i)
+                    {
+                    const int a = (i >= static_cast<size_t>(pixelBytes)) ? row[i - pixelBytes] : 0;
+                    const int b = prev[i];
+                    const int c = (i >= static_cast<size_t>(pixelBytes)) ? prev[i - pixelBytes] : 0;
+                    const int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+                    const int paeth = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+                    const int predicted[] = {0, a, b, (a + b) / 2, paeth};
+                    filtered[i] = static_cast<uint8_t>(row[i] - predicted[type]);
+                    }
+
+                const pngfilters::UnfilterKernel* unfilter = (pixelBytes == 4) ? filters->unfilterRGBA
+                                                                                 : filters->unfilterRGB;
+                unfilter[type](filtered.data(), prev.data(), rowBytes);
+                if (filtered != row)
+                    {
+                    std::printf("unfilter %s type %d, %d bytes per pixel: MISMATCH\n", filters->name, type, pixelBytes);
+                    ok = false;
+                    }
+                }
+        }
+    return ok;
+}
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: decodebenchmark <image folder>
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+        {
+        std::printf("Usage: %s <image folder>\n", argv[0]);
+        return 1;
+        }
+
+    std::printf("unfilter kernels: %s\n", CheckUnfilters() ? "ok" : "MISMATCH");
+
+    std::vector<std::string> files;
+    if (DIR* dir = opendir(argv[1]))
+        {
+        while (dirent* entry = readdir(dir))
+            {
+            const std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".png") == 0)
+                files.push_back(std::string(argv[1]) + "/" + name);
+            }
+        closedir(dir);
+        }
+    std::sort(files.begin(), files.end());
+
+    // decode each file with both, best of three runs each
+    double libpngTime = 0, libpngNativeFilesTime = 0, nativeTime = 0, fallbackTime = 0;
+    size_t nativeFiles = 0, pixelBytes = 0, mismatches = 0;
+    for (const std::string& file : files)
+        {
+        double libpngBest = 1e30, nativeBest = 1e30;
+        int width = 0, height = 0, channels = 0;
+        uint8_t* reference = nullptr;
+        uint8_t* decoded = nullptr;
+        for (int run = 0; run < 3; ++run)
+            {
+            delete[] reference;
+            delete[] decoded;
+            reference = decoded = nullptr;
+
+            auto start = std::chrono::steady_clock::now();
+            try
+                {
+                uint32_t* palette = nullptr;
+                reference = pngutilities::ReadPNG(file.c_str(), width, height, channels, palette);
+                delete[] palette;
+                }
+            catch (const std::exception& err)
+                {
+                std::printf("%s: %s\n", file.c_str(), err.what());
+                break;
+                }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            libpngBest = std::min(libpngBest, elapsed.count());
+
+            int nativeWidth = 0, nativeHeight = 0, nativeChannels = 0;
+            start = std::chrono::steady_clock::now();
+            decoded = pngdecoder::TryReadPNG(file.c_str(), nativeWidth, nativeHeight, nativeChannels);
+            elapsed = std::chrono::steady_clock::now() - start;
+            nativeBest = std::min(nativeBest, elapsed.count());
+
+            if (decoded && (nativeWidth != width || nativeHeight != height || nativeChannels != channels
+                            || memcmp(decoded, reference, static_cast<size_t>(width) * height * channels) != 0))
+                {
+                std::printf("%s: MISMATCH\n", file.c_str());
+                ++mismatches;
+                break;
+                }
+            }
+
+        if (reference)
+            {
+            libpngTime += libpngBest;
+            if (decoded)
+                {
+                nativeTime += nativeBest;
+                libpngNativeFilesTime += libpngBest;
+                ++nativeFiles;
+                pixelBytes += static_cast<size_t>(width) * height * channels;
+                }
+            else    // the native attempt bailed out, then libpng read it
+                fallbackTime += libpngBest + nativeBest;
+            }
+        delete[] reference;
+        delete[] decoded;
+        }
+
+    std::printf("%zu files, %zu read natively (%.1f MB of pixels), %zu mismatches\n",
+                files.size(), nativeFiles, pixelBytes / 1e6, mismatches);
+    std::printf("those files: libpng %9.1f ms, native %9.1f ms, %.2fx\n",
+                libpngNativeFilesTime, nativeTime, nativeTime > 0 ? libpngNativeFilesTime / nativeTime : 0.0);
+    std::printf("all files:   libpng %9.1f ms, native with fallback %9.1f ms\n",
+                libpngTime, nativeTime + fallbackTime);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// End Of File
@@ -0,0 +1,187 @@
+//==============================================================================
+// Name         : encodebenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For Writing The Texture Atlas .png: The Row Filter
+//                Kernels Per Instruction Set, libpng Versus .qoi And
+//                PNGStreamWriter's Compression Presets, And The Default
+//                Preset On 1..N Threads
+//==============================================================================
+
+#define PNG_SKIP_SETJMP_CHECK
+#include <vector>                 // std::vector
+#include <chrono>                 // std::chrono
+#include <cstdio>                 // printf, FILE
+#include <cstdlib>                // std::atoi
+#include <functional>             // std::function
+#include <algorithm>              // std::min
+#include <png.h>                  // png_write_png
+#include "pngstreamwriter.h"      // PNGStreamWriter
+#include "qoistreamwriter.h"      // QOIStreamWriter
+#include "pngfilters.h"           // pngfilters::ForIsa, FilterAdaptive
+#include "threadpool.h"           // ThreadPool
+
+
+//==============================================================================
+//! @brief Get The Size Of A File In Bytes
+//==============================================================================
+static long FileSize(const char* aFilename)
+{
+    FILE* file = fopen(aFilename, "rb");
+    if (!file)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+
+//==============================================================================
+//! @brief Time One Encoder, Best Of Three Runs
+//==============================================================================
+static void TimeEncoder(const char* aLabel, const char* aFilename, size_t aImageBytes,
+                        const std::function<void()>& aEncode)
+{
+    double best = 1e30;
+    for (int run = 0; run < 3; ++run)
+        {
+        const auto start = std::chrono::steady_clock::now();
+        aEncode();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        }
+
+    std::printf("%-24s %9.1f ms %8.1f MB/s %11ld bytes\n", aLabel, best,
+                aImageBytes / (best / 1e3) / 1e6, FileSize(aFilename));
+}
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: encodebenchmark [width] [height]
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    const int width = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    const int height = (argc > 2) ? std::atoi(argv[2]) : 4096;
+    const size_t rowBytes = 4 * static_cast<size_t>(width);
+
+    // an atlas-like mix: flat and gradient sprites, noisy ones, transparent gaps
+    std::vector<uint8_t> image(rowBytes * height);
+    unsigned seed = 12345;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            {
+            uint8_t* pixel = &image[y * rowBytes + 4 * static_cast<size_t>(x)];
+            const int cell = (y / 256) * 64 + x / 256;
+            seed = seed * 1103515245 + 12345;
+            switch (cell % 4)
+                {
+                case 0: pixel[0] = x; pixel[1] = y; pixel[2] = cell; pixel[3] = 255; break;
+                case 1: pixel[0] = seed >> 24; pixel[1] = seed >> 16; pixel[2] = seed >> 8; pixel[3] = 255; break;
+                case 2: pixel[0] = (x * y) >> 6; pixel[1] = x ^ y; pixel[2] = 40; pixel[3] = (x + y) / 4; break;
+                default: pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0; break;
+                }
+            }
+
+    std::printf("%dx%d RGBA, %.1f MB\n", width, height, image.size() / 1e6);
+
+    // adaptive filtering alone, per instruction set, each checked against the scalar filters
+    const pngfilters::Filters* scalar = pngfilters::ForIsa(blitkernels::Isa::Scalar);
+    std::vector<uint8_t> reference(height * (rowBytes + 1));
+    std::vector<uint8_t> filtered(height * (rowBytes + 1));
+    std::vector<uint8_t> scratch(rowBytes);
+    const std::vector<uint8_t> zeroRow(rowBytes, 0);
+    auto filterImage = [&](const pngfilters::Filters& aFilters, std::vector<uint8_t>& aOut)
+        {
+        for (int y = 0; y < height; ++y)
+            pngfilters::FilterAdaptive(aFilters, &image[y * rowBytes],
+                                       y ? &image[(y - 1) * rowBytes] : zeroRow.data(),
+                                       rowBytes, 4, &aOut[y * (rowBytes + 1)], scratch.data());
+        };
+    filterImage(*scalar, reference);
+
+    const blitkernels::Isa isas[] = {blitkernels::Isa::Scalar, blitkernels::Isa::SSSE3,
+                                     blitkernels::Isa::AVX2, blitkernels::Isa::AVX512};
+    for (blitkernels::Isa isa : isas)
+        {
+        const pngfilters::Filters* filters = pngfilters::ForIsa(isa);
+        if (!filters)
+            continue;
+
+        double best = 1e30;
+        for (int run = 0; run < 3; ++run)
+            {
+            const auto start = std::chrono::steady_clock::now();
+            filterImage(*filters, filtered);
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+            }
+        std::printf("filters %-16s %9.1f ms %8.1f MB/s %s\n", filters->name, best,
+                    image.size() / (best / 1e3) / 1e6, filtered == reference ? "ok" : "MISMATCH");
+        }
+    std::printf("\n");
+    std::printf("%-24s %12s %13s %17s\n", "encoder", "time", "speed", "size");
+
+    TimeEncoder("libpng", "encodebenchmark.png", image.size(), [&]
+        {
+        FILE* file = fopen("encodebenchmark.png", "wb");
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        png_infop info = png_create_info_struct(png);
+        png_init_io(png, file);
+        png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        std::vector<png_bytep> rows(height);
+        for (int y = 0; y < height; ++y)
+            rows[y] = &image[y * rowBytes];
+        png_set_rows(png, info, rows.data());
+        png_write_png(png, info, PNG_TRANSFORM_IDENTITY, nullptr);
+        png_destroy_write_struct(&png, &info);
+        fclose(file);
+        });
+
+    TimeEncoder("qoi", "encodebenchmark.qoi", image.size(), [&]
+        {
+        QOIStreamWriter writer("encodebenchmark.qoi", width, height);
+        writer.WriteRows(image.data(), height, rowBytes);
+        writer.Finish();
+        });
+    std::remove("encodebenchmark.qoi");
+
+    const char* presetNames[] = {"store", "fast", "default", "max", "exhaustive"};
+    const unsigned maxThreads = ThreadPool().ThreadCount();
+    for (int preset = 0; preset < 5; ++preset)
+        {
+        ThreadPool threadPool(1);
+        char label[64];
+        std::snprintf(label, sizeof(label), "%s, 1 thread", presetNames[preset]);
+        TimeEncoder(label, "encodebenchmark.png", image.size(), [&]
+            {
+            PNGStreamWriter writer("encodebenchmark.png", width, height, threadPool,
+                                   static_cast<CompressionPreset>(preset));
+            writer.WriteRows(image.data(), height, rowBytes);
+            writer.Finish();
+            });
+        }
+
+    for (unsigned threads = 1;; threads = std::min(2 * threads, maxThreads))
+        {
+        ThreadPool threadPool(threads);
+        char label[64];
+        std::snprintf(label, sizeof(label), "default, %u thread%s", threads, threads > 1 ? "s" : "");
+        TimeEncoder(label, "encodebenchmark.png", image.size(), [&]
+            {
+            PNGStreamWriter writer("encodebenchmark.png", width, height, threadPool);
+            writer.WriteRows(image.data(), height, rowBytes);
+            writer.Finish();
+            });
+
+        if (threads == maxThreads)
+            break;
+        }
+
+    std::remove("encodebenchmark.png");
+    return 0;
+}
+
+// End Of File
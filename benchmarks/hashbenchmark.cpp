@@ -0,0 +1,67 @@
+//==============================================================================
+// Name         : hashbenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For The Image Hash Kernels: Hashing A Large Buffer Of
+//                Pixels Per ISA, Checked Against Scalar, In GB/s
+//==============================================================================
+
+#include <vector>              // std::vector
+#include <chrono>              // std::chrono
+#include <cstdio>              // printf
+#include <cstdlib>             // std::atoi
+#include <algorithm>           // std::min
+#include "imagehash.h"         // imagehash::ForIsa
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: hashbenchmark [megabytes]
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    const size_t bytes = static_cast<size_t>((argc > 1) ? std::atoi(argv[1]) : 256) << 20;
+
+    // noisy pixels, so no kernel gets lucky with runs of equal bytes
+    std::vector<uint8_t> pixels(bytes);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < bytes; ++i)
+        {
+        seed = seed * 1664525u + 1013904223u;
+        pixels[i] = static_cast<uint8_t>(seed >> 24);
+        }
+
+    const blitkernels::Isa isas[] = {blitkernels::Isa::Scalar, blitkernels::Isa::SSSE3,
+                                     blitkernels::Isa::AVX2, blitkernels::Isa::AVX512};
+    const imagehash::Kernels* scalar = imagehash::ForIsa(blitkernels::Isa::Scalar);
+
+    std::printf("%zu MB, active kernels: %s\n\n", bytes >> 20, imagehash::Active().name);
+    std::printf("%-8s %12s\n", "isa", "hash");
+
+    for (blitkernels::Isa isa : isas)
+        {
+        const imagehash::Kernels* kernels = imagehash::ForIsa(isa);
+        if (!kernels)
+            continue;
+
+        // every length up to a few stripes, to cover the zero-padded last stripe
+        bool valid = true;
+        for (size_t length = 0; length <= 3 * imagehash::kStripeBytes && valid; ++length)
+            valid = imagehash::Hash(pixels.data() + 1, length, *kernels)
+                    == imagehash::Hash(pixels.data() + 1, length, *scalar);
+
+        double seconds = 1e30;
+        uint64_t hash = 0;
+        for (int run = 0; run < 3; ++run)
+            {
+            auto start = std::chrono::steady_clock::now();
+            hash = imagehash::Hash(pixels.data(), bytes, *kernels);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            seconds = std::min(seconds, elapsed.count());
+            }
+        valid = valid && hash == imagehash::Hash(pixels.data(), bytes, *scalar);
+        std::printf("%-8s %7.2f GB/s%s\n", kernels->name, bytes / seconds / 1e9, valid ? "" : " MISMATCH");
+        }
+    return 0;
+}
+
+// End Of File
@@ -0,0 +1,107 @@
+//==============================================================================
+// Name         : packbenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For The 16-bit Pixel Packing Kernels: Ordered And
+//                Error-Diffusion Dithering Per ISA And Layout, Checked Against
+//                Scalar, In Mpixels/s
+//==============================================================================
+
+#include <vector>            // std::vector
+#include <chrono>            // std::chrono
+#include <cstdio>            // printf
+#include <cstdlib>           // std::atoi
+#include <algorithm>         // std::min
+#include "pixelpacker.h"     // pixelpacker::ForIsa
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: packbenchmark [width] [height]
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    const int width = (argc > 1) ? std::atoi(argv[1]) : 2047;
+    const int height = (argc > 2) ? std::atoi(argv[2]) : 1024;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+
+    // gradients, where banding shows, with some noise
+    std::vector<uint8_t> image(4 * pixelCount);
+    unsigned seed = 12345;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            {
+            uint8_t* pixel = &image[4 * (static_cast<size_t>(y) * width + x)];
+            seed = seed * 1103515245 + 12345;
+            pixel[0] = static_cast<uint8_t>(x * 255 / width);
+            pixel[1] = static_cast<uint8_t>(y * 255 / height);
+            pixel[2] = static_cast<uint8_t>((x + y) / 8 + (seed >> 30));
+            pixel[3] = static_cast<uint8_t>(255 - x * 255 / width);
+            }
+
+    struct Case { const char* name; pixelpacker::Layout layout; };
+    const Case cases[] =
+    {
+        { "rgba4444", { {4, 4, 4, 4}, {12, 8, 4, 0} } },
+        { "rgb565", { {5, 6, 5, 0}, {11, 5, 0, 0} } },
+        { "a1rgb555", { {5, 5, 5, 1}, {10, 5, 0, 15} } },
+    };
+    const blitkernels::Isa isas[] = {blitkernels::Isa::Scalar, blitkernels::Isa::SSSE3,
+                                     blitkernels::Isa::AVX2, blitkernels::Isa::AVX512};
+    const pixelpacker::Kernels* scalar = pixelpacker::ForIsa(blitkernels::Isa::Scalar);
+
+    std::printf("%dx%d RGBA, active kernels: %s\n", width, height, pixelpacker::Active().name);
+    for (const Case& c : cases)
+        {
+        // what the scalar kernels make of the image, row by row as the writer packs it
+        std::vector<uint16_t> orderedReference(pixelCount), diffusedReference(pixelCount);
+        std::vector<int16_t> errors(4 * static_cast<size_t>(width));
+        for (int y = 0; y < height; ++y)
+            {
+            const size_t row = static_cast<size_t>(y) * width;
+            scalar->packOrdered(&image[4 * row], width, pixelpacker::BayerRow(y), c.layout, &orderedReference[row]);
+            scalar->packDiffused(&image[4 * row], width, errors.data(), c.layout, &diffusedReference[row]);
+            }
+
+        std::printf("\n%-9s %-8s %16s %16s\n", c.name, "isa", "ordered", "diffusion");
+        for (blitkernels::Isa isa : isas)
+            {
+            const pixelpacker::Kernels* kernels = pixelpacker::ForIsa(isa);
+            if (!kernels)
+                continue;
+
+            std::vector<uint16_t> packed(pixelCount);
+            double ordered = 1e30, diffused = 1e30;
+            bool orderedValid = true, diffusedValid = true;
+            for (int run = 0; run < 3; ++run)
+                {
+                auto start = std::chrono::steady_clock::now();
+                for (int y = 0; y < height; ++y)
+                    {
+                    const size_t row = static_cast<size_t>(y) * width;
+                    kernels->packOrdered(&image[4 * row], width, pixelpacker::BayerRow(y), c.layout, &packed[row]);
+                    }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                ordered = std::min(ordered, elapsed.count());
+                orderedValid = orderedValid && packed == orderedReference;
+
+                std::fill(errors.begin(), errors.end(), 0);
+                start = std::chrono::steady_clock::now();
+                for (int y = 0; y < height; ++y)
+                    {
+                    const size_t row = static_cast<size_t>(y) * width;
+                    kernels->packDiffused(&image[4 * row], width, errors.data(), c.layout, &packed[row]);
+                    }
+                elapsed = std::chrono::steady_clock::now() - start;
+                diffused = std::min(diffused, elapsed.count());
+                diffusedValid = diffusedValid && packed == diffusedReference;
+                }
+
+            std::printf("%-9s %-8s %8.1f Mpix/s%s %8.1f Mpix/s%s\n", "", kernels->name,
+                        pixelCount / ordered / 1e6, orderedValid ? "" : " MISMATCH",
+                        pixelCount / diffused / 1e6, diffusedValid ? "" : " MISMATCH");
+            }
+        }
+    return 0;
+}
+
+// End Of File
@@ -0,0 +1,121 @@
+//==============================================================================
+// Name         : reducebenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For The Channel Reduction Kernels: Scanning RGBA And
+//                RGB Images And Narrowing Them, Per ISA, Checked Against
+//                Scalar, In Mpixels/s
+//==============================================================================
+
+#include <vector>              // std::vector
+#include <chrono>              // std::chrono
+#include <cstdio>              // printf
+#include <cstdlib>             // std::atoi
+#include <algorithm>           // std::min
+#include "channelreducer.h"    // channelreducer::ForIsa
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: reducebenchmark [width] [height]
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    const int width = (argc > 1) ? std::atoi(argv[1]) : 2047;
+    const int height = (argc > 2) ? std::atoi(argv[2]) : 1024;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+
+    // opaque gray, so a scan can't stop early; the RGB copy drops alpha
+    std::vector<uint8_t> rgba(4 * pixelCount), rgb(3 * pixelCount);
+    for (size_t i = 0; i < pixelCount; ++i)
+        {
+        const uint8_t gray = static_cast<uint8_t>(i * 7 + i / width);
+        for (int c = 0; c < 3; ++c)
+            rgba[4 * i + c] = rgb[3 * i + c] = gray;
+        rgba[4 * i + 3] = 255;
+        }
+
+    // a few pixels that clear one flag each, checked one at a time
+    struct Probe { size_t pixel; uint8_t rgba[4]; };
+    const Probe probes[] =
+    {
+        { pixelCount - 1, {  9,  9,  9, 254 } },
+        { pixelCount / 2, {  9, 10,  9, 255 } },
+        { 5,              { 30, 30, 30,   0 } },
+    };
+
+    const channelreducer::Channels targets[] = {channelreducer::Channels::RGB, channelreducer::Channels::GrayAlpha,
+                                                channelreducer::Channels::Gray, channelreducer::Channels::Alpha};
+    const blitkernels::Isa isas[] = {blitkernels::Isa::Scalar, blitkernels::Isa::SSSE3,
+                                     blitkernels::Isa::AVX2, blitkernels::Isa::AVX512};
+    const channelreducer::Kernels* scalar = channelreducer::ForIsa(blitkernels::Isa::Scalar);
+
+    std::printf("%dx%d, active kernels: %s\n\n", width, height, channelreducer::Active().name);
+    std::printf("%-8s %16s %16s", "isa", "scan rgba", "scan rgb");
+    for (channelreducer::Channels target : targets)
+        std::printf(" %16s", channelreducer::Name(target));
+    std::printf("\n");
+
+    for (blitkernels::Isa isa : isas)
+        {
+        const channelreducer::Kernels* kernels = channelreducer::ForIsa(isa);
+        if (!kernels)
+            continue;
+
+        // the flags must agree on the plain image and with each probe pixel planted
+        bool scanValid = kernels->scanRGBA(rgba.data(), pixelCount) == scalar->scanRGBA(rgba.data(), pixelCount)
+                         && kernels->scanRGB(rgb.data(), pixelCount) == scalar->scanRGB(rgb.data(), pixelCount);
+        for (const Probe& probe : probes)
+            {
+            std::vector<uint8_t> image(rgba);
+            std::copy(probe.rgba, probe.rgba + 4, &image[4 * probe.pixel]);
+            scanValid = scanValid && kernels->scanRGBA(image.data(), pixelCount)
+                                     == scalar->scanRGBA(image.data(), pixelCount);
+            }
+
+        double scanRGBA = 1e30, scanRGB = 1e30;
+        for (int run = 0; run < 3; ++run)
+            {
+            auto start = std::chrono::steady_clock::now();
+            kernels->scanRGBA(rgba.data(), pixelCount);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            scanRGBA = std::min(scanRGBA, elapsed.count());
+
+            start = std::chrono::steady_clock::now();
+            kernels->scanRGB(rgb.data(), pixelCount);
+            elapsed = std::chrono::steady_clock::now() - start;
+            scanRGB = std::min(scanRGB, elapsed.count());
+            }
+        std::printf("%-8s %8.1f Mpix/s%s %8.1f Mpix/s ", kernels->name, pixelCount / scanRGBA / 1e6,
+                    scanValid ? "" : " MISMATCH", pixelCount / scanRGB / 1e6);
+
+        // each target from RGBA, checked from RGB too
+        for (channelreducer::Channels target : targets)
+            {
+            const channelreducer::Selection fromRGBA = channelreducer::Select(4, target);
+            const channelreducer::Selection fromRGB = channelreducer::Select(3, target);
+            const size_t bytes = fromRGBA.dstBytes * pixelCount;
+            std::vector<uint8_t> narrow(bytes), reference(bytes);
+
+            double seconds = 1e30;
+            for (int run = 0; run < 3; ++run)
+                {
+                auto start = std::chrono::steady_clock::now();
+                kernels->narrow(narrow.data(), rgba.data(), pixelCount, fromRGBA);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                seconds = std::min(seconds, elapsed.count());
+                }
+            scalar->narrow(reference.data(), rgba.data(), pixelCount, fromRGBA);
+            bool valid = narrow == reference;
+
+            kernels->narrow(narrow.data(), rgb.data(), pixelCount, fromRGB);
+            scalar->narrow(reference.data(), rgb.data(), pixelCount, fromRGB);
+            valid = valid && narrow == reference;
+
+            std::printf(" %8.1f Mpix/s%s", pixelCount / seconds / 1e6, valid ? "" : " MISMATCH");
+            }
+        std::printf("\n");
+        }
+    return 0;
+}
+
+// End Of File
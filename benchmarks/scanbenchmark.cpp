@@ -0,0 +1,56 @@
+//==============================================================================
+// Name         : scanbenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For The Directory Scanner: Finding The .png Files Of
+//                A Folder Tree On 1 To N Threads, Checked For The Same Result
+//==============================================================================
+
+#include <vector>                 // std::vector
+#include <string>                 // std::string
+#include <chrono>                 // std::chrono
+#include <cstdio>                 // printf
+#include <thread>                 // std::thread::hardware_concurrency
+#include <algorithm>              // std::max, std::min
+#include "directoryscanner.h"     // directoryscanner::FindFiles
+#include "threadpool.h"           // ThreadPool
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: scanbenchmark <folder>
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+        {
+        std::printf("Usage: %s <folder>\n", argv[0]);
+        return 1;
+        }
+
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> expected;
+    std::printf("%-8s %12s %10s\n", "threads", "files", "ms");
+    for (unsigned threads = 1; threads <= hardwareThreads; threads *= 2)
+        {
+        ThreadPool threadPool(threads);
+
+        // the first run warms the directory cache, the best of the rest is reported
+        double seconds = 1e30;
+        std::vector<std::string> files;
+        for (int run = 0; run < 4; ++run)
+            {
+            auto start = std::chrono::steady_clock::now();
+            files = directoryscanner::FindFiles(argv[1], ".png", true, threadPool);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (run > 0)
+                seconds = std::min(seconds, elapsed.count());
+            }
+        if (threads == 1)
+            expected = files;
+        std::printf("%-8u %12zu %10.1f%s\n", threads, files.size(), seconds * 1e3,
+                    files == expected ? "" : " MISMATCH");
+        }
+    return 0;
+}
+
+// End Of File
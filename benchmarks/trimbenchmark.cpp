@@ -0,0 +1,114 @@
+//==============================================================================
+// Name         : trimbenchmark.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Benchmark For The Alpha Trimming Kernels: Finding The Visible
+//                Bounds Of Gray-Alpha, RGBA And RGBA16 Images, Per ISA, Checked
+//                Against Scalar, In Mpixels/s
+//==============================================================================
+
+#include <vector>              // std::vector
+#include <chrono>              // std::chrono
+#include <cstdio>              // printf
+#include <cstdlib>             // std::atoi
+#include <algorithm>           // std::min
+#include "alphatrimmer.h"      // alphatrimmer::ForIsa
+
+
+//==============================================================================
+//! @brief Find The Bounds Of A Whole Image With Some Kernels, Row By Row
+//! @return Left, Right, Top And Bottom, Right And Bottom One Past The Last
+//==============================================================================
+static std::vector<size_t> Bounds(const alphatrimmer::Kernels& aKernels, const uint8_t* aPixels, size_t aWidth,
+                                  size_t aHeight, size_t aPixelBytes)
+{
+    size_t left = aWidth, right = 0, top = aHeight, bottom = 0;
+    for (size_t y = 0; y < aHeight; ++y)
+        {
+        const uint8_t* row = aPixels + y * aWidth * aPixelBytes;
+        const size_t first = aKernels.firstVisible(row, aWidth, aPixelBytes);
+        if (first == aWidth)
+            continue;
+        left = std::min(left, first);
+        right = std::max(right, aKernels.lastVisible(row, aWidth, aPixelBytes));
+        top = std::min(top, y);
+        bottom = y + 1;
+        }
+    return std::vector<size_t>{left, right, top, bottom};
+}
+
+
+//==============================================================================
+//! Benchmark Entry Point
+//! Usage: trimbenchmark [width] [height]
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    const int width = (argc > 1) ? std::atoi(argv[1]) : 2047;
+    const int height = (argc > 2) ? std::atoi(argv[2]) : 1024;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+
+    // a mostly transparent image, a few visible pixels that every row scan has to reach
+    const size_t pixelSizes[] = {2, 4, 8};
+    std::vector<std::vector<uint8_t>> images;
+    for (size_t pixelBytes : pixelSizes)
+        {
+        std::vector<uint8_t> image(pixelBytes * pixelCount, 0x7F);
+        for (size_t i = 0; i < pixelCount; ++i)
+            {
+            const size_t x = i % width, y = i / width;
+            const bool visible = (x == (y * 37) % width) && (y % 3 == 0);
+            image[pixelBytes * i + pixelBytes - 1] = visible ? 200 : 0;
+            if (pixelBytes == 8)
+                image[pixelBytes * i + 6] = 0;
+            }
+        images.push_back(image);
+        }
+
+    const blitkernels::Isa isas[] = {blitkernels::Isa::Scalar, blitkernels::Isa::SSSE3,
+                                     blitkernels::Isa::AVX2, blitkernels::Isa::AVX512};
+    const alphatrimmer::Kernels* scalar = alphatrimmer::ForIsa(blitkernels::Isa::Scalar);
+
+    std::printf("%dx%d, active kernels: %s\n\n", width, height, alphatrimmer::Active().name);
+    std::printf("%-8s %16s %16s %16s\n", "isa", "gray-alpha", "rgba", "rgba16");
+
+    for (blitkernels::Isa isa : isas)
+        {
+        const alphatrimmer::Kernels* kernels = alphatrimmer::ForIsa(isa);
+        if (!kernels)
+            continue;
+
+        std::printf("%-8s", kernels->name);
+        for (size_t i = 0; i < images.size(); ++i)
+            {
+            const uint8_t* pixels = images[i].data();
+            bool valid = Bounds(*kernels, pixels, width, height, pixelSizes[i])
+                         == Bounds(*scalar, pixels, width, height, pixelSizes[i]);
+
+            // a single pixel at every position of a short row, to cover the block edges
+            for (size_t x = 0; x < 67 && valid; ++x)
+                {
+                std::vector<uint8_t> row(67 * pixelSizes[i], 0);
+                row[x * pixelSizes[i] + pixelSizes[i] - 1] = 1;
+                for (size_t count = 0; count <= 67; ++count)
+                    valid = valid && kernels->firstVisible(row.data(), count, pixelSizes[i])
+                                     == scalar->firstVisible(row.data(), count, pixelSizes[i])
+                                  && kernels->lastVisible(row.data(), count, pixelSizes[i])
+                                     == scalar->lastVisible(row.data(), count, pixelSizes[i]);
+                }
+
+            double seconds = 1e30;
+            for (int run = 0; run < 3; ++run)
+                {
+                auto start = std::chrono::steady_clock::now();
+                Bounds(*kernels, pixels, width, height, pixelSizes[i]);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                seconds = std::min(seconds, elapsed.count());
+                }
+            std::printf(" %8.1f Mpix/s%s", pixelCount / seconds / 1e6, valid ? "" : " MISMATCH");
+            }
+        std::printf("\n");
+        }
+    return 0;
+}
+
+// End Of File
@@ -0,0 +1,397 @@
+//==============================================================================
+// Name         : alphatrimmer.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The Kernels That Find The Fully Transparent Borders Of
+//                Images And Trim Them Off, With Runtime CPU Dispatch
+//==============================================================================
+
+#include "alphatrimmer.h"     // alphatrimmer::Kernels
+#include <algorithm>          // std::min, std::max
+#include <string.h>           // memmove
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define TRIM_X86
+    #include <immintrin.h>          // SSSE3, AVX2 intrinsics
+    #if defined(_MSC_VER)
+        #include <intrin.h>         // _BitScanForward, _BitScanReverse
+        #define TRIM_TARGET(aIsa)
+    #else
+        #define TRIM_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace alphatrimmer
+{
+    using blitkernels::Isa;
+
+    //==============================================================================
+    //! @brief Whether A Pixel Of aPixelBytes Bytes Has Alpha Other Than 0
+    //==============================================================================
+    static inline bool Visible(const uint8_t* aPixel, size_t aPixelBytes)
+    {
+        return (aPixelBytes == 8) ? (aPixel[6] | aPixel[7]) != 0 : aPixel[aPixelBytes - 1] != 0;
+    }
+
+
+    //==============================================================================
+    // Scalar Kernels, Used On Every CPU For The Row Tails Too
+    //==============================================================================
+    static size_t FirstVisibleScalar(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aRow += aPixelBytes)
+            if (Visible(aRow, aPixelBytes))
+                return i;
+        return aPixels;
+    }
+
+    static size_t LastVisibleScalar(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes)
+    {
+        for (size_t i = aPixels; i > 0; --i)
+            if (Visible(aRow + (i - 1) * aPixelBytes, aPixelBytes))
+                return i;
+        return 0;
+    }
+
+
+#if defined(TRIM_X86)
+    //==============================================================================
+    //! @brief The Lowest And Highest Set Bit Of A Non-Zero Mask
+    //==============================================================================
+    static inline unsigned LowestBit(uint32_t aMask)
+    {
+    #if defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanForward(&bit, aMask);
+        return bit;
+    #else
+        return __builtin_ctz(aMask);
+    #endif
+    }
+
+    static inline unsigned HighestBit(uint32_t aMask)
+    {
+    #if defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanReverse(&bit, aMask);
+        return bit;
+    #else
+        return 31 - __builtin_clz(aMask);
+    #endif
+    }
+
+    //==============================================================================
+    //! @brief Build The Mask Of The Alpha Bytes In A 16-Byte Block, Both Bytes Of A
+    //!        16-bit Alpha; aPixelBytes Divides 16, So Every Block Starts On A Pixel
+    //==============================================================================
+    static inline void AlphaBytes(uint8_t aMask[16], size_t aPixelBytes)
+    {
+        const size_t first = aPixelBytes - ((aPixelBytes == 8) ? 2 : 1);
+        for (size_t b = 0; b < 16; ++b)
+            aMask[b] = (b % aPixelBytes >= first) ? 0xFF : 0;
+    }
+
+    //==============================================================================
+    // SSSE3 Kernels, 16 Bytes At A Time
+    // The Alpha Bytes Are Masked In And Compared With 0; movemask Turns The Result
+    // Into A Bit Per Byte, So The First Or Last Set Bit Over The Pixel Size Is The
+    // First Or Last Visible Pixel Of The Block
+    //==============================================================================
+    TRIM_TARGET("ssse3")
+    static inline uint32_t VisibleBitsSSSE3(const uint8_t* aBytes, __m128i aAlphaMask)
+    {
+        const __m128i alphas = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aBytes)), aAlphaMask);
+        return ~_mm_movemask_epi8(_mm_cmpeq_epi8(alphas, _mm_setzero_si128())) & 0xFFFFu & _mm_movemask_epi8(aAlphaMask);
+    }
+
+    TRIM_TARGET("ssse3")
+    static size_t FirstVisibleSSSE3(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes)
+    {
+        uint8_t mask[16];
+        AlphaBytes(mask, aPixelBytes);
+        const __m128i alphaMask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+        const size_t bytes = aPixels * aPixelBytes;
+
+        size_t b = 0;
+        for (; b + 16 <= bytes; b += 16)
+            if (const uint32_t bits = VisibleBitsSSSE3(aRow + b, alphaMask))
+                return (b + LowestBit(bits)) / aPixelBytes;
+        const size_t i = b / aPixelBytes;
+        return i + FirstVisibleScalar(aRow + b, aPixels - i, aPixelBytes);
+    }
+
+    TRIM_TARGET("ssse3")
+    static size_t LastVisibleSSSE3(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes)
+    {
+        uint8_t mask[16];
+        AlphaBytes(mask, aPixelBytes);
+        const __m128i alphaMask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+        const size_t bytes = aPixels * aPixelBytes;
+
+        // the tail past the last whole block first, then blocks backward
+        size_t b = bytes & ~static_cast<size_t>(15);
+        const size_t i = b / aPixelBytes;
+        if (const size_t last = LastVisibleScalar(aRow + b, aPixels - i, aPixelBytes))
+            return i + last;
+        while (b > 0)
+            {
+            b -= 16;
+            if (const uint32_t bits = VisibleBitsSSSE3(aRow + b, alphaMask))
+                return (b + HighestBit(bits)) / aPixelBytes + 1;
+            }
+        return 0;
+    }
+
+    //==============================================================================
+    // AVX2 Kernels, 32 Bytes At A Time, The Rest Left To The SSSE3 Kernels
+    //==============================================================================
+    TRIM_TARGET("avx2")
+    static inline uint32_t VisibleBitsAVX2(const uint8_t* aBytes, __m256i aAlphaMask)
+    {
+        const __m256i alphas = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(aBytes)),
+                                                aAlphaMask);
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(alphas, _mm256_setzero_si256())))
+               & static_cast<uint32_t>(_mm256_movemask_epi8(aAlphaMask));
+    }
+
+    TRIM_TARGET("avx2")
+    static size_t FirstVisibleAVX2(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes)
+    {
+        uint8_t mask[16];
+        AlphaBytes(mask, aPixelBytes);
+        const __m256i alphaMask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask)));
+        const size_t bytes = aPixels * aPixelBytes;
+
+        size_t b = 0;
+        for (; b + 32 <= bytes; b += 32)
+            if (const uint32_t bits = VisibleBitsAVX2(aRow + b, alphaMask))
+                {
+                _mm256_zeroupper();
+                return (b + LowestBit(bits)) / aPixelBytes;
+                }
+        _mm256_zeroupper();
+        const size_t i = b / aPixelBytes;
+        return i + FirstVisibleSSSE3(aRow + b, aPixels - i, aPixelBytes);
+    }
+
+    TRIM_TARGET("avx2")
+    static size_t LastVisibleAVX2(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes)
+    {
+        uint8_t mask[16];
+        AlphaBytes(mask, aPixelBytes);
+        const __m256i alphaMask = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask)));
+        const size_t bytes = aPixels * aPixelBytes;
+
+        size_t b = bytes & ~static_cast<size_t>(31);
+        const size_t i = b / aPixelBytes;
+        if (const size_t last = LastVisibleSSSE3(aRow + b, aPixels - i, aPixelBytes))
+            {
+            _mm256_zeroupper();
+            return i + last;
+            }
+        while (b > 0)
+            {
+            b -= 32;
+            if (const uint32_t bits = VisibleBitsAVX2(aRow + b, alphaMask))
+                {
+                _mm256_zeroupper();
+                return (b + HighestBit(bits)) / aPixelBytes + 1;
+                }
+            }
+        _mm256_zeroupper();
+        return 0;
+    }
+#endif    // TRIM_X86
+
+
+    //==============================================================================
+    // Kernel Table, Narrowest Instruction Set First
+    //==============================================================================
+    static const Kernels kKernels[] =
+    {
+        { Isa::Scalar, "scalar", FirstVisibleScalar, LastVisibleScalar },
+#if defined(TRIM_X86)
+        { Isa::SSSE3, "ssse3", FirstVisibleSSSE3, LastVisibleSSSE3 },
+        { Isa::AVX2, "avx2", FirstVisibleAVX2, LastVisibleAVX2 },
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    //==============================================================================
+    const Kernels* ForIsa(Isa aIsa)
+    {
+        return blitkernels::FindForIsa(kKernels, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    //==============================================================================
+    const Kernels& Active()
+    {
+        static const Kernels& active = blitkernels::SelectForIsa(kKernels);
+        return active;
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Visible Bounds Of A Palette Image, A Byte Per Pixel Looked Up
+    //!        In A Table Of Which Colors Are Visible
+    //==============================================================================
+    static Rect IndexedBounds(const Image& aImage)
+    {
+        bool visible[256];
+        for (int c = 0; c < 256; ++c)
+            visible[c] = (reinterpret_cast<const uint8_t*>(&aImage.palette[c])[3] != 0);
+
+        int left = aImage.width, right = 0, top = aImage.height, bottom = 0;
+        for (int y = 0; y < aImage.height; ++y)
+            {
+            const uint8_t* row = aImage.data + static_cast<size_t>(y) * aImage.width;
+            int first = 0;
+            while (first < aImage.width && !visible[row[first]])
+                ++first;
+            if (first == aImage.width)
+                continue;
+
+            int last = aImage.width;
+            while (!visible[row[last - 1]])
+                --last;
+            left = std::min(left, first);
+            right = std::max(right, last);
+            top = std::min(top, y);
+            bottom = y + 1;
+            }
+        return (right > 0) ? Rect(left, top, right - left, bottom - top) : Rect(0, 0, 0, 0);
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Smallest Rectangle Holding Every Visible Pixel Of An Image
+    //! @param aImage The Image; Without Alpha Every Pixel Is Visible
+    //! @return The Rectangle In Image Coordinates, 0 x 0 If Nothing Is Visible
+    //==============================================================================
+    Rect VisibleBounds(const Image& aImage)
+    {
+        if (aImage.palette)
+            return IndexedBounds(aImage);
+        if (aImage.channels != 2 && aImage.channels != 4)
+            return Rect(0, 0, aImage.width, aImage.height);
+
+        const Kernels& kernels = Active();
+        const size_t pixelBytes = static_cast<size_t>(aImage.channels) * aImage.bitDepth / 8;
+        const size_t width = static_cast<size_t>(aImage.width);
+        const size_t rowBytes = width * pixelBytes;
+        auto row = [&](int aY) { return aImage.data + static_cast<size_t>(aY) * rowBytes; };
+
+        // the top and bottom rows with anything visible, found from either end
+        int top = 0;
+        while (top < aImage.height && kernels.firstVisible(row(top), width, pixelBytes) == width)
+            ++top;
+        if (top == aImage.height)
+            return Rect(0, 0, 0, 0);
+        int bottom = aImage.height;
+        while (kernels.lastVisible(row(bottom - 1), width, pixelBytes) == 0)
+            --bottom;
+
+        // each row only needs scanning up to the left edge so far, and back to the right
+        size_t left = width, right = 0;
+        for (int y = top; y < bottom && (left > 0 || right < width); ++y)
+            {
+            left = std::min(left, kernels.firstVisible(row(y), left, pixelBytes));
+            if (right < width)
+                {
+                const size_t last = kernels.lastVisible(row(y) + right * pixelBytes, width - right, pixelBytes);
+                if (last)
+                    right += last;
+                }
+            }
+        return Rect(static_cast<int>(left), top, static_cast<int>(right - left), bottom - top);
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Visible Pixels Of Each Row
+    //! @param aImage The Image; Without Alpha Every Pixel Is Visible
+    //! @param aBounds 2 Per Row: The First Visible Pixel And One Past The Last, Both 0 If None Is
+    //==============================================================================
+    void RowBounds(const Image& aImage, int* aBounds)
+    {
+        if (aImage.palette)
+            {
+            bool visible[256];
+            for (int c = 0; c < 256; ++c)
+                visible[c] = (reinterpret_cast<const uint8_t*>(&aImage.palette[c])[3] != 0);
+
+            for (int y = 0; y < aImage.height; ++y, aBounds += 2)
+                {
+                const uint8_t* row = aImage.data + static_cast<size_t>(y) * aImage.width;
+                int first = 0, last = aImage.width;
+                while (first < last && !visible[row[first]])
+                    ++first;
+                while (last > first && !visible[row[last - 1]])
+                    --last;
+                aBounds[0] = (first < last) ? first : 0;
+                aBounds[1] = (first < last) ? last : 0;
+                }
+            return;
+            }
+
+        const bool hasAlpha = (aImage.channels == 2 || aImage.channels == 4);
+        const Kernels& kernels = Active();
+        const size_t pixelBytes = static_cast<size_t>(aImage.channels) * aImage.bitDepth / 8;
+        const size_t width = static_cast<size_t>(aImage.width);
+        for (int y = 0; y < aImage.height; ++y, aBounds += 2)
+            {
+            if (!hasAlpha)
+                {
+                aBounds[0] = 0;
+                aBounds[1] = aImage.width;
+                continue;
+                }
+
+            const uint8_t* row = aImage.data + static_cast<size_t>(y) * width * pixelBytes;
+            const size_t first = kernels.firstVisible(row, width, pixelBytes);
+            aBounds[0] = (first < width) ? static_cast<int>(first) : 0;
+            aBounds[1] = (first < width) ? static_cast<int>(kernels.lastVisible(row, width, pixelBytes)) : 0;
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Trim An Image To Its Visible Pixels In Place, Keeping Its Untrimmed Size
+    //!        And Where The Trimmed Rectangle Was In It; A Fully Transparent Image
+    //!        Is Trimmed To Its Top-Left Pixel
+    //! @param aImage The Image
+    //! @return True If The Image Got Smaller
+    //==============================================================================
+    bool Trim(Image& aImage)
+    {
+        Rect bounds = VisibleBounds(aImage);
+        if (bounds.width == 0)
+            bounds = Rect(0, 0, 1, 1);
+        if (bounds.width == aImage.width && bounds.height == aImage.height)
+            return false;
+
+        // rows move toward the start of the buffer, so compacting in order is safe
+        const size_t pixelBytes = aImage.palette ? 1 : static_cast<size_t>(aImage.channels) * aImage.bitDepth / 8;
+        const size_t srcRowBytes = static_cast<size_t>(aImage.width) * pixelBytes;
+        const size_t dstRowBytes = static_cast<size_t>(bounds.width) * pixelBytes;
+        for (int y = 0; y < bounds.height; ++y)
+            memmove(aImage.data + y * dstRowBytes,
+                    aImage.data + (bounds.y + y) * srcRowBytes + bounds.x * pixelBytes, dstRowBytes);
+
+        aImage.trimX += bounds.x;
+        aImage.trimY += bounds.y;
+        aImage.width = bounds.width;
+        aImage.height = bounds.height;
+        return true;
+    }
+}
+
+// End Of File
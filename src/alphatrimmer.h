@@ -0,0 +1,61 @@
+//==============================================================================
+// Name         : alphatrimmer.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The Kernels That Find The Fully Transparent Borders Of
+//                Images And Trim Them Off, With Runtime CPU Dispatch
+//==============================================================================
+
+#ifndef ALPHATRIMMER_H
+#define ALPHATRIMMER_H
+
+#include <cstddef>            // size_t
+#include <cstdint>            // uint8_t
+#include "blitkernels.h"      // blitkernels::Isa
+#include "image.h"            // Image
+#include "rect.h"             // Rect
+
+namespace alphatrimmer
+{
+    //! Span Kernel: Looks For Pixels Whose Alpha Is Not 0 In A Row Of aPixels Pixels
+    //! Of aPixelBytes Bytes, 2 For Gray-Alpha, 4 For RGBA, 8 For RGBA16, Alpha Last
+    typedef size_t (*SpanKernel)(const uint8_t* aRow, size_t aPixels, size_t aPixelBytes);
+
+    //! The Kernels Built For One Instruction Set Level
+    struct Kernels
+    {
+        blitkernels::Isa    isa;
+        const char*         name;
+        SpanKernel          firstVisible;    // the first visible pixel, aPixels if none is
+        SpanKernel          lastVisible;     // one past the last visible pixel, 0 if none is
+    };
+
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    const Kernels& Active();
+
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    const Kernels* ForIsa(blitkernels::Isa aIsa);
+
+    //! @brief Find The Smallest Rectangle Holding Every Visible Pixel Of An Image
+    //! @param aImage The Image; Without Alpha Every Pixel Is Visible
+    //! @return The Rectangle In Image Coordinates, 0 x 0 If Nothing Is Visible
+    Rect VisibleBounds(const Image& aImage);
+
+    //! @brief Find The Visible Pixels Of Each Row
+    //! @param aImage The Image; Without Alpha Every Pixel Is Visible
+    //! @param aBounds 2 Per Row: The First Visible Pixel And One Past The Last, Both 0 If None Is
+    void RowBounds(const Image& aImage, int* aBounds);
+
+    //! @brief Trim An Image To Its Visible Pixels In Place, Keeping Its Untrimmed Size
+    //!        And Where The Trimmed Rectangle Was In It; A Fully Transparent Image
+    //!        Is Trimmed To Its Top-Left Pixel
+    //! @param aImage The Image
+    //! @return True If The Image Got Smaller
+    bool Trim(Image& aImage);
+}
+
+#endif    // ALPHATRIMMER_H
+
+// End Of File
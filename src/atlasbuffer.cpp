@@ -0,0 +1,248 @@
+//==============================================================================
+// Name         : atlasbuffer.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements AtlasBuffer Class
+//==============================================================================
+
+#include "atlasbuffer.h"    // AtlasBuffer
+#include <stdexcept>        // std::runtime_error
+#include <limits>           // std::numeric_limits
+
+#if defined(_WIN32)
+    #include <windows.h>    // VirtualAlloc, GetLargePageMinimum, CreateFileMapping
+#else
+    #include <sys/mman.h>   // mmap, madvise, munmap
+    #include <sys/stat.h>   // S_IRUSR, S_IWUSR
+    #include <fcntl.h>      // open, fallocate, posix_fallocate
+    #include <unistd.h>     // close, ftruncate, unlink
+    #include <errno.h>      // errno
+    #include <string.h>     // strerror
+#endif
+
+
+//==============================================================================
+//! @brief Constructor, Allocates The Buffer
+//! @param aSize The Size In Bytes
+//! @param aHugePages Try To Back The Buffer With Huge Pages, Falls Back
+//!        To Normal Pages When The System Has None To Give
+//! @param aBackingFile If Not Empty, Map This Scratch File Instead Of Using RAM;
+//!        It Must Not Exist Yet; It Is Created, Pre-Sized And Removed Again
+//==============================================================================
+AtlasBuffer::AtlasBuffer(uint64_t aSize, bool aHugePages, const std::string& aBackingFile)
+    : iData(nullptr)
+    , iSize(static_cast<size_t>(aSize))
+    , iMappedSize(0)
+    , iBacking(Backing::Heap)
+    , iHugePages(false)
+    , iFileMapping(nullptr)
+{
+    // a 32-bit build can't address more than 4 GB, file-backed or not
+    if (aSize > std::numeric_limits<size_t>::max())
+        throw std::runtime_error("The texture atlas is too large for a 32-bit build!");
+
+    // freshly mapped pages are zero already, heap memory is left uninitialized
+    if (!aBackingFile.empty())
+        MapFile(aBackingFile);
+    else if (aHugePages && MapHugePages())
+        {
+        iBacking = Backing::Anonymous;
+        iHugePages = true;
+        }
+    else
+        iData = new uint8_t[iSize];
+}
+
+
+//==============================================================================
+//! @brief Move Constructor
+//! @param aOther The Buffer To Take Over, Left Empty
+//==============================================================================
+AtlasBuffer::AtlasBuffer(AtlasBuffer&& aOther)
+    : iData(aOther.iData)
+    , iSize(aOther.iSize)
+    , iMappedSize(aOther.iMappedSize)
+    , iBacking(aOther.iBacking)
+    , iHugePages(aOther.iHugePages)
+    , iFileMapping(aOther.iFileMapping)
+{
+    aOther.iData = nullptr;
+    aOther.iSize = 0;
+    aOther.iMappedSize = 0;
+    aOther.iBacking = Backing::Heap;
+    aOther.iHugePages = false;
+    aOther.iFileMapping = nullptr;
+}
+
+
+//==============================================================================
+//! @brief Destructor, Frees The Buffer
+//==============================================================================
+AtlasBuffer::~AtlasBuffer()
+{
+    if (iBacking == Backing::Heap)
+        delete[] iData;
+#if defined(_WIN32)
+    else if (iBacking == Backing::Anonymous)
+        VirtualFree(iData, 0, MEM_RELEASE);
+    else
+        {
+        UnmapViewOfFile(iData);
+        CloseHandle(static_cast<HANDLE>(iFileMapping));
+        }
+#else
+    else
+        munmap(iData, iMappedSize);
+#endif
+
+    iData = nullptr;
+}
+
+
+//==============================================================================
+//! @brief Try To Map iSize Bytes Backed By Huge Pages
+//! @return True On Success, iData/iMappedSize Are Set
+//==============================================================================
+bool AtlasBuffer::MapHugePages()
+{
+#if defined(_WIN32)
+    // large pages need the "Lock pages in memory" privilege, without it VirtualAlloc fails
+    const size_t largePage = GetLargePageMinimum();
+    if (largePage == 0)
+        return false;
+
+    const size_t size = (iSize + largePage - 1) / largePage * largePage;
+    void* data = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (!data)
+        return false;
+
+    iData = static_cast<uint8_t*>(data);
+    iMappedSize = size;
+    return true;
+#else
+    const size_t hugePage = 2 * 1024 * 1024;
+    const size_t size = (iSize + hugePage - 1) / hugePage * hugePage;
+
+    #if defined(MAP_HUGETLB)
+    // explicit huge pages, only there if the administrator reserved some
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED)
+        {
+        iData = static_cast<uint8_t*>(data);
+        iMappedSize = size;
+        return true;
+        }
+    #endif
+
+    #if defined(MADV_HUGEPAGE)
+    // transparent huge pages: map one extra huge page so the start can be aligned to it
+    void* area = mmap(nullptr, size + hugePage, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+        return false;
+
+    uint8_t* start = static_cast<uint8_t*>(area);
+    uint8_t* aligned = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(start) + hugePage - 1)
+                                                  & ~static_cast<uintptr_t>(hugePage - 1));
+    if (aligned != start)
+        munmap(start, aligned - start);
+    if (aligned + size != start + size + hugePage)
+        munmap(aligned + size, (start + size + hugePage) - (aligned + size));
+
+    if (madvise(aligned, size, MADV_HUGEPAGE) != 0)
+        {
+        munmap(aligned, size);
+        return false;
+        }
+
+    iData = aligned;
+    iMappedSize = size;
+    return true;
+    #else
+    return false;
+    #endif
+#endif
+}
+
+
+//==============================================================================
+//! @brief Map iSize Bytes Of A Scratch File, Throws If That Fails
+//! @param aPath The File Path
+//==============================================================================
+void AtlasBuffer::MapFile(const std::string& aPath)
+{
+#if defined(_WIN32)
+    // the file goes away with its last handle, the mapping keeps it alive until then;
+    // an existing file is never taken over, it would be deleted along with the scratch data
+    HANDLE file = CreateFileA(aPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        {
+        if (GetLastError() == ERROR_FILE_EXISTS)
+            throw std::runtime_error("The atlas file " + aPath + " already exists, give a path that doesn't!");
+        throw std::runtime_error("Could not create the atlas file " + aPath + "!");
+        }
+
+    // pre-size the file, so a full disk shows up here rather than half way through drawing
+    LARGE_INTEGER size;
+    size.QuadPart = static_cast<LONGLONG>(iSize);
+    if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+        {
+        CloseHandle(file);
+        throw std::runtime_error("Could not make the atlas file " + aPath + " large enough!");
+        }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        throw std::runtime_error("Could not map the atlas file " + aPath + "!");
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, iSize);
+    if (!data)
+        {
+        CloseHandle(mapping);
+        throw std::runtime_error("Could not map the atlas file " + aPath + "!");
+        }
+
+    iFileMapping = mapping;
+#else
+    // an existing file is never taken over, it would be truncated and unlinked below
+    const int file = open(aPath.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (file < 0 && errno == EEXIST)
+        throw std::runtime_error("The atlas file " + aPath + " already exists, give a path that doesn't!");
+    if (file < 0)
+        throw std::runtime_error("Could not create the atlas file " + aPath + ": " + strerror(errno));
+
+    // reserve the blocks up front, so a full disk shows up here instead of as a
+    // SIGBUS half way through drawing; fall back to a sparse file where unsupported
+    int error = 0;
+    #if defined(__linux__)
+    if (fallocate(file, 0, 0, static_cast<off_t>(iSize)) != 0)
+        error = errno;
+    #else
+    error = posix_fallocate(file, 0, static_cast<off_t>(iSize));
+    #endif
+    if (error == EOPNOTSUPP || error == ENOSYS || error == EINVAL)
+        error = (ftruncate(file, static_cast<off_t>(iSize)) == 0) ? 0 : errno;
+
+    void* data = MAP_FAILED;
+    if (error == 0)
+        {
+        data = mmap(nullptr, iSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED)
+            error = errno;
+        }
+
+    // the mapping keeps the file alive, unlinking now means nothing is left behind on a crash
+    close(file);
+    unlink(aPath.c_str());
+
+    if (error != 0)
+        throw std::runtime_error("Could not map the atlas file " + aPath + ": " + strerror(error));
+#endif
+
+    iData = static_cast<uint8_t*>(data);
+    iMappedSize = iSize;
+    iBacking = Backing::File;
+}
+
+// End Of File
@@ -0,0 +1,95 @@
+//==============================================================================
+// Name         : atlasbuffer.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares AtlasBuffer Class
+//==============================================================================
+
+#ifndef ATLASBUFFER_H
+#define ATLASBUFFER_H
+
+#include <string>     // std::string
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t, uint64_t
+
+
+//==============================================================================
+//! AtlasBuffer Class
+//! Owns The Memory The Texture Atlas Is Composed In: Heap Memory (Left
+//! Uninitialized, The Compositor Clears Only What No Image Covers), Huge
+//! Pages To Cut TLB Misses On Big Atlases, Or A Memory-Mapped Scratch File
+//! For Atlases Larger Than RAM
+//==============================================================================
+class AtlasBuffer
+{
+    public:
+    //! @brief Constructor, Allocates The Buffer
+    //! @param aSize The Size In Bytes
+    //! @param aHugePages Try To Back The Buffer With Huge Pages, Falls Back
+    //!        To Normal Pages When The System Has None To Give
+    //! @param aBackingFile If Not Empty, Map This Scratch File Instead Of Using RAM;
+    //!        It Must Not Exist Yet; It Is Created, Pre-Sized And Removed Again
+    AtlasBuffer(uint64_t aSize, bool aHugePages, const std::string& aBackingFile = std::string());
+
+    //! @brief Move Constructor
+    //! @param aOther The Buffer To Take Over, Left Empty
+    AtlasBuffer(AtlasBuffer&& aOther);
+
+    //! @brief Destructor, Frees The Buffer
+    ~AtlasBuffer();
+
+    //! @brief Get The First Byte Of The Buffer
+    uint8_t* Data() const
+    {
+        return iData;
+    };
+
+    //! @brief Get The Size In Bytes
+    size_t Size() const
+    {
+        return iSize;
+    };
+
+    //! @brief Whether Huge Pages Back The Buffer (Explicit Or Transparent)
+    bool HugePages() const
+    {
+        return iHugePages;
+    };
+
+    //! @brief Whether The Buffer Is Known To Be All Zero, As Fresh Mappings Are
+    bool Zeroed() const
+    {
+        return iBacking != Backing::Heap;
+    };
+
+    private:
+    //! Where The Buffer Memory Comes From
+    enum class Backing
+    {
+        Heap,
+        Anonymous,    // mapped pages, huge pages
+        File
+    };
+
+    AtlasBuffer(const AtlasBuffer&);
+    AtlasBuffer& operator=(const AtlasBuffer&);
+
+    //! @brief Try To Map iSize Bytes Backed By Huge Pages
+    //! @return True On Success, iData/iMappedSize Are Set
+    bool MapHugePages();
+
+    //! @brief Map iSize Bytes Of A Scratch File, Throws If That Fails
+    //! @param aPath The File Path
+    void MapFile(const std::string& aPath);
+
+    private:
+    uint8_t*    iData;
+    size_t      iSize;
+    size_t      iMappedSize;
+    Backing     iBacking;
+    bool        iHugePages;
+    void*       iFileMapping;    // Windows file mapping handle
+};
+
+#endif    // ATLASBUFFER_H
+
+// End Of File
@@ -13,7 +13,27 @@
 #include <functional>                  // std::greater
 #include <fstream>                     // std::ofstream
 #include <iostream>                    // std::cout
-#include "pngutilities.h"              // ReadPNG, WritePNG
+#include <memory>                      // std::unique_ptr
+#include <thread>                      // std::thread
+#include <mutex>                       // std::mutex
+#include <condition_variable>          // std::condition_variable
+#include <exception>                   // std::exception_ptr
+#include <atomic>                      // std::atomic
+#include <cmath>                       // std::sqrt, std::ceil
+#include <unordered_map>               // std::unordered_multimap
+#include <string.h>                    // memcmp
+#include "pngutilities.h"              // ReadPNG
+#include "pngdecoder.h"                // TryReadPNG
+#include "pngstreamwriter.h"           // PNGStreamWriter
+#include "palettestreamwriter.h"        // PaletteStreamWriter
+#include "imagestreamwriter.h"         // ImageStreamWriter
+#include "threadpool.h"                // ThreadPool
+#include "atlasbuffer.h"               // AtlasBuffer
+#include "compositor.h"                // Compositor
+#include "blitkernels.h"               // blitkernels::Active
+#include "alphatrimmer.h"              // alphatrimmer::Trim
+#include "imagehash.h"                 // imagehash::Hash
+#include "imageslicer.h"               // imageslicer::Cut
 #include "rapidjson/prettywriter.h"    // Prettywriter
 #include "rapidjson/stringbuffer.h"    // StringBuffe
 
@@ -21,10 +41,20 @@
 //==============================================================================
 //! @brief Constructor
 //! @param aImgList A List Of All The Image Files With Path
+//! @param aOptions The Settings From The Command Line
 //==============================================================================
-AtlasGenerator::AtlasGenerator(const std::vector<std::string> aImgList)
-    : iImgFileList(aImgList)
+AtlasGenerator::AtlasGenerator(const std::vector<std::string> aImgList, const AtlasOptions& aOptions)
+    : iOptions(aOptions)
     , iPackingAlgorithm(new BinaryTreeAlgorithm)
+    , iHullPacking(nullptr)
+    , iThreadPool(new ThreadPool(aOptions.threadCount))
+    , iImgFileList(aImgList)
+    , iChannels(channelreducer::Channels::RGBA)
+    , iBitDepth(8)
+    , iAtlasWidth(0)
+    , iAtlasHeight(0)
+    , iTextureWidth(0)
+    , iTextureHeight(0)
 {
 };
 
@@ -36,11 +66,18 @@ AtlasGenerator::~AtlasGenerator()
 {
     delete iPackingAlgorithm;
     iPackingAlgorithm = nullptr;
+    delete iHullPacking;
+    iHullPacking = nullptr;
+
+    delete iThreadPool;
+    iThreadPool = nullptr;
 
     for (auto img : iSortedImageList)
         {
         delete[] img.data;
         img.data = nullptr;
+        delete[] img.palette;
+        img.palette = nullptr;
         }
 };
 
@@ -50,20 +87,44 @@ AtlasGenerator::~AtlasGenerator()
 //==============================================================================
 void AtlasGenerator::Run()
 {
-    std::vector<uint8_t> atlas = Packing();
+    Packing();
+    ReduceChannels();
+
+    if (iOptions.composeMode == ComposeMode::Stream)
+        {
+        // the texture atlas is written while it is drawn, only the metadata is left
+        StreamImages();
+        OutputMetadata();
+        }
+    else
+        {
+        // create an empty texture atlas with the size the packer ended up with;
+        // size in 64 bits, as an int 4 * width * height overflows from 32768 x 16384 on
+        const uint64_t width = iAtlasWidth;
+        const uint64_t height = iAtlasHeight;
+        const uint64_t pixelBytes = channelreducer::ChannelCount(iChannels) * iBitDepth / 8;
+        AtlasBuffer atlas(pixelBytes * width * height, iOptions.hugePages, iOptions.atlasFile);
+
+        DrawImages(atlas);
 
-    // output texture atlas and metadata to files
-    Output(atlas);
+        // output texture atlas and metadata to files
+        Output(atlas);
+        }
 }
 
 
 //==============================================================================
 //! @brief Packing Images Onto The Texture Atlas, Also Collecting Metadata
 //==============================================================================
-std::vector<uint8_t> AtlasGenerator::Packing()
+void AtlasGenerator::Packing()
 {
     // sort images by their max side, max(width, height) in descendent order
     SortImages();
+    if (iOptions.packMode == PackMode::Hulls)
+        {
+        PackHulls();
+        return;
+        }
 
     // the initiate canvas dimension is set to the first image's dimension
     const int initialWidth = iSortedImageList[0].width;
@@ -83,17 +144,63 @@ std::vector<uint8_t> AtlasGenerator::Packing()
             node = iPackingAlgorithm->GrowAtlasCanvas(width, height, i);
         }
 
-    // create an empty texture atlas with the size indicated by the rootNode of the binary tree
-    int width = iPackingAlgorithm->rootNode()->width;
-    int height = iPackingAlgorithm->rootNode()->height;
+    // copy the positions of the tree Nodes to the images, ready for drawing
+    CollectPlacements();
+    iAtlasWidth = iPackingAlgorithm->rootNode()->width;
+    iAtlasHeight = iPackingAlgorithm->rootNode()->height;
+}
 
-    std::vector<uint8_t> atlasBuffer(4 * width * height);
-    const int atlasRowBytes = 4 * width;
 
-    // draw images to canvas accoring to their coorespending tree Nodes indicated
-    DrawImages(iPackingAlgorithm->rootNode(), atlasBuffer, atlasRowBytes);
+//==============================================================================
+//! @brief With --pack hulls, Build The Hull Of Every Image And Pack The Hulls
+//!        Instead Of The Rectangles
+//==============================================================================
+void AtlasGenerator::PackHulls()
+{
+    iHulls.resize(iSortedImageList.size());
+    iThreadPool->ParallelFor(iSortedImageList.size(), [&](size_t aImage)
+        {
+        iHulls[aImage] = HullPackingAlgorithm::BuildHull(iSortedImageList[aImage], iOptions.hullVertices);
+        });
+
+    // the atlas width would make the hulls about square with a little slack for the gaps,
+    // but no narrower than the widest image
+    uint64_t hullArea = 0, rectArea = 0, vertices = 0;
+    int widest = 1;
+    for (auto i = 0; i != iSortedImageList.size(); ++i)
+        {
+        const Image& img = iSortedImageList[i];
+        widest = std::max(widest, img.width);
+        rectArea += static_cast<uint64_t>(img.width) * img.height;
+        vertices += iHulls[i].vertices.size() / 2;
+        for (int y = 0; y < img.height; ++y)
+            hullArea += iHulls[i].spans[2 * y + 1] - iHulls[i].spans[2 * y];
+        }
+    const int width = std::max(widest, static_cast<int>(std::ceil(std::sqrt(1.1 * hullArea))));
 
-    return  atlasBuffer;
+    // placed in the sorted order, biggest first; each image only draws its spans
+    iHullPacking = new HullPackingAlgorithm(width);
+    for (auto i = 0; i != iSortedImageList.size(); ++i)
+        {
+        Image& img = iSortedImageList[i];
+        iHullPacking->Insert(iHulls[i].spans, img.width, img.height, img.x, img.y);
+        img.spans = iHulls[i].spans.data();
+        iAtlasWidth = std::max(iAtlasWidth, img.x + img.width);
+        iAtlasHeight = std::max(iAtlasHeight, img.y + img.height);
+        }
+
+    std::cout << "Hulls: " << vertices / std::max<size_t>(1, iSortedImageList.size())
+              << " vertices per image on average, " << (rectArea ? 100 * hullArea / rectArea : 0)
+              << "% of the rectangle area." << std::endl;
+}
+
+
+//==============================================================================
+//! @brief Get The Areas No Image Covers, From Whichever Packer Was Used
+//==============================================================================
+std::vector<Rect> AtlasGenerator::FreeRects() const
+{
+    return iHullPacking ? iHullPacking->FreeRects(iAtlasWidth, iAtlasHeight) : iPackingAlgorithm->FreeRects();
 }
 
 
@@ -103,17 +210,35 @@ std::vector<uint8_t> AtlasGenerator::Packing()
 //==============================================================================
 void AtlasGenerator::SortImages()
 {
+    // 16-bit images keep their precision when the output is a .png that can hold it
+    const bool keep16 = iOptions.outputFormat == OutputFormat::PNG && iOptions.paletteColors == 0;
     for (auto i = 0; i != iImgFileList.size(); ++i)
         {
         int width = 0, height = 0, channels = 0;
-        uint8_t* imgData = pngutilities::ReadPNG(iImgFileList[i].c_str(), width, height, channels);
-
+        uint8_t* imgData = nullptr;
+        uint32_t* palette = nullptr;
+        int bitDepth = 8;
+        if (iOptions.nativeDecoder)
+            imgData = pngdecoder::TryReadPNG(iImgFileList[i].c_str(), width, height, channels);
+        if (!imgData)    // not the common case, or libpng was picked
+            imgData = pngutilities::ReadPNG(iImgFileList[i].c_str(), width, height, channels, palette,
+                                            keep16 ? &bitDepth : nullptr);
+        iBitDepth = std::max(iBitDepth, bitDepth);
+
+        // named by the path below the image folder, so images of different subfolders stay apart
         std::string filePathName = iImgFileList[i].c_str();
-        int pos = filePathName.find_last_of('/');
-        std::string fileName = filePathName.substr(pos + 1, std::string::npos);
+        const std::string folder = iOptions.imageFolder + "/";
+        std::string fileName = (!iOptions.imageFolder.empty() && filePathName.compare(0, folder.size(), folder) == 0)
+                               ? filePathName.substr(folder.size())
+                               : filePathName.substr(filePathName.find_last_of('/') + 1);
 
-        iImageList.push_back(Image(fileName, width, height, imgData, channels));
+        iImageList.push_back(Image(fileName, width, height, imgData, channels, palette, bitDepth));
         }
+    if (iBitDepth == 16)
+        std::cout << "Bit depth: 16 bits per channel, 8 byte(s) per pixel." << std::endl;
+    SliceSheets();
+    DedupeImages();
+    TrimImages();
 
     std::vector<std::pair<int, int>> maxsideIndexList;  // pair<maxside, index>
     for (auto i = 0; i != iImageList.size(); ++i)
@@ -134,61 +259,445 @@ void AtlasGenerator::SortImages()
 
 
 //==============================================================================
-//! @brief Start From rootNood, Recursively Call Itself To Draw All Images
-//! @param aNode The Node In The Binary Tree
-//! @param aAtlasBuffer The Buffter For PNG Image Bytes Of The Texture Atlas
-//! @param aAtlasRowBytes The Row Bytes, libpng Draws Image Row by Row
+//! @brief With --sheets, Replace Every Image By The Sprites In Its Cells
 //==============================================================================
-void AtlasGenerator::DrawImages(Node* aNode, std::vector<uint8_t>&
-                                aAtlasBuffer, const int aAtlasRowBytes)
+void AtlasGenerator::SliceSheets()
 {
-    if (aNode)
+    if (iOptions.sheetMode == SheetMode::None)
+        return;
+
+    // each sheet was decoded once, its cells are cut in parallel into images of their own
+    std::vector<std::vector<Image>> sheetSprites(iImageList.size());
+    iThreadPool->ParallelFor(iImageList.size(), [&](size_t aSheet)
         {
-        if (aNode->imgID >= 0)
+        Image& sheet = iImageList[aSheet];
+        const std::vector<Rect> cells = (iOptions.sheetMode == SheetMode::Grid)
+            ? imageslicer::Grid(sheet.width, sheet.height, iOptions.cellWidth, iOptions.cellHeight)
+            : imageslicer::SeparatedCells(sheet);
+
+        // sprites are named after the sheet and their cell, row by row; empty grid cells are left out
+        for (auto i = 0; i != cells.size(); ++i)
             {
-            // add new image's info to metadata
-            iSortedImageList[aNode->imgID].x = aNode->x;
-            iSortedImageList[aNode->imgID].y = aNode->y;
+            Image sprite = imageslicer::Cut(sheet, cells[i], sheet.name + "#" + std::to_string(i));
+            if (iOptions.sheetMode == SheetMode::Grid && alphatrimmer::VisibleBounds(sprite).width == 0)
+                {
+                delete[] sprite.data;
+                delete[] sprite.palette;
+                }
+            else
+                sheetSprites[aSheet].push_back(sprite);
+            }
+        delete[] sheet.data;
+        delete[] sheet.palette;
+        });
+
+    std::vector<Image> sprites;
+    for (const std::vector<Image>& cells : sheetSprites)
+        sprites.insert(sprites.end(), cells.begin(), cells.end());
+    if (sprites.empty())
+        throw std::runtime_error("Every sheet cell is empty, there is nothing to pack!");
+
+    std::cout << "Sheets: " << sprites.size() << " sprites cut from " << iImageList.size() << " images."
+              << std::endl;
+    iImageList.swap(sprites);
+}
+
+
+//==============================================================================
+//! @brief With --dedupe, Keep Only One Of Each Set Of Identical Images, The
+//!        Others Become Its Aliases; With --dedupe tiles The Images Are Tiles
+//==============================================================================
+void AtlasGenerator::DedupeImages()
+{
+    if (iOptions.dedupe == DedupeMode::None)
+        return;
+    if (iOptions.dedupe == DedupeMode::Tiles)
+        SliceTiles();
+
+    // the decoded bytes are hashed in parallel, at memory speed with the SIMD kernels
+    std::vector<uint64_t> hashes(iImageList.size());
+    iThreadPool->ParallelFor(iImageList.size(), [&](size_t aImage)
+        {
+        const Image& img = iImageList[aImage];
+        const size_t bytes = static_cast<size_t>(img.width) * img.height * img.channels * (img.bitDepth / 8);
+        hashes[aImage] = imagehash::Hash(img.data, bytes);
+        });
+
+    // images with equal hashes are compared byte for byte, so a collision never aliases two images;
+    // the first of each set in file order is kept, so the output doesn't depend on the thread count
+    std::unordered_multimap<uint64_t, size_t> kept;    // hash, index in unique
+    std::vector<Image> unique;
+    std::vector<int> uniqueIndex(iImageList.size());    // per image, where it or its original is in unique
+    uint64_t area = 0, savedArea = 0;
+    for (auto i = 0; i != iImageList.size(); ++i)
+        {
+        Image& img = iImageList[i];
+        const size_t bytes = static_cast<size_t>(img.width) * img.height * img.channels * (img.bitDepth / 8);
+        area += static_cast<uint64_t>(img.width) * img.height;
 
-            int width = iSortedImageList[aNode->imgID].width;
-            int height = iSortedImageList[aNode->imgID].height;
-            int channels = iSortedImageList[aNode->imgID].channels;
-            uint8_t* imgData = iSortedImageList[aNode->imgID].data;
+        Image* original = nullptr;
+        auto range = kept.equal_range(hashes[i]);
+        for (auto iter = range.first; iter != range.second && !original; ++iter)
+            {
+            Image& other = unique[iter->second];
+            if (other.width == img.width && other.height == img.height && other.channels == img.channels
+                && other.bitDepth == img.bitDepth && !other.palette == !img.palette
+                && (!img.palette || memcmp(other.palette, img.palette, 256 * sizeof(uint32_t)) == 0)
+                && memcmp(other.data, img.data, bytes) == 0)
+                {
+                original = &other;
+                uniqueIndex[i] = static_cast<int>(iter->second);
+                }
+            }
 
-            const int srcRowBytes = width  * channels;
-            const int column_size = channels * width;
+        if (original)
+            {
+            // tiles have no names of their own, the tile maps point at the original instead
+            if (iOptions.dedupe == DedupeMode::Sprites)
+                original->aliases.push_back(img.name);
+            savedArea += static_cast<uint64_t>(img.width) * img.height;
+            delete[] img.data;
+            delete[] img.palette;
+            }
+        else
+            {
+            uniqueIndex[i] = static_cast<int>(unique.size());
+            kept.insert(std::make_pair(hashes[i], unique.size()));
+            unique.push_back(img);
+            }
+        }
 
-            uint8_t* dst = &aAtlasBuffer[4 * (aNode->y * iPackingAlgorithm->rootNode()->width + aNode->x)];
+    if (iOptions.dedupe == DedupeMode::Tiles)
+        {
+        // tiles are named by their id, the index the tile maps use
+        for (Tilemap& tilemap : iTilemaps)
+            for (int& tile : tilemap.tiles)
+                if (tile >= 0)
+                    tile = uniqueIndex[tile];
+        for (auto i = 0; i != unique.size(); ++i)
+            unique[i].name = "tile" + std::to_string(i);
+
+        std::cout << "Tiles: " << unique.size() << " distinct of " << iImageList.size() << " visible tiles in "
+                  << iTilemaps.size() << " images, " << (area ? 100 * savedArea / area : 0) << "% less area."
+                  << std::endl;
+        iImageList.swap(unique);
+        return;
+        }
 
-            if (channels == 4)
+    std::cout << "Duplicates: " << iImageList.size() - unique.size() << " of " << iImageList.size()
+              << " images packed as aliases, " << (area ? 100 * savedArea / area : 0) << "% less area." << std::endl;
+    iImageList.swap(unique);
+}
+
+
+//==============================================================================
+//! @brief With --dedupe tiles, Replace Every Image By Its Tiles, Leaving Out The
+//!        Fully Transparent Ones, And Record Where Each Tile Came From
+//==============================================================================
+void AtlasGenerator::SliceTiles()
+{
+    // images are cut in parallel, each into its own list of tiles
+    const int tileSize = iOptions.tileSize;
+    std::vector<std::vector<Image>> imageTiles(iImageList.size());
+    iTilemaps.resize(iImageList.size());
+    iThreadPool->ParallelFor(iImageList.size(), [&](size_t aImage)
+        {
+        Image& img = iImageList[aImage];
+        Tilemap& tilemap = iTilemaps[aImage];
+        tilemap.name = img.name;
+        tilemap.columns = (img.width + tileSize - 1) / tileSize;
+        tilemap.rows = (img.height + tileSize - 1) / tileSize;
+
+        // the last column and row of tiles are cut short where the image isn't a whole number of tiles
+        for (const Rect& cell : imageslicer::Grid(img.width, img.height, tileSize, tileSize))
+            {
+            Image tile = imageslicer::Cut(img, cell, img.name);
+            if (alphatrimmer::VisibleBounds(tile).width == 0)
+                {
+                delete[] tile.data;
+                delete[] tile.palette;
+                tilemap.tiles.push_back(-1);
+                }
+            else
                 {
-                for (int y = 0; y < height; y++)
+                tilemap.tiles.push_back(static_cast<int>(imageTiles[aImage].size()));
+                imageTiles[aImage].push_back(tile);
+                }
+            }
+        delete[] img.data;
+        delete[] img.palette;
+        });
+
+    // the tiles are numbered in image order, then row by row
+    std::vector<Image> tiles;
+    for (auto i = 0; i != imageTiles.size(); ++i)
+        {
+        for (int& tile : iTilemaps[i].tiles)
+            if (tile >= 0)
+                tile += static_cast<int>(tiles.size());
+        tiles.insert(tiles.end(), imageTiles[i].begin(), imageTiles[i].end());
+        }
+    if (tiles.empty())
+        throw std::runtime_error("Every tile is fully transparent, there is nothing to pack!");
+    iImageList.swap(tiles);
+}
+
+
+//==============================================================================
+//! @brief With --trim, Cut The Fully Transparent Borders Off Every Image So Only
+//!        The Visible Rectangle Is Packed
+//==============================================================================
+void AtlasGenerator::TrimImages()
+{
+    if (!iOptions.trim)
+        return;
+
+    std::atomic<size_t> trimmed(0);
+    iThreadPool->ParallelFor(iImageList.size(), [&](size_t aImage)
+        {
+        if (alphatrimmer::Trim(iImageList[aImage]))
+            ++trimmed;
+        });
+
+    uint64_t sourceArea = 0, area = 0;
+    for (const Image& img : iImageList)
+        {
+        sourceArea += static_cast<uint64_t>(img.sourceWidth) * img.sourceHeight;
+        area += static_cast<uint64_t>(img.width) * img.height;
+        }
+    std::cout << "Trimmed: " << trimmed.load() << " of " << iImageList.size() << " images, "
+              << (sourceArea ? 100 * (sourceArea - area) / sourceArea : 0) << "% less area." << std::endl;
+}
+
+
+//==============================================================================
+//! @brief With --channels auto, Scan Every Image For The Channels It Really Uses
+//!        And Narrow Them All To The Fewest That Hold Every One Exactly
+//==============================================================================
+void AtlasGenerator::ReduceChannels()
+{
+    // only a plain .png can store fewer channels; a 16-bit atlas stays RGBA
+    if (iOptions.channelMode != ChannelMode::Auto || iOptions.outputFormat != OutputFormat::PNG
+        || iOptions.paletteColors > 0 || iBitDepth == 16)
+        return;
+
+    // images are scanned in parallel until none of the flags is left true of them all
+    std::atomic<unsigned> flags(channelreducer::kOpaque | channelreducer::kGray | channelreducer::kWhite);
+    iThreadPool->ParallelFor(iSortedImageList.size(), [&](size_t aImage)
+        {
+        const Image& img = iSortedImageList[aImage];
+        const size_t pixelCount = static_cast<size_t>(img.width) * img.height;
+        if (flags.load())
+            flags.fetch_and(img.palette ? channelreducer::ScanIndexed(img.data, pixelCount, img.palette)
+                                        : channelreducer::Scan(img.data, pixelCount, img.channels));
+        });
+    iChannels = channelreducer::Narrowest(flags.load());
+
+    // the atlas is composed with the narrow pixels, narrower images stay as they are in an RGBA
+    // atlas; a gray image is the same bytes as a gray or alpha atlas needs, a mask being all 255
+    const int channels = channelreducer::ChannelCount(iChannels);
+    if (channels < 4)
+        iThreadPool->ParallelFor(iSortedImageList.size(), [&](size_t aImage)
+            {
+            Image& img = iSortedImageList[aImage];
+            if (img.channels == channels && !img.palette)
+                return;
+
+            const size_t pixelCount = static_cast<size_t>(img.width) * img.height;
+            uint8_t* narrow = new uint8_t[channels * pixelCount];
+            if (img.palette)
+                {
+                // palette images are looked up a row at a time, then narrowed from RGBA
+                const channelreducer::Selection selection = channelreducer::Select(4, iChannels);
+                std::vector<uint8_t> row(4 * static_cast<size_t>(img.width));
+                for (int y = 0; y < img.height; ++y)
                     {
-                    memcpy(dst, imgData, column_size);
-                    imgData += srcRowBytes;
-                    dst += aAtlasRowBytes;
+                    blitkernels::Active().expandIndexed(row.data(), img.data + y * static_cast<size_t>(img.width),
+                                                        img.width, img.palette);
+                    channelreducer::Active().narrow(narrow + y * static_cast<size_t>(channels) * img.width,
+                                                    row.data(), img.width, selection);
                     }
+                delete[] img.palette;
+                img.palette = nullptr;
                 }
-            else if (channels == 3)
+            else
+                channelreducer::Active().narrow(narrow, img.data, pixelCount,
+                                                channelreducer::Select(img.channels, iChannels));
+            delete[] img.data;
+            img.data = narrow;
+            img.channels = channels;
+            });
+
+    std::cout << "Channels: " << channelreducer::Name(iChannels) << ", " << channels
+              << " byte(s) per pixel." << std::endl;
+}
+
+
+//==============================================================================
+//! @brief Walk The Binary Tree Once And Copy Each Image's Position Into
+//!        iSortedImageList, Which Then Serves As The Flat Placement List
+//==============================================================================
+void AtlasGenerator::CollectPlacements()
+{
+    // an explicit stack instead of recursion, the tree gets as deep as there are images
+    std::vector<Node*> pending(1, iPackingAlgorithm->rootNode());
+
+    while (!pending.empty())
+        {
+        Node* node = pending.back();
+        pending.pop_back();
+        if (!node)
+            continue;
+
+        if (node->imgID >= 0)
+            {
+            // add new image's info to metadata
+            iSortedImageList[node->imgID].x = node->x;
+            iSortedImageList[node->imgID].y = node->y;
+            }
+
+        pending.push_back(node->downChild);
+        pending.push_back(node->rightChild);
+        }
+}
+
+
+//==============================================================================
+//! @brief Draw All Images From The Placement List, Split Across The Thread Pool
+//! @param aAtlasBuffer The Buffter For PNG Image Bytes Of The Texture Atlas
+//==============================================================================
+void AtlasGenerator::DrawImages(AtlasBuffer& aAtlasBuffer)
+{
+    // the buffer starts uninitialized unless freshly mapped: clear only what no image covers
+    std::vector<Rect> freeRects;
+    if (!aAtlasBuffer.Zeroed())
+        freeRects = FreeRects();
+
+    Compositor compositor(iSortedImageList, freeRects, iAtlasWidth, iAtlasHeight, 0,
+                          channelreducer::ChannelCount(iChannels), iBitDepth);
+
+    if (iOptions.composeMode == ComposeMode::Bands)
+        compositor.DrawBands(aAtlasBuffer.Data(), *iThreadPool);
+    else
+        compositor.DrawSprites(aAtlasBuffer.Data(), *iThreadPool);
+}
+
+
+//==============================================================================
+//! @brief Draw The Texture Atlas Band By Band Into A Small Ring Of Buffers And
+//!        Write Each Band To The .png File As Soon As It Is Done
+//==============================================================================
+void AtlasGenerator::StreamImages()
+{
+    const int width = iAtlasWidth;
+    const int height = iAtlasHeight;
+
+    // ring slots are reused without clearing, so the free rectangles are always drawn
+    Compositor compositor(iSortedImageList, FreeRects(), width, height, 0,
+                          channelreducer::ChannelCount(iChannels), iBitDepth);
+    const int bandCount = compositor.BandCount();
+    const size_t bandBytes = compositor.BandHeight() * compositor.RowBytes();
+
+    // one slot being compressed, one per thread being drawn
+    const int slotCount = std::min(bandCount, static_cast<int>(iThreadPool->ThreadCount()) + 1);
+    std::unique_ptr<uint8_t[]> ring(new uint8_t[slotCount * bandBytes]);
+
+    std::mutex mutex;
+    std::condition_variable bandDone;
+    int drawnBands = 0;      // bands drawn, band b lives in slot b % slotCount
+    int writtenBands = 0;    // bands compressed, their slots are free again
+    bool stop = false;
+    std::exception_ptr drawError;
+
+    // draw on a separate thread, handing all free slots to the thread pool at once
+    std::thread drawer([&]
+        {
+        try
+            {
+            for (int first = 0; first < bandCount;)
                 {
-                for (int y = 0; y < height; y++)
+                int count = 0;
+                    {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    bandDone.wait(lock, [&] { return stop || drawnBands - writtenBands < slotCount; });
+                    if (stop)
+                        return;
+                    count = std::min(slotCount - (drawnBands - writtenBands), bandCount - first);
+                    }
+
+                iThreadPool->ParallelFor(count, [&](size_t i)
+                    {
+                    const int band = first + static_cast<int>(i);
+                    compositor.DrawBand(band, ring.get() + (band % slotCount) * bandBytes, false);
+                    });
+                first += count;
+
                     {
-                    for (int xs = 0, xd = 0; xs < column_size; xs += 3, xd += 4)
-                        {
-                        dst[xd + 0] = imgData[xs + 0];
-                        dst[xd + 1] = imgData[xs + 1];
-                        dst[xd + 2] = imgData[xs + 2];
-                        dst[xd + 3] = 0xFF;
-                        }
-                    imgData += srcRowBytes;
-                    dst += aAtlasRowBytes;
+                    std::lock_guard<std::mutex> lock(mutex);
+                    drawnBands = first;
                     }
+                bandDone.notify_all();
                 }
             }
+        catch (...)
+            {
+                {
+                std::lock_guard<std::mutex> lock(mutex);
+                drawError = std::current_exception();
+                stop = true;
+                }
+            bandDone.notify_all();
+            }
+        });
 
-        DrawImages(aNode->rightChild, aAtlasBuffer, aAtlasRowBytes);
-        DrawImages(aNode->downChild, aAtlasBuffer, aAtlasRowBytes);
+    // compress on this thread, in band order
+    try
+        {
+        std::unique_ptr<ImageStreamWriter> writer =
+            ImageStreamWriter::Create(iOptions.outputFile.c_str(), width, height, *iThreadPool, iOptions,
+                                      channelreducer::ChannelCount(iChannels), iBitDepth);
+        iTextureWidth = width;
+        iTextureHeight = height;
+        writer->StoredSize(iTextureWidth, iTextureHeight);
+        for (int band = 0; band < bandCount; ++band)
+            {
+                {
+                std::unique_lock<std::mutex> lock(mutex);
+                bandDone.wait(lock, [&] { return stop || drawnBands > band; });
+                if (stop)
+                    break;
+                }
+
+            const int rows = std::min(compositor.BandHeight(), height - band * compositor.BandHeight());
+            writer->WriteRows(ring.get() + (band % slotCount) * bandBytes, rows, compositor.RowBytes());
+
+                {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++writtenBands;
+                }
+            bandDone.notify_all();
+            }
+
+        if (!drawError)
+            {
+            writer->Finish();
+            ReportCompression(*writer);
+            }
+        }
+    catch (...)
+        {
+            {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            }
+        bandDone.notify_all();
+        drawer.join();
+        throw;
         }
+
+    drawer.join();
+    if (drawError)
+        std::rethrow_exception(drawError);
 }
 
 
@@ -196,17 +705,54 @@ void AtlasGenerator::DrawImages(Node* aNode, std::vector<uint8_t>&
 //! @brief Output The Texture Atlas Image And Metadata To Files 
 //! @param aAtlasBuffer The Texture Atlas
 //==============================================================================
-void AtlasGenerator::Output(std::vector<uint8_t>& aAtlasBuffer)
+void AtlasGenerator::Output(AtlasBuffer& aAtlasBuffer)
 {
-    // save the texture atlas in .png format in the working directory
-    pngutilities::WritePNG("texture_atlas.png", iPackingAlgorithm->rootNode()->width,
-                           iPackingAlgorithm->rootNode()->height, &aAtlasBuffer[0]);
+    // save the texture atlas in the output format, in the working directory unless given a path
+    const int width = iAtlasWidth;
+    const int height = iAtlasHeight;
+    const int channels = channelreducer::ChannelCount(iChannels);
+    std::unique_ptr<ImageStreamWriter> writer =
+        ImageStreamWriter::Create(iOptions.outputFile.c_str(), width, height, *iThreadPool, iOptions,
+                                  channels, iBitDepth);
+    iTextureWidth = width;
+    iTextureHeight = height;
+    writer->StoredSize(iTextureWidth, iTextureHeight);
+    writer->WriteRows(aAtlasBuffer.Data(), height, channels * (iBitDepth / 8) * static_cast<size_t>(width));
+    writer->Finish();
+    ReportCompression(*writer);
 
     // save the metadata in .json format in the working directory
     OutputMetadata();
 }
 
 
+//==============================================================================
+//! @brief Print The Palette Of Indexed-Color Output And What The Exhaustive
+//!        Compression Search Saved Over The Default Preset
+//! @param aWriter The Finished Writer
+//==============================================================================
+void AtlasGenerator::ReportCompression(const ImageStreamWriter& aWriter) const
+{
+    const PNGStreamWriter* pngWriter = dynamic_cast<const PNGStreamWriter*>(&aWriter);
+    const PaletteStreamWriter* paletteWriter = dynamic_cast<const PaletteStreamWriter*>(&aWriter);
+    if (paletteWriter)
+        {
+        std::cout << "Indexed color: " << paletteWriter->Palette().colors << " palette colors, "
+                  << (paletteWriter->Palette().exact ? "exact" : "quantized") << "." << std::endl;
+        pngWriter = paletteWriter->Writer();
+        }
+    if (!pngWriter || iOptions.compression != CompressionPreset::Exhaustive)
+        return;
+
+    const PNGStreamWriter::SearchReport& report = pngWriter->Report();
+    const int64_t saved = static_cast<int64_t>(report.defaultIdatBytes) - static_cast<int64_t>(report.idatBytes);
+    std::cout << "Exhaustive compression: " << report.idatBytes << " bytes of image data, "
+              << saved << " bytes (" << (report.defaultIdatBytes ? 100.0 * saved / report.defaultIdatBytes : 0.0)
+              << "%) smaller than the default preset; " << report.searchedChunks << " of "
+              << report.chunks << " chunks searched within the time budget." << std::endl;
+}
+
+
 //==============================================================================
 // ! @brief Save The Metadata In .json Format In The Working Directory
 //==============================================================================
@@ -218,25 +764,111 @@ void AtlasGenerator::OutputMetadata() const
     writer.StartObject();
     writer.Key("Metadata");
 
-    if (iSortedImageList.size() >= 2)
+    // every alias gets an entry of its own, the same as the image it is identical to
+    size_t entries = 0;
+    for (const Image& img : iSortedImageList)
+        entries += 1 + img.aliases.size();
+
+    if (entries >= 2)
         writer.StartArray();
     for (const Image& img : iSortedImageList)
         {
-        writer.StartObject();
-        writer.Key("name");
-        writer.String(img.name.c_str());
-        writer.Key("x");
-        writer.Int(img.x);
-        writer.Key("y");
-        writer.Int(img.y);
-        writer.Key("width");
-        writer.Int(img.width);
-        writer.Key("height");
-        writer.Int(img.height);
-        writer.EndObject();
-        }
-    if (iSortedImageList.size() >= 2)
+        auto writeEntry = [&](const std::string& aName)
+            {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(aName.c_str());
+            if (&aName != &img.name)
+                {
+                // an identical image, drawn once at the same place
+                writer.Key("aliasOf");
+                writer.String(img.name.c_str());
+                }
+            writer.Key("x");
+            writer.Int(img.x);
+            writer.Key("y");
+            writer.Int(img.y);
+            writer.Key("width");
+            writer.Int(img.width);
+            writer.Key("height");
+            writer.Int(img.height);
+            if (iOptions.trim)
+                {
+                // where the packed rectangle sits in the untrimmed image
+                writer.Key("sourceWidth");
+                writer.Int(img.sourceWidth);
+                writer.Key("sourceHeight");
+                writer.Int(img.sourceHeight);
+                writer.Key("trimX");
+                writer.Int(img.trimX);
+                writer.Key("trimY");
+                writer.Int(img.trimY);
+                }
+            if (iHullPacking)
+                {
+                // the hull as a triangle fan: positions in the untrimmed image, uvs in the texture
+                // the output file stores, which .dds and .ktx2 pad to the pitch and block size
+                const std::vector<double>& vertices = iHulls[&img - &iSortedImageList[0]].vertices;
+                writer.Key("vertices");
+                writer.StartArray();
+                for (size_t v = 0; v < vertices.size(); v += 2)
+                    {
+                    writer.Double(vertices[v] + img.trimX);
+                    writer.Double(vertices[v + 1] + img.trimY);
+                    }
+                writer.EndArray();
+                writer.Key("uvs");
+                writer.StartArray();
+                for (size_t v = 0; v < vertices.size(); v += 2)
+                    {
+                    writer.Double((img.x + vertices[v]) / iTextureWidth);
+                    writer.Double((img.y + vertices[v + 1]) / iTextureHeight);
+                    }
+                writer.EndArray();
+                writer.Key("triangles");
+                writer.StartArray();
+                for (int v = 2; v < static_cast<int>(vertices.size() / 2); ++v)
+                    {
+                    writer.Int(0);
+                    writer.Int(v - 1);
+                    writer.Int(v);
+                    }
+                writer.EndArray();
+                }
+            writer.EndObject();
+            };
+        writeEntry(img.name);
+        for (const std::string& alias : img.aliases)
+            writeEntry(alias);
+        }
+    if (entries >= 2)
+        writer.EndArray();
+
+    if (!iTilemaps.empty())
+        {
+        // which tile entry of the metadata goes in each cell of each image, by the number in its name
+        writer.Key("Tilemaps");
+        writer.StartArray();
+        for (const Tilemap& tilemap : iTilemaps)
+            {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(tilemap.name.c_str());
+            writer.Key("tileSize");
+            writer.Int(iOptions.tileSize);
+            writer.Key("columns");
+            writer.Int(tilemap.columns);
+            writer.Key("rows");
+            writer.Int(tilemap.rows);
+            writer.Key("tiles");
+            writer.StartArray();
+            for (int tile : tilemap.tiles)
+                writer.Int(tile);
+            writer.EndArray();
+            writer.EndObject();
+            }
         writer.EndArray();
+        }
 
     writer.EndObject();
 
@@ -11,42 +11,25 @@
 #include <string>                   // std::string
 #include <cstdint>                  // uint8_t
 #include "binarytreealgorithm.h"    // BinaryTreeAlgorithm
+#include "hullpackingalgorithm.h"   // HullPackingAlgorithm, Hull
+#include "atlasoptions.h"           // AtlasOptions
+#include "image.h"                  // Image
+#include "channelreducer.h"         // channelreducer::Channels
+
+class ThreadPool;
+class AtlasBuffer;
+class ImageStreamWriter;
 
 
 //==============================================================================
-//! Image Struct For Each Image On The Texture Atlas
+//! Tilemap Struct, Which Packed Tile Goes In Each Cell Of An Image Cut Into Tiles
 //==============================================================================
-struct Image
+struct Tilemap
 {
-    //! @brief Constructor
-    //! @param aName The Image Name
-    //! @param aX The X Coordinate Of The Image Top-Left Point on Texture Atlas
-    //! @param aY The Y Coordinate Of The Image Top-Left Point on Texture Atlas
-    //! @param aWidth The Image Width
-    //! @param aHeight The Image Height
-    Image(std::string aName, int aX, int aY, int aWidth, int aHeight)
-        : name(aName), x(aX), y(aY), width(aWidth), height(aHeight), data(nullptr)
-    {
-    };
-
-    //! @brief Constructor
-    //! @param aName The Image Name
-    //! @param aWidth The Image Width
-    //! @param aHeight The Image Height
-    //! @param aData The png image bytes
-    //! @param aChannels The png image Channels
-    Image(std::string aName, int aWidth, int aHeight, uint8_t* aData, int aChannels)
-        : name(aName), width(aWidth), height(aHeight), data(aData), channels(aChannels)
-    {
-    };
-
-    std::string name;
-    int         x;
-    int         y;
-    int         width;
-    int         height;
-    uint8_t*    data;    // png image bytes
-    int         channels;
+    std::string         name;       // the image file name
+    int                 columns;
+    int                 rows;
+    std::vector<int>    tiles;      // per cell, row by row: the tile id, -1 where fully transparent
 };
 
 
@@ -58,7 +41,8 @@ class AtlasGenerator
     public:
     //! @brief Constructor
     //! @param aImgList A List Of All The Image Files With Path
-    AtlasGenerator(const std::vector<std::string> aImgList);
+    //! @param aOptions The Settings From The Command Line
+    AtlasGenerator(const std::vector<std::string> aImgList, const AtlasOptions& aOptions);
 
     //! @brief Destructor
     ~AtlasGenerator();
@@ -68,31 +52,80 @@ class AtlasGenerator
 
     private:
     //! @brief Packing Images Onto The Texture Atlas, Also Collecting Metadata
-    std::vector<uint8_t> Packing();
+    void Packing();
 
     //! @brief Sort Images By Their Max Side, Max(Width, Height) In Descendent Order
     //!        So The One Who Has Largest Side Get Packed First
     void SortImages();
 
-    //! @brief Start From rootNood, Recursively Call Itself To Draw All Images
-    //! @param aNode The Node In The Binary Tree
+    //! @brief With --sheets, Replace Every Image By The Sprites In Its Cells
+    void SliceSheets();
+
+    //! @brief With --dedupe, Keep Only One Of Each Set Of Identical Images, The
+    //!        Others Become Its Aliases; With --dedupe tiles The Images Are Tiles
+    void DedupeImages();
+
+    //! @brief With --dedupe tiles, Replace Every Image By Its Tiles, Leaving Out The
+    //!        Fully Transparent Ones, And Record Where Each Tile Came From
+    void SliceTiles();
+
+    //! @brief With --trim, Cut The Fully Transparent Borders Off Every Image So Only
+    //!        The Visible Rectangle Is Packed
+    void TrimImages();
+
+    //! @brief With --pack hulls, Build The Hull Of Every Image And Pack The Hulls
+    //!        Instead Of The Rectangles
+    void PackHulls();
+
+    //! @brief Get The Areas No Image Covers, From Whichever Packer Was Used
+    std::vector<Rect> FreeRects() const;
+
+    //! @brief With --channels auto, Scan Every Image For The Channels It Really Uses
+    //!        And Narrow Them All To The Fewest That Hold Every One Exactly
+    void ReduceChannels();
+
+    //! @brief Walk The Binary Tree Once And Copy Each Image's Position Into
+    //!        iSortedImageList, Which Then Serves As The Flat Placement List
+    void CollectPlacements();
+
+    //! @brief Draw All Images From The Placement List, Split Across The Thread Pool
+    //!        In The Compose Mode Picked On The Command Line
     //! @param aAtlasBuffer The Buffter For PNG Image Bytes Of The Texture Atlas
-    //! @param aAtlasRowBytes The Row Bytes, libpng Draws Image Row by Row
-    void DrawImages(Node* aNode, std::vector<uint8_t>&  aAtlasBuffer,
-                    const int aAtlasRowBytes);
+    void DrawImages(AtlasBuffer& aAtlasBuffer);
+
+    //! @brief Draw The Texture Atlas Band By Band Into A Small Ring Of Buffers And
+    //!        Write Each Band To The .png File As Soon As It Is Done, Drawing The
+    //!        Next Bands On The Thread Pool While The Current One Is Compressed
+    void StreamImages();
 
     //! @brief Output The Texture Atlas And Metadata To Files 
     //! @param aAtlasDataBuffer The Data (Raw Bytes) Of The Texture Atlas
-    void Output(std::vector<uint8_t>& aAtlasDataBuffer);
+    void Output(AtlasBuffer& aAtlasDataBuffer);
 
     // ! @brief Save The Metadata In .json Format In The Working Directory
     void OutputMetadata() const;
 
+    //! @brief Print The Palette Of Indexed-Color Output And What The Exhaustive
+    //!        Compression Search Saved Over The Default Preset
+    //! @param aWriter The Finished Writer
+    void ReportCompression(const ImageStreamWriter& aWriter) const;
+
     private:
+    AtlasOptions                iOptions;
     BinaryTreeAlgorithm*        iPackingAlgorithm;
+    HullPackingAlgorithm*       iHullPacking;    // nullptr unless packing hulls
+    std::vector<Hull>           iHulls;          // per sorted image, with --pack hulls
+    std::vector<Tilemap>        iTilemaps;       // per image file, with --dedupe tiles
+    ThreadPool*                 iThreadPool;
     std::vector<std::string>    iImgFileList;
     std::vector<Image>          iImageList;
     std::vector<Image>          iSortedImageList;
+    channelreducer::Channels    iChannels;    // what the texture atlas keeps
+    int                         iBitDepth;    // bits per atlas channel, 16 when any image has 16
+    int                         iAtlasWidth;
+    int                         iAtlasHeight;
+    int                         iTextureWidth;     // the atlas size the output file stores, with padding
+    int                         iTextureHeight;
 };
 
 #endif    // ATLASGENERATOR_H
@@ -0,0 +1,248 @@
+//==============================================================================
+// Name         : atlasoptions.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares AtlasOptions Struct
+//==============================================================================
+
+#ifndef ATLASOPTIONS_H
+#define ATLASOPTIONS_H
+
+#include <string>    // std::string
+
+
+//==============================================================================
+//! How The Images Are Drawn Onto The Texture Atlas
+//==============================================================================
+enum class ComposeMode
+{
+    Sprites,    // image by image, in packing order
+    Bands,      // horizontal bands of rows in memory order, non-temporal stores
+    Stream      // bands drawn into a small ring of buffers, each written to the .png once done
+};
+
+
+//==============================================================================
+//! How The Images Are Packed Onto The Texture Atlas
+//==============================================================================
+enum class PackMode
+{
+    Rects,    // their rectangles, with the binary tree packer
+    Hulls     // their convex hulls, rasterized, so rectangles may overlap where nothing is visible
+};
+
+
+//==============================================================================
+//! Whether And How The Input Images Are Cut Into Sprites
+//==============================================================================
+enum class SheetMode
+{
+    None,    // every image is a sprite
+    Grid,    // every image is a sheet of equal cells
+    Auto     // every image is a sheet of sprites set apart by rows and columns of background
+};
+
+
+//==============================================================================
+//! Which Repeated Pixels Are Packed Only Once
+//==============================================================================
+enum class DedupeMode
+{
+    None,       // every image is packed
+    Sprites,    // identical images are packed once, the others are aliases of it in the metadata
+    Tiles       // images are cut into tiles, identical tiles are packed once, each image gets a tile map
+};
+
+
+//==============================================================================
+//! How Hard The Texture Atlas .png Is Compressed
+//==============================================================================
+enum class CompressionPreset
+{
+    Store,      // no filtering, stored deflate blocks: biggest file, near-instant
+    Fast,       // per-row adaptive filters, fastest deflate level with run-length matching
+    Default,    // per-row adaptive filters, deflate level 6, as libpng writes by default
+    Max,        // per-row adaptive filters, deflate level 9
+    Exhaustive  // per chunk, the smallest of every filter choice with several deflate settings
+};
+
+
+//==============================================================================
+//! The File Format Of The Texture Atlas, Chosen By The Output File Extension
+//==============================================================================
+enum class OutputFormat
+{
+    PNG,    // .png, deflate compressed
+    QOI,    // .qoi, no entropy coding: larger, but encodes and decodes many times faster
+    DDS,    // .dds, uncompressed with mip levels, ready for upload
+    KTX2    // .ktx2, uncompressed with mip levels, ready for upload
+};
+
+
+//==============================================================================
+//! How .dds And .ktx2 Texels Are Stored; Desktop GPUs Sample BCn, Mobile Ones ETC2
+//==============================================================================
+enum class TextureFormat
+{
+    RGBA8,    // uncompressed, 4 bytes per pixel
+    BC1,      // 4x4 blocks in 8 bytes: RGB with 1-bit alpha
+    BC3,      // 4x4 blocks in 16 bytes: BC1 color with interpolated alpha
+    BC7,      // 4x4 blocks in 16 bytes: RGBA, the best quality of the three
+    ETC2RGB,  // 4x4 blocks in 8 bytes: ETC2 RGB, alpha dropped; .ktx2 only
+    ETC2RGBA, // 4x4 blocks in 16 bytes: EAC alpha and ETC2 RGB; .ktx2 only
+    RGBA4444, // 16 bits per pixel, 4 per channel
+    RGB565,   // 16 bits per pixel, alpha dropped
+    RGBA5551  // 16 bits per pixel, 1-bit alpha
+};
+
+
+//==============================================================================
+//! How The 16-bit Texture Formats Hide Their Banding
+//==============================================================================
+enum class DitherMode
+{
+    None,       // round each channel to nearest
+    Ordered,    // add a 4x4 Bayer pattern before rounding: stable, no artifacts spreading between sprites
+    Diffusion   // carry each pixel's rounding error to its neighbours, Floyd-Steinberg style: smoothest
+};
+
+
+//==============================================================================
+//! Which Channels The Texture Atlas .png Keeps
+//==============================================================================
+enum class ChannelMode
+{
+    RGBA,    // always all four
+    Auto     // the fewest that hold every input exactly: RGB, gray and alpha, gray, or an alpha mask
+};
+
+
+//==============================================================================
+//! How Hard Block-Compressed Textures Are Encoded
+//==============================================================================
+enum class EncodeQuality
+{
+    Fast,      // one endpoint fit per block
+    Normal,    // refined endpoints, a few candidate modes
+    High       // more modes, partitions and refinement
+};
+
+
+//==============================================================================
+//! AtlasOptions Struct
+//! The Settings Of One Run, Filled In From The Command Line
+//==============================================================================
+struct AtlasOptions
+{
+    //! @brief Constructor, Sets The Defaults
+    AtlasOptions()
+        : threadCount(0)
+        , recursive(false)
+        , composeMode(ComposeMode::Sprites)
+        , outputFile("texture_atlas.png")
+        , outputFormat(OutputFormat::PNG)
+        , mipLevels(0)
+        , bgra(false)
+        , pitchAlignment(0)
+        , textureFormat(TextureFormat::RGBA8)
+        , encodeQuality(EncodeQuality::Normal)
+        , dither(DitherMode::None)
+        , hugePages(false)
+        , compression(CompressionPreset::Default)
+        , timeBudget(0)
+        , paletteColors(0)
+        , channelMode(ChannelMode::RGBA)
+        , nativeDecoder(false)
+        , trim(false)
+        , packMode(PackMode::Rects)
+        , hullVertices(8)
+        , sheetMode(SheetMode::None)
+        , cellWidth(0)
+        , cellHeight(0)
+        , dedupe(DedupeMode::None)
+        , tileSize(16)
+    {
+    };
+
+    // threads used for compositing and compression, 0 means one per hardware thread
+    unsigned    threadCount;
+
+    // the folder the images are read from, image names in the metadata are relative to it
+    std::string imageFolder;
+
+    // read the images in the subfolders of the image folder too
+    bool        recursive;
+
+    // how the images are drawn onto the texture atlas
+    ComposeMode composeMode;
+
+    // the texture atlas file, written to the working directory unless it has a path
+    std::string outputFile;
+
+    // the texture atlas file format, from the output file extension
+    OutputFormat outputFormat;
+
+    // mip levels of .dds and .ktx2 output, 0 means the full chain down to 1x1
+    int         mipLevels;
+
+    // store .dds and .ktx2 output as BGRA8 instead of RGBA8
+    bool        bgra;
+
+    // pad .dds and .ktx2 output so level 0 rows are a multiple of this many bytes, 0 means no padding
+    unsigned    pitchAlignment;
+
+    // how .dds and .ktx2 texels are stored
+    TextureFormat textureFormat;
+
+    // how hard block-compressed texture formats are encoded
+    EncodeQuality encodeQuality;
+
+    // how the 16-bit texture formats are dithered
+    DitherMode  dither;
+
+    // back the texture atlas buffer with huge pages when the system has them
+    bool        hugePages;
+
+    // if not empty, compose the texture atlas in this memory-mapped scratch file
+    std::string atlasFile;
+
+    // how hard the texture atlas .png is compressed, .png output only
+    CompressionPreset compression;
+
+    // seconds the exhaustive compression preset may search for, 0 means no limit
+    double      timeBudget;
+
+    // write an indexed-color .png with at most this many palette colors, 0 means RGBA
+    int         paletteColors;
+
+    // which channels the texture atlas keeps, .png output only; fewer mean a smaller atlas buffer
+    ChannelMode channelMode;
+
+    // read the common 8-bit RGB/RGBA images with the in-tree decoder, libpng reads the rest
+    bool        nativeDecoder;
+
+    // pack images without their fully transparent borders, the metadata says where they were
+    bool        trim;
+
+    // what is packed, the rectangles or the hulls of the images
+    PackMode    packMode;
+
+    // the most vertices of each hull, the metadata mesh of each image
+    int         hullVertices;
+
+    // whether the input images are sheets, cut into sprites after they are decoded
+    SheetMode   sheetMode;
+
+    // the cell size of SheetMode::Grid
+    int         cellWidth;
+    int         cellHeight;
+
+    // which repeated pixels are packed only once
+    DedupeMode  dedupe;
+
+    // the width and height of the tiles images are cut into with --dedupe tiles
+    int         tileSize;
+};
+
+#endif    // ATLASOPTIONS_H
+
+// End Of File
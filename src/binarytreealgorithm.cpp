@@ -6,6 +6,7 @@
 
 #include "binarytreealgorithm.h"
 #include <iostream>                 // std::cout
+#include <vector>                   // std::vector
 
 
 //========================================================================================
@@ -163,4 +164,40 @@ Node*  BinaryTreeAlgorithm::GrowDown(int aImgWidth, int aImgHeight, const int aI
         return nullptr;
 }
 
+
+//========================================================================================
+//! @brief Get The Free (Unused) Rectangles Of The Canvas; Together With
+//!        The Placed Images They Cover The Whole Canvas Without Overlap
+//! @return The Free Rectangles, Empty Ones Left Out
+//========================================================================================
+std::vector<Rect> BinaryTreeAlgorithm::FreeRects() const
+{
+    std::vector<Rect> freeRects;
+
+    // every used node splits into its image, rightChild and downChild, and every
+    // grow adds a used root over the old canvas and the new strip, so the unused
+    // leaves are exactly what is left
+    std::vector<const Node*> pending(1, iRootNode);
+    while (!pending.empty())
+        {
+        const Node* node = pending.back();
+        pending.pop_back();
+        if (!node)
+            continue;
+
+        if (!node->isUsed)
+            {
+            if (node->width > 0 && node->height > 0)
+                freeRects.push_back(Rect(node->x, node->y, node->width, node->height));
+            }
+        else
+            {
+            pending.push_back(node->downChild);
+            pending.push_back(node->rightChild);
+            }
+        }
+
+    return freeRects;
+}
+
 // End Of File
\ No newline at end of file
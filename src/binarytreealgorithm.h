@@ -7,6 +7,9 @@
 #ifndef BINARYTREEALGORTHM_H
 #define BINARYTREEALGORTHM_H
 
+#include <vector>     // std::vector
+#include "rect.h"     // Rect
+
 
 //==============================================================================
 //! Node Struct
@@ -102,6 +105,11 @@ class BinaryTreeAlgorithm
     //! @return The Pointer To The Node That Stores The Newly Added Image
     Node*  GrowDown(int aWide, int aHeight, const int aImgID);
 
+    //! @brief Get The Free (Unused) Rectangles Of The Canvas; Together With
+    //!        The Placed Images They Cover The Whole Canvas Without Overlap
+    //! @return The Free Rectangles, Empty Ones Left Out
+    std::vector<Rect> FreeRects() const;
+
     //! @brief Get the rootNode
     Node*  rootNode()
     {
@@ -0,0 +1,804 @@
+//==============================================================================
+// Name         : blitkernels.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements Row Blit Kernels With Runtime CPU Dispatch
+//==============================================================================
+
+#include "blitkernels.h"    // RowKernel, Kernels
+#include <string.h>         // memcpy
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define BLIT_X86
+    #include <immintrin.h>          // SSSE3, AVX2, AVX-512 intrinsics
+    #if defined(_MSC_VER)
+        #include <intrin.h>         // __cpuidex, _xgetbv
+        #define BLIT_TARGET(aIsa)
+        #if _MSC_VER < 1910         // AVX-512 intrinsics need Visual Studio 2017
+            #define BLIT_NO_AVX512
+        #endif
+    #else
+        #include <cpuid.h>          // __cpuid_count
+        #define BLIT_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace blitkernels
+{
+    //==============================================================================
+    // Scalar Kernels, Used On Every CPU For The Row Tails Too
+    //==============================================================================
+    static void CopyRGBAScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        memcpy(aDst, aSrc, 4 * aPixels);
+    }
+
+    static void ExpandRGBScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aSrc += 3, aDst += 4)
+            {
+            aDst[0] = aSrc[0];
+            aDst[1] = aSrc[1];
+            aDst[2] = aSrc[2];
+            aDst[3] = 0xFF;
+            }
+    }
+
+    static void ExpandGrayScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        for (size_t i = 0; i < aPixels; ++i, ++aSrc, aDst += 4)
+            {
+            aDst[0] = aDst[1] = aDst[2] = aSrc[0];
+            aDst[3] = 0xFF;
+            }
+    }
+
+    static void ExpandGrayAlphaScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aSrc += 2, aDst += 4)
+            {
+            aDst[0] = aDst[1] = aDst[2] = aSrc[0];
+            aDst[3] = aSrc[1];
+            }
+    }
+
+    static void ExpandIndexedScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels, const uint32_t* aPalette)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aDst += 4)
+            memcpy(aDst, &aPalette[aSrc[i]], 4);
+    }
+
+    static void ExpandRGB16Scalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aSrc += 6, aDst += 8)
+            {
+            memcpy(aDst, aSrc, 6);
+            aDst[6] = aDst[7] = 0xFF;
+            }
+    }
+
+    //! A Byte Doubled Is Its 16-bit Value, x * 257, In Either Byte Order
+    static void WidenRGBAScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        for (size_t i = 0; i < 4 * aPixels; ++i, aDst += 2)
+            aDst[0] = aDst[1] = aSrc[i];
+    }
+
+    static void WidenRGBScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aSrc += 3, aDst += 8)
+            {
+            aDst[0] = aDst[1] = aSrc[0];
+            aDst[2] = aDst[3] = aSrc[1];
+            aDst[4] = aDst[5] = aSrc[2];
+            aDst[6] = aDst[7] = 0xFF;
+            }
+    }
+
+#if defined(BLIT_X86)
+    //! Block Kernel: Converts Whole Blocks Of Pixels, Returns How Many Pixels It Did
+    typedef size_t (*BlockKernel)(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels);
+
+    //==============================================================================
+    //! @brief Streaming (Non-Temporal) Row Kernel Built From A Block Kernel
+    //!        Regular Stores Up To The First Cache Line Boundary, Streaming Stores
+    //!        For The Whole Lines, Regular Stores Again For The Tail
+    //==============================================================================
+    template <BlockKernel kStreamBlocks, RowKernel kRegular, size_t kSrcBytes>
+    BLIT_TARGET("sse2")
+    static void StreamRow(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(aDst);
+        const size_t head = ((0 - address) & 63) / 4;
+        if ((address & 3) != 0 || head >= aPixels)
+            {
+            kRegular(aDst, aSrc, aPixels);
+            return;
+            }
+
+        kRegular(aDst, aSrc, head);
+        aDst += 4 * head;
+        aSrc += kSrcBytes * head;
+        aPixels -= head;
+
+        const size_t done = kStreamBlocks(aDst, aSrc, aPixels);
+        kRegular(aDst + 4 * done, aSrc + kSrcBytes * done, aPixels - done);
+
+        // streaming stores are weakly ordered, drain them before the row counts as drawn
+        _mm_sfence();
+    }
+
+
+    //==============================================================================
+    // SSSE3 Kernels, 16 Pixels Per Block
+    // pshufb Spreads 4 RGB Pixels (12 Bytes) Over 16 Bytes, Then Alpha Is Or-ed In
+    //==============================================================================
+    template <bool kStream>
+    BLIT_TARGET("ssse3")
+    static inline void Store128(uint8_t* aDst, __m128i aValue)
+    {
+        if (kStream)
+            _mm_stream_si128(reinterpret_cast<__m128i*>(aDst), aValue);
+        else
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDst), aValue);
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("ssse3")
+    static size_t CopyRGBABlocksSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = 0;
+        for (; i + 16 <= aPixels; i += 16, aSrc += 64, aDst += 64)
+            {
+            __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16));
+            __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 32));
+            __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 48));
+            Store128<kStream>(aDst, p0);
+            Store128<kStream>(aDst + 16, p1);
+            Store128<kStream>(aDst + 32, p2);
+            Store128<kStream>(aDst + 48, p3);
+            }
+        return i;
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("ssse3")
+    static size_t ExpandRGBBlocksSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        size_t i = 0;
+        for (; i + 16 <= aPixels; i += 16, aSrc += 48, aDst += 64)
+            {
+            __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16));
+            __m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 32));
+
+            // line up 4 pixels at the start of each register
+            __m128i p0 = s0;
+            __m128i p1 = _mm_alignr_epi8(s1, s0, 12);
+            __m128i p2 = _mm_alignr_epi8(s2, s1, 8);
+            __m128i p3 = _mm_srli_si128(s2, 4);
+
+            Store128<kStream>(aDst, _mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alpha));
+            Store128<kStream>(aDst + 16, _mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alpha));
+            Store128<kStream>(aDst + 32, _mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alpha));
+            Store128<kStream>(aDst + 48, _mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alpha));
+            }
+        return i;
+    }
+
+    //! pshufb Spreads Gray Bytes 4k..4k+3 Of The Source Over 16 Bytes
+    template <bool kStream>
+    BLIT_TARGET("ssse3")
+    static size_t ExpandGrayBlocksSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        size_t i = 0;
+        for (; i + 16 <= aPixels; i += 16, aSrc += 16, aDst += 64)
+            {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            Store128<kStream>(aDst, _mm_or_si128(_mm_shuffle_epi8(s, shuffle), alpha));
+            Store128<kStream>(aDst + 16, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(s, 4), shuffle), alpha));
+            Store128<kStream>(aDst + 32, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(s, 8), shuffle), alpha));
+            Store128<kStream>(aDst + 48, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(s, 12), shuffle), alpha));
+            }
+        return i;
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("ssse3")
+    static size_t ExpandGrayAlphaBlocksSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+
+        size_t i = 0;
+        for (; i + 16 <= aPixels; i += 16, aSrc += 32, aDst += 64)
+            {
+            __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16));
+            Store128<kStream>(aDst, _mm_shuffle_epi8(s0, shuffle));
+            Store128<kStream>(aDst + 16, _mm_shuffle_epi8(_mm_srli_si128(s0, 8), shuffle));
+            Store128<kStream>(aDst + 32, _mm_shuffle_epi8(s1, shuffle));
+            Store128<kStream>(aDst + 48, _mm_shuffle_epi8(_mm_srli_si128(s1, 8), shuffle));
+            }
+        return i;
+    }
+
+    //! 2 RGB16 Pixels Are 12 Bytes Like 4 RGB Ones, So The Source Is Lined Up The Same Way
+    BLIT_TARGET("ssse3")
+    static void ExpandRGB16SSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+        const __m128i alpha = _mm_set1_epi64x(static_cast<long long>(0xFFFF000000000000ull));
+
+        size_t i = 0;
+        for (; i + 8 <= aPixels; i += 8, aSrc += 48, aDst += 64)
+            {
+            __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16));
+            __m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 32));
+
+            __m128i p0 = s0;
+            __m128i p1 = _mm_alignr_epi8(s1, s0, 12);
+            __m128i p2 = _mm_alignr_epi8(s2, s1, 8);
+            __m128i p3 = _mm_srli_si128(s2, 4);
+
+            Store128<false>(aDst, _mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alpha));
+            Store128<false>(aDst + 16, _mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alpha));
+            Store128<false>(aDst + 32, _mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alpha));
+            Store128<false>(aDst + 48, _mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alpha));
+            }
+        ExpandRGB16Scalar(aDst, aSrc, aPixels - i);
+    }
+
+    //! Unpacking A Register With Itself Doubles Every Byte
+    BLIT_TARGET("ssse3")
+    static void WidenRGBASSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = 0;
+        for (; i + 8 <= aPixels; i += 8, aSrc += 32, aDst += 64)
+            {
+            __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16));
+            Store128<false>(aDst, _mm_unpacklo_epi8(s0, s0));
+            Store128<false>(aDst + 16, _mm_unpackhi_epi8(s0, s0));
+            Store128<false>(aDst + 32, _mm_unpacklo_epi8(s1, s1));
+            Store128<false>(aDst + 48, _mm_unpackhi_epi8(s1, s1));
+            }
+        WidenRGBAScalar(aDst, aSrc, aPixels - i);
+    }
+
+    BLIT_TARGET("ssse3")
+    static void WidenRGBSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        // 16 bytes are loaded for 12, so stop while 16 are left
+        size_t i = 0;
+        for (; 3 * i + 16 <= 3 * aPixels; i += 4, aSrc += 12, aDst += 32)
+            {
+            __m128i p = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc)),
+                                                      shuffle), alpha);
+            Store128<false>(aDst, _mm_unpacklo_epi8(p, p));
+            Store128<false>(aDst + 16, _mm_unpackhi_epi8(p, p));
+            }
+        WidenRGBScalar(aDst, aSrc, aPixels - i);
+    }
+
+    BLIT_TARGET("ssse3")
+    static void CopyRGBASSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = CopyRGBABlocksSSSE3<false>(aDst, aSrc, aPixels);
+        CopyRGBAScalar(aDst + 4 * done, aSrc + 4 * done, aPixels - done);
+    }
+
+    BLIT_TARGET("ssse3")
+    static void ExpandRGBSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = ExpandRGBBlocksSSSE3<false>(aDst, aSrc, aPixels);
+        ExpandRGBScalar(aDst + 4 * done, aSrc + 3 * done, aPixels - done);
+    }
+
+    BLIT_TARGET("ssse3")
+    static void ExpandGraySSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = ExpandGrayBlocksSSSE3<false>(aDst, aSrc, aPixels);
+        ExpandGrayScalar(aDst + 4 * done, aSrc + done, aPixels - done);
+    }
+
+    BLIT_TARGET("ssse3")
+    static void ExpandGrayAlphaSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = ExpandGrayAlphaBlocksSSSE3<false>(aDst, aSrc, aPixels);
+        ExpandGrayAlphaScalar(aDst + 4 * done, aSrc + 2 * done, aPixels - done);
+    }
+
+
+    //==============================================================================
+    // AVX2 Kernels, 32 Pixels Per Block
+    // vpshufb Works Within 128-bit Lanes, So Each Lane Is Loaded With 4 Pixels
+    //==============================================================================
+    template <bool kStream>
+    BLIT_TARGET("avx2")
+    static inline void Store256(uint8_t* aDst, __m256i aValue)
+    {
+        if (kStream)
+            _mm256_stream_si256(reinterpret_cast<__m256i*>(aDst), aValue);
+        else
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDst), aValue);
+    }
+
+    BLIT_TARGET("avx2")
+    static inline __m256i LoadRGBx8(const uint8_t* aSrc)
+    {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 12));
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("avx2")
+    static size_t CopyRGBABlocksAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = 0;
+        for (; i + 32 <= aPixels; i += 32, aSrc += 128, aDst += 128)
+            {
+            __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc));
+            __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 32));
+            __m256i p2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 64));
+            __m256i p3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 96));
+            Store256<kStream>(aDst, p0);
+            Store256<kStream>(aDst + 32, p1);
+            Store256<kStream>(aDst + 64, p2);
+            Store256<kStream>(aDst + 96, p3);
+            }
+        // the caller's tail may run legacy SSE code, avoid the AVX to SSE transition penalty
+        _mm256_zeroupper();
+        return i;
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("avx2")
+    static size_t ExpandRGBBlocksAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+        // the last lane load reads 4 bytes past the 32 pixels, keep it inside the row
+        size_t i = 0;
+        for (; i + 34 <= aPixels; i += 32, aSrc += 96, aDst += 128)
+            {
+            __m256i p0 = LoadRGBx8(aSrc);
+            __m256i p1 = LoadRGBx8(aSrc + 24);
+            __m256i p2 = LoadRGBx8(aSrc + 48);
+            __m256i p3 = LoadRGBx8(aSrc + 72);
+
+            Store256<kStream>(aDst, _mm256_or_si256(_mm256_shuffle_epi8(p0, shuffle), alpha));
+            Store256<kStream>(aDst + 32, _mm256_or_si256(_mm256_shuffle_epi8(p1, shuffle), alpha));
+            Store256<kStream>(aDst + 64, _mm256_or_si256(_mm256_shuffle_epi8(p2, shuffle), alpha));
+            Store256<kStream>(aDst + 96, _mm256_or_si256(_mm256_shuffle_epi8(p3, shuffle), alpha));
+            }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    //! Both Lanes Hold The Same 16 Source Bytes, The Upper Lane's Shuffle Picks The Next Pixels
+    template <bool kStream>
+    BLIT_TARGET("avx2")
+    static size_t ExpandGrayBlocksAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m256i shuffle0 = _mm256_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1,
+                                                  4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1);
+        const __m256i shuffle1 = _mm256_add_epi8(shuffle0, _mm256_set1_epi32(0x00080808));
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+        size_t i = 0;
+        for (; i + 32 <= aPixels; i += 32, aSrc += 32, aDst += 128)
+            {
+            __m256i s0 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc)));
+            __m256i s1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16)));
+            Store256<kStream>(aDst, _mm256_or_si256(_mm256_shuffle_epi8(s0, shuffle0), alpha));
+            Store256<kStream>(aDst + 32, _mm256_or_si256(_mm256_shuffle_epi8(s0, shuffle1), alpha));
+            Store256<kStream>(aDst + 64, _mm256_or_si256(_mm256_shuffle_epi8(s1, shuffle0), alpha));
+            Store256<kStream>(aDst + 96, _mm256_or_si256(_mm256_shuffle_epi8(s1, shuffle1), alpha));
+            }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("avx2")
+    static size_t ExpandGrayAlphaBlocksAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7,
+                                                 8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+
+        size_t i = 0;
+        for (; i + 32 <= aPixels; i += 32, aSrc += 64, aDst += 128)
+            {
+            __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc));
+            __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aSrc + 32));
+
+            // each lane gets 4 pixels, in the half its shuffle reads
+            __m256i p0 = _mm256_permute4x64_epi64(s0, 0x50);
+            __m256i p1 = _mm256_permute4x64_epi64(s0, 0xFA);
+            __m256i p2 = _mm256_permute4x64_epi64(s1, 0x50);
+            __m256i p3 = _mm256_permute4x64_epi64(s1, 0xFA);
+            Store256<kStream>(aDst, _mm256_shuffle_epi8(p0, shuffle));
+            Store256<kStream>(aDst + 32, _mm256_shuffle_epi8(p1, shuffle));
+            Store256<kStream>(aDst + 64, _mm256_shuffle_epi8(p2, shuffle));
+            Store256<kStream>(aDst + 96, _mm256_shuffle_epi8(p3, shuffle));
+            }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    BLIT_TARGET("avx2")
+    static void CopyRGBAAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = CopyRGBABlocksAVX2<false>(aDst, aSrc, aPixels);
+        CopyRGBASSSE3(aDst + 4 * done, aSrc + 4 * done, aPixels - done);
+    }
+
+    BLIT_TARGET("avx2")
+    static void ExpandRGBAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = ExpandRGBBlocksAVX2<false>(aDst, aSrc, aPixels);
+        ExpandRGBSSSE3(aDst + 4 * done, aSrc + 3 * done, aPixels - done);
+    }
+
+    BLIT_TARGET("avx2")
+    static void ExpandGrayAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = ExpandGrayBlocksAVX2<false>(aDst, aSrc, aPixels);
+        ExpandGraySSSE3(aDst + 4 * done, aSrc + done, aPixels - done);
+    }
+
+    BLIT_TARGET("avx2")
+    static void ExpandGrayAlphaAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const size_t done = ExpandGrayAlphaBlocksAVX2<false>(aDst, aSrc, aPixels);
+        ExpandGrayAlphaSSSE3(aDst + 4 * done, aSrc + 2 * done, aPixels - done);
+    }
+
+    //! Each Lane Is Loaded With 2 RGB16 Pixels, As LoadRGBx8 Does With 4 RGB Ones
+    BLIT_TARGET("avx2")
+    static void ExpandRGB16AVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1,
+                                                 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+        const __m256i alpha = _mm256_set1_epi64x(static_cast<long long>(0xFFFF000000000000ull));
+
+        // the last lane load reads 4 bytes past the 16 pixels, keep it inside the row
+        size_t i = 0;
+        for (; i + 17 <= aPixels; i += 16, aSrc += 96, aDst += 128)
+            {
+            __m256i p0 = LoadRGBx8(aSrc);
+            __m256i p1 = LoadRGBx8(aSrc + 24);
+            __m256i p2 = LoadRGBx8(aSrc + 48);
+            __m256i p3 = LoadRGBx8(aSrc + 72);
+
+            Store256<false>(aDst, _mm256_or_si256(_mm256_shuffle_epi8(p0, shuffle), alpha));
+            Store256<false>(aDst + 32, _mm256_or_si256(_mm256_shuffle_epi8(p1, shuffle), alpha));
+            Store256<false>(aDst + 64, _mm256_or_si256(_mm256_shuffle_epi8(p2, shuffle), alpha));
+            Store256<false>(aDst + 96, _mm256_or_si256(_mm256_shuffle_epi8(p3, shuffle), alpha));
+            }
+        _mm256_zeroupper();
+        ExpandRGB16SSSE3(aDst, aSrc, aPixels - i);
+    }
+
+    //! vpmovzxbw Spreads 16 Bytes Over 16 Words, Then Each Byte Is Copied Into The High Half
+    BLIT_TARGET("avx2")
+    static inline __m256i Widen16(__m128i aBytes)
+    {
+        const __m256i words = _mm256_cvtepu8_epi16(aBytes);
+        return _mm256_or_si256(words, _mm256_slli_epi16(words, 8));
+    }
+
+    BLIT_TARGET("avx2")
+    static void WidenRGBAAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = 0;
+        for (; i + 16 <= aPixels; i += 16, aSrc += 64, aDst += 128)
+            {
+            Store256<false>(aDst, Widen16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc))));
+            Store256<false>(aDst + 32, Widen16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16))));
+            Store256<false>(aDst + 64, Widen16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 32))));
+            Store256<false>(aDst + 96, Widen16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 48))));
+            }
+        _mm256_zeroupper();
+        WidenRGBASSSE3(aDst, aSrc, aPixels - i);
+    }
+
+    BLIT_TARGET("avx2")
+    static void WidenRGBAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        size_t i = 0;
+        for (; i + 16 <= aPixels; i += 16, aSrc += 48, aDst += 128)
+            {
+            __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc));
+            __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 16));
+            __m128i s2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + 32));
+
+            __m128i p0 = s0;
+            __m128i p1 = _mm_alignr_epi8(s1, s0, 12);
+            __m128i p2 = _mm_alignr_epi8(s2, s1, 8);
+            __m128i p3 = _mm_srli_si128(s2, 4);
+
+            Store256<false>(aDst, Widen16(_mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alpha)));
+            Store256<false>(aDst + 32, Widen16(_mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alpha)));
+            Store256<false>(aDst + 64, Widen16(_mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alpha)));
+            Store256<false>(aDst + 96, Widen16(_mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alpha)));
+            }
+        _mm256_zeroupper();
+        WidenRGBSSSE3(aDst, aSrc, aPixels - i);
+    }
+
+    //! vpgatherdd Looks Up 8 Palette Colors At Once
+    BLIT_TARGET("avx2")
+    static void ExpandIndexedAVX2(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels, const uint32_t* aPalette)
+    {
+        const int* palette = reinterpret_cast<const int*>(aPalette);
+
+        size_t i = 0;
+        for (; i + 8 <= aPixels; i += 8, aDst += 32)
+            {
+            __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(aSrc + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDst), _mm256_i32gather_epi32(palette, indices, 4));
+            }
+        _mm256_zeroupper();
+        ExpandIndexedScalar(aDst, aSrc + i, aPixels - i, aPalette);
+    }
+
+
+#if !defined(BLIT_NO_AVX512)
+    //==============================================================================
+    // AVX-512 Kernels (F + BW), 16 Pixels Per Register
+    // Masked Loads And Stores Handle The Row Tails Without A Scalar Loop
+    //==============================================================================
+    template <bool kStream>
+    BLIT_TARGET("avx512f,avx512bw")
+    static inline void Store512(uint8_t* aDst, __m512i aValue)
+    {
+        if (kStream)
+            _mm512_stream_si512(reinterpret_cast<__m512i*>(aDst), aValue);
+        else
+            _mm512_storeu_si512(aDst, aValue);
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("avx512f,avx512bw")
+    static size_t CopyRGBABlocksAVX512(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = 0;
+        for (; i + 64 <= aPixels; i += 64, aSrc += 256, aDst += 256)
+            {
+            __m512i p0 = _mm512_loadu_si512(aSrc);
+            __m512i p1 = _mm512_loadu_si512(aSrc + 64);
+            __m512i p2 = _mm512_loadu_si512(aSrc + 128);
+            __m512i p3 = _mm512_loadu_si512(aSrc + 192);
+            Store512<kStream>(aDst, p0);
+            Store512<kStream>(aDst + 64, p1);
+            Store512<kStream>(aDst + 128, p2);
+            Store512<kStream>(aDst + 192, p3);
+            }
+        return i;
+    }
+
+    //! Moves Dwords 3k..3k+2 To The Start Of Lane k, Then vpshufb Spreads Them
+    BLIT_TARGET("avx512f,avx512bw")
+    static inline __m512i ExpandRGBx16(__m512i aSrc)
+    {
+        const __m512i permute = _mm512_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0, 6, 7, 8, 0, 9, 10, 11, 0);
+        const __m512i shuffle = _mm512_broadcast_i32x4(
+                                    _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+        const __m512i alpha = _mm512_set1_epi32(static_cast<int>(0xFF000000));
+
+        __m512i pixels = _mm512_shuffle_epi8(_mm512_permutexvar_epi32(permute, aSrc), shuffle);
+        return _mm512_or_si512(pixels, alpha);
+    }
+
+    template <bool kStream>
+    BLIT_TARGET("avx512f,avx512bw")
+    static size_t ExpandRGBBlocksAVX512(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = 0;
+        for (; i + 32 <= aPixels; i += 32, aSrc += 96, aDst += 128)
+            {
+            __m512i s0 = _mm512_maskz_loadu_epi8(0x0000FFFFFFFFFFFFull, aSrc);
+            __m512i s1 = _mm512_maskz_loadu_epi8(0x0000FFFFFFFFFFFFull, aSrc + 48);
+            Store512<kStream>(aDst, ExpandRGBx16(s0));
+            Store512<kStream>(aDst + 64, ExpandRGBx16(s1));
+            }
+        return i;
+    }
+
+    BLIT_TARGET("avx512f,avx512bw")
+    static void CopyRGBAAVX512(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = CopyRGBABlocksAVX512<false>(aDst, aSrc, aPixels);
+        aDst += 4 * i;
+        aSrc += 4 * i;
+        for (; i < aPixels; i += 16, aSrc += 64, aDst += 64)
+            {
+            const size_t count = (aPixels - i < 16) ? aPixels - i : 16;
+            const __mmask16 mask = static_cast<__mmask16>((1u << count) - 1);
+            _mm512_mask_storeu_epi32(aDst, mask, _mm512_maskz_loadu_epi32(mask, aSrc));
+            }
+    }
+
+    BLIT_TARGET("avx512f,avx512bw")
+    static void ExpandRGBAVX512(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels)
+    {
+        size_t i = ExpandRGBBlocksAVX512<false>(aDst, aSrc, aPixels);
+        aDst += 4 * i;
+        aSrc += 3 * i;
+        for (; i < aPixels; i += 16, aSrc += 48, aDst += 64)
+            {
+            const size_t count = (aPixels - i < 16) ? aPixels - i : 16;
+            const __mmask64 loadMask = (1ull << (3 * count)) - 1;
+            const __mmask16 storeMask = static_cast<__mmask16>((1u << count) - 1);
+            __m512i pixels = ExpandRGBx16(_mm512_maskz_loadu_epi8(loadMask, aSrc));
+            _mm512_mask_storeu_epi32(aDst, storeMask, pixels);
+            }
+    }
+#endif    // !BLIT_NO_AVX512
+
+
+    //==============================================================================
+    //! @brief Query CPUID
+    //! @param aLeaf The CPUID Leaf
+    //! @param aSubLeaf The CPUID Sub-Leaf
+    //! @param aRegs Receives EAX, EBX, ECX, EDX
+    //==============================================================================
+    static void CpuId(unsigned aLeaf, unsigned aSubLeaf, unsigned aRegs[4])
+    {
+#if defined(_MSC_VER)
+        int regs[4];
+        __cpuidex(regs, static_cast<int>(aLeaf), static_cast<int>(aSubLeaf));
+        for (int i = 0; i < 4; ++i)
+            aRegs[i] = static_cast<unsigned>(regs[i]);
+#else
+        __cpuid_count(aLeaf, aSubLeaf, aRegs[0], aRegs[1], aRegs[2], aRegs[3]);
+#endif
+    }
+
+    //==============================================================================
+    //! @brief Read XCR0, Which Tells Which Register States The OS Saves
+    //==============================================================================
+    static uint64_t ReadXCR0()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t eax = 0, edx = 0;
+        __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+#endif    // BLIT_X86
+
+
+    //==============================================================================
+    //! @brief Detect The Best Instruction Set Level Usable On This CPU And OS
+    //==============================================================================
+    static Isa DetectIsa()
+    {
+#if defined(BLIT_X86)
+        unsigned regs[4];
+        CpuId(0, 0, regs);
+        const unsigned maxLeaf = regs[0];
+        if (maxLeaf < 1)
+            return Isa::Scalar;
+
+        CpuId(1, 0, regs);
+        const bool ssse3 = (regs[2] & (1u << 9)) != 0;
+        const bool osxsave = (regs[2] & (1u << 27)) != 0;
+        const bool avx = (regs[2] & (1u << 28)) != 0;
+        if (!ssse3)
+            return Isa::Scalar;
+        if (!osxsave || !avx || maxLeaf < 7)
+            return Isa::SSSE3;
+
+        // the OS must save the YMM (and for AVX-512 the opmask and ZMM) registers
+        const uint64_t xcr0 = ReadXCR0();
+        if ((xcr0 & 0x06) != 0x06)
+            return Isa::SSSE3;
+
+        CpuId(7, 0, regs);
+        const bool avx2 = (regs[1] & (1u << 5)) != 0;
+        const bool avx512f = (regs[1] & (1u << 16)) != 0;
+        const bool avx512bw = (regs[1] & (1u << 30)) != 0;
+
+    #if !defined(BLIT_NO_AVX512)
+        if (avx2 && avx512f && avx512bw && (xcr0 & 0xE6) == 0xE6)
+            return Isa::AVX512;
+    #endif
+        return avx2 ? Isa::AVX2 : Isa::SSSE3;
+#else
+        return Isa::Scalar;
+#endif
+    }
+
+
+    //! The Kernel Table, One Entry Per Isa
+    static const Kernels kKernels[] =
+    {
+        { Isa::Scalar, "scalar", CopyRGBAScalar, ExpandRGBScalar, CopyRGBAScalar, ExpandRGBScalar,
+          ExpandGrayScalar, ExpandGrayAlphaScalar, ExpandGrayScalar, ExpandGrayAlphaScalar, ExpandIndexedScalar,
+          ExpandRGB16Scalar, WidenRGBAScalar, WidenRGBScalar },
+#if defined(BLIT_X86)
+        { Isa::SSSE3, "ssse3", CopyRGBASSSE3, ExpandRGBSSSE3,
+          StreamRow<CopyRGBABlocksSSSE3<true>, CopyRGBASSSE3, 4>,
+          StreamRow<ExpandRGBBlocksSSSE3<true>, ExpandRGBSSSE3, 3>,
+          ExpandGraySSSE3, ExpandGrayAlphaSSSE3,
+          StreamRow<ExpandGrayBlocksSSSE3<true>, ExpandGraySSSE3, 1>,
+          StreamRow<ExpandGrayAlphaBlocksSSSE3<true>, ExpandGrayAlphaSSSE3, 2>,
+          ExpandIndexedScalar, ExpandRGB16SSSE3, WidenRGBASSSE3, WidenRGBSSSE3 },
+        { Isa::AVX2, "avx2", CopyRGBAAVX2, ExpandRGBAVX2,
+          StreamRow<CopyRGBABlocksAVX2<true>, CopyRGBAAVX2, 4>,
+          StreamRow<ExpandRGBBlocksAVX2<true>, ExpandRGBAVX2, 3>,
+          ExpandGrayAVX2, ExpandGrayAlphaAVX2,
+          StreamRow<ExpandGrayBlocksAVX2<true>, ExpandGrayAVX2, 1>,
+          StreamRow<ExpandGrayAlphaBlocksAVX2<true>, ExpandGrayAlphaAVX2, 2>,
+          ExpandIndexedAVX2, ExpandRGB16AVX2, WidenRGBAAVX2, WidenRGBAVX2 },
+    #if !defined(BLIT_NO_AVX512)
+        // the narrow and 16-bit sources are bound by the stores already, they keep the AVX2 kernels
+        { Isa::AVX512, "avx512", CopyRGBAAVX512, ExpandRGBAVX512,
+          StreamRow<CopyRGBABlocksAVX512<true>, CopyRGBAAVX512, 4>,
+          StreamRow<ExpandRGBBlocksAVX512<true>, ExpandRGBAVX512, 3>,
+          ExpandGrayAVX2, ExpandGrayAlphaAVX2,
+          StreamRow<ExpandGrayBlocksAVX2<true>, ExpandGrayAVX2, 1>,
+          StreamRow<ExpandGrayAlphaBlocksAVX2<true>, ExpandGrayAlphaAVX2, 2>,
+          ExpandIndexedAVX2, ExpandRGB16AVX2, WidenRGBAAVX2, WidenRGBAVX2 },
+    #endif
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Does Not Support aIsa
+    //==============================================================================
+    const Kernels* ForIsa(Isa aIsa)
+    {
+        return FindForIsa(kKernels, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Best Instruction Set Level This CPU And OS Support,
+    //!        CPUID Is Queried Once, On The First Call
+    //! @return The Level
+    //==============================================================================
+    Isa DetectedIsa()
+    {
+        static const Isa detected = DetectIsa();
+        return detected;
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports,
+    //!        CPUID Is Queried Once, On The First Call
+    //! @return The Selected Kernels
+    //==============================================================================
+    const Kernels& Active()
+    {
+        static const Kernels& active = SelectForIsa(kKernels);
+        return active;
+    }
+}
+
+// End Of File
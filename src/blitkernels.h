@@ -0,0 +1,98 @@
+//==============================================================================
+// Name         : blitkernels.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares Row Blit Kernels With Runtime CPU Dispatch
+//==============================================================================
+
+#ifndef BLITKERNELS_H
+#define BLITKERNELS_H
+
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t
+
+namespace blitkernels
+{
+    //! Instruction Set Levels The Kernels Are Specialised For
+    enum class Isa
+    {
+        Scalar,
+        SSSE3,
+        AVX2,
+        AVX512
+    };
+
+    //! Row Kernel: Writes aPixels RGBA Pixels To aDst, Reading From aSrc; 16-bit Samples
+    //! Are Big-Endian, As A .png Stores Them
+    typedef void (*RowKernel)(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels);
+
+    //! Palette Kernel: Writes aPixels RGBA Pixels To aDst, Looking aSrc's Index Bytes Up In
+    //! aPalette, 256 RGBA Colors
+    typedef void (*PaletteKernel)(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels, const uint32_t* aPalette);
+
+    //! A Set Of Row Kernels Built For One Instruction Set Level
+    struct Kernels
+    {
+        Isa             isa;
+        const char*     name;
+        RowKernel       copyRGBA;                 // RGBA -> RGBA, a wide copy
+        RowKernel       expandRGB;                // RGB -> RGBA, alpha filled with 0xFF
+        RowKernel       copyRGBAStream;           // as copyRGBA, with non-temporal stores
+        RowKernel       expandRGBStream;          // as expandRGB, with non-temporal stores
+        RowKernel       expandGray;               // gray -> RGBA, alpha filled with 0xFF
+        RowKernel       expandGrayAlpha;          // gray-alpha -> RGBA
+        RowKernel       expandGrayStream;         // as expandGray, with non-temporal stores
+        RowKernel       expandGrayAlphaStream;    // as expandGrayAlpha, with non-temporal stores
+        PaletteKernel   expandIndexed;            // palette indices -> RGBA
+        RowKernel       expandRGB16;              // RGB16 -> RGBA16, alpha filled with 0xFFFF
+        RowKernel       widenRGBA;                // RGBA -> RGBA16, each byte doubled, x * 257
+        RowKernel       widenRGB;                 // RGB -> RGBA16, alpha filled with 0xFFFF
+    };
+
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports,
+    //!        CPUID Is Queried Once, On The First Call
+    //! @return The Selected Kernels
+    const Kernels& Active();
+
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Does Not Support aIsa
+    const Kernels* ForIsa(Isa aIsa);
+
+    //! @brief Get The Best Instruction Set Level This CPU And OS Support,
+    //!        CPUID Is Queried Once, On The First Call
+    //! @return The Level
+    Isa DetectedIsa();
+
+    //! @brief Find The Entry For An Instruction Set Level In A Kernel Table; Every
+    //!        Module's Table Has One Entry Per Isa It Was Built For, Each With An isa Member
+    //! @param aTable The Table, Narrowest Isa First
+    //! @param aIsa The Instruction Set Level
+    //! @return The Entry, Or nullptr If This CPU Does Not Support aIsa Or The Table Has None For It
+    template <typename Entry, size_t Count>
+    const Entry* FindForIsa(const Entry (&aTable)[Count], Isa aIsa)
+    {
+        if (aIsa > DetectedIsa())
+            return nullptr;
+
+        for (const Entry& entry : aTable)
+            if (entry.isa == aIsa)
+                return &entry;
+        return nullptr;
+    }
+
+    //! @brief Pick The Widest Entry Of A Kernel Table That This CPU Supports
+    //! @param aTable The Table, Narrowest Isa First, The First Entry Scalar
+    //! @return The Entry
+    template <typename Entry, size_t Count>
+    const Entry& SelectForIsa(const Entry (&aTable)[Count])
+    {
+        for (size_t i = Count; i-- > 0;)
+            if (const Entry* entry = FindForIsa(aTable, aTable[i].isa))
+                return *entry;
+        return aTable[0];
+    }
+}
+
+#endif    // BLITKERNELS_H
+
+// End Of File
@@ -0,0 +1,1093 @@
+//==============================================================================
+// Name         : blockencoder.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The BC1, BC3 And BC7 Block Encoders
+//==============================================================================
+
+#include "blockencoder.h"    // EncodeBC1, EncodeBC3, EncodeBC7
+#include <algorithm>         // std::min, std::max, std::swap, std::sort, std::copy
+#include <cmath>             // std::sqrt, std::abs
+#include <cstdlib>           // std::abs
+#include <string.h>          // memcpy, memset
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define BLOCK_X86
+    #include <immintrin.h>          // SSSE3, AVX2 intrinsics
+    #if defined(_MSC_VER)
+        #define BLOCK_TARGET(aIsa)
+    #else
+        #define BLOCK_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace blockencoder
+{
+    using blitkernels::Isa;
+
+    //! BC7 Two-Subset Partitions, Bit i Set When Pixel i Belongs To Subset 1
+    static const uint16_t kPartitions2[64] =
+    {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+        0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+        0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+        0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+        0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+    };
+
+    //! BC7 Anchor Pixel Of Subset 1 Per Two-Subset Partition, Its Index Loses The Top Bit
+    static const uint8_t kAnchors2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+    };
+
+    //! BC7 Interpolation Weights Out Of 64, For 2, 3 And 4-Bit Indices
+    static const uint8_t kWeights2[4] = {0, 21, 43, 64};
+    static const uint8_t kWeights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    static const uint8_t kWeights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    //! How A BC7 Mode Stores P-Bits, The Shared Lowest Bit Of Every Endpoint Channel
+    enum PBits
+    {
+        kPBitNone,           // modes 4 and 5
+        kPBitPerEndpoint,    // mode 6: one per endpoint
+        kPBitShared          // mode 1: one per subset
+    };
+
+
+    //==============================================================================
+    //! @brief Find The Nearest Palette Color Of Each Pixel, One Pixel At A Time
+    //! @param aPixels 16 RGBA Pixels
+    //! @param aPalette aPaletteSize RGBA Colors
+    //! @param aPaletteSize The Number Of Palette Colors, Up To 16
+    //! @param aIndices Receives The Palette Index Per Pixel
+    //! @param aErrors Receives The Squared Distance To It Per Pixel
+    //==============================================================================
+    static void FindIndicesScalar(const uint8_t* aPixels, const uint8_t* aPalette, int aPaletteSize,
+                                  uint8_t* aIndices, uint32_t* aErrors)
+    {
+        for (int i = 0; i < 16; ++i)
+            {
+            const uint8_t* pixel = aPixels + 4 * i;
+            uint32_t best = UINT32_MAX;
+            int bestIndex = 0;
+            for (int j = 0; j < aPaletteSize; ++j)
+                {
+                const uint8_t* color = aPalette + 4 * j;
+                uint32_t error = 0;
+                for (int c = 0; c < 4; ++c)
+                    {
+                    const int d = pixel[c] - color[c];
+                    error += d * d;
+                    }
+                if (error < best)
+                    {
+                    best = error;
+                    bestIndex = j;
+                    }
+                }
+            aIndices[i] = static_cast<uint8_t>(bestIndex);
+            aErrors[i] = best;
+            }
+    }
+
+
+#if defined(BLOCK_X86)
+    //==============================================================================
+    //! @brief Find The Nearest Palette Color Of Each Pixel, 4 Pixels At A Time
+    //==============================================================================
+    BLOCK_TARGET("ssse3")
+    static void FindIndicesSSSE3(const uint8_t* aPixels, const uint8_t* aPalette, int aPaletteSize,
+                                 uint8_t* aIndices, uint32_t* aErrors)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        for (int group = 0; group < 4; ++group)
+            {
+            // two pixels per register as 16-bit channels
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPixels + 16 * group));
+            const __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+            const __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+
+            __m128i best = _mm_set1_epi32(INT32_MAX);
+            __m128i bestIndex = zero;
+            for (int j = 0; j < aPaletteSize; ++j)
+                {
+                int32_t packed;
+                memcpy(&packed, aPalette + 4 * j, sizeof(packed));
+                const __m128i color = _mm_unpacklo_epi8(_mm_set1_epi32(packed), zero);
+
+                // r*r+g*g and b*b+a*a per pixel, then summed across: one distance per pixel
+                const __m128i dlo = _mm_sub_epi16(lo, color);
+                const __m128i dhi = _mm_sub_epi16(hi, color);
+                const __m128i error = _mm_hadd_epi32(_mm_madd_epi16(dlo, dlo), _mm_madd_epi16(dhi, dhi));
+
+                const __m128i less = _mm_cmplt_epi32(error, best);
+                best = _mm_or_si128(_mm_and_si128(less, error), _mm_andnot_si128(less, best));
+                bestIndex = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(j)), _mm_andnot_si128(less, bestIndex));
+                }
+
+            int32_t indices[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aErrors + 4 * group), best);
+            for (int i = 0; i < 4; ++i)
+                aIndices[4 * group + i] = static_cast<uint8_t>(indices[i]);
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Nearest Palette Color Of Each Pixel, 8 Pixels At A Time
+    //==============================================================================
+    BLOCK_TARGET("avx2")
+    static void FindIndicesAVX2(const uint8_t* aPixels, const uint8_t* aPalette, int aPaletteSize,
+                                uint8_t* aIndices, uint32_t* aErrors)
+    {
+        for (int half = 0; half < 2; ++half)
+            {
+            const uint8_t* pixels = aPixels + 32 * half;
+            const __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)));
+            const __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 16)));
+
+            __m256i best = _mm256_set1_epi32(INT32_MAX);
+            __m256i bestIndex = _mm256_setzero_si256();
+            for (int j = 0; j < aPaletteSize; ++j)
+                {
+                const uint8_t* c = aPalette + 4 * j;
+                const __m256i color = _mm256_set1_epi64x(static_cast<int64_t>(c[0]) | static_cast<int64_t>(c[1]) << 16
+                                                         | static_cast<int64_t>(c[2]) << 32
+                                                         | static_cast<int64_t>(c[3]) << 48);
+
+                // hadd works per lane, the distances come out as pixels 0 1 4 5 | 2 3 6 7
+                const __m256i dlo = _mm256_sub_epi16(lo, color);
+                const __m256i dhi = _mm256_sub_epi16(hi, color);
+                const __m256i error = _mm256_hadd_epi32(_mm256_madd_epi16(dlo, dlo), _mm256_madd_epi16(dhi, dhi));
+
+                const __m256i less = _mm256_cmpgt_epi32(best, error);
+                best = _mm256_min_epi32(best, error);
+                bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(j), less);
+                }
+
+            // back to pixel order
+            best = _mm256_permute4x64_epi64(best, _MM_SHUFFLE(3, 1, 2, 0));
+            bestIndex = _mm256_permute4x64_epi64(bestIndex, _MM_SHUFFLE(3, 1, 2, 0));
+
+            int32_t indices[8];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(indices), bestIndex);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aErrors + 8 * half), best);
+            for (int i = 0; i < 8; ++i)
+                aIndices[8 * half + i] = static_cast<uint8_t>(indices[i]);
+            }
+
+        _mm256_zeroupper();
+    }
+#endif
+
+
+    //! The Kernels Per Instruction Set Level, Narrowest First
+    static const Kernels kKernels[] =
+    {
+        { Isa::Scalar, "scalar", FindIndicesScalar },
+#if defined(BLOCK_X86)
+        { Isa::SSSE3, "ssse3", FindIndicesSSSE3 },
+        { Isa::AVX2, "avx2", FindIndicesAVX2 },
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    //==============================================================================
+    const Kernels* ForIsa(Isa aIsa)
+    {
+        return blitkernels::FindForIsa(kKernels, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    //==============================================================================
+    const Kernels& Active()
+    {
+        static const Kernels& active = blitkernels::SelectForIsa(kKernels);
+        return active;
+    }
+
+
+    //==============================================================================
+    //! @brief Fit A Line Through Pixels By Their Principal Axis
+    //! @param aPixels The Pixels, RGBA
+    //! @param aCount The Number Of Pixels
+    //! @param aChannels The Channels To Fit, 3 For RGB Or 4 For RGBA
+    //! @param aMean Receives The Mean
+    //! @param aAxis Receives The Unit Direction Of The Line
+    //! @return The Squared Distances Of The Pixels To The Line, Summed
+    //==============================================================================
+    static float FitLine(const uint8_t* aPixels, int aCount, int aChannels, float* aMean, float* aAxis)
+    {
+        for (int c = 0; c < 4; ++c)
+            {
+            float sum = 0;
+            for (int i = 0; i < aCount; ++i)
+                sum += aPixels[4 * i + c];
+            aMean[c] = (c < aChannels) ? sum / aCount : 0;
+            aAxis[c] = 0;
+            }
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < aCount; ++i)
+            {
+            float d[4];
+            for (int c = 0; c < aChannels; ++c)
+                d[c] = aPixels[4 * i + c] - aMean[c];
+            for (int r = 0; r < aChannels; ++r)
+                for (int c = r; c < aChannels; ++c)
+                    covariance[r][c] += d[r] * d[c];
+            }
+        float trace = 0;
+        for (int r = 0; r < aChannels; ++r)
+            {
+            trace += covariance[r][r];
+            for (int c = 0; c < r; ++c)
+                covariance[r][c] = covariance[c][r];
+            }
+
+        // power iteration, starting from the channel that varies most
+        int widest = 0;
+        for (int c = 1; c < aChannels; ++c)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        if (covariance[widest][widest] <= 0)
+            {
+            aAxis[0] = 1;
+            return 0;
+            }
+
+        float axis[4] = {};
+        for (int c = 0; c < aChannels; ++c)
+            axis[c] = covariance[widest][c];
+        for (int iteration = 0; iteration < 8; ++iteration)
+            {
+            float next[4] = {};
+            float length = 0;
+            for (int r = 0; r < aChannels; ++r)
+                {
+                for (int c = 0; c < aChannels; ++c)
+                    next[r] += covariance[r][c] * axis[c];
+                length += next[r] * next[r];
+                }
+            if (length <= 0)
+                break;
+            length = std::sqrt(length);
+            for (int c = 0; c < aChannels; ++c)
+                axis[c] = next[c] / length;
+            }
+
+        float along = 0;
+        for (int r = 0; r < aChannels; ++r)
+            {
+            aAxis[r] = axis[r];
+            for (int c = 0; c < aChannels; ++c)
+                along += axis[r] * covariance[r][c] * axis[c];
+            }
+        return std::max(0.0f, trace - along);
+    }
+
+
+    //==============================================================================
+    //! @brief Get Two Endpoints Spanning Pixels Along Their Principal Axis
+    //! @param aPixels The Pixels, RGBA
+    //! @param aCount The Number Of Pixels
+    //! @param aChannels The Channels To Fit, 3 For RGB Or 4 For RGBA
+    //! @param aLow Receives One End, 0..255 Per Channel
+    //! @param aHigh Receives The Other End
+    //==============================================================================
+    static void FitEndpoints(const uint8_t* aPixels, int aCount, int aChannels, float* aLow, float* aHigh)
+    {
+        float mean[4], axis[4];
+        FitLine(aPixels, aCount, aChannels, mean, axis);
+
+        float lowest = 0, highest = 0;
+        for (int i = 0; i < aCount; ++i)
+            {
+            float t = 0;
+            for (int c = 0; c < aChannels; ++c)
+                t += (aPixels[4 * i + c] - mean[c]) * axis[c];
+            lowest = std::min(lowest, t);
+            highest = std::max(highest, t);
+            }
+
+        for (int c = 0; c < 4; ++c)
+            {
+            aLow[c] = std::min(255.0f, std::max(0.0f, mean[c] + lowest * axis[c]));
+            aHigh[c] = std::min(255.0f, std::max(0.0f, mean[c] + highest * axis[c]));
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Solve For The Endpoints That Best Reproduce The Pixels With Their
+    //!        Current Indices, By Least Squares; Leaves Them If The Indices Are All Equal
+    //! @param aPixels The Pixels, RGBA
+    //! @param aCount The Number Of Pixels
+    //! @param aChannels The Channels To Solve, 3 Or 4
+    //! @param aIndices The Index Per Pixel
+    //! @param aWeights The Weight Of The High End Per Index, Out Of aScale
+    //! @param aScale The Full Weight
+    //! @param aLow The Low End, Updated
+    //! @param aHigh The High End, Updated
+    //==============================================================================
+    static void SolveEndpoints(const uint8_t* aPixels, int aCount, int aChannels, const uint8_t* aIndices,
+                               const uint8_t* aWeights, float aScale, float* aLow, float* aHigh)
+    {
+        float aa = 0, ab = 0, bb = 0;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < aCount; ++i)
+            {
+            const float w = aWeights[aIndices[i]] / aScale;
+            aa += (1 - w) * (1 - w);
+            ab += (1 - w) * w;
+            bb += w * w;
+            for (int c = 0; c < aChannels; ++c)
+                {
+                ax[c] += (1 - w) * aPixels[4 * i + c];
+                bx[c] += w * aPixels[4 * i + c];
+                }
+            }
+
+        const float determinant = aa * bb - ab * ab;
+        if (determinant < 1e-6f)
+            return;
+
+        for (int c = 0; c < aChannels; ++c)
+            {
+            aLow[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+            aHigh[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Append Bits To A Block, Least Significant First
+    //==============================================================================
+    static inline void PutBits(uint8_t* aBlock, int& aPosition, uint32_t aValue, int aBits)
+    {
+        for (int i = 0; i < aBits; ++i, ++aPosition)
+            aBlock[aPosition >> 3] |= static_cast<uint8_t>(((aValue >> i) & 1) << (aPosition & 7));
+    }
+
+
+    //==============================================================================
+    //! @brief Round A Color To RGB565
+    //==============================================================================
+    static inline uint16_t To565(const float* aColor)
+    {
+        const int r = static_cast<int>(aColor[0] * 31 / 255 + 0.5f);
+        const int g = static_cast<int>(aColor[1] * 63 / 255 + 0.5f);
+        const int b = static_cast<int>(aColor[2] * 31 / 255 + 0.5f);
+        return static_cast<uint16_t>(r << 11 | g << 5 | b);
+    }
+
+
+    //==============================================================================
+    //! @brief Expand RGB565 To 8 Bits Per Channel, As The Decoder Does
+    //==============================================================================
+    static inline void From565(uint16_t aValue, uint8_t* aColor)
+    {
+        const int r = aValue >> 11;
+        const int g = (aValue >> 5) & 63;
+        const int b = aValue & 31;
+        aColor[0] = static_cast<uint8_t>(r << 3 | r >> 2);
+        aColor[1] = static_cast<uint8_t>(g << 2 | g >> 4);
+        aColor[2] = static_cast<uint8_t>(b << 3 | b >> 2);
+        aColor[3] = 0;
+    }
+
+
+    //==============================================================================
+    //! @brief Encode The Color Half Of A BC1 Or BC3 Block
+    //! @param aPixels 16 RGBA Pixels
+    //! @param aBlock Receives 8 Bytes
+    //! @param aQuality How Hard To Encode
+    //! @param aAlpha BC1: Pixels Below Half Opaque Become Transparent; BC3 Has Its Own Alpha
+    //==============================================================================
+    static void EncodeColor(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality, bool aAlpha)
+    {
+        // the weight of c1 per index, out of 3 for four colors and 2 for three colors
+        static const uint8_t kFourWeights[4] = {0, 3, 1, 2};
+        static const uint8_t kThreeWeights[3] = {0, 2, 1};
+
+        const IndexKernel findIndices = Active().findIndices;
+        const int refinements = (aQuality == EncodeQuality::Fast) ? 0 : (aQuality == EncodeQuality::Normal) ? 1 : 3;
+
+        // colors compared without alpha; the opaque ones decide the endpoints
+        uint8_t colors[64], opaque[64];
+        bool transparent[16];
+        int opaqueCount = 0;
+        for (int i = 0; i < 16; ++i)
+            {
+            memcpy(colors + 4 * i, aPixels + 4 * i, 4);
+            colors[4 * i + 3] = 0;
+            transparent[i] = aAlpha && aPixels[4 * i + 3] < 128;
+            if (!transparent[i])
+                memcpy(opaque + 4 * opaqueCount++, colors + 4 * i, 4);
+            }
+
+        memset(aBlock, 0, 8);
+        if (opaqueCount == 0)
+            {
+            // c0 <= c1 selects three colors, index 3 is transparent black
+            memset(aBlock + 4, 0xFF, 4);
+            return;
+            }
+
+        float fitLow[4], fitHigh[4];
+        FitEndpoints(opaque, opaqueCount, 3, fitLow, fitHigh);
+
+        // BC3 always decodes four colors; BC1 needs three for transparency and may win with them anyway
+        const bool anyTransparent = (opaqueCount < 16);
+        const bool tryFour = !anyTransparent;
+        const bool tryThree = aAlpha && (anyTransparent || aQuality == EncodeQuality::High);
+
+        uint32_t bestError = UINT32_MAX;
+        uint16_t bestEnds[2] = {0, 0};
+        uint8_t bestIndices[16] = {};
+        bool bestThree = false;
+
+        for (int mode = 0; mode < 2; ++mode)
+            {
+            const bool three = (mode == 1);
+            if ((three && !tryThree) || (!three && !tryFour))
+                continue;
+
+            float low[4], high[4];
+            std::copy(fitLow, fitLow + 4, low);
+            std::copy(fitHigh, fitHigh + 4, high);
+
+            for (int pass = 0; pass <= refinements; ++pass)
+                {
+                const uint16_t ends[2] = {To565(high), To565(low)};
+                uint8_t palette[16];
+                From565(ends[0], palette);
+                From565(ends[1], palette + 4);
+                for (int c = 0; c < 3; ++c)
+                    {
+                    if (three)
+                        palette[8 + c] = static_cast<uint8_t>((palette[c] + palette[4 + c] + 1) / 2);
+                    else
+                        {
+                        palette[8 + c] = static_cast<uint8_t>((2 * palette[c] + palette[4 + c] + 1) / 3);
+                        palette[12 + c] = static_cast<uint8_t>((palette[c] + 2 * palette[4 + c] + 1) / 3);
+                        }
+                    }
+                palette[11] = palette[15] = 0;
+
+                uint8_t indices[16];
+                uint32_t errors[16];
+                findIndices(colors, palette, three ? 3 : 4, indices, errors);
+
+                uint32_t error = 0;
+                for (int i = 0; i < 16; ++i)
+                    {
+                    if (transparent[i])
+                        indices[i] = 3;
+                    else
+                        error += errors[i];
+                    }
+
+                if (error < bestError)
+                    {
+                    bestError = error;
+                    bestEnds[0] = ends[0];
+                    bestEnds[1] = ends[1];
+                    std::copy(indices, indices + 16, bestIndices);
+                    bestThree = three;
+                    }
+                if (error == 0 || pass == refinements)
+                    break;
+
+                // refit on the opaque pixels with their indices; the ends are c0 = high, c1 = low
+                uint8_t opaqueIndices[16];
+                for (int i = 0, j = 0; i < 16; ++i)
+                    if (!transparent[i])
+                        opaqueIndices[j++] = indices[i];
+                SolveEndpoints(opaque, opaqueCount, 3, opaqueIndices, three ? kThreeWeights : kFourWeights,
+                               three ? 2.0f : 3.0f, high, low);
+                }
+            }
+
+        // the endpoint order tells the decoder the mode: c0 > c1 for four colors
+        if (!bestThree && bestEnds[0] < bestEnds[1])
+            {
+            static const uint8_t kSwapped[4] = {1, 0, 3, 2};
+            std::swap(bestEnds[0], bestEnds[1]);
+            for (uint8_t& index : bestIndices)
+                index = kSwapped[index];
+            }
+        else if (!bestThree && bestEnds[0] == bestEnds[1])
+            std::fill(bestIndices, bestIndices + 16, 0);
+        else if (bestThree && bestEnds[0] > bestEnds[1])
+            {
+            static const uint8_t kSwapped[4] = {1, 0, 2, 3};
+            std::swap(bestEnds[0], bestEnds[1]);
+            for (uint8_t& index : bestIndices)
+                index = kSwapped[index];
+            }
+
+        int position = 0;
+        PutBits(aBlock, position, bestEnds[0], 16);
+        PutBits(aBlock, position, bestEnds[1], 16);
+        for (int i = 0; i < 16; ++i)
+            PutBits(aBlock, position, bestIndices[i], 2);
+    }
+
+
+    //==============================================================================
+    //! @brief Encode The Alpha Half Of A BC3 Block, As BC4 Does
+    //! @param aPixels 16 RGBA Pixels
+    //! @param aBlock Receives 8 Bytes
+    //! @param aQuality Normal And High Also Try The Six-Value Mode With Exact 0 And 255
+    //==============================================================================
+    static void EncodeAlpha(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality)
+    {
+        int lowest = 255, highest = 0, innerLow = 255, innerHigh = 0;
+        for (int i = 0; i < 16; ++i)
+            {
+            const int a = aPixels[4 * i + 3];
+            lowest = std::min(lowest, a);
+            highest = std::max(highest, a);
+            if (a != 0 && a != 255)
+                {
+                innerLow = std::min(innerLow, a);
+                innerHigh = std::max(innerHigh, a);
+                }
+            }
+        if (innerLow > innerHigh)
+            innerLow = innerHigh = lowest;
+
+        uint32_t bestError = UINT32_MAX;
+        uint8_t bestEnds[2] = {0, 0};
+        uint8_t bestIndices[16] = {};
+
+        for (int mode = 0; mode < 2; ++mode)
+            {
+            // a0 > a1 interpolates eight values; a0 <= a1 six, plus 0 and 255
+            const bool six = (mode == 1);
+            if (six && aQuality == EncodeQuality::Fast && lowest != highest)
+                continue;
+
+            const int a0 = six ? innerLow : highest;
+            const int a1 = six ? innerHigh : lowest;
+            if (!six && a0 == a1)
+                continue;
+
+            int palette[8] = {a0, a1};
+            for (int i = 1; i < (six ? 5 : 7); ++i)
+                palette[1 + i] = six ? ((5 - i) * a0 + i * a1 + 2) / 5 : ((7 - i) * a0 + i * a1 + 3) / 7;
+            if (six)
+                {
+                palette[6] = 0;
+                palette[7] = 255;
+                }
+
+            uint32_t error = 0;
+            uint8_t indices[16];
+            for (int i = 0; i < 16; ++i)
+                {
+                const int a = aPixels[4 * i + 3];
+                int best = 0;
+                for (int j = 1; j < 8; ++j)
+                    if (std::abs(palette[j] - a) < std::abs(palette[best] - a))
+                        best = j;
+                indices[i] = static_cast<uint8_t>(best);
+                error += (palette[best] - a) * (palette[best] - a);
+                }
+
+            if (error < bestError)
+                {
+                bestError = error;
+                bestEnds[0] = static_cast<uint8_t>(a0);
+                bestEnds[1] = static_cast<uint8_t>(a1);
+                std::copy(indices, indices + 16, bestIndices);
+                }
+            }
+
+        memset(aBlock, 0, 8);
+        int position = 0;
+        PutBits(aBlock, position, bestEnds[0], 8);
+        PutBits(aBlock, position, bestEnds[1], 8);
+        for (int i = 0; i < 16; ++i)
+            PutBits(aBlock, position, bestIndices[i], 3);
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A 4x4 Block As BC1, With 1-Bit Alpha Where Any Pixel Is Below Half Opaque
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 8 Byte Block
+    //! @param aQuality Fast Fits The Endpoints Once, Normal And High Refine Them
+    //==============================================================================
+    void EncodeBC1(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality)
+    {
+        EncodeColor(aPixels, aBlock, aQuality, true);
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A 4x4 Block As BC3: Interpolated Alpha, Then A BC1 Color Block
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 16 Byte Block
+    //! @param aQuality Fast Fits The Endpoints Once, Normal And High Refine Them
+    //==============================================================================
+    void EncodeBC3(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality)
+    {
+        EncodeAlpha(aPixels, aBlock, aQuality);
+        EncodeColor(aPixels, aBlock + 8, aQuality, false);
+    }
+
+
+    //! A Fitted BC7 Subset: Endpoint Codes And Indices
+    struct SubsetFit
+    {
+        int         codes[2][4];    // per endpoint and channel, p-bit included as the lowest bit
+        uint8_t     indices[16];
+        uint32_t    error;
+    };
+
+
+    //==============================================================================
+    //! @brief Expand A BC7 Endpoint Code To 8 Bits, As The Decoder Does
+    //! @param aCode The Code, P-Bit Included
+    //! @param aBits The Bits Of The Code, 6 To 8
+    //==============================================================================
+    static inline int Expand(int aCode, int aBits)
+    {
+        return (aCode << (8 - aBits)) | (aCode >> (2 * aBits - 8));
+    }
+
+
+    //==============================================================================
+    //! @brief Quantize A Channel To The BC7 Endpoint Code That Expands Closest To It
+    //! @param aValue The Value, 0..255
+    //! @param aBits The Bits Of The Code, P-Bit Included
+    //! @param aPBit The Lowest Bit The Code Must Have, Or -1 For Any
+    //==============================================================================
+    static int Quantize(float aValue, int aBits, int aPBit)
+    {
+        const int top = (1 << aBits) - 1;
+        const int nearest = static_cast<int>(aValue * top / 255 + 0.5f);
+
+        int best = -1;
+        float bestError = 0;
+        for (int code = nearest - 2; code <= nearest + 2; ++code)
+            {
+            if (code < 0 || code > top || (aPBit >= 0 && (code & 1) != aPBit))
+                continue;
+            const float error = std::abs(Expand(code, aBits) - aValue);
+            if (best < 0 || error < bestError)
+                {
+                best = code;
+                bestError = error;
+                }
+            }
+        return best;
+    }
+
+
+    //==============================================================================
+    //! @brief Index The Pixels Of A Subset Against The Palette Of Its Endpoint Codes
+    //! @param aPixels 16 Pixels, The Subset's First, Unused Channels Zero
+    //! @param aCount The Number Of Pixels In The Subset
+    //! @param aColorBits The Bits Of The Color Codes
+    //! @param aAlphaBits The Bits Of The Alpha Codes, 0 When Alpha Is Not Encoded
+    //! @param aWeights The Interpolation Weights
+    //! @param aIndexCount The Number Of Indices
+    //! @param aFit The Subset, Its Indices And Error Are Filled In
+    //==============================================================================
+    static void IndexSubset(const uint8_t* aPixels, int aCount, int aColorBits, int aAlphaBits,
+                            const uint8_t* aWeights, int aIndexCount, SubsetFit& aFit)
+    {
+        int ends[2][4];
+        for (int e = 0; e < 2; ++e)
+            for (int c = 0; c < 4; ++c)
+                {
+                const int bits = (c < 3) ? aColorBits : aAlphaBits;
+                ends[e][c] = bits ? Expand(aFit.codes[e][c], bits) : 0;
+                }
+
+        uint8_t palette[64];
+        for (int i = 0; i < aIndexCount; ++i)
+            for (int c = 0; c < 4; ++c)
+                palette[4 * i + c] = static_cast<uint8_t>(((64 - aWeights[i]) * ends[0][c]
+                                                           + aWeights[i] * ends[1][c] + 32) >> 6);
+
+        uint32_t errors[16];
+        Active().findIndices(aPixels, palette, aIndexCount, aFit.indices, errors);
+        aFit.error = 0;
+        for (int i = 0; i < aCount; ++i)
+            aFit.error += errors[i];
+    }
+
+
+    //==============================================================================
+    //! @brief Fit A BC7 Subset: Endpoints Along The Principal Axis, Every P-Bit Choice,
+    //!        Then Least-Squares Refinement
+    //! @param aPixels 16 Pixels, The Subset's First, Unused Channels Zero
+    //! @param aCount The Number Of Pixels In The Subset
+    //! @param aChannels The Channels To Fit, 3 Or 4
+    //! @param aColorBits The Bits Of The Color Codes, P-Bit Included
+    //! @param aAlphaBits The Bits Of The Alpha Codes, P-Bit Included, 0 When Alpha Is Not Encoded
+    //! @param aPBits How The Mode Stores P-Bits
+    //! @param aWeights The Interpolation Weights
+    //! @param aIndexCount The Number Of Indices
+    //! @param aRefinements The Number Of Refinement Passes
+    //! @return The Best Fit
+    //==============================================================================
+    static SubsetFit FitSubset(const uint8_t* aPixels, int aCount, int aChannels, int aColorBits, int aAlphaBits,
+                               PBits aPBits, const uint8_t* aWeights, int aIndexCount, int aRefinements)
+    {
+        float low[4], high[4];
+        FitEndpoints(aPixels, aCount, aChannels, low, high);
+
+        SubsetFit best;
+        best.error = UINT32_MAX;
+        const int combinations = (aPBits == kPBitNone) ? 1 : (aPBits == kPBitShared) ? 2 : 4;
+
+        for (int pass = 0; pass <= aRefinements; ++pass)
+            {
+            SubsetFit passBest;
+            passBest.error = UINT32_MAX;
+            for (int combination = 0; combination < combinations; ++combination)
+                {
+                const int p0 = (aPBits == kPBitNone) ? -1 : (combination & 1);
+                const int p1 = (aPBits == kPBitPerEndpoint) ? (combination >> 1) : p0;
+
+                SubsetFit fit;
+                for (int c = 0; c < 4; ++c)
+                    {
+                    const int bits = (c < 3) ? aColorBits : aAlphaBits;
+                    fit.codes[0][c] = bits ? Quantize(low[c], bits, p0) : 0;
+                    fit.codes[1][c] = bits ? Quantize(high[c], bits, p1) : 0;
+                    }
+                IndexSubset(aPixels, aCount, aColorBits, aAlphaBits, aWeights, aIndexCount, fit);
+                if (fit.error < passBest.error)
+                    passBest = fit;
+                }
+
+            if (passBest.error < best.error)
+                best = passBest;
+            if (best.error == 0 || pass == aRefinements)
+                break;
+            SolveEndpoints(aPixels, aCount, aChannels, passBest.indices, aWeights, 64.0f, low, high);
+            }
+        return best;
+    }
+
+
+    //==============================================================================
+    //! @brief Swap A Subset's Endpoints And Mirror Its Indices, So The Anchor
+    //!        Pixel's Index Has Its Top Bit Clear As BC7 Requires
+    //==============================================================================
+    static void FlipSubset(SubsetFit& aFit, uint8_t* aIndices, const bool* aMember, int aIndexCount)
+    {
+        for (int c = 0; c < 4; ++c)
+            std::swap(aFit.codes[0][c], aFit.codes[1][c]);
+        for (int i = 0; i < 16; ++i)
+            if (aMember[i])
+                aIndices[i] = static_cast<uint8_t>(aIndexCount - 1 - aIndices[i]);
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A Block With BC7 Mode 6: One Subset, RGBA 7.7.7.7 Endpoints With
+    //!        A P-Bit Each, 4-Bit Indices
+    //! @return The Squared Error
+    //==============================================================================
+    static uint32_t EncodeMode6(const uint8_t* aPixels, uint8_t* aBlock, int aRefinements)
+    {
+        SubsetFit fit = FitSubset(aPixels, 16, 4, 8, 8, kPBitPerEndpoint, kWeights4, 16, aRefinements);
+
+        static const bool kAll[16] = {true, true, true, true, true, true, true, true,
+                                      true, true, true, true, true, true, true, true};
+        if (fit.indices[0] & 8)
+            FlipSubset(fit, fit.indices, kAll, 16);
+
+        memset(aBlock, 0, 16);
+        int position = 0;
+        PutBits(aBlock, position, 1 << 6, 7);
+        for (int c = 0; c < 4; ++c)
+            for (int e = 0; e < 2; ++e)
+                PutBits(aBlock, position, fit.codes[e][c] >> 1, 7);
+        PutBits(aBlock, position, fit.codes[0][0] & 1, 1);
+        PutBits(aBlock, position, fit.codes[1][0] & 1, 1);
+        for (int i = 0; i < 16; ++i)
+            PutBits(aBlock, position, fit.indices[i], i ? 4 : 3);
+        return fit.error;
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A Block With BC7 Mode 5: One Subset, RGB 7.7.7 And Alpha 8 With
+    //!        Separate 2-Bit Indices, Alpha Optionally Swapped With A Color Channel
+    //! @param aRotation 0 For None, 1..3 To Swap Alpha With Red, Green Or Blue
+    //! @return The Squared Error
+    //==============================================================================
+    static uint32_t EncodeMode5(const uint8_t* aPixels, uint8_t* aBlock, int aRotation, int aRefinements)
+    {
+        uint8_t color[64], alpha[64];
+        for (int i = 0; i < 16; ++i)
+            {
+            uint8_t pixel[4];
+            memcpy(pixel, aPixels + 4 * i, 4);
+            if (aRotation)
+                std::swap(pixel[aRotation - 1], pixel[3]);
+            memcpy(color + 4 * i, pixel, 3);
+            color[4 * i + 3] = 0;
+            memset(alpha + 4 * i, 0, 3);
+            alpha[4 * i + 3] = pixel[3];
+            }
+
+        // the alpha fit sees zero color, which quantizes and expands to zero
+        SubsetFit colorFit = FitSubset(color, 16, 3, 7, 0, kPBitNone, kWeights2, 4, aRefinements);
+        SubsetFit alphaFit = FitSubset(alpha, 16, 4, 7, 8, kPBitNone, kWeights2, 4, aRefinements);
+
+        static const bool kAll[16] = {true, true, true, true, true, true, true, true,
+                                      true, true, true, true, true, true, true, true};
+        if (colorFit.indices[0] & 2)
+            FlipSubset(colorFit, colorFit.indices, kAll, 4);
+        if (alphaFit.indices[0] & 2)
+            FlipSubset(alphaFit, alphaFit.indices, kAll, 4);
+
+        memset(aBlock, 0, 16);
+        int position = 0;
+        PutBits(aBlock, position, 1 << 5, 6);
+        PutBits(aBlock, position, aRotation, 2);
+        for (int c = 0; c < 3; ++c)
+            for (int e = 0; e < 2; ++e)
+                PutBits(aBlock, position, colorFit.codes[e][c], 7);
+        for (int e = 0; e < 2; ++e)
+            PutBits(aBlock, position, alphaFit.codes[e][3], 8);
+        for (int i = 0; i < 16; ++i)
+            PutBits(aBlock, position, colorFit.indices[i], i ? 2 : 1);
+        for (int i = 0; i < 16; ++i)
+            PutBits(aBlock, position, alphaFit.indices[i], i ? 2 : 1);
+        return colorFit.error + alphaFit.error;
+    }
+
+
+    //==============================================================================
+    //! @brief Encode An Opaque Block With BC7 Mode 1: Two Subsets, RGB 6.6.6 Endpoints
+    //!        With A Shared P-Bit Per Subset, 3-Bit Indices
+    //! @param aPartition The Two-Subset Partition
+    //! @return The Squared Error
+    //==============================================================================
+    static uint32_t EncodeMode1(const uint8_t* aPixels, uint8_t* aBlock, int aPartition, int aRefinements)
+    {
+        uint8_t subsets[2][64];
+        int counts[2] = {0, 0};
+        bool members[2][16];
+        for (int i = 0; i < 16; ++i)
+            {
+            const int subset = (kPartitions2[aPartition] >> i) & 1;
+            members[subset][i] = true;
+            members[1 - subset][i] = false;
+            uint8_t* pixel = subsets[subset] + 4 * counts[subset]++;
+            memcpy(pixel, aPixels + 4 * i, 3);
+            pixel[3] = 0;
+            }
+
+        SubsetFit fits[2];
+        for (int s = 0; s < 2; ++s)
+            {
+            // the kernel takes 16 pixels, the padding is left out of the error
+            for (int i = counts[s]; i < 16; ++i)
+                memcpy(subsets[s] + 4 * i, subsets[s], 4);
+            fits[s] = FitSubset(subsets[s], counts[s], 3, 7, 0, kPBitShared, kWeights3, 8, aRefinements);
+            }
+
+        uint8_t indices[16];
+        int next[2] = {0, 0};
+        for (int i = 0; i < 16; ++i)
+            {
+            const int subset = members[1][i] ? 1 : 0;
+            indices[i] = fits[subset].indices[next[subset]++];
+            }
+
+        const int anchors[2] = {0, kAnchors2[aPartition]};
+        for (int s = 0; s < 2; ++s)
+            if (indices[anchors[s]] & 4)
+                FlipSubset(fits[s], indices, members[s], 8);
+
+        memset(aBlock, 0, 16);
+        int position = 0;
+        PutBits(aBlock, position, 1 << 1, 2);
+        PutBits(aBlock, position, static_cast<uint32_t>(aPartition), 6);
+        for (int c = 0; c < 3; ++c)
+            for (int s = 0; s < 2; ++s)
+                for (int e = 0; e < 2; ++e)
+                    PutBits(aBlock, position, fits[s].codes[e][c] >> 1, 6);
+        for (int s = 0; s < 2; ++s)
+            PutBits(aBlock, position, fits[s].codes[0][0] & 1, 1);
+        for (int i = 0; i < 16; ++i)
+            PutBits(aBlock, position, indices[i], (i == anchors[0] || i == anchors[1]) ? 2 : 3);
+        return fits[0].error + fits[1].error;
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Squared Distances Of RGB Pixels To Their Best Line, From Their Moments
+    //! @param aSums The Sums Of R, G And B
+    //! @param aProducts The Sums Of RR, RG, RB, GG, GB And BB
+    //! @param aCount The Number Of Pixels
+    //==============================================================================
+    static float LineResidual(const int* aSums, const int* aProducts, int aCount)
+    {
+        if (aCount == 0)
+            return 0;
+
+        // covariance, then its largest eigenvalue by power iteration
+        static const int kIndex[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+        float covariance[3][3];
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c)
+                covariance[r][c] = aProducts[kIndex[r][c]] - static_cast<float>(aSums[r]) * aSums[c] / aCount;
+        const float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+
+        int widest = 0;
+        for (int c = 1; c < 3; ++c)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        if (covariance[widest][widest] <= 0)
+            return 0;
+
+        float axis[3] = {covariance[widest][0], covariance[widest][1], covariance[widest][2]};
+        float along = 0;
+        for (int iteration = 0; iteration < 4; ++iteration)
+            {
+            float next[3];
+            float length = 0;
+            for (int r = 0; r < 3; ++r)
+                {
+                next[r] = covariance[r][0] * axis[0] + covariance[r][1] * axis[1] + covariance[r][2] * axis[2];
+                length += next[r] * next[r];
+                }
+            if (length <= 0)
+                return trace;
+            length = std::sqrt(length);
+            for (int c = 0; c < 3; ++c)
+                axis[c] = next[c] / length;
+            along = length;
+            }
+        return std::max(0.0f, trace - along);
+    }
+
+
+    //==============================================================================
+    //! @brief Order The Two-Subset Partitions By How Well Two Lines Fit Their Subsets
+    //! @param aPixels 16 RGBA Pixels
+    //! @param aOrder Receives The 64 Partitions, Most Promising First
+    //==============================================================================
+    static void RankPartitions(const uint8_t* aPixels, int* aOrder)
+    {
+        // the moments of each pixel, so a subset's are sums over its pixels
+        int moments[16][9];
+        int total[9] = {};
+        for (int i = 0; i < 16; ++i)
+            {
+            const int r = aPixels[4 * i], g = aPixels[4 * i + 1], b = aPixels[4 * i + 2];
+            const int values[9] = {r, g, b, r * r, r * g, r * b, g * g, g * b, b * b};
+            for (int k = 0; k < 9; ++k)
+                {
+                moments[i][k] = values[k];
+                total[k] += values[k];
+                }
+            }
+
+        float residuals[64];
+        for (int p = 0; p < 64; ++p)
+            {
+            int second[9] = {};
+            int count = 0;
+            for (int i = 0; i < 16; ++i)
+                if ((kPartitions2[p] >> i) & 1)
+                    {
+                    ++count;
+                    for (int k = 0; k < 9; ++k)
+                        second[k] += moments[i][k];
+                    }
+
+            int first[9];
+            for (int k = 0; k < 9; ++k)
+                first[k] = total[k] - second[k];
+            residuals[p] = LineResidual(first, first + 3, 16 - count) + LineResidual(second, second + 3, count);
+            aOrder[p] = p;
+            }
+
+        std::sort(aOrder, aOrder + 64, [&](int aLeft, int aRight) { return residuals[aLeft] < residuals[aRight]; });
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A 4x4 Block As BC7
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 16 Byte Block
+    //! @param aQuality Fast Uses Mode 6 Only; Normal Also Tries The Best Mode 1 Partitions
+    //!        For Opaque Blocks And Mode 5 For The Rest; High Searches More Partitions,
+    //!        Every Mode 5 Rotation And Refines More
+    //==============================================================================
+    void EncodeBC7(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality)
+    {
+        const int refinements = (aQuality == EncodeQuality::Fast) ? 0 : (aQuality == EncodeQuality::Normal) ? 1 : 2;
+
+        uint32_t bestError = EncodeMode6(aPixels, aBlock, refinements);
+        if (aQuality == EncodeQuality::Fast || bestError == 0)
+            return;
+
+        bool opaque = true;
+        for (int i = 0; i < 16; ++i)
+            opaque = opaque && aPixels[4 * i + 3] == 255;
+
+        uint8_t candidate[16];
+        if (opaque)
+            {
+            // mode 1's two lines beat mode 6's one where the block has two distinct colors
+            int order[64];
+            RankPartitions(aPixels, order);
+            const int partitions = (aQuality == EncodeQuality::Normal) ? 4 : 16;
+            for (int i = 0; i < partitions && bestError != 0; ++i)
+                {
+                const uint32_t error = EncodeMode1(aPixels, candidate, order[i], refinements);
+                if (error < bestError)
+                    {
+                    bestError = error;
+                    memcpy(aBlock, candidate, 16);
+                    }
+                }
+            }
+        else
+            {
+            // mode 5 fits alpha on its own, for alpha that doesn't follow the color
+            const int rotations = (aQuality == EncodeQuality::Normal) ? 1 : 4;
+            for (int rotation = 0; rotation < rotations && bestError != 0; ++rotation)
+                {
+                const uint32_t error = EncodeMode5(aPixels, candidate, rotation, refinements);
+                if (error < bestError)
+                    {
+                    bestError = error;
+                    memcpy(aBlock, candidate, 16);
+                    }
+                }
+            }
+    }
+}
+
+// End Of File
@@ -0,0 +1,61 @@
+//==============================================================================
+// Name         : blockencoder.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The BC1, BC3 And BC7 Block Encoders
+//==============================================================================
+
+#ifndef BLOCKENCODER_H
+#define BLOCKENCODER_H
+
+#include <cstdint>            // uint8_t, uint32_t
+#include "blitkernels.h"      // blitkernels::Isa
+#include "atlasoptions.h"     // EncodeQuality
+
+namespace blockencoder
+{
+    //! Index Kernel: For Each Of 16 RGBA Pixels, Find The Nearest Of aPaletteSize RGBA
+    //! Colors By Squared Distance; The Inner Loop Of Every Encoder
+    typedef void (*IndexKernel)(const uint8_t* aPixels, const uint8_t* aPalette, int aPaletteSize,
+                                uint8_t* aIndices, uint32_t* aErrors);
+
+    //! The Index Kernel Built For One Instruction Set Level
+    struct Kernels
+    {
+        blitkernels::Isa    isa;
+        const char*         name;
+        IndexKernel         findIndices;
+    };
+
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    const Kernels& Active();
+
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    const Kernels* ForIsa(blitkernels::Isa aIsa);
+
+    //! @brief Encode A 4x4 Block As BC1, With 1-Bit Alpha Where Any Pixel Is Below Half Opaque
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 8 Byte Block
+    //! @param aQuality Fast Fits The Endpoints Once, Normal And High Refine Them
+    void EncodeBC1(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality);
+
+    //! @brief Encode A 4x4 Block As BC3: Interpolated Alpha, Then A BC1 Color Block
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 16 Byte Block
+    //! @param aQuality Fast Fits The Endpoints Once, Normal And High Refine Them
+    void EncodeBC3(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality);
+
+    //! @brief Encode A 4x4 Block As BC7
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 16 Byte Block
+    //! @param aQuality Fast Uses Mode 6 Only; Normal Also Tries The Best Mode 1 Partitions
+    //!        For Opaque Blocks And Mode 5 For The Rest; High Searches More Partitions,
+    //!        Every Mode 5 Rotation And Refines More
+    void EncodeBC7(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality);
+}
+
+#endif    // BLOCKENCODER_H
+
+// End Of File
@@ -0,0 +1,385 @@
+//==============================================================================
+// Name         : channelreducer.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The Kernels That Find Which Channels Images Really Use
+//                And Narrow Them To Fewer, With Runtime CPU Dispatch
+//==============================================================================
+
+#include "channelreducer.h"    // channelreducer::Kernels
+#include <algorithm>           // std::min
+#include <string.h>            // memcpy
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define REDUCE_X86
+    #include <immintrin.h>          // SSSE3, AVX2 intrinsics
+    #if defined(_MSC_VER)
+        #define REDUCE_TARGET(aIsa)
+    #else
+        #define REDUCE_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace channelreducer
+{
+    using blitkernels::Isa;
+
+    //! Pixels Scanned Between Checks For Whether Anything Is Still True
+    static const size_t kScanBlock = 16384;
+
+
+    //==============================================================================
+    //! @brief Turn What Was Or-ed And And-ed Together Over Some Pixels Into ScanFlags
+    //! @param aAlphas The Alphas And-ed Together
+    //! @param aDiffs R^G And G^B Or-ed Together
+    //! @param aWhites R&G&B And-ed Together, Fully Transparent Pixels Counting As 255
+    //==============================================================================
+    static inline unsigned Flags(unsigned aAlphas, unsigned aDiffs, unsigned aWhites)
+    {
+        return ((aAlphas & 0xFF) == 0xFF ? static_cast<unsigned>(kOpaque) : 0u)
+               | ((aDiffs & 0xFF) == 0 ? static_cast<unsigned>(kGray) : 0u)
+               | ((aWhites & 0xFF) == 0xFF ? static_cast<unsigned>(kWhite) : 0u);
+    }
+
+
+    //==============================================================================
+    // Scalar Kernels, Used On Every CPU For The Row Tails Too
+    //==============================================================================
+    static unsigned ScanRGBAScalar(const uint8_t* aPixels, size_t aCount)
+    {
+        unsigned alphas = 0xFF, diffs = 0, whites = 0xFF;
+        for (size_t i = 0; i < aCount; ++i, aPixels += 4)
+            {
+            alphas &= aPixels[3];
+            diffs |= (aPixels[0] ^ aPixels[1]) | (aPixels[1] ^ aPixels[2]);
+            whites &= aPixels[3] ? (aPixels[0] & aPixels[1] & aPixels[2]) : 0xFF;
+            }
+        return Flags(alphas, diffs, whites);
+    }
+
+    static unsigned ScanRGBScalar(const uint8_t* aPixels, size_t aCount)
+    {
+        unsigned diffs = 0, whites = 0xFF;
+        for (size_t i = 0; i < aCount; ++i, aPixels += 3)
+            {
+            diffs |= (aPixels[0] ^ aPixels[1]) | (aPixels[1] ^ aPixels[2]);
+            whites &= aPixels[0] & aPixels[1] & aPixels[2];
+            }
+        return Flags(0xFF, diffs, whites);
+    }
+
+    //! Gray Scans Only And Bytes Together, Left To The Compiler On Every CPU
+    static unsigned ScanGrayScalar(const uint8_t* aPixels, size_t aCount)
+    {
+        unsigned whites = 0xFF;
+        for (size_t i = 0; i < aCount; ++i)
+            whites &= aPixels[i];
+        return Flags(0xFF, 0, whites);
+    }
+
+    static unsigned ScanGrayAlphaScalar(const uint8_t* aPixels, size_t aCount)
+    {
+        unsigned alphas = 0xFF, whites = 0xFF;
+        for (size_t i = 0; i < aCount; ++i, aPixels += 2)
+            {
+            alphas &= aPixels[1];
+            whites &= aPixels[1] ? aPixels[0] : 0xFF;
+            }
+        return Flags(alphas, 0, whites);
+    }
+
+    static void NarrowScalar(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels, const Selection& aSelection)
+    {
+        for (size_t i = 0; i < aPixels; ++i, aSrc += aSelection.srcBytes)
+            for (int b = 0; b < aSelection.dstBytes; ++b)
+                *aDst++ = (aSelection.picks[b] < 0) ? 0xFF : aSrc[aSelection.picks[b]];
+    }
+
+
+#if defined(REDUCE_X86)
+    //==============================================================================
+    //! @brief Turn Per-Pixel Accumulators, One Pixel Per 32-bit Lane, Into ScanFlags
+    //==============================================================================
+    REDUCE_TARGET("ssse3")
+    static inline unsigned FlagsSSSE3(__m128i aAlphas, __m128i aDiffs, __m128i aWhites)
+    {
+        uint32_t alphas[4], diffs[4], whites[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(alphas), aAlphas);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(diffs), aDiffs);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(whites), aWhites);
+
+        const uint32_t alpha = alphas[0] & alphas[1] & alphas[2] & alphas[3];
+        const uint32_t diff = diffs[0] | diffs[1] | diffs[2] | diffs[3];
+        const uint32_t white = whites[0] & whites[1] & whites[2] & whites[3];
+        return Flags(alpha >> 24, (diff | diff >> 8) & 0xFF, white & white >> 8 & white >> 16);
+    }
+
+    //==============================================================================
+    //! @brief Accumulate 4 RGBA Pixels: Alphas And-ed, R^G And G^B Or-ed In The Low
+    //!        Two Bytes, R, G And B And-ed With Fully Transparent Pixels Forced White
+    //==============================================================================
+    REDUCE_TARGET("ssse3")
+    static inline void AccumulateSSSE3(__m128i aPixels, __m128i& aAlphas, __m128i& aDiffs, __m128i& aWhites)
+    {
+        const __m128i transparent = _mm_cmpeq_epi32(_mm_srli_epi32(aPixels, 24), _mm_setzero_si128());
+        aAlphas = _mm_and_si128(aAlphas, aPixels);
+        aDiffs = _mm_or_si128(aDiffs, _mm_and_si128(_mm_xor_si128(aPixels, _mm_srli_epi32(aPixels, 8)),
+                                                     _mm_set1_epi32(0xFFFF)));
+        aWhites = _mm_and_si128(aWhites, _mm_or_si128(aPixels, transparent));
+    }
+
+    //==============================================================================
+    // SSSE3 Kernels, 4 Pixels At A Time
+    // RGB Pixels Are Spread To RGBA With pshufb Then Scanned Alike; Narrowing Is One
+    // pshufb Built From The Selection, The Missing Alpha Or-ed In
+    //==============================================================================
+    REDUCE_TARGET("ssse3")
+    static unsigned ScanRGBASSSE3(const uint8_t* aPixels, size_t aCount)
+    {
+        const __m128i ones = _mm_set1_epi8(-1);
+        __m128i alphas = ones, diffs = _mm_setzero_si128(), whites = ones;
+
+        size_t i = 0;
+        for (; i + 4 <= aCount; i += 4)
+            AccumulateSSSE3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aPixels + 4 * i)),
+                            alphas, diffs, whites);
+        return FlagsSSSE3(alphas, diffs, whites) & ScanRGBAScalar(aPixels + 4 * i, aCount - i);
+    }
+
+    REDUCE_TARGET("ssse3")
+    static unsigned ScanRGBSSSE3(const uint8_t* aPixels, size_t aCount)
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+        const __m128i ones = _mm_set1_epi8(-1);
+        __m128i alphas = ones, diffs = _mm_setzero_si128(), whites = ones;
+
+        // 16 bytes are loaded for 12, so stop while 16 are left
+        size_t i = 0;
+        for (; 3 * i + 16 <= 3 * aCount; i += 4)
+            {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPixels + 3 * i));
+            AccumulateSSSE3(_mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha), alphas, diffs, whites);
+            }
+        return FlagsSSSE3(alphas, diffs, whites) & ScanRGBScalar(aPixels + 3 * i, aCount - i);
+    }
+
+    REDUCE_TARGET("ssse3")
+    static void NarrowSSSE3(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels, const Selection& aSelection)
+    {
+        const size_t srcBytes = aSelection.srcBytes;
+        const size_t dstBytes = aSelection.dstBytes;
+
+        // 4 pixels per shuffle, their bytes at the start of the register
+        alignas(16) int8_t shuffle[16];
+        alignas(16) int8_t fill[16];
+        for (int b = 0; b < 16; ++b)
+            {
+            const size_t pixel = b / dstBytes;
+            const int pick = aSelection.picks[b % dstBytes];
+            const bool used = pixel < 4;
+            shuffle[b] = (used && pick >= 0) ? static_cast<int8_t>(pixel * srcBytes + pick) : -1;
+            fill[b] = (used && pick < 0) ? -1 : 0;
+            }
+        const __m128i shuffleMask = _mm_load_si128(reinterpret_cast<const __m128i*>(shuffle));
+        const __m128i fillMask = _mm_load_si128(reinterpret_cast<const __m128i*>(fill));
+
+        // all 16 bytes are loaded and stored, the next 4 pixels overwrite the extra ones
+        size_t i = 0;
+        for (; srcBytes * i + 16 <= srcBytes * aPixels && dstBytes * i + 16 <= dstBytes * aPixels; i += 4)
+            {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSrc + srcBytes * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDst + dstBytes * i),
+                             _mm_or_si128(_mm_shuffle_epi8(pixels, shuffleMask), fillMask));
+            }
+        NarrowScalar(aDst + dstBytes * i, aSrc + srcBytes * i, aPixels - i, aSelection);
+    }
+
+
+    //==============================================================================
+    // AVX2 Kernels, 8 Pixels At A Time; RGB Scans And Narrowing Reuse SSSE3, Their
+    // Shuffles Don't Cross The Middle Of A 256-bit Register
+    //==============================================================================
+    REDUCE_TARGET("avx2")
+    static unsigned ScanRGBAAVX2(const uint8_t* aPixels, size_t aCount)
+    {
+        const __m256i ones = _mm256_set1_epi8(-1);
+        const __m256i lowBytes = _mm256_set1_epi32(0xFFFF);
+        __m256i alphas = ones, diffs = _mm256_setzero_si256(), whites = ones;
+
+        size_t i = 0;
+        for (; i + 8 <= aCount; i += 8)
+            {
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aPixels + 4 * i));
+            const __m256i transparent = _mm256_cmpeq_epi32(_mm256_srli_epi32(pixels, 24), _mm256_setzero_si256());
+            alphas = _mm256_and_si256(alphas, pixels);
+            diffs = _mm256_or_si256(diffs, _mm256_and_si256(_mm256_xor_si256(pixels, _mm256_srli_epi32(pixels, 8)),
+                                                            lowBytes));
+            whites = _mm256_and_si256(whites, _mm256_or_si256(pixels, transparent));
+            }
+
+        const __m128i alpha = _mm_and_si128(_mm256_castsi256_si128(alphas), _mm256_extracti128_si256(alphas, 1));
+        const __m128i diff = _mm_or_si128(_mm256_castsi256_si128(diffs), _mm256_extracti128_si256(diffs, 1));
+        const __m128i white = _mm_and_si128(_mm256_castsi256_si128(whites), _mm256_extracti128_si256(whites, 1));
+
+        // leave the upper halves clean for the SSE code that follows
+        _mm256_zeroupper();
+        return FlagsSSSE3(alpha, diff, white) & ScanRGBAScalar(aPixels + 4 * i, aCount - i);
+    }
+#endif    // REDUCE_X86
+
+
+    //==============================================================================
+    // Kernel Table, Narrowest Instruction Set First
+    //==============================================================================
+    static const Kernels kKernels[] =
+    {
+        { Isa::Scalar, "scalar", ScanRGBAScalar, ScanRGBScalar, NarrowScalar },
+#if defined(REDUCE_X86)
+        { Isa::SSSE3, "ssse3", ScanRGBASSSE3, ScanRGBSSSE3, NarrowSSSE3 },
+        { Isa::AVX2, "avx2", ScanRGBAAVX2, ScanRGBSSSE3, NarrowSSSE3 },
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    //==============================================================================
+    const Kernels* ForIsa(Isa aIsa)
+    {
+        return blitkernels::FindForIsa(kKernels, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    //==============================================================================
+    const Kernels& Active()
+    {
+        static const Kernels& active = blitkernels::SelectForIsa(kKernels);
+        return active;
+    }
+
+
+    //==============================================================================
+    //! @brief Scan An Image, Stopping Early Once Nothing Is Left True
+    //! @param aPixels The Pixels
+    //! @param aCount The Number Of Pixels
+    //! @param aChannels 4 For RGBA, 3 For RGB, 2 For Gray-Alpha, 1 For Gray
+    //! @return The ScanFlags True Of Every Pixel
+    //==============================================================================
+    unsigned Scan(const uint8_t* aPixels, size_t aCount, int aChannels)
+    {
+        static const ScanKernel grayScans[] = {nullptr, ScanGrayScalar, ScanGrayAlphaScalar};
+        const ScanKernel scan = (aChannels == 4) ? Active().scanRGBA
+                                : (aChannels == 3) ? Active().scanRGB : grayScans[aChannels];
+        unsigned flags = kOpaque | kGray | kWhite;
+        for (size_t i = 0; i < aCount && flags; i += kScanBlock)
+            flags &= scan(aPixels + aChannels * i, std::min(kScanBlock, aCount - i));
+        return flags;
+    }
+
+
+    //==============================================================================
+    //! @brief Scan A Palette Image, Only The Colors Its Indices Use
+    //! @param aIndices The Palette Indices, A Byte Per Pixel
+    //! @param aCount The Number Of Pixels
+    //! @param aPalette 256 RGBA Colors
+    //! @return The ScanFlags True Of Every Pixel
+    //==============================================================================
+    unsigned ScanIndexed(const uint8_t* aIndices, size_t aCount, const uint32_t* aPalette)
+    {
+        bool used[256] = {};
+        for (size_t i = 0; i < aCount; ++i)
+            used[aIndices[i]] = true;
+
+        uint32_t colors[256];
+        size_t colorCount = 0;
+        for (int i = 0; i < 256; ++i)
+            if (used[i])
+                colors[colorCount++] = aPalette[i];
+        return Scan(reinterpret_cast<const uint8_t*>(colors), colorCount, 4);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Narrowest Channels That Hold Images With These ScanFlags
+    //==============================================================================
+    Channels Narrowest(unsigned aFlags)
+    {
+        // an opaque white image is gray too, so gray is tried before the mask
+        if ((aFlags & kOpaque) && (aFlags & kGray))
+            return Channels::Gray;
+        if (aFlags & kWhite)
+            return Channels::Alpha;
+        if (aFlags & kGray)
+            return Channels::GrayAlpha;
+        if (aFlags & kOpaque)
+            return Channels::RGB;
+        return Channels::RGBA;
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Bytes Per Pixel Of Channels
+    //==============================================================================
+    int ChannelCount(Channels aChannels)
+    {
+        static const int counts[] = {4, 3, 2, 1, 1};
+        return counts[static_cast<int>(aChannels)];
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Name Of Channels, As The Command Line Spells It
+    //==============================================================================
+    const char* Name(Channels aChannels)
+    {
+        static const char* const names[] = {"rgba", "rgb", "gray-alpha", "gray", "alpha"};
+        return names[static_cast<int>(aChannels)];
+    }
+
+
+    //==============================================================================
+    //! @brief Get What Narrowing Pixels Of aSrcChannels Bytes To aChannels Picks
+    //! @param aSrcChannels 4 For RGBA, 3 For RGB, 2 For Gray-Alpha, 1 For Gray
+    //! @param aChannels Channels Other Than RGBA
+    //==============================================================================
+    Selection Select(int aSrcChannels, Channels aChannels)
+    {
+        // RGB and gray images have no alpha byte, it reads as 255; gray is R, G and B
+        const int8_t alpha = (aSrcChannels == 4) ? 3 : (aSrcChannels == 2) ? 1 : -1;
+        const bool gray = aSrcChannels < 3;
+        Selection selection = { static_cast<uint8_t>(aSrcChannels), 0, { -1, -1, -1, -1 } };
+        switch (aChannels)
+            {
+            case Channels::RGB:
+                selection.dstBytes = 3;
+                selection.picks[0] = 0;
+                selection.picks[1] = gray ? 0 : 1;
+                selection.picks[2] = gray ? 0 : 2;
+                break;
+            case Channels::GrayAlpha:
+                selection.dstBytes = 2;
+                selection.picks[0] = 0;
+                selection.picks[1] = alpha;
+                break;
+            case Channels::Gray:
+                selection.dstBytes = 1;
+                selection.picks[0] = 0;
+                break;
+            case Channels::Alpha:
+                selection.dstBytes = 1;
+                selection.picks[0] = alpha;
+                break;
+            default:
+                break;
+            }
+        return selection;
+    }
+}
+
+// End Of File
@@ -0,0 +1,99 @@
+//==============================================================================
+// Name         : channelreducer.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The Kernels That Find Which Channels Images Really Use
+//                And Narrow Them To Fewer, With Runtime CPU Dispatch
+//==============================================================================
+
+#ifndef CHANNELREDUCER_H
+#define CHANNELREDUCER_H
+
+#include <cstddef>            // size_t
+#include <cstdint>            // uint8_t, int8_t, uint32_t
+#include "blitkernels.h"      // blitkernels::Isa
+
+namespace channelreducer
+{
+    //! What A Scan Found True Of Every Pixel
+    enum ScanFlags
+    {
+        kOpaque = 1,    // alpha is 255
+        kGray = 2,      // R, G And B are equal
+        kWhite = 4      // R, G And B are 255 unless alpha is 0
+    };
+
+    //! The Channels Kept In The Texture Atlas, Widest First
+    enum class Channels
+    {
+        RGBA,
+        RGB,          // every pixel opaque
+        GrayAlpha,    // every pixel gray
+        Gray,         // every pixel opaque and gray
+        Alpha         // every visible pixel white, a coverage mask
+    };
+
+    //! Which Source Byte Goes To Each Destination Byte When Narrowing
+    struct Selection
+    {
+        uint8_t     srcBytes;    // 1 to 4
+        uint8_t     dstBytes;    // 1 to 3
+        int8_t      picks[4];    // the source byte of each destination byte, -1 for 0xFF
+    };
+
+    //! Scan Kernel: Returns The ScanFlags True Of All aCount Pixels
+    typedef unsigned (*ScanKernel)(const uint8_t* aPixels, size_t aCount);
+
+    //! Narrow Kernel: Writes aPixels Pixels Of aSelection.dstBytes Bytes From aSrc
+    typedef void (*NarrowKernel)(uint8_t* aDst, const uint8_t* aSrc, size_t aPixels, const Selection& aSelection);
+
+    //! The Kernels Built For One Instruction Set Level
+    struct Kernels
+    {
+        blitkernels::Isa    isa;
+        const char*         name;
+        ScanKernel          scanRGBA;
+        ScanKernel          scanRGB;
+        NarrowKernel        narrow;
+    };
+
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    const Kernels& Active();
+
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    const Kernels* ForIsa(blitkernels::Isa aIsa);
+
+    //! @brief Scan An Image, Stopping Early Once Nothing Is Left True
+    //! @param aPixels The Pixels
+    //! @param aCount The Number Of Pixels
+    //! @param aChannels 4 For RGBA, 3 For RGB, 2 For Gray-Alpha, 1 For Gray
+    //! @return The ScanFlags True Of Every Pixel
+    unsigned Scan(const uint8_t* aPixels, size_t aCount, int aChannels);
+
+    //! @brief Scan A Palette Image, Only The Colors Its Indices Use
+    //! @param aIndices The Palette Indices, A Byte Per Pixel
+    //! @param aCount The Number Of Pixels
+    //! @param aPalette 256 RGBA Colors
+    //! @return The ScanFlags True Of Every Pixel
+    unsigned ScanIndexed(const uint8_t* aIndices, size_t aCount, const uint32_t* aPalette);
+
+    //! @brief Get The Narrowest Channels That Hold Images With These ScanFlags
+    Channels Narrowest(unsigned aFlags);
+
+    //! @brief Get The Bytes Per Pixel Of Channels
+    int ChannelCount(Channels aChannels);
+
+    //! @brief Get The Name Of Channels, As The Command Line Spells It
+    const char* Name(Channels aChannels);
+
+    //! @brief Get What Narrowing Pixels Of aSrcChannels Bytes To aChannels Picks
+    //! @param aSrcChannels 4 For RGBA, 3 For RGB, 2 For Gray-Alpha, 1 For Gray
+    //! @param aChannels Channels Other Than RGBA
+    Selection Select(int aSrcChannels, Channels aChannels);
+}
+
+#endif    // CHANNELREDUCER_H
+
+// End Of File
@@ -0,0 +1,429 @@
+//==============================================================================
+// Name         : colorquantizer.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The Color Counting, Palette Building And Palette
+//                Mapping Behind Indexed-Color Output
+//==============================================================================
+
+#include "colorquantizer.h"    // ColorCount, CountColors, BuildPalette, PaletteMapper
+#include <algorithm>           // std::sort, std::stable_partition, std::lower_bound, std::min, std::max
+#include <climits>             // INT_MAX
+#include <cfloat>              // FLT_MAX
+
+namespace colorquantizer
+{
+    //! K-Means Passes After The Median Cut, Each Moves Every Color To Its Nearest Mean
+    static const int kKMeansPasses = 6;
+
+    //! Slots Of The Palette Mapper's Exact Table, At Least 4 Per Palette Color
+    static const int kExactTableBits = 10;
+
+
+    //==============================================================================
+    //! @brief Hash A Color To A Slot Of A Table Of 2^(32 - aShift) Slots
+    //==============================================================================
+    static inline size_t Hash(uint32_t aColor, int aShift)
+    {
+        return static_cast<size_t>((aColor * 2654435761u) >> aShift);
+    }
+
+
+    //==============================================================================
+    //! @brief Count The Distinct Colors Of An Image With A Hash Set
+    //! @param aPixels The Pixels, RGBA
+    //! @param aPixelCount The Number Of Pixels
+    //! @param aLimit Give Up Once There Are More Distinct Colors Than This
+    //! @param aDroppedBits Low Bits Dropped From Each Channel First, 0 To Count Exactly
+    //! @param aColors Receives The Colors And Their Counts
+    //! @return False If There Were More Than aLimit Colors, aColors Is Then Incomplete
+    //==============================================================================
+    bool CountColors(const uint8_t* aPixels, size_t aPixelCount, size_t aLimit, int aDroppedBits,
+                     std::vector<ColorCount>& aColors)
+    {
+        // open addressing, at most half full; a count of 0 marks an empty slot
+        int bits = 10;
+        while ((size_t(1) << bits) < 2 * aLimit)
+            ++bits;
+        const size_t mask = (size_t(1) << bits) - 1;
+        std::vector<ColorCount> table(mask + 1, ColorCount());
+
+        // dropped bits are replaced by half their range, so the colors stay centered
+        const uint32_t keep = (0xFFu << aDroppedBits & 0xFFu) * 0x01010101u;
+        const uint32_t half = aDroppedBits ? (1u << (aDroppedBits - 1)) * 0x01010101u : 0;
+
+        size_t distinct = 0;
+        uint32_t run = 0, runColor = 0;
+        for (size_t i = 0; i <= aPixelCount; ++i)
+            {
+            uint32_t color = 0;
+            if (i < aPixelCount)
+                {
+                color = PixelColor(aPixels + 4 * i);
+                if (aDroppedBits && color)
+                    color = (color & keep) | half;
+
+                // atlases are mostly runs of one color, hashed once per run
+                if (run && color == runColor)
+                    {
+                    ++run;
+                    continue;
+                    }
+                }
+
+            if (run)
+                {
+                size_t slot = Hash(runColor, 32 - bits);
+                while (table[slot].count && table[slot].color != runColor)
+                    slot = (slot + 1) & mask;
+                if (!table[slot].count)
+                    {
+                    if (++distinct > aLimit)
+                        return false;
+                    table[slot].color = runColor;
+                    }
+                table[slot].count += run;
+                }
+            run = 1;
+            runColor = color;
+            }
+
+        aColors.clear();
+        aColors.reserve(distinct);
+        for (const ColorCount& entry : table)
+            if (entry.count)
+                aColors.push_back(entry);
+        return true;
+    }
+
+
+    //! A Histogram Color In Premultiplied Floats, With Its Pixel Count As Weight
+    struct Point
+    {
+        float   value[4];
+        float   weight;
+    };
+
+    //! A Median Cut Box: A Range Of Points, Its Weighted Squared Error And Widest Axis
+    struct Box
+    {
+        size_t  begin;
+        size_t  end;
+        float   error;
+        int     axis;
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Weighted Mean Of A Range Of Points
+    //==============================================================================
+    static void Mean(const Point* aPoints, size_t aCount, float aMean[4], float& aWeight)
+    {
+        double sums[4] = {0, 0, 0, 0}, weight = 0;
+        for (size_t i = 0; i < aCount; ++i)
+            {
+            for (int c = 0; c < 4; ++c)
+                sums[c] += aPoints[i].value[c] * aPoints[i].weight;
+            weight += aPoints[i].weight;
+            }
+        for (int c = 0; c < 4; ++c)
+            aMean[c] = static_cast<float>(weight ? sums[c] / weight : 0);
+        aWeight = static_cast<float>(weight);
+    }
+
+
+    //==============================================================================
+    //! @brief Fill In A Box's Error And The Axis Its Points Vary Most Along
+    //==============================================================================
+    static void Measure(const std::vector<Point>& aPoints, Box& aBox)
+    {
+        float mean[4], weight;
+        Mean(&aPoints[aBox.begin], aBox.end - aBox.begin, mean, weight);
+
+        double variance[4] = {0, 0, 0, 0};
+        for (size_t i = aBox.begin; i < aBox.end; ++i)
+            for (int c = 0; c < 4; ++c)
+                {
+                const double d = aPoints[i].value[c] - mean[c];
+                variance[c] += d * d * aPoints[i].weight;
+                }
+
+        aBox.axis = 0;
+        for (int c = 1; c < 4; ++c)
+            if (variance[c] > variance[aBox.axis])
+                aBox.axis = c;
+        aBox.error = static_cast<float>(variance[0] + variance[1] + variance[2] + variance[3]);
+    }
+
+
+    //==============================================================================
+    //! @brief Choose Up To aPaletteSize Colors Representing A Histogram: Its Own
+    //!        Colors If They Fit, Else A Median Cut Refined By K-Means, Both On
+    //!        Premultiplied Colors So Barely Visible Pixels Weigh Little
+    //! @param aColors The Histogram
+    //! @param aPaletteSize The Most Colors, 1 To 256
+    //! @return The Palette, Translucent Colors First So tRNS Can Stop Early
+    //==============================================================================
+    std::vector<uint32_t> BuildPalette(const std::vector<ColorCount>& aColors, int aPaletteSize)
+    {
+        std::vector<uint32_t> palette;
+        if (aColors.size() <= static_cast<size_t>(aPaletteSize))
+            for (const ColorCount& entry : aColors)
+                palette.push_back(entry.color);
+        else
+            {
+            std::vector<Point> points(aColors.size());
+            for (size_t i = 0; i < aColors.size(); ++i)
+                {
+                const uint32_t color = aColors[i].color;
+                const float alpha = static_cast<float>(color >> 24);
+                for (int c = 0; c < 3; ++c)
+                    points[i].value[c] = ((color >> (8 * c)) & 0xFF) * alpha / 255;
+                points[i].value[3] = alpha;
+                points[i].weight = static_cast<float>(aColors[i].count);
+                }
+
+            // median cut: split the box with the most error at the weighted median of its widest axis
+            std::vector<Box> boxes(1);
+            boxes[0].begin = 0;
+            boxes[0].end = points.size();
+            Measure(points, boxes[0]);
+            while (boxes.size() < static_cast<size_t>(aPaletteSize))
+                {
+                int worst = -1;
+                for (size_t i = 0; i < boxes.size(); ++i)
+                    if (boxes[i].end - boxes[i].begin > 1 && (worst < 0 || boxes[i].error > boxes[worst].error))
+                        worst = static_cast<int>(i);
+                if (worst < 0 || boxes[worst].error <= 0)
+                    break;
+
+                Box box = boxes[worst];
+                const int axis = box.axis;
+                std::sort(points.begin() + box.begin, points.begin() + box.end,
+                          [axis](const Point& aLeft, const Point& aRight)
+                          { return aLeft.value[axis] < aRight.value[axis]; });
+
+                double total = 0, below = 0;
+                for (size_t i = box.begin; i < box.end; ++i)
+                    total += points[i].weight;
+                size_t split = box.begin + 1;
+                for (size_t i = box.begin; i + 1 < box.end; ++i)
+                    {
+                    below += points[i].weight;
+                    split = i + 1;
+                    if (below >= total / 2)
+                        break;
+                    }
+
+                Box upper = box;
+                box.end = split;
+                upper.begin = split;
+                Measure(points, box);
+                Measure(points, upper);
+                boxes[worst] = box;
+                boxes.push_back(upper);
+                }
+
+            std::vector<float> means(4 * boxes.size());
+            for (size_t i = 0; i < boxes.size(); ++i)
+                {
+                float weight;
+                Mean(&points[boxes[i].begin], boxes[i].end - boxes[i].begin, &means[4 * i], weight);
+                }
+
+            // k-means: every point to its nearest mean, every mean to the center of its points
+            std::vector<double> sums(5 * boxes.size());
+            for (int pass = 0; pass < kKMeansPasses; ++pass)
+                {
+                std::fill(sums.begin(), sums.end(), 0.0);
+                for (const Point& point : points)
+                    {
+                    float best = FLT_MAX;
+                    size_t nearest = 0;
+                    for (size_t j = 0; j < boxes.size(); ++j)
+                        {
+                        const float* mean = &means[4 * j];
+                        float distance = 0;
+                        for (int c = 0; c < 4; ++c)
+                            distance += (point.value[c] - mean[c]) * (point.value[c] - mean[c]);
+                        if (distance < best)
+                            {
+                            best = distance;
+                            nearest = j;
+                            }
+                        }
+                    for (int c = 0; c < 4; ++c)
+                        sums[5 * nearest + c] += point.value[c] * point.weight;
+                    sums[5 * nearest + 4] += point.weight;
+                    }
+
+                // a mean left without points stays where it is
+                for (size_t j = 0; j < boxes.size(); ++j)
+                    if (sums[5 * j + 4] > 0)
+                        for (int c = 0; c < 4; ++c)
+                            means[4 * j + c] = static_cast<float>(sums[5 * j + c] / sums[5 * j + 4]);
+                }
+
+            // back to straight alpha
+            for (size_t j = 0; j < boxes.size(); ++j)
+                {
+                const float* mean = &means[4 * j];
+                const int alpha = std::min(255, std::max(0, static_cast<int>(mean[3] + 0.5f)));
+                uint32_t color = static_cast<uint32_t>(alpha) << 24;
+                if (alpha)
+                    for (int c = 0; c < 3; ++c)
+                        {
+                        const int value = static_cast<int>(mean[c] * 255 / alpha + 0.5f);
+                        color |= static_cast<uint32_t>(std::min(255, std::max(0, value))) << (8 * c);
+                        }
+                palette.push_back(color);
+                }
+            }
+
+        std::stable_partition(palette.begin(), palette.end(), [](uint32_t aColor) { return (aColor >> 24) != 255; });
+        return palette;
+    }
+
+
+    //==============================================================================
+    //! @brief Premultiply A Color Into 4 Ints, 0..255 Each
+    //==============================================================================
+    static inline void Premultiply(uint32_t aColor, int aValue[4])
+    {
+        const int alpha = static_cast<int>(aColor >> 24);
+        for (int c = 0; c < 3; ++c)
+            aValue[c] = (static_cast<int>((aColor >> (8 * c)) & 0xFF) * alpha + 127) / 255;
+        aValue[3] = alpha;
+    }
+
+
+    //==============================================================================
+    //! @brief Constructor
+    //! @param aPalette The Palette, Up To 256 Colors
+    //==============================================================================
+    PaletteMapper::PaletteMapper(const std::vector<uint32_t>& aPalette)
+        : iTableColors(size_t(1) << kExactTableBits, 0)
+        , iTableIndices(size_t(1) << kExactTableBits, -1)
+        , iAxis(0)
+    {
+        const size_t mask = iTableColors.size() - 1;
+        for (size_t i = 0; i < aPalette.size(); ++i)
+            {
+            size_t slot = Hash(aPalette[i], 32 - kExactTableBits);
+            while (iTableIndices[slot] >= 0 && iTableColors[slot] != aPalette[i])
+                slot = (slot + 1) & mask;
+            if (iTableIndices[slot] < 0)
+                {
+                iTableColors[slot] = aPalette[i];
+                iTableIndices[slot] = static_cast<int16_t>(i);
+                }
+            }
+
+        // sort along the channel the palette spreads most on, which prunes the search best
+        std::vector<int> values(4 * aPalette.size());
+        for (size_t i = 0; i < aPalette.size(); ++i)
+            Premultiply(aPalette[i], &values[4 * i]);
+
+        double best = -1;
+        for (int c = 0; c < 4; ++c)
+            {
+            double sum = 0, squares = 0;
+            for (size_t i = 0; i < aPalette.size(); ++i)
+                {
+                sum += values[4 * i + c];
+                squares += static_cast<double>(values[4 * i + c]) * values[4 * i + c];
+                }
+            const double spread = squares - sum * sum / std::max<size_t>(1, aPalette.size());
+            if (spread > best)
+                {
+                best = spread;
+                iAxis = c;
+                }
+            }
+
+        std::vector<int> order(aPalette.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = static_cast<int>(i);
+        const int axis = iAxis;
+        std::sort(order.begin(), order.end(), [&values, axis](int aLeft, int aRight)
+                  { return values[4 * aLeft + axis] < values[4 * aRight + axis]; });
+
+        iSorted.resize(values.size());
+        iIndices.resize(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            {
+            std::copy(&values[4 * order[i]], &values[4 * order[i]] + 4, &iSorted[4 * i]);
+            iIndices[i] = static_cast<uint8_t>(order[i]);
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Index Of The Palette Color For A Color
+    //! @param aColor The Color, As PixelColor() Gives It
+    //! @return The Palette Index
+    //==============================================================================
+    uint8_t PaletteMapper::Map(uint32_t aColor) const
+    {
+        const size_t mask = iTableColors.size() - 1;
+        for (size_t slot = Hash(aColor, 32 - kExactTableBits); iTableIndices[slot] >= 0; slot = (slot + 1) & mask)
+            if (iTableColors[slot] == aColor)
+                return static_cast<uint8_t>(iTableIndices[slot]);
+        return Nearest(aColor);
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Nearest Palette Color By Premultiplied Distance
+    //==============================================================================
+    uint8_t PaletteMapper::Nearest(uint32_t aColor) const
+    {
+        int value[4];
+        Premultiply(aColor, value);
+
+        // walk out both ways from the color's place on the axis; a side is done once
+        // the distance along the axis alone is no better than the best so far
+        const int count = static_cast<int>(iIndices.size());
+        int low = 0, high = count;
+        while (low < high)
+            {
+            const int middle = (low + high) / 2;
+            if (iSorted[4 * middle + iAxis] < value[iAxis])
+                low = middle + 1;
+            else
+                high = middle;
+            }
+
+        int best = INT_MAX, nearest = 0;
+        int down = low - 1, up = low;
+        while (down >= 0 || up < count)
+            {
+            for (int side = 0; side < 2; ++side)
+                {
+                int& i = side ? down : up;
+                if (i < 0 || i >= count)
+                    continue;
+
+                const int* candidate = &iSorted[4 * i];
+                const int along = candidate[iAxis] - value[iAxis];
+                if (along * along >= best)
+                    {
+                    i = side ? -1 : count;
+                    continue;
+                    }
+
+                int distance = 0;
+                for (int c = 0; c < 4; ++c)
+                    distance += (candidate[c] - value[c]) * (candidate[c] - value[c]);
+                if (distance < best)
+                    {
+                    best = distance;
+                    nearest = i;
+                    }
+                i += side ? -1 : 1;
+                }
+            }
+        return iIndices[nearest];
+    }
+}
+
+// End Of File
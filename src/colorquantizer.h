@@ -0,0 +1,82 @@
+//==============================================================================
+// Name         : colorquantizer.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The Color Counting, Palette Building And Palette
+//                Mapping Behind Indexed-Color Output
+//==============================================================================
+
+#ifndef COLORQUANTIZER_H
+#define COLORQUANTIZER_H
+
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t, int16_t, uint32_t
+#include <vector>     // std::vector
+
+namespace colorquantizer
+{
+    //! A Distinct Color, RGBA With R In The Low Byte, And How Many Pixels Have It
+    struct ColorCount
+    {
+        uint32_t    color;
+        uint32_t    count;
+    };
+
+    //! @brief Get The Color Of An RGBA Pixel; Every Fully Transparent Pixel Is Transparent Black
+    inline uint32_t PixelColor(const uint8_t* aPixel)
+    {
+        return aPixel[3] ? (aPixel[0] | aPixel[1] << 8 | aPixel[2] << 16 | static_cast<uint32_t>(aPixel[3]) << 24) : 0;
+    }
+
+    //! @brief Count The Distinct Colors Of An Image With A Hash Set
+    //! @param aPixels The Pixels, RGBA
+    //! @param aPixelCount The Number Of Pixels
+    //! @param aLimit Give Up Once There Are More Distinct Colors Than This
+    //! @param aDroppedBits Low Bits Dropped From Each Channel First, 0 To Count Exactly
+    //! @param aColors Receives The Colors And Their Counts
+    //! @return False If There Were More Than aLimit Colors, aColors Is Then Incomplete
+    bool CountColors(const uint8_t* aPixels, size_t aPixelCount, size_t aLimit, int aDroppedBits,
+                     std::vector<ColorCount>& aColors);
+
+    //! @brief Choose Up To aPaletteSize Colors Representing A Histogram: Its Own
+    //!        Colors If They Fit, Else A Median Cut Refined By K-Means, Both On
+    //!        Premultiplied Colors So Barely Visible Pixels Weigh Little
+    //! @param aColors The Histogram
+    //! @param aPaletteSize The Most Colors, 1 To 256
+    //! @return The Palette, Translucent Colors First So tRNS Can Stop Early
+    std::vector<uint32_t> BuildPalette(const std::vector<ColorCount>& aColors, int aPaletteSize);
+
+
+    //==============================================================================
+    //! PaletteMapper Class
+    //! Finds The Palette Index Of A Color: The Exact Entry When There Is One, Else
+    //! The Nearest By Premultiplied Distance, Searched Outwards Along The Axis The
+    //! Palette Spreads Most On
+    //==============================================================================
+    class PaletteMapper
+    {
+        public:
+        //! @brief Constructor
+        //! @param aPalette The Palette, Up To 256 Colors
+        explicit PaletteMapper(const std::vector<uint32_t>& aPalette);
+
+        //! @brief Get The Index Of The Palette Color For A Color
+        //! @param aColor The Color, As PixelColor() Gives It
+        //! @return The Palette Index
+        uint8_t Map(uint32_t aColor) const;
+
+        private:
+        //! @brief Find The Nearest Palette Color By Premultiplied Distance
+        uint8_t Nearest(uint32_t aColor) const;
+
+        private:
+        std::vector<uint32_t>   iTableColors;     // open addressing table of the palette colors
+        std::vector<int16_t>    iTableIndices;    // their palette indices, -1 for an empty slot
+        std::vector<int>        iSorted;          // premultiplied palette colors, 4 ints each, sorted along iAxis
+        std::vector<uint8_t>    iIndices;         // the palette index of each sorted color
+        int                     iAxis;            // the channel the palette is sorted on
+    };
+}
+
+#endif    // COLORQUANTIZER_H
+
+// End Of File
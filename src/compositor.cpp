@@ -0,0 +1,345 @@
+//==============================================================================
+// Name         : compositor.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements Compositor Class
+//==============================================================================
+
+#include "compositor.h"        // Compositor
+#include <algorithm>           // std::min, std::max, std::sort
+#include <string.h>            // memset, memcpy
+#include "blitkernels.h"       // blitkernels::Active
+#include "threadpool.h"        // ThreadPool
+
+
+//! Images Taller Than This Are Split Into Several Blit Tasks,
+//! So One Huge Image Does Not Leave The Other Threads Idle
+static const int kRowsPerBlitTask = 64;
+
+//! Bands Are Sized To About One 2 MB Huge Page, One TLB Entry Per Band
+static const size_t kBandBytes = 2 * 1024 * 1024;
+
+//! In Band Mode, Image Rows At Least This Long Use Non-Temporal Stores
+static const size_t kStreamRowBytes = 1024;
+
+//! Gray And Palette Rows Drawn Into A 16-bit Atlas Go Through RGBA This Many Pixels At A Time
+static const int kWidenRun = 256;
+
+
+//==============================================================================
+//! @brief Constructor, Also Works Out Which Images Cross Each Band
+//! @param aImages The Images, With Their Atlas Positions Filled In
+//! @param aFreeRects The Areas No Image Covers, Cleared To Zero While Drawing;
+//!        Leave Empty When The Atlas Buffer Is Zero Already
+//! @param aAtlasWidth The Texture Atlas Width
+//! @param aAtlasHeight The Texture Atlas Height
+//! @param aBandHeight Rows Per Band, 0 Picks Bands Of About One Huge Page
+//! @param aChannels Channels Per Atlas Pixel; Below 4, Every Image Must Have That Many Channels
+//!        And No Palette
+//! @param aBitDepth Bits Per Atlas Channel, 8, Or 16 For An RGBA Atlas Any Image May Be Drawn Into
+//==============================================================================
+Compositor::Compositor(const std::vector<Image>& aImages, const std::vector<Rect>& aFreeRects,
+                       int aAtlasWidth, int aAtlasHeight, int aBandHeight, int aChannels, int aBitDepth)
+    : iImages(aImages)
+    , iFreeRects(aFreeRects)
+    , iAtlasWidth(aAtlasWidth)
+    , iAtlasHeight(aAtlasHeight)
+    , iChannels(aChannels)
+    , iBitDepth(aBitDepth)
+    , iPixelBytes(aChannels * aBitDepth / 8)
+    , iRowBytes(iPixelBytes * static_cast<size_t>(aAtlasWidth))
+    , iBandHeight(aBandHeight)
+{
+    if (iBandHeight <= 0)
+        iBandHeight = static_cast<int>(std::max<size_t>(1, kBandBytes / iRowBytes));
+
+    iBandItems.resize((iAtlasHeight + iBandHeight - 1) / iBandHeight);
+
+    auto addItem = [this](const Rect& aRect, int aImgID)
+        {
+        const int firstBand = aRect.y / iBandHeight;
+        const int lastBand = (aRect.y + aRect.height - 1) / iBandHeight;
+        for (int band = firstBand; band <= lastBand; ++band)
+            iBandItems[band].push_back(BandItem { aRect, aImgID });
+        };
+
+    for (auto i = 0; i != iImages.size(); ++i)
+        addItem(Rect(iImages[i].x, iImages[i].y, iImages[i].width, iImages[i].height), i);
+    for (const Rect& freeRect : iFreeRects)
+        addItem(freeRect, -1);
+
+    // left to right, so each atlas row is written front to back
+    for (std::vector<BandItem>& bandItems : iBandItems)
+        std::sort(bandItems.begin(), bandItems.end(),
+                  [](const BandItem& aLeft, const BandItem& aRight) { return aLeft.rect.x < aRight.rect.x; });
+}
+
+
+//==============================================================================
+//! @brief Copy A Row Of Any Pixel Size With A 4 Byte Pixel Copy Kernel,
+//!        The Last Few Bytes With memcpy
+//==============================================================================
+static inline void CopyRow(blitkernels::RowKernel aCopy, uint8_t* aDst, const uint8_t* aSrc, size_t aBytes)
+{
+    const size_t whole = aBytes & ~size_t(3);
+    aCopy(aDst, aSrc, aBytes / 4);
+    memcpy(aDst + whole, aSrc + whole, aBytes - whole);
+}
+
+
+//==============================================================================
+//! @brief Get The Bytes Of One Image Row
+//==============================================================================
+static inline size_t SourceRowBytes(const Image& aImage)
+{
+    return static_cast<size_t>(aImage.width) * aImage.channels * (aImage.bitDepth / 8);
+}
+
+
+//==============================================================================
+//! @brief Get The Bytes Of One Image Pixel, Palette Indices Being One
+//==============================================================================
+static inline size_t SourcePixelBytes(const Image& aImage)
+{
+    return static_cast<size_t>(aImage.channels) * (aImage.bitDepth / 8);
+}
+
+
+//==============================================================================
+//! @brief Blit One Image Row Into A 16-bit RGBA Texture Atlas
+//! @param aKernels The Row Kernels
+//! @param aImage The Image
+//! @param aDst Where The Row Goes In The Atlas
+//! @param aSrc The Image Row
+//! @param aPixels The Pixels To Blit
+//! @param aStream Copy 16-bit RGBA Rows With Non-Temporal Stores
+//==============================================================================
+static void BlitRow16(const blitkernels::Kernels& aKernels, const Image& aImage,
+                      uint8_t* aDst, const uint8_t* aSrc, int aPixels, bool aStream)
+{
+    if (aImage.bitDepth == 16)
+        {
+        if (aImage.channels == 4)
+            CopyRow(aStream ? aKernels.copyRGBAStream : aKernels.copyRGBA, aDst, aSrc, 8 * static_cast<size_t>(aPixels));
+        else
+            aKernels.expandRGB16(aDst, aSrc, aPixels);
+        return;
+        }
+
+    // 8-bit samples are widened to x * 257, so 255 stays full scale
+    if (!aImage.palette && aImage.channels >= 3)
+        {
+        (aImage.channels == 4 ? aKernels.widenRGBA : aKernels.widenRGB)(aDst, aSrc, aPixels);
+        return;
+        }
+
+    // gray and palette rows are expanded to RGBA on the stack first, a run at a time
+    uint8_t rgba[4 * kWidenRun];
+    for (int x = 0; x < aPixels; x += kWidenRun)
+        {
+        const int count = std::min(kWidenRun, aPixels - x);
+        const uint8_t* src = aSrc + static_cast<size_t>(x) * aImage.channels;
+        if (aImage.palette)
+            aKernels.expandIndexed(rgba, src, count, aImage.palette);
+        else if (aImage.channels == 2)
+            aKernels.expandGrayAlpha(rgba, src, count);
+        else
+            aKernels.expandGray(rgba, src, count);
+        aKernels.widenRGBA(aDst + 8 * static_cast<size_t>(x), rgba, count);
+        }
+}
+
+
+//==============================================================================
+//! @brief Blit One Image Row Into The Texture Atlas
+//! @param aKernels The Row Kernels
+//! @param aImage The Image
+//! @param aDst Where The Row Goes In The Atlas
+//! @param aSrc The Image Row
+//! @param aPixels The Pixels To Blit
+//! @param aDstChannels Channels Per Atlas Pixel
+//! @param aDstBitDepth Bits Per Atlas Channel
+//! @param aStream Use The Kernels With Non-Temporal Stores
+//==============================================================================
+static inline void BlitRow(const blitkernels::Kernels& aKernels, const Image& aImage, uint8_t* aDst,
+                           const uint8_t* aSrc, int aPixels, int aDstChannels, int aDstBitDepth, bool aStream)
+{
+    if (aDstBitDepth == 16)
+        {
+        BlitRow16(aKernels, aImage, aDst, aSrc, aPixels, aStream);
+        return;
+        }
+
+    // rows already in the atlas pixel size are plain copies, narrower ones are expanded
+    // to RGBA with alpha filled with 0xFF unless they have one; palette rows are looked up
+    if (aImage.palette)
+        aKernels.expandIndexed(aDst, aSrc, aPixels, aImage.palette);
+    else if (aImage.channels == aDstChannels)
+        CopyRow(aStream ? aKernels.copyRGBAStream : aKernels.copyRGBA, aDst, aSrc,
+                static_cast<size_t>(aPixels) * aImage.channels);
+    else if (aImage.channels == 3)
+        (aStream ? aKernels.expandRGBStream : aKernels.expandRGB)(aDst, aSrc, aPixels);
+    else if (aImage.channels == 2)
+        (aStream ? aKernels.expandGrayAlphaStream : aKernels.expandGrayAlpha)(aDst, aSrc, aPixels);
+    else
+        (aStream ? aKernels.expandGrayStream : aKernels.expandGray)(aDst, aSrc, aPixels);
+}
+
+
+//==============================================================================
+//! @brief Blit One Image Row, Only Its Span When The Image Has Spans, Whose
+//!        Rectangle May Then Overlap Other Images Outside Them
+//! @param aKernels The Row Kernels
+//! @param aImage The Image
+//! @param aRow The Image Row
+//! @param aDst Where The Row Goes In The Atlas
+//! @param aDstPixelBytes Bytes Per Atlas Pixel
+//! @param aDstChannels Channels Per Atlas Pixel
+//! @param aDstBitDepth Bits Per Atlas Channel
+//! @param aStream Use The Kernels With Non-Temporal Stores
+//==============================================================================
+static inline void BlitSpan(const blitkernels::Kernels& aKernels, const Image& aImage, int aRow, uint8_t* aDst,
+                            size_t aDstPixelBytes, int aDstChannels, int aDstBitDepth, bool aStream)
+{
+    const uint8_t* src = aImage.data + aRow * SourceRowBytes(aImage);
+    if (!aImage.spans)
+        {
+        BlitRow(aKernels, aImage, aDst, src, aImage.width, aDstChannels, aDstBitDepth, aStream);
+        return;
+        }
+
+    const int begin = aImage.spans[2 * aRow], end = aImage.spans[2 * aRow + 1];
+    if (begin < end)
+        BlitRow(aKernels, aImage, aDst + begin * aDstPixelBytes, src + begin * SourcePixelBytes(aImage),
+                end - begin, aDstChannels, aDstBitDepth, aStream);
+}
+
+
+//==============================================================================
+//! @brief Blit Rows Of One Image Into The Texture Atlas
+//! @param aImage The Image
+//! @param aFirstRow The First Image Row To Blit
+//! @param aRowCount The Number Of Rows To Blit
+//! @param aDst Where Image Row aFirstRow Goes In The Atlas
+//! @param aDstRowBytes The Atlas Row Bytes
+//! @param aDstPixelBytes Bytes Per Atlas Pixel
+//! @param aDstChannels Channels Per Atlas Pixel
+//! @param aDstBitDepth Bits Per Atlas Channel
+//==============================================================================
+static void BlitImageRows(const Image& aImage, int aFirstRow, int aRowCount, uint8_t* aDst,
+                          const size_t aDstRowBytes, size_t aDstPixelBytes, int aDstChannels, int aDstBitDepth)
+{
+    // the row kernels are picked once for this CPU
+    const blitkernels::Kernels& kernels = blitkernels::Active();
+
+    for (int y = 0; y < aRowCount; y++)
+        {
+        BlitSpan(kernels, aImage, aFirstRow + y, aDst, aDstPixelBytes, aDstChannels, aDstBitDepth, false);
+        aDst += aDstRowBytes;
+        }
+}
+
+
+//==============================================================================
+//! @brief Clear The Free Rectangles, Slices Of Them Handed Out Across The Threads
+//! @param aAtlas The Texture Atlas Bytes
+//! @param aThreadPool The Threads To Clear With
+//==============================================================================
+void Compositor::ClearFreeRects(uint8_t* aAtlas, ThreadPool& aThreadPool) const
+{
+    // free rectangles are sliced like images, imgID holds the rectangle index
+    std::vector<BlitTask> tasks;
+    for (auto i = 0; i != iFreeRects.size(); ++i)
+        for (int row = 0; row < iFreeRects[i].height; row += kRowsPerBlitTask)
+            tasks.push_back(BlitTask(i, row, std::min(kRowsPerBlitTask, iFreeRects[i].height - row)));
+
+    aThreadPool.ParallelFor(tasks.size(), [&](size_t aTask)
+        {
+        const BlitTask& task = tasks[aTask];
+        const Rect& rect = iFreeRects[task.imgID];
+
+        uint8_t* dst = aAtlas + (rect.y + task.firstRow) * iRowBytes + iPixelBytes * rect.x;
+        for (int y = 0; y < task.rowCount; ++y, dst += iRowBytes)
+            memset(dst, 0, iPixelBytes * rect.width);
+        });
+}
+
+
+//==============================================================================
+//! @brief Clear The Free Rectangles, Then Draw All Images One By One,
+//!        Slices Of Both Handed Out Across The Threads
+//! @param aAtlas The Texture Atlas Bytes
+//! @param aThreadPool The Threads To Draw With
+//==============================================================================
+void Compositor::DrawSprites(uint8_t* aAtlas, ThreadPool& aThreadPool) const
+{
+    ClearFreeRects(aAtlas, aThreadPool);
+
+    // destination rectangles never overlap, or only outside the spans of images that have
+    // them, so the slices can be drawn in any order; the list is sorted by max side, so big
+    // slices are handed out first
+    std::vector<BlitTask> tasks;
+    for (auto i = 0; i != iImages.size(); ++i)
+        for (int row = 0; row < iImages[i].height; row += kRowsPerBlitTask)
+            tasks.push_back(BlitTask(i, row, std::min(kRowsPerBlitTask, iImages[i].height - row)));
+
+    aThreadPool.ParallelFor(tasks.size(), [&](size_t aTask)
+        {
+        const BlitTask& task = tasks[aTask];
+        const Image& img = iImages[task.imgID];
+
+        uint8_t* dst = aAtlas + (img.y + task.firstRow) * iRowBytes + iPixelBytes * img.x;
+        BlitImageRows(img, task.firstRow, task.rowCount, dst, iRowBytes, iPixelBytes, iChannels, iBitDepth);
+        });
+}
+
+
+//==============================================================================
+//! @brief Draw All Bands, Handed Out Across The Threads
+//! @param aAtlas The Texture Atlas Bytes
+//! @param aThreadPool The Threads To Draw With
+//==============================================================================
+void Compositor::DrawBands(uint8_t* aAtlas, ThreadPool& aThreadPool) const
+{
+    aThreadPool.ParallelFor(iBandItems.size(), [&](size_t aBand)
+        {
+        DrawBand(static_cast<int>(aBand), aAtlas + aBand * iBandHeight * iRowBytes, true);
+        });
+}
+
+
+//==============================================================================
+//! @brief Draw One Band, Row By Row Across Every Image And Free Rectangle Crossing It
+//! @param aBand The Band Index
+//! @param aDst Where The Band's First Row Goes, Rows Are RowBytes() Apart
+//! @param aStreamingStores Write Long Rows With Non-Temporal Stores
+//==============================================================================
+void Compositor::DrawBand(int aBand, uint8_t* aDst, bool aStreamingStores) const
+{
+    const int top = aBand * iBandHeight;
+    const int bottom = std::min(top + iBandHeight, iAtlasHeight);
+    const std::vector<BandItem>& bandItems = iBandItems[aBand];
+    const blitkernels::Kernels& kernels = blitkernels::Active();
+
+    for (int y = top; y < bottom; ++y, aDst += iRowBytes)
+        {
+        for (const BandItem& item : bandItems)
+            {
+            const Rect& rect = item.rect;
+            if (y < rect.y || y >= rect.y + rect.height)
+                continue;
+
+            uint8_t* dst = aDst + iPixelBytes * rect.x;
+            if (item.imgID < 0)
+                {
+                memset(dst, 0, iPixelBytes * rect.width);
+                continue;
+                }
+
+            const Image& img = iImages[item.imgID];
+            const bool stream = aStreamingStores && iPixelBytes * img.width >= kStreamRowBytes;
+            BlitSpan(kernels, img, y - img.y, dst, iPixelBytes, iChannels, iBitDepth, stream);
+            }
+        }
+}
+
+// End Of File
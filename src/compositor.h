@@ -0,0 +1,125 @@
+//==============================================================================
+// Name         : compositor.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares Compositor Class
+//==============================================================================
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <vector>     // std::vector
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t
+#include "image.h"    // Image
+#include "rect.h"     // Rect
+
+class ThreadPool;
+
+
+//==============================================================================
+//! BlitTask Struct, A Horizontal Slice Of One Image To Draw On The Texture Atlas,
+//! Or Of One Free Rectangle To Clear
+//! The Unit Of Work When Compositing Is Split Across Threads
+//==============================================================================
+struct BlitTask
+{
+    //! @brief Constructor
+    //! @param aImgID The Index Of The Image In The Image List (Of The Rectangle When Clearing)
+    //! @param aFirstRow The First Image Row Of The Slice
+    //! @param aRowCount The Number Of Rows In The Slice
+    BlitTask(int aImgID, int aFirstRow, int aRowCount)
+        : imgID(aImgID), firstRow(aFirstRow), rowCount(aRowCount)
+    {
+    };
+
+    int imgID;
+    int firstRow;
+    int rowCount;
+};
+
+
+//==============================================================================
+//! Compositor Class
+//! Draws The Placed Images Onto The Texture Atlas, Either Image By Image
+//! Or Band By Band (Horizontal Strips Of Atlas Rows Written In Memory Order),
+//! And Clears The Free Rectangles, So The Atlas Buffer Needn't Start Zeroed
+//==============================================================================
+class Compositor
+{
+    public:
+    //! @brief Constructor, Also Works Out Which Images Cross Each Band
+    //! @param aImages The Images, With Their Atlas Positions Filled In
+    //! @param aFreeRects The Areas No Image Covers, Cleared To Zero While Drawing;
+    //!        Leave Empty When The Atlas Buffer Is Zero Already
+    //! @param aAtlasWidth The Texture Atlas Width
+    //! @param aAtlasHeight The Texture Atlas Height
+    //! @param aBandHeight Rows Per Band, 0 Picks Bands Of About One Huge Page
+    //! @param aChannels Channels Per Atlas Pixel; Below 4, Every Image Must Have That Many Channels
+    //!        And No Palette
+    //! @param aBitDepth Bits Per Atlas Channel, 8, Or 16 For An RGBA Atlas Any Image May Be Drawn Into
+    Compositor(const std::vector<Image>& aImages, const std::vector<Rect>& aFreeRects,
+               int aAtlasWidth, int aAtlasHeight, int aBandHeight = 0, int aChannels = 4, int aBitDepth = 8);
+
+    //! @brief Clear The Free Rectangles, Then Draw All Images One By One,
+    //!        Slices Of Both Handed Out Across The Threads
+    //! @param aAtlas The Texture Atlas Bytes, RowBytes() Per Row
+    //! @param aThreadPool The Threads To Draw With
+    void DrawSprites(uint8_t* aAtlas, ThreadPool& aThreadPool) const;
+
+    //! @brief Draw All Bands, Handed Out Across The Threads; Long Rows Are Written
+    //!        With Non-Temporal Stores So They Don't Evict The Source Images From Cache
+    //! @param aAtlas The Texture Atlas Bytes, RowBytes() Per Row
+    //! @param aThreadPool The Threads To Draw With
+    void DrawBands(uint8_t* aAtlas, ThreadPool& aThreadPool) const;
+
+    //! @brief Draw One Band, Row By Row Across Every Image And Free Rectangle Crossing It
+    //! @param aBand The Band Index
+    //! @param aDst Where The Band's First Row Goes, Rows Are RowBytes() Apart
+    //! @param aStreamingStores Write Long Rows With Non-Temporal Stores
+    void DrawBand(int aBand, uint8_t* aDst, bool aStreamingStores) const;
+
+    //! @brief Get The Number Of Bands
+    int BandCount() const
+    {
+        return static_cast<int>(iBandItems.size());
+    };
+
+    //! @brief Get The Rows Per Band, The Last Band May Be Shorter
+    int BandHeight() const
+    {
+        return iBandHeight;
+    };
+
+    //! @brief Get The Texture Atlas Row Bytes
+    size_t RowBytes() const
+    {
+        return iRowBytes;
+    };
+
+    private:
+    //! One Rectangle Crossing A Band: An Image, Or A Free Rectangle (imgID -1)
+    struct BandItem
+    {
+        Rect    rect;
+        int     imgID;
+    };
+
+    //! @brief Clear The Free Rectangles, Slices Of Them Handed Out Across The Threads
+    void ClearFreeRects(uint8_t* aAtlas, ThreadPool& aThreadPool) const;
+
+    private:
+    const std::vector<Image>&               iImages;
+    std::vector<Rect>                       iFreeRects;
+    int                                     iAtlasWidth;
+    int                                     iAtlasHeight;
+    int                                     iChannels;
+    int                                     iBitDepth;
+    size_t                                  iPixelBytes;
+    size_t                                  iRowBytes;
+    int                                     iBandHeight;
+    std::vector<std::vector<BandItem>>      iBandItems;    // per band, what crosses it sorted by x
+};
+
+#endif    // COMPOSITOR_H
+
+// End Of File
@@ -0,0 +1,212 @@
+//==============================================================================
+// Name         : directoryscanner.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The Function That Finds The Image Files Of A Folder
+//                Tree, Listing Its Folders In Parallel
+//==============================================================================
+
+#include "directoryscanner.h"    // directoryscanner::FindFiles
+#include <algorithm>             // std::sort
+#include <stdexcept>             // std::runtime_error
+#include <cstdint>               // uint64_t, int64_t
+#include <string.h>              // strlen, strcmp
+#include "threadpool.h"          // ThreadPool
+
+#if defined(__linux__)
+    #include <fcntl.h>           // openat, O_DIRECTORY, AT_FDCWD
+    #include <unistd.h>          // syscall, close
+    #include <sys/syscall.h>     // SYS_getdents64
+    #include <sys/stat.h>        // fstatat
+    #include <dirent.h>          // DT_REG, DT_DIR, DT_UNKNOWN
+#else
+    #include <dirent.h>          // DIR, dirent
+    #if !defined(_WIN32)
+        #include <sys/stat.h>    // lstat
+    #endif
+#endif
+
+
+namespace directoryscanner
+{
+    //==============================================================================
+    //! The Entries Of One Folder Worth Keeping
+    //==============================================================================
+    struct Listing
+    {
+        Listing()
+            : opened(false)
+        {
+        };
+
+        bool                        opened;
+        std::vector<std::string>    files;      // relative to the scanned folder
+        std::vector<std::string>    folders;    // relative to the scanned folder, each ending in '/'
+    };
+
+
+    //==============================================================================
+    //! @brief Whether A File Name Ends In An Extension
+    //==============================================================================
+    static inline bool HasExtension(const char* aName, size_t aLength, const std::string& aExtension)
+    {
+        return aLength >= aExtension.size()
+               && aExtension.compare(0, std::string::npos, aName + aLength - aExtension.size()) == 0;
+    }
+
+
+    //==============================================================================
+    //! @brief Sort A Folder Entry Into The Listing By Its Type
+    //! @param aListing The Listing
+    //! @param aPrefix The Folder Path Relative To The Scanned Folder, Ending In '/' Unless Empty
+    //! @param aName The Entry Name
+    //! @param aType DT_REG, DT_DIR Or Anything Else, Which Is Left Out
+    //! @param aExtension The File Name Ending Wanted
+    //==============================================================================
+    static void AddEntry(Listing& aListing, const std::string& aPrefix, const char* aName, unsigned char aType,
+                         const std::string& aExtension)
+    {
+        const size_t length = strlen(aName);
+        if (aType == DT_REG && HasExtension(aName, length, aExtension))
+            aListing.files.push_back(aPrefix + aName);
+        else if (aType == DT_DIR && strcmp(aName, ".") != 0 && strcmp(aName, "..") != 0)
+            aListing.folders.push_back(aPrefix + aName + "/");
+    }
+
+
+#if defined(__linux__)
+    //==============================================================================
+    //! A Record Of getdents64, As The Kernel Lays It Out
+    //==============================================================================
+    struct LinuxDirent64
+    {
+        uint64_t        d_ino;
+        int64_t         d_off;
+        unsigned short  d_reclen;
+        unsigned char   d_type;
+        char            d_name[1];    // nul-terminated, as long as the record allows
+    };
+
+
+    //==============================================================================
+    //! @brief List A Folder With getdents64, Tens Of Entries Per System Call; Only
+    //!        Entries Whose Type The File System Doesn't Report Cost An fstatat
+    //! @param aPath The Folder Path
+    //! @param aPrefix The Folder Path Relative To The Scanned Folder
+    //! @param aExtension The File Name Ending Wanted
+    //! @return The Listing
+    //==============================================================================
+    static Listing ListFolder(const std::string& aPath, const std::string& aPrefix, const std::string& aExtension)
+    {
+        Listing listing;
+        const int folder = openat(AT_FDCWD, aPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (folder < 0)
+            return listing;
+        listing.opened = true;
+
+        std::vector<char> buffer(64 * 1024);
+        for (;;)
+            {
+            const long bytes = syscall(SYS_getdents64, folder, buffer.data(), buffer.size());
+            if (bytes <= 0)
+                break;
+
+            for (long offset = 0; offset < bytes;)
+                {
+                const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                offset += entry->d_reclen;
+
+                // some file systems (older XFS, network mounts) don't fill in the type
+                unsigned char type = entry->d_type;
+                if (type == DT_UNKNOWN)
+                    {
+                    struct stat status;
+                    if (fstatat(folder, entry->d_name, &status, AT_SYMLINK_NOFOLLOW) == 0)
+                        type = S_ISREG(status.st_mode) ? DT_REG : S_ISDIR(status.st_mode) ? DT_DIR : DT_UNKNOWN;
+                    }
+                AddEntry(listing, aPrefix, entry->d_name, type, aExtension);
+                }
+            }
+        close(folder);
+        return listing;
+    }
+#else
+    //==============================================================================
+    //! @brief List A Folder With readdir; Only Entries Whose Type The File System
+    //!        Doesn't Report Cost An lstat
+    //! @param aPath The Folder Path
+    //! @param aPrefix The Folder Path Relative To The Scanned Folder
+    //! @param aExtension The File Name Ending Wanted
+    //! @return The Listing
+    //==============================================================================
+    static Listing ListFolder(const std::string& aPath, const std::string& aPrefix, const std::string& aExtension)
+    {
+        Listing listing;
+        DIR* folder = opendir(aPath.c_str());
+        if (!folder)
+            return listing;
+        listing.opened = true;
+
+        while (const dirent* entry = readdir(folder))
+            {
+            unsigned char type = entry->d_type;
+    #if !defined(_WIN32)
+            if (type == DT_UNKNOWN)
+                {
+                struct stat status;
+                if (lstat((aPath + "/" + entry->d_name).c_str(), &status) == 0)
+                    type = S_ISREG(status.st_mode) ? DT_REG : S_ISDIR(status.st_mode) ? DT_DIR : DT_UNKNOWN;
+                }
+    #endif
+            AddEntry(listing, aPrefix, entry->d_name, type, aExtension);
+            }
+        closedir(folder);
+        return listing;
+    }
+#endif
+
+
+    //==============================================================================
+    //! @brief Find The Regular Files With An Extension In A Folder, And With
+    //!        aRecursive In Its Subfolders At Any Depth; Symbolic Links Are Not
+    //!        Followed, So A Tree With Link Cycles Still Ends
+    //! @param aFolder The Folder
+    //! @param aExtension The File Name Ending, e.g. ".png", Matched Case-Sensitively
+    //! @param aRecursive Whether Subfolders Are Searched Too
+    //! @param aThreadPool Lists The Folders Of Each Depth In Parallel
+    //! @return The File Paths Relative To aFolder, '/' Between Folders, Sorted By
+    //!         Their Bytes So The Order Doesn't Depend On The File System
+    //==============================================================================
+    std::vector<std::string> FindFiles(const std::string& aFolder, const std::string& aExtension, bool aRecursive,
+                                       ThreadPool& aThreadPool)
+    {
+        std::vector<std::string> files;
+        std::vector<std::string> level(1, std::string());    // the folders of one depth, relative
+        for (bool root = true; !level.empty(); root = false)
+            {
+            // every folder of a depth is listed on the pool at once, wide trees keep all threads busy
+            std::vector<Listing> listings(level.size());
+            aThreadPool.ParallelFor(level.size(), [&](size_t aFolderIndex)
+                {
+                listings[aFolderIndex] = ListFolder(aFolder + "/" + level[aFolderIndex], level[aFolderIndex],
+                                                    aExtension);
+                });
+            if (root && !listings[0].opened)
+                throw std::runtime_error("Please provide a valid directory");
+
+            // subfolders that can't be opened are skipped like files that can't be read
+            std::vector<std::string> next;
+            for (Listing& listing : listings)
+                {
+                files.insert(files.end(), listing.files.begin(), listing.files.end());
+                if (aRecursive)
+                    next.insert(next.end(), listing.folders.begin(), listing.folders.end());
+                }
+            level.swap(next);
+            }
+
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+}
+
+// End Of File
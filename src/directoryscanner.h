@@ -0,0 +1,33 @@
+//==============================================================================
+// Name         : directoryscanner.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The Function That Finds The Image Files Of A Folder
+//                Tree, Listing Its Folders In Parallel
+//==============================================================================
+
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+
+#include <vector>     // std::vector
+#include <string>     // std::string
+
+class ThreadPool;
+
+namespace directoryscanner
+{
+    //! @brief Find The Regular Files With An Extension In A Folder, And With
+    //!        aRecursive In Its Subfolders At Any Depth; Symbolic Links Are Not
+    //!        Followed, So A Tree With Link Cycles Still Ends
+    //! @param aFolder The Folder
+    //! @param aExtension The File Name Ending, e.g. ".png", Matched Case-Sensitively
+    //! @param aRecursive Whether Subfolders Are Searched Too
+    //! @param aThreadPool Lists The Folders Of Each Depth In Parallel
+    //! @return The File Paths Relative To aFolder, '/' Between Folders, Sorted By
+    //!         Their Bytes So The Order Doesn't Depend On The File System
+    std::vector<std::string> FindFiles(const std::string& aFolder, const std::string& aExtension, bool aRecursive,
+                                       ThreadPool& aThreadPool);
+}
+
+#endif    // DIRECTORYSCANNER_H
+
+// End Of File
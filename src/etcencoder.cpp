@@ -0,0 +1,640 @@
+//==============================================================================
+// Name         : etcencoder.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The ETC2 RGB And ETC2 RGBA8 Block Encoders
+//==============================================================================
+
+#include "etcencoder.h"      // EncodeETC2RGB, EncodeETC2RGBA
+#include "blockencoder.h"    // blockencoder::Active, the SIMD index kernel
+#include <algorithm>         // std::min, std::max, std::swap
+#include <cstdlib>           // std::abs
+
+namespace etcencoder
+{
+    //! ETC1 Intensity Modifiers Per Table Codeword: The Small And The Large Step
+    static const int kModifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+    //! ETC2 T And H Mode Distances
+    static const int kDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+    //! EAC Modifiers Per Table, Scaled By The Block's Multiplier
+    static const int kAlphaModifiers[16][8] =
+    {
+        {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+        {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+        {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+        {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+        {-2, -6, -8, -10, 1, 5, 7, 9}, {-2, -5, -8, -10, 1, 4, 7, 9},
+        {-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+        {-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9},
+        {-4, -6, -8, -9, 3, 5, 7, 8}, {-3, -5, -7, -9, 2, 4, 6, 8}
+    };
+
+    //! The Two Subblocks Per Flip Bit, As Masks Of Row-Major Pixels:
+    //! Left And Right Halves, Or Top And Bottom
+    static const uint16_t kSubblocks[2][2] = {{0x3333, 0xCCCC}, {0x00FF, 0xFF00}};
+
+    //! The Block Modes, Told Apart By The Decoder From The Differential Bit And Overflow
+    enum class Mode
+    {
+        Individual,      // two 4-bit base colors
+        Differential,    // a 5-bit base color and a 3-bit signed offset
+        T,               // red overflows: one color, and one with a distance either way
+        H,               // green overflows: two colors, each with a distance either way
+        Planar           // blue overflows: a color gradient over the block
+    };
+
+    //! The Best Block Found So Far
+    struct Candidate
+    {
+        uint64_t    bits;
+        uint32_t    error;
+    };
+
+
+    //==============================================================================
+    //! @brief Clamp A Value To 0..255
+    //==============================================================================
+    static inline int Clamp255(int aValue)
+    {
+        return std::min(255, std::max(0, aValue));
+    }
+
+
+    //==============================================================================
+    //! @brief Quantize An 8-bit Value To aBits Bits, Rounding
+    //==============================================================================
+    static inline int Quantize(float aValue, int aBits)
+    {
+        const int top = (1 << aBits) - 1;
+        return std::min(top, std::max(0, static_cast<int>(aValue * top / 255 + 0.5f)));
+    }
+
+
+    //==============================================================================
+    //! @brief Expand A 4, 5, 6 Or 7-bit Value To 8 Bits By Repeating Its Top Bits
+    //==============================================================================
+    static inline int Expand(int aValue, int aBits)
+    {
+        return (aValue << (8 - aBits)) | (aValue >> (2 * aBits - 8));
+    }
+
+
+    //==============================================================================
+    //! @brief Put Row-Major 2-bit Indices Into ETC's Index Bits: Column-Major,
+    //!        The High Bits In Bits 16..31, The Low Bits In 0..15
+    //==============================================================================
+    static uint64_t IndexBits(const uint8_t* aIndices)
+    {
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i)
+            {
+            const int position = (i & 3) * 4 + (i >> 2);
+            bits |= static_cast<uint64_t>(aIndices[i] >> 1) << (16 + position);
+            bits |= static_cast<uint64_t>(aIndices[i] & 1) << position;
+            }
+        return bits;
+    }
+
+
+    //==============================================================================
+    //! @brief Tell Which Mode The Decoder Reads A Block As
+    //==============================================================================
+    static Mode DecodedMode(uint64_t aBits)
+    {
+        if (!((aBits >> 33) & 1))
+            return Mode::Individual;
+
+        // a 5-bit base plus a 3-bit signed offset per channel, out of range means another mode
+        const Mode overflows[3] = {Mode::T, Mode::H, Mode::Planar};
+        for (int c = 0; c < 3; ++c)
+            {
+            const int base = static_cast<int>((aBits >> (59 - 8 * c)) & 31);
+            const int offset = static_cast<int>((aBits >> (56 - 8 * c)) & 7);
+            const int sum = base + ((offset & 4) ? offset - 8 : offset);
+            if (sum < 0 || sum > 31)
+                return overflows[c];
+            }
+        return Mode::Differential;
+    }
+
+
+    //==============================================================================
+    //! @brief Set The Bits A Mode Leaves Free So The Decoder Reads The Block As That Mode
+    //! @param aBits The Block, Its Free Bits Are Overwritten
+    //! @param aFree The Free Bits
+    //! @param aMode The Mode
+    //! @return False If No Setting Of The Free Bits Gives aMode
+    //==============================================================================
+    static bool ForceMode(uint64_t& aBits, uint64_t aFree, Mode aMode)
+    {
+        // every subset of the free bits
+        uint64_t setting = 0;
+        do
+            {
+            const uint64_t bits = (aBits & ~aFree) | setting;
+            if (DecodedMode(bits) == aMode)
+                {
+                aBits = bits;
+                return true;
+                }
+            setting = (setting - aFree) & aFree;
+            }
+        while (setting != 0);
+        return false;
+    }
+
+
+    //==============================================================================
+    //! @brief Index Pixels Against A Four Color Palette With The SIMD Kernel
+    //! @param aColors 16 Pixels, RGB With Alpha Zero
+    //! @param aPalette 4 Colors, 0..255, Alpha Zero
+    //! @param aMask The Pixels Whose Error Counts, Row-Major
+    //! @param aIndices Receives The Index Of Every Pixel
+    //! @return The Squared Error Of The Pixels In aMask
+    //==============================================================================
+    static uint32_t MatchPalette(const uint8_t* aColors, const int aPalette[4][3], uint16_t aMask,
+                                 uint8_t* aIndices)
+    {
+        uint8_t palette[16];
+        for (int j = 0; j < 4; ++j)
+            {
+            for (int c = 0; c < 3; ++c)
+                palette[4 * j + c] = static_cast<uint8_t>(aPalette[j][c]);
+            palette[4 * j + 3] = 0;
+            }
+
+        uint32_t errors[16];
+        blockencoder::Active().findIndices(aColors, palette, 4, aIndices, errors);
+
+        uint32_t error = 0;
+        for (int i = 0; i < 16; ++i)
+            if ((aMask >> i) & 1)
+                error += errors[i];
+        return error;
+    }
+
+
+    //==============================================================================
+    //! @brief Pick The Best Modifier Table For A Subblock Around A Base Color
+    //! @param aColors 16 Pixels, RGB With Alpha Zero
+    //! @param aMask The Subblock's Pixels
+    //! @param aBase The Base Color, 0..255
+    //! @param aCodeword Receives The Table Codeword
+    //! @param aIndices Receives The Indices Of The Subblock's Pixels, Others Untouched
+    //! @return The Squared Error Of The Subblock
+    //==============================================================================
+    static uint32_t FitSubblock(const uint8_t* aColors, uint16_t aMask, const int* aBase, int& aCodeword,
+                                uint8_t* aIndices)
+    {
+        uint32_t best = UINT32_MAX;
+        for (int codeword = 0; codeword < 8; ++codeword)
+            {
+            // index 0 and 1 add the small and large step, 2 and 3 subtract them
+            const int steps[4] = {kModifiers[codeword][0], kModifiers[codeword][1],
+                                  -kModifiers[codeword][0], -kModifiers[codeword][1]};
+            int palette[4][3];
+            for (int j = 0; j < 4; ++j)
+                for (int c = 0; c < 3; ++c)
+                    palette[j][c] = Clamp255(aBase[c] + steps[j]);
+
+            uint8_t indices[16];
+            const uint32_t error = MatchPalette(aColors, palette, aMask, indices);
+            if (error < best)
+                {
+                best = error;
+                aCodeword = codeword;
+                for (int i = 0; i < 16; ++i)
+                    if ((aMask >> i) & 1)
+                        aIndices[i] = indices[i];
+                }
+            }
+        return best;
+    }
+
+
+    //==============================================================================
+    //! @brief Try The Individual And Differential Modes, Both Flips
+    //==============================================================================
+    static void TryETC1(const uint8_t* aColors, EncodeQuality aQuality, Candidate& aBest)
+    {
+        // High also moves the quantized base colors a step up and down together
+        const int shifts = (aQuality == EncodeQuality::High) ? 3 : 1;
+
+        for (int flip = 0; flip < 2; ++flip)
+            {
+            float mean[2][3] = {};
+            for (int s = 0; s < 2; ++s)
+                {
+                for (int i = 0; i < 16; ++i)
+                    if ((kSubblocks[flip][s] >> i) & 1)
+                        for (int c = 0; c < 3; ++c)
+                            mean[s][c] += aColors[4 * i + c];
+                for (int c = 0; c < 3; ++c)
+                    mean[s][c] /= 8;
+                }
+
+            for (int differential = 0; differential < 2; ++differential)
+                {
+                const int bits = differential ? 5 : 4;
+                int quantized[2][3];
+                for (int s = 0; s < 2; ++s)
+                    for (int c = 0; c < 3; ++c)
+                        quantized[s][c] = Quantize(mean[s][c], bits);
+
+                int codewords[2] = {0, 0};
+                uint8_t indices[16];
+                uint32_t error = 0;
+                for (int s = 0; s < 2; ++s)
+                    {
+                    // the second color is an offset of -4..3 from the first, as the first was chosen
+                    if (differential && s == 1)
+                        for (int c = 0; c < 3; ++c)
+                            quantized[1][c] = quantized[0][c]
+                                              + std::min(3, std::max(-4, quantized[1][c] - quantized[0][c]));
+
+                    uint32_t subblockBest = UINT32_MAX;
+                    int subblockCodeword = 0;
+                    uint8_t subblockIndices[16];
+                    int subblockColor[3];
+                    for (int shift = 0; shift < shifts; ++shift)
+                        {
+                        // the second differential color only moves while its offset stays in range
+                        const int step = (shift == 0) ? 0 : (shift == 1) ? 1 : -1;
+                        int color[3];
+                        bool valid = true;
+                        for (int c = 0; c < 3; ++c)
+                            {
+                            color[c] = quantized[s][c] + step;
+                            valid = valid && color[c] >= 0 && color[c] < (1 << bits);
+                            if (differential && s == 1)
+                                {
+                                const int offset = color[c] - quantized[0][c];
+                                valid = valid && offset >= -4 && offset <= 3;
+                                }
+                            }
+                        if (!valid)
+                            continue;
+
+                        const int base[3] = {Expand(color[0], bits), Expand(color[1], bits), Expand(color[2], bits)};
+                        int codeword = 0;
+                        const uint32_t shiftError = FitSubblock(aColors, kSubblocks[flip][s], base, codeword,
+                                                                subblockIndices);
+                        if (shiftError < subblockBest)
+                            {
+                            subblockBest = shiftError;
+                            subblockCodeword = codeword;
+                            std::copy(color, color + 3, subblockColor);
+                            for (int i = 0; i < 16; ++i)
+                                if ((kSubblocks[flip][s] >> i) & 1)
+                                    indices[i] = subblockIndices[i];
+                            }
+                        }
+                    codewords[s] = subblockCodeword;
+                    std::copy(subblockColor, subblockColor + 3, quantized[s]);
+                    error += subblockBest;
+                    }
+
+                if (error >= aBest.error)
+                    continue;
+
+                uint64_t block = IndexBits(indices);
+                for (int c = 0; c < 3; ++c)
+                    {
+                    if (differential)
+                        block |= static_cast<uint64_t>(quantized[0][c]) << (59 - 8 * c)
+                                 | static_cast<uint64_t>((quantized[1][c] - quantized[0][c]) & 7) << (56 - 8 * c);
+                    else
+                        block |= static_cast<uint64_t>(quantized[0][c]) << (60 - 8 * c)
+                                 | static_cast<uint64_t>(quantized[1][c]) << (56 - 8 * c);
+                    }
+                block |= static_cast<uint64_t>(codewords[0]) << 37 | static_cast<uint64_t>(codewords[1]) << 34
+                         | static_cast<uint64_t>(differential) << 33 | static_cast<uint64_t>(flip) << 32;
+                aBest.bits = block;
+                aBest.error = error;
+                }
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Try The Planar Mode: A Least-Squares Gradient Through The Block
+    //==============================================================================
+    static void TryPlanar(const uint8_t* aColors, Candidate& aBest)
+    {
+        // c = a + bx * x + by * y; over the 4x4 grid x and y each sum to 20 squared about their mean
+        int quantized[3][3];    // origin, horizontal and vertical corner per channel
+        static const int kBits[3] = {6, 7, 6};
+        for (int c = 0; c < 3; ++c)
+            {
+            float sum = 0, sumX = 0, sumY = 0;
+            for (int i = 0; i < 16; ++i)
+                {
+                const float value = aColors[4 * i + c];
+                sum += value;
+                sumX += ((i & 3) - 1.5f) * value;
+                sumY += ((i >> 2) - 1.5f) * value;
+                }
+            const float slopeX = sumX / 20, slopeY = sumY / 20;
+            const float origin = sum / 16 - 1.5f * (slopeX + slopeY);
+            quantized[0][c] = Quantize(origin, kBits[c]);
+            quantized[1][c] = Quantize(origin + 4 * slopeX, kBits[c]);
+            quantized[2][c] = Quantize(origin + 4 * slopeY, kBits[c]);
+            }
+
+        uint32_t error = 0;
+        for (int c = 0; c < 3; ++c)
+            {
+            const int o = Expand(quantized[0][c], kBits[c]);
+            const int h = Expand(quantized[1][c], kBits[c]);
+            const int v = Expand(quantized[2][c], kBits[c]);
+            for (int i = 0; i < 16; ++i)
+                {
+                const int decoded = Clamp255(((i & 3) * (h - o) + (i >> 2) * (v - o) + 4 * o + 2) >> 2);
+                const int d = decoded - aColors[4 * i + c];
+                error += d * d;
+                }
+            }
+        if (error >= aBest.error)
+            return;
+
+        const uint64_t ro = quantized[0][0], go = quantized[0][1], bo = quantized[0][2];
+        const uint64_t rh = quantized[1][0], gh = quantized[1][1], bh = quantized[1][2];
+        const uint64_t rv = quantized[2][0], gv = quantized[2][1], bv = quantized[2][2];
+        uint64_t block = ro << 57 | (go >> 6) << 56 | (go & 63) << 49 | (bo >> 5) << 48 | ((bo >> 3) & 3) << 43
+                         | (bo & 7) << 39 | (rh >> 1) << 34 | uint64_t(1) << 33 | (rh & 1) << 32
+                         | gh << 25 | bh << 19 | rv << 13 | gv << 6 | bv;
+
+        // bits 63, 55, 47..45 and 42 are free
+        if (ForceMode(block, uint64_t(1) << 63 | uint64_t(1) << 55 | uint64_t(7) << 45 | uint64_t(1) << 42,
+                      Mode::Planar))
+            {
+            aBest.bits = block;
+            aBest.error = error;
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Split A Block's Colors Into Two Clusters By 2-Means, Seeded With The
+    //!        Farthest Pair
+    //! @param aColors 16 Pixels, RGB With Alpha Zero
+    //! @param aMeans Receives The Mean Of Each Cluster
+    //==============================================================================
+    static void SplitColors(const uint8_t* aColors, float aMeans[2][3])
+    {
+        int farthest = -1, first = 0, second = 0;
+        for (int i = 0; i < 16; ++i)
+            for (int j = i + 1; j < 16; ++j)
+                {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c)
+                    distance += (aColors[4 * i + c] - aColors[4 * j + c]) * (aColors[4 * i + c] - aColors[4 * j + c]);
+                if (distance > farthest)
+                    {
+                    farthest = distance;
+                    first = i;
+                    second = j;
+                    }
+                }
+        for (int c = 0; c < 3; ++c)
+            {
+            aMeans[0][c] = aColors[4 * first + c];
+            aMeans[1][c] = aColors[4 * second + c];
+            }
+
+        for (int iteration = 0; iteration < 3; ++iteration)
+            {
+            float sums[2][3] = {};
+            int counts[2] = {0, 0};
+            for (int i = 0; i < 16; ++i)
+                {
+                float distances[2] = {0, 0};
+                for (int k = 0; k < 2; ++k)
+                    for (int c = 0; c < 3; ++c)
+                        distances[k] += (aColors[4 * i + c] - aMeans[k][c]) * (aColors[4 * i + c] - aMeans[k][c]);
+                const int cluster = (distances[1] < distances[0]) ? 1 : 0;
+                ++counts[cluster];
+                for (int c = 0; c < 3; ++c)
+                    sums[cluster][c] += aColors[4 * i + c];
+                }
+            for (int k = 0; k < 2; ++k)
+                if (counts[k])
+                    for (int c = 0; c < 3; ++c)
+                        aMeans[k][c] = sums[k][c] / counts[k];
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Try The T And H Modes, For Blocks Of Two Distinct Colors
+    //==============================================================================
+    static void TryTH(const uint8_t* aColors, Candidate& aBest)
+    {
+        float means[2][3];
+        SplitColors(aColors, means);
+
+        int quantized[2][3], expanded[2][3];
+        for (int k = 0; k < 2; ++k)
+            for (int c = 0; c < 3; ++c)
+                {
+                quantized[k][c] = Quantize(means[k][c], 4);
+                expanded[k][c] = Expand(quantized[k][c], 4);
+                }
+
+        // T: one cluster is a single color, the other its color and a distance either way
+        for (int single = 0; single < 2; ++single)
+            {
+            const int* a = expanded[single];
+            const int* b = expanded[1 - single];
+            for (int distance = 0; distance < 8; ++distance)
+                {
+                const int d = kDistances[distance];
+                int palette[4][3];
+                for (int c = 0; c < 3; ++c)
+                    {
+                    palette[0][c] = a[c];
+                    palette[1][c] = Clamp255(b[c] + d);
+                    palette[2][c] = b[c];
+                    palette[3][c] = Clamp255(b[c] - d);
+                    }
+
+                uint8_t indices[16];
+                const uint32_t error = MatchPalette(aColors, palette, 0xFFFF, indices);
+                if (error >= aBest.error)
+                    continue;
+
+                const int* qa = quantized[single];
+                const int* qb = quantized[1 - single];
+                uint64_t block = IndexBits(indices)
+                                 | static_cast<uint64_t>(qa[0] >> 2) << 59 | static_cast<uint64_t>(qa[0] & 3) << 56
+                                 | static_cast<uint64_t>(qa[1]) << 52 | static_cast<uint64_t>(qa[2]) << 48
+                                 | static_cast<uint64_t>(qb[0]) << 44 | static_cast<uint64_t>(qb[1]) << 40
+                                 | static_cast<uint64_t>(qb[2]) << 36 | static_cast<uint64_t>(distance >> 1) << 34
+                                 | uint64_t(1) << 33 | static_cast<uint64_t>(distance & 1) << 32;
+
+                // bits 63..61 and 58 are free
+                if (ForceMode(block, uint64_t(7) << 61 | uint64_t(1) << 58, Mode::T))
+                    {
+                    aBest.bits = block;
+                    aBest.error = error;
+                    }
+                }
+            }
+
+        // H: both clusters a color and a distance either way; the lowest distance bit is
+        // whether the first color, read as a 12-bit number, is at least the second
+        for (int distance = 0; distance < 8; ++distance)
+            {
+            int first = 0, second = 1;
+            const int values[2] = {quantized[0][0] << 8 | quantized[0][1] << 4 | quantized[0][2],
+                                   quantized[1][0] << 8 | quantized[1][1] << 4 | quantized[1][2]};
+            if ((values[0] >= values[1]) != ((distance & 1) != 0))
+                {
+                if (values[0] == values[1])
+                    continue;
+                std::swap(first, second);
+                }
+
+            const int d = kDistances[distance];
+            int palette[4][3];
+            for (int c = 0; c < 3; ++c)
+                {
+                palette[0][c] = Clamp255(expanded[first][c] + d);
+                palette[1][c] = Clamp255(expanded[first][c] - d);
+                palette[2][c] = Clamp255(expanded[second][c] + d);
+                palette[3][c] = Clamp255(expanded[second][c] - d);
+                }
+
+            uint8_t indices[16];
+            const uint32_t error = MatchPalette(aColors, palette, 0xFFFF, indices);
+            if (error >= aBest.error)
+                continue;
+
+            const int* qa = quantized[first];
+            const int* qb = quantized[second];
+            uint64_t block = IndexBits(indices)
+                             | static_cast<uint64_t>(qa[0]) << 59 | static_cast<uint64_t>(qa[1] >> 1) << 56
+                             | static_cast<uint64_t>(qa[1] & 1) << 52 | static_cast<uint64_t>(qa[2] >> 3) << 51
+                             | static_cast<uint64_t>(qa[2] & 7) << 47 | static_cast<uint64_t>(qb[0]) << 43
+                             | static_cast<uint64_t>(qb[1]) << 39 | static_cast<uint64_t>(qb[2]) << 35
+                             | static_cast<uint64_t>(distance >> 2) << 34 | uint64_t(1) << 33
+                             | static_cast<uint64_t>((distance >> 1) & 1) << 32;
+
+            // bits 63, 55..53 and 50 are free
+            if (ForceMode(block, uint64_t(1) << 63 | uint64_t(7) << 53 | uint64_t(1) << 50, Mode::H))
+                {
+                aBest.bits = block;
+                aBest.error = error;
+                }
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Store A Block Big-Endian, As ETC And EAC Do
+    //==============================================================================
+    static inline void PutBigEndian(uint8_t* aBlock, uint64_t aBits)
+    {
+        for (int i = 0; i < 8; ++i)
+            aBlock[i] = static_cast<uint8_t>(aBits >> (56 - 8 * i));
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A 4x4 Block As ETC2 RGB, Alpha Is Dropped
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 8 Byte Block
+    //! @param aQuality Fast Tries The ETC1 Individual And Differential Modes; Normal
+    //!        Adds The Planar Mode For Gradients And The T And H Modes For Blocks
+    //!        Of Two Distinct Colors; High Also Searches Base Colors Around The Mean
+    //==============================================================================
+    void EncodeETC2RGB(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality)
+    {
+        uint8_t colors[64];
+        for (int i = 0; i < 16; ++i)
+            {
+            std::copy(aPixels + 4 * i, aPixels + 4 * i + 3, colors + 4 * i);
+            colors[4 * i + 3] = 0;
+            }
+
+        Candidate best = {0, UINT32_MAX};
+        TryETC1(colors, aQuality, best);
+        if (aQuality != EncodeQuality::Fast && best.error != 0)
+            TryPlanar(colors, best);
+        if (aQuality != EncodeQuality::Fast && best.error != 0)
+            TryTH(colors, best);
+
+        PutBigEndian(aBlock, best.bits);
+    }
+
+
+    //==============================================================================
+    //! @brief Encode A 4x4 Block As ETC2 RGBA8: An EAC Alpha Block, Then An ETC2 RGB Block
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 16 Byte Block
+    //! @param aQuality As For EncodeETC2RGB; High Also Searches More EAC Base Values And Multipliers
+    //==============================================================================
+    void EncodeETC2RGBA(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality)
+    {
+        int lowest = 255, highest = 0;
+        for (int i = 0; i < 16; ++i)
+            {
+            lowest = std::min(lowest, static_cast<int>(aPixels[4 * i + 3]));
+            highest = std::max(highest, static_cast<int>(aPixels[4 * i + 3]));
+            }
+
+        // per table, the multiplier that spans the range and the base that centers it;
+        // High also tries the neighbouring multipliers and bases
+        const int spread = (aQuality == EncodeQuality::High) ? 1 : 0;
+        uint32_t bestError = UINT32_MAX;
+        uint64_t bestBits = 0;
+        for (int table = 0; table < 16; ++table)
+            {
+            const int* modifiers = kAlphaModifiers[table];
+            const int span = modifiers[7] - modifiers[3];
+            const int fit = std::min(15, std::max(1, ((highest - lowest) + span / 2) / span));
+            for (int multiplier = std::max(1, fit - spread); multiplier <= std::min(15, fit + spread); ++multiplier)
+                {
+                const int center = (lowest + highest + 1) / 2 - multiplier * (modifiers[3] + modifiers[7]) / 2;
+                for (int base = Clamp255(center - spread); base <= Clamp255(center + spread); ++base)
+                    {
+                    uint32_t error = 0;
+                    uint64_t bits = static_cast<uint64_t>(base) << 56 | static_cast<uint64_t>(multiplier) << 52
+                                    | static_cast<uint64_t>(table) << 48;
+                    for (int i = 0; i < 16 && error < bestError; ++i)
+                        {
+                        const int alpha = aPixels[4 * i + 3];
+                        int bestIndex = 0, bestDistance = 256;
+                        for (int j = 0; j < 8; ++j)
+                            {
+                            const int distance = std::abs(Clamp255(base + modifiers[j] * multiplier) - alpha);
+                            if (distance < bestDistance)
+                                {
+                                bestDistance = distance;
+                                bestIndex = j;
+                                }
+                            }
+                        error += bestDistance * bestDistance;
+
+                        // 3 bits per pixel, column-major, the first pixel highest
+                        const int position = (i & 3) * 4 + (i >> 2);
+                        bits |= static_cast<uint64_t>(bestIndex) << (45 - 3 * position);
+                        }
+                    if (error < bestError)
+                        {
+                        bestError = error;
+                        bestBits = bits;
+                        }
+                    }
+                }
+            if (bestError == 0)
+                break;
+            }
+
+        PutBigEndian(aBlock, bestBits);
+        EncodeETC2RGB(aPixels, aBlock + 8, aQuality);
+    }
+}
+
+// End Of File
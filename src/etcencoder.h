@@ -0,0 +1,32 @@
+//==============================================================================
+// Name         : etcencoder.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The ETC2 RGB And ETC2 RGBA8 Block Encoders
+//==============================================================================
+
+#ifndef ETCENCODER_H
+#define ETCENCODER_H
+
+#include <cstdint>            // uint8_t
+#include "atlasoptions.h"     // EncodeQuality
+
+namespace etcencoder
+{
+    //! @brief Encode A 4x4 Block As ETC2 RGB, Alpha Is Dropped
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 8 Byte Block
+    //! @param aQuality Fast Tries The ETC1 Individual And Differential Modes; Normal
+    //!        Adds The Planar Mode For Gradients And The T And H Modes For Blocks
+    //!        Of Two Distinct Colors; High Also Searches Base Colors Around The Mean
+    void EncodeETC2RGB(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality);
+
+    //! @brief Encode A 4x4 Block As ETC2 RGBA8: An EAC Alpha Block, Then An ETC2 RGB Block
+    //! @param aPixels 16 RGBA Pixels, Row By Row
+    //! @param aBlock Receives The 16 Byte Block
+    //! @param aQuality As For EncodeETC2RGB; High Also Searches More EAC Base Values And Multipliers
+    void EncodeETC2RGBA(const uint8_t* aPixels, uint8_t* aBlock, EncodeQuality aQuality);
+}
+
+#endif    // ETCENCODER_H
+
+// End Of File
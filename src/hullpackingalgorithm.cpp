@@ -0,0 +1,589 @@
+//==============================================================================
+// Name         : hullpackingalgorithm.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements HullPackingAlgorithm Class
+//==============================================================================
+
+#include "hullpackingalgorithm.h"    // HullPackingAlgorithm
+#include <algorithm>                 // std::sort, std::min, std::max
+#include <utility>                   // std::pair
+#include <cmath>                     // std::floor, std::ceil, std::fabs
+#include "alphatrimmer.h"            // alphatrimmer::RowBounds
+
+#if defined(_MSC_VER)
+    #include <intrin.h>              // _BitScanForward64
+#endif
+
+
+//! Slack For Rounding Errors When Hull Edges Are Rasterized To Pixels
+static const double kRasterSlack = 1e-4;
+
+//! Once No More Positions Than This Are Left, Each Is Tested On Its Own
+//! Instead Of Whole Occupancy Rows At A Time
+static const int kPositionTests = 2;
+
+
+//==============================================================================
+//! @brief The Index Of The Lowest Set Bit Of A Non-Zero Word
+//==============================================================================
+static inline int LowestBit(uint64_t aWord)
+{
+#if defined(_MSC_VER)
+    unsigned long bit;
+    _BitScanForward64(&bit, aWord);
+    return static_cast<int>(bit);
+#else
+    return __builtin_ctzll(aWord);
+#endif
+}
+
+
+//==============================================================================
+//! @brief The Number Of Set Bits In A Word
+//==============================================================================
+static inline int BitCount(uint64_t aWord)
+{
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(aWord));
+#else
+    return __builtin_popcountll(aWord);
+#endif
+}
+
+
+//==============================================================================
+//! @brief Shift A Bit Row Toward Bit 0, Bit x Of aDst Taking Bit x + aBits Of aSrc;
+//!        Bits Shifted In From Past The End Are Set, As If Occupied. aDst May Be aSrc,
+//!        As Reads Are Never Behind The Write
+//==============================================================================
+static void ShiftDown(uint64_t* aDst, const uint64_t* aSrc, size_t aWords, int aBits)
+{
+    const size_t wordShift = static_cast<size_t>(aBits) / 64;
+    const int bitShift = aBits % 64;
+    auto word = [&](size_t aIndex) { return (aIndex < aWords) ? aSrc[aIndex] : ~uint64_t(0); };
+
+    // the words with both sources inside in a plain loop the compiler can vectorize
+    size_t i = 0;
+    if (bitShift)
+        for (; i + wordShift + 1 < aWords; ++i)
+            aDst[i] = (aSrc[i + wordShift] >> bitShift) | (aSrc[i + wordShift + 1] << (64 - bitShift));
+    else
+        for (; i + wordShift < aWords; ++i)
+            aDst[i] = aSrc[i + wordShift];
+    for (; i < aWords; ++i)
+        aDst[i] = bitShift ? (word(i + wordShift) >> bitShift) | (word(i + wordShift + 1) << (64 - bitShift))
+                           : word(i + wordShift);
+}
+
+
+//==============================================================================
+//! @brief The Longest Run Of Free (Clear) Bits In A Bit Row, Whole Words At A Time
+//!        Where They Are All Free Or All Taken
+//==============================================================================
+static int LongestFreeRun(const uint64_t* aRow, int aWords)
+{
+    int longest = 0, run = 0;
+    for (int i = 0; i < aWords; ++i)
+        {
+        const uint64_t word = aRow[i];
+        if (word == 0)
+            run += 64;
+        else if (~word == 0)
+            {
+            longest = std::max(longest, run);
+            run = 0;
+            }
+        else
+            for (int bit = 0; bit < 64; ++bit)
+                if (word >> bit & 1)
+                    {
+                    longest = std::max(longest, run);
+                    run = 0;
+                    }
+                else
+                    ++run;
+        }
+    return std::max(longest, run);
+}
+
+
+//==============================================================================
+//! @brief The Signed Area Of The Parallelogram Of Two Vectors
+//==============================================================================
+static inline double Cross(double aX1, double aY1, double aX2, double aY2)
+{
+    return aX1 * aY2 - aY1 * aX2;
+}
+
+
+//==============================================================================
+//! @brief Build The Hull Of An Image: The Convex Hull Of Its Visible Pixels,
+//!        Cut Down To At Most aMaxVertices Corners By Pushing Edges Outward, So
+//!        It Still Holds Every Visible Pixel, And Kept Inside The Image
+//! @param aImage The Image; Without Alpha Its Hull Is Its Rectangle
+//! @param aMaxVertices The Most Corners Wanted, At Least 3
+//! @return The Hull
+//==============================================================================
+Hull HullPackingAlgorithm::BuildHull(const Image& aImage, int aMaxVertices)
+{
+    Hull hull;
+    hull.spans.assign(2 * static_cast<size_t>(aImage.height), 0);
+    std::vector<int> bounds(2 * static_cast<size_t>(aImage.height));
+    alphatrimmer::RowBounds(aImage, bounds.data());
+
+    // the corners of each row's visible run; their convex hull holds every visible pixel
+    std::vector<std::pair<int, int>> corners;
+    for (int y = 0; y < aImage.height; ++y)
+        if (bounds[2 * y + 1] > bounds[2 * y])
+            {
+            corners.push_back(std::make_pair(bounds[2 * y], y));
+            corners.push_back(std::make_pair(bounds[2 * y], y + 1));
+            corners.push_back(std::make_pair(bounds[2 * y + 1], y));
+            corners.push_back(std::make_pair(bounds[2 * y + 1], y + 1));
+            }
+    if (corners.empty())
+        return hull;
+
+    // Andrew's monotone chain, collinear points dropped; the result turns one way throughout
+    std::sort(corners.begin(), corners.end());
+    std::vector<std::pair<int, int>> chain(2 * corners.size());
+    size_t count = 0;
+    auto turn = [&](const std::pair<int, int>& aO, const std::pair<int, int>& aA, const std::pair<int, int>& aB)
+        {
+        return static_cast<int64_t>(aA.first - aO.first) * (aB.second - aO.second)
+               - static_cast<int64_t>(aA.second - aO.second) * (aB.first - aO.first);
+        };
+    for (size_t i = 0; i < corners.size(); ++i)
+        {
+        while (count >= 2 && turn(chain[count - 2], chain[count - 1], corners[i]) <= 0)
+            --count;
+        chain[count++] = corners[i];
+        }
+    for (size_t i = corners.size() - 1, lower = count + 1; i-- > 0;)
+        {
+        while (count >= lower && turn(chain[count - 2], chain[count - 1], corners[i]) <= 0)
+            --count;
+        chain[count++] = corners[i];
+        }
+    std::vector<double> xs, ys;
+    for (size_t i = 0; i + 1 < count; ++i)
+        {
+        xs.push_back(chain[i].first);
+        ys.push_back(chain[i].second);
+        }
+
+    // cut corners: an edge is dropped by extending its two neighbours until they meet,
+    // which keeps the hull convex and around every pixel; the edge adding least area goes first
+    const double width = aImage.width, height = aImage.height;
+    while (static_cast<int>(xs.size()) > std::max(3, aMaxVertices))
+        {
+        const size_t n = xs.size();
+        size_t best = n;
+        double bestArea = 0, bestX = 0, bestY = 0;
+        for (size_t b = 0; b < n; ++b)
+            {
+            const size_t a = (b + n - 1) % n, c = (b + 1) % n, d = (b + 2) % n;
+            const double dx1 = xs[b] - xs[a], dy1 = ys[b] - ys[a];
+            const double dx2 = xs[d] - xs[c], dy2 = ys[d] - ys[c];
+            const double ex = xs[c] - xs[b], ey = ys[c] - ys[b];
+
+            // the neighbours only meet beyond the edge if they turn less than half a circle
+            const double denominator = Cross(dx1, dy1, dx2, dy2);
+            if (denominator <= 1e-12)
+                continue;
+            const double t = Cross(ex, ey, dx2, dy2) / denominator;
+            const double px = xs[b] + t * dx1, py = ys[b] + t * dy1;
+            if (t < 0 || px < -kRasterSlack || py < -kRasterSlack || px > width + kRasterSlack
+                || py > height + kRasterSlack)
+                continue;
+
+            const double area = 0.5 * std::fabs(Cross(px - xs[b], py - ys[b], ex, ey));
+            if (best == n || area < bestArea)
+                {
+                best = b;
+                bestArea = area;
+                bestX = std::min(std::max(px, 0.0), width);
+                bestY = std::min(std::max(py, 0.0), height);
+                }
+            }
+        if (best == n)
+            break;    // no edge can go without leaving the image
+
+        xs[best] = bestX;
+        ys[best] = bestY;
+        const size_t dropped = (best + 1) % n;
+        xs.erase(xs.begin() + dropped);
+        ys.erase(ys.begin() + dropped);
+        }
+
+    for (size_t i = 0; i < xs.size(); ++i)
+        {
+        hull.vertices.push_back(xs[i]);
+        hull.vertices.push_back(ys[i]);
+        }
+
+    // rasterize: the x extent of the hull within each row's strip, widened to the
+    // row's visible run too, so rounding can never leave a visible pixel out
+    const double top = *std::min_element(ys.begin(), ys.end());
+    const double bottom = *std::max_element(ys.begin(), ys.end());
+    const size_t n = xs.size();
+    for (int y = 0; y < aImage.height; ++y)
+        {
+        int begin = aImage.width, end = 0;
+        if (bottom > y + kRasterSlack && top < y + 1 - kRasterSlack)
+            {
+            double left = width, right = 0;
+            for (size_t i = 0; i < n; ++i)
+                {
+                // the part of each edge inside the strip
+                const size_t j = (i + 1) % n;
+                double t0 = 0, t1 = 1;
+                const double dy = ys[j] - ys[i];
+                if (dy != 0)
+                    {
+                    const double ta = (y - ys[i]) / dy, tb = (y + 1 - ys[i]) / dy;
+                    t0 = std::max(0.0, std::min(ta, tb));
+                    t1 = std::min(1.0, std::max(ta, tb));
+                    }
+                else if (ys[i] < y || ys[i] > y + 1)
+                    continue;
+                if (t0 > t1)
+                    continue;
+
+                const double x0 = xs[i] + t0 * (xs[j] - xs[i]), x1 = xs[i] + t1 * (xs[j] - xs[i]);
+                left = std::min(left, std::min(x0, x1));
+                right = std::max(right, std::max(x0, x1));
+                }
+            begin = std::max(0, static_cast<int>(std::floor(left + kRasterSlack)));
+            end = std::min(aImage.width, static_cast<int>(std::ceil(right - kRasterSlack)));
+            }
+        if (bounds[2 * y + 1] > bounds[2 * y])
+            {
+            begin = std::min(begin, bounds[2 * y]);
+            end = std::max(end, bounds[2 * y + 1]);
+            }
+        if (begin < end)
+            {
+            hull.spans[2 * y] = begin;
+            hull.spans[2 * y + 1] = end;
+            }
+        }
+
+    return hull;
+}
+
+
+//==============================================================================
+//! @brief Constructor, Starts An Empty Atlas That Grows Downward
+//! @param aAtlasWidth The Atlas Width, At Least The Widest Image
+//==============================================================================
+HullPackingAlgorithm::HullPackingAlgorithm(int aAtlasWidth)
+    : iAtlasWidth(aAtlasWidth)
+    , iWords((aAtlasWidth + 63) / 64)
+{
+}
+
+
+//==============================================================================
+//! @brief Add Rows To The Occupancy Bitmap Until It Has aRows
+//==============================================================================
+void HullPackingAlgorithm::Grow(int aRows)
+{
+    // the bits past the atlas width stay set, so no span ever fits over them
+    const int tail = iAtlasWidth % 64;
+    while (static_cast<int>(iLongestRun.size()) < aRows)
+        {
+        iOccupied.resize(iOccupied.size() + iWords, 0);
+        if (tail)
+            iOccupied.back() = ~uint64_t(0) << tail;
+        iLongestRun.push_back(iAtlasWidth);
+        }
+}
+
+
+//==============================================================================
+//! @brief Set The Pixels [aBegin, aEnd) Of An Occupancy Row
+//==============================================================================
+void HullPackingAlgorithm::Occupy(int aRow, int aBegin, int aEnd)
+{
+    uint64_t* row = &iOccupied[static_cast<size_t>(aRow) * iWords];
+    for (int x = aBegin; x < aEnd;)
+        {
+        const int bit = x % 64;
+        const int bits = std::min(64 - bit, aEnd - x);
+        row[x / 64] |= ((bits == 64) ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1)) << bit;
+        x += bits;
+        }
+    iLongestRun[aRow] = LongestFreeRun(row, iWords);
+}
+
+
+//==============================================================================
+//! @brief Whether The Pixels [aBegin, aEnd) Of An Occupancy Row Are All Free
+//==============================================================================
+bool HullPackingAlgorithm::IsFree(int aRow, int aBegin, int aEnd) const
+{
+    const uint64_t* row = &iOccupied[static_cast<size_t>(aRow) * iWords];
+    for (int x = aBegin; x < aEnd;)
+        {
+        const int bit = x % 64;
+        const int bits = std::min(64 - bit, aEnd - x);
+        if (row[x / 64] & (((bits == 64) ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1)) << bit))
+            return false;
+        x += bits;
+        }
+    return true;
+}
+
+
+//==============================================================================
+//! @brief Find Where A Span Can't Start In An Occupancy Row
+//! @param aRow The Occupancy Row
+//! @param aOffset Where The Span Starts In The Image
+//! @param aLength The Span Length, At Least 1
+//! @param aBlocked Set To A Bit Per Image Position x, Set If Pixels
+//!        [x + aOffset, x + aOffset + aLength) Are Not All Free
+//! @param aScratch A Row To Work In
+//! @param aFirstWord The First Word Of aBlocked Wanted
+//! @param aLastWord The Last Word Of aBlocked Wanted, The Others Are Left Undefined
+//==============================================================================
+void HullPackingAlgorithm::BlockedPositions(int aRow, int aOffset, int aLength, std::vector<uint64_t>& aBlocked,
+                                            std::vector<uint64_t>& aScratch, int aFirstWord, int aLastWord) const
+{
+    // or-ing the row with itself shifted by 1, 2, 4... gives, at each bit, whether any of
+    // the next 2^k pixels is taken; one more shift covers the rest of the span, the last
+    // moves each window from where the span starts to where the image does. Only the words
+    // the wanted ones read from are worked on, those past them count as taken
+    const int end = std::min(iWords, aLastWord + 3 + (aOffset + aLength) / 64);
+    const size_t words = end - aFirstWord;
+    const uint64_t* row = &iOccupied[static_cast<size_t>(aRow) * iWords + aFirstWord];
+    aBlocked.resize(iWords);
+    aScratch.resize(iWords);
+    uint64_t* blocked = aBlocked.data() + aFirstWord;
+    uint64_t* scratch = aScratch.data() + aFirstWord;
+    std::copy(row, row + words, blocked);
+
+    for (int covered = 1; covered < aLength;)
+        {
+        const int step = std::min(covered, aLength - covered);
+        ShiftDown(scratch, blocked, words, step);
+        for (size_t i = 0; i < words; ++i)
+            blocked[i] |= scratch[i];
+        covered += step;
+        }
+    ShiftDown(blocked, blocked, words, aOffset);
+}
+
+
+//==============================================================================
+//! @brief Place An Image's Hull At The Lowest, Then Leftmost Free Position
+//! @param aSpans The Hull Spans, 2 Per Row
+//! @param aImgWidth The Image's Width
+//! @param aImgHeight The Image's Height
+//! @param aX Set To The X Coordinate Of The Image's Top-Left Point
+//! @param aY Set To The Y Coordinate Of The Image's Top-Left Point
+//==============================================================================
+void HullPackingAlgorithm::Insert(const std::vector<int>& aSpans, int aImgWidth, int aImgHeight, int& aX, int& aY)
+{
+    // positions where the image stays inside the atlas width
+    std::vector<uint64_t> inside(iWords, 0), valid, blocked, scratch;
+    for (int x = 0; x <= iAtlasWidth - aImgWidth; ++x)
+        inside[x / 64] |= uint64_t(1) << (x % 64);
+
+    // the image rows with spans, longest first, as those rule out the most positions
+    std::vector<int> rows;
+    for (int r = 0; r < aImgHeight; ++r)
+        if (aSpans[2 * r + 1] > aSpans[2 * r])
+            rows.push_back(r);
+    std::sort(rows.begin(), rows.end(), [&](int aLeft, int aRight)
+        {
+        return aSpans[2 * aLeft + 1] - aSpans[2 * aLeft] > aSpans[2 * aRight + 1] - aSpans[2 * aRight];
+        });
+
+    // the core: rows next to the widest one and the run their spans share, grown a row at a
+    // time toward the longer shared run while that makes the rectangle bigger
+    const int widest = rows.empty() ? 0 : rows[0];
+    int coreTop = widest, coreBottom = widest + 1, coreBegin = aSpans[2 * widest], coreEnd = aSpans[2 * widest + 1];
+    for (int top = coreTop, bottom = coreBottom, begin = coreBegin, end = coreEnd; end > begin;)
+        {
+        auto shared = [&](int aRow)
+            {
+            return (aRow < 0 || aRow >= aImgHeight) ? 0
+                   : std::min(end, aSpans[2 * aRow + 1]) - std::max(begin, aSpans[2 * aRow]);
+            };
+        const bool up = shared(top - 1) >= shared(bottom);
+        const int row = up ? --top : bottom++;
+        if (shared(row) <= 0)
+            break;
+        begin = std::max(begin, aSpans[2 * row]);
+        end = std::min(end, aSpans[2 * row + 1]);
+        if ((end - begin) * (bottom - top) > (coreEnd - coreBegin) * (coreBottom - coreTop))
+            {
+            coreTop = top;
+            coreBottom = bottom;
+            coreBegin = begin;
+            coreEnd = end;
+            }
+        }
+
+    // past the core, the rows outside it rule out the most positions, so they are tested first
+    std::stable_partition(rows.begin(), rows.end(), [&](int aRow) { return aRow < coreTop || aRow >= coreBottom; });
+
+    // where the core rectangle can't start, for every atlas row at once: each row's blocked
+    // windows or-ed down the core height by doubling, rows past the bitmap being free
+    const int bitmapRows = static_cast<int>(iLongestRun.size());
+    std::vector<uint64_t> coreBlocked(static_cast<size_t>(bitmapRows) * iWords);
+    if (!rows.empty())
+        {
+        for (int row = 0; row < bitmapRows; ++row)
+            {
+            BlockedPositions(row, 0, coreEnd - coreBegin, blocked, scratch, 0, iWords - 1);
+            std::copy(blocked.begin(), blocked.end(), coreBlocked.begin() + static_cast<size_t>(row) * iWords);
+            }
+        for (int covered = 1; covered < coreBottom - coreTop;)
+            {
+            const int step = std::min(covered, coreBottom - coreTop - covered);
+            for (size_t w = 0; w + static_cast<size_t>(step) * iWords < coreBlocked.size(); ++w)
+                coreBlocked[w] |= coreBlocked[w + static_cast<size_t>(step) * iWords];
+            covered += step;
+            }
+        }
+
+    // rows past the bitmap are free, so at the latest the image goes below everything
+    for (int top = 0;; ++top)
+        {
+        // first a cheap test: every atlas row needs a free run as long as its span
+        bool any = true;
+        for (size_t i = 0; i < rows.size() && any; ++i)
+            {
+            const int row = top + rows[i];
+            any = row >= bitmapRows || iLongestRun[row] >= aSpans[2 * rows[i] + 1] - aSpans[2 * rows[i]];
+            }
+        if (!any)
+            continue;
+
+        // then the core rectangle, where it can't go being known already
+        valid = inside;
+        if (!rows.empty() && top + coreTop < bitmapRows)
+            {
+            ShiftDown(blocked.data(), &coreBlocked[static_cast<size_t>(top + coreTop) * iWords], iWords,
+                      coreBegin);
+            any = false;
+            for (int w = 0; w < iWords; ++w)
+                any = (valid[w] &= ~blocked[w]) != 0 || any;
+            if (!any)
+                continue;
+            }
+
+        // then whole rows of positions ruled out 64 at a time, while many are left,
+        // only between the first and last words with positions left
+        int firstWord = 0, lastWord = (iAtlasWidth - aImgWidth) / 64;
+        size_t i = 0;
+        for (int positions = iAtlasWidth; i < rows.size() && positions > kPositionTests; ++i)
+            {
+            const int r = rows[i], row = top + r;
+            if (row >= bitmapRows)
+                continue;
+
+            BlockedPositions(row, aSpans[2 * r], aSpans[2 * r + 1] - aSpans[2 * r], blocked, scratch,
+                             firstWord, lastWord);
+            positions = 0;
+            for (int w = firstWord; w <= lastWord; ++w)
+                positions += BitCount(valid[w] &= ~blocked[w]);
+            while (firstWord < lastWord && !valid[firstWord])
+                ++firstWord;
+            while (lastWord > firstWord && !valid[lastWord])
+                --lastWord;
+            }
+
+        // and the few left one by one, left to right, against the rows not tested yet
+        bool placed = false;
+        for (int w = firstWord; w <= lastWord && !placed; ++w)
+            for (uint64_t bits = valid[w]; bits && !placed; bits &= bits - 1)
+                {
+                const int x = 64 * w + LowestBit(bits);
+                placed = true;
+                for (size_t j = i; j < rows.size() && placed; ++j)
+                    {
+                    const int r = rows[j], row = top + r;
+                    placed = row >= bitmapRows || IsFree(row, x + aSpans[2 * r], x + aSpans[2 * r + 1]);
+                    }
+                aX = x;
+                }
+        if (placed)
+            {
+            aY = top;
+            break;
+            }
+        }
+
+    Grow(aY + aImgHeight);
+    for (int r = 0; r < aImgHeight; ++r)
+        if (aSpans[2 * r + 1] > aSpans[2 * r])
+            Occupy(aY + r, aX + aSpans[2 * r], aX + aSpans[2 * r + 1]);
+}
+
+
+//==============================================================================
+//! @brief Get The Free Rectangles Of An Atlas Of The Given Size, Runs Of Free
+//!        Pixels Merged Down The Rows They Repeat In; Together With The Hull
+//!        Spans Of The Placed Images They Cover The Atlas Without Overlap
+//! @param aAtlasWidth The Final Atlas Width, At Most The One Packed Into
+//! @param aAtlasHeight The Final Atlas Height
+//! @return The Free Rectangles
+//==============================================================================
+std::vector<Rect> HullPackingAlgorithm::FreeRects(int aAtlasWidth, int aAtlasHeight) const
+{
+    std::vector<Rect> freeRects, open, next;
+    std::vector<Rect> runs;
+
+    for (int y = 0; y <= aAtlasHeight; ++y)
+        {
+        // the runs of free pixels in this row, none past the last row to close everything
+        runs.clear();
+        if (y < aAtlasHeight)
+            {
+            const uint64_t* row = (y < static_cast<int>(iLongestRun.size()))
+                                  ? &iOccupied[static_cast<size_t>(y) * iWords] : nullptr;
+            for (int x = 0; x < aAtlasWidth;)
+                {
+                const uint64_t word = row ? row[x / 64] >> (x % 64) : 0;
+                if (word & 1)
+                    {
+                    // skip the taken pixels, a word at a time where they fill one
+                    x += (~word == 0) ? 64 - x % 64 : LowestBit(~word);
+                    continue;
+                    }
+                int end = x;
+                while (end < aAtlasWidth && !(row && (row[end / 64] >> (end % 64) & 1)))
+                    end = (row && end % 64 == 0 && row[end / 64] == 0) ? end + 64 : end + 1;
+                end = std::min(end, aAtlasWidth);
+                runs.push_back(Rect(x, y, end - x, 1));
+                x = end;
+                }
+            }
+
+        // a run where an open rectangle left off makes it a row taller; both lists are by x
+        next.clear();
+        size_t r = 0;
+        for (const Rect& rect : open)
+            {
+            while (r < runs.size() && runs[r].x < rect.x)
+                next.push_back(runs[r++]);
+            if (r < runs.size() && runs[r].x == rect.x && runs[r].width == rect.width)
+                {
+                next.push_back(Rect(rect.x, rect.y, rect.width, rect.height + 1));
+                ++r;
+                }
+            else
+                freeRects.push_back(rect);
+            }
+        while (r < runs.size())
+            next.push_back(runs[r++]);
+        open.swap(next);
+        }
+
+    return freeRects;
+}
+
+// End Of File
@@ -0,0 +1,99 @@
+//==============================================================================
+// Name         : hullpackingalgorithm.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares HullPackingAlgorithm Class
+//==============================================================================
+
+#ifndef HULLPACKINGALGORITHM_H
+#define HULLPACKINGALGORITHM_H
+
+#include <vector>      // std::vector
+#include <cstdint>     // uint64_t
+#include "image.h"     // Image
+#include "rect.h"      // Rect
+
+
+//==============================================================================
+//! Hull Struct, The Convex Outline Of An Image's Visible Pixels
+//==============================================================================
+struct Hull
+{
+    // x, y pairs in image pixels, in order around the outline; empty when nothing is visible
+    std::vector<double> vertices;
+
+    // 2 per image row: the [begin, end) pixels the outline covers, both 0 if it misses the row
+    std::vector<int>    spans;
+};
+
+
+//==============================================================================
+//! HullPackingAlgorithm Class
+//! Packs Images By Their Hulls Instead Of Their Rectangles: Each Hull Is
+//! Rasterized To Row Spans, And Placed At The Lowest, Then Leftmost Position
+//! Where No Span Overlaps The Occupancy Bitmap Of The Atlas, 64 Positions Tested
+//! Per Word Operation; Rectangles Of Different Images May Overlap, Hulls Never Do
+//==============================================================================
+class HullPackingAlgorithm
+{
+    public:
+    //! @brief Build The Hull Of An Image: The Convex Hull Of Its Visible Pixels,
+    //!        Cut Down To At Most aMaxVertices Corners By Pushing Edges Outward, So
+    //!        It Still Holds Every Visible Pixel, And Kept Inside The Image
+    //! @param aImage The Image; Without Alpha Its Hull Is Its Rectangle
+    //! @param aMaxVertices The Most Corners Wanted, At Least 3; Fewer Means Less
+    //!        Vertex Work, More Means A Tighter Fit
+    //! @return The Hull
+    static Hull BuildHull(const Image& aImage, int aMaxVertices);
+
+    //! @brief Constructor, Starts An Empty Atlas That Grows Downward
+    //! @param aAtlasWidth The Atlas Width, At Least The Widest Image
+    explicit HullPackingAlgorithm(int aAtlasWidth);
+
+    //! @brief Place An Image's Hull At The Lowest, Then Leftmost Free Position
+    //! @param aSpans The Hull Spans, 2 Per Row
+    //! @param aImgWidth The Image's Width
+    //! @param aImgHeight The Image's Height
+    //! @param aX Set To The X Coordinate Of The Image's Top-Left Point
+    //! @param aY Set To The Y Coordinate Of The Image's Top-Left Point
+    void Insert(const std::vector<int>& aSpans, int aImgWidth, int aImgHeight, int& aX, int& aY);
+
+    //! @brief Get The Free Rectangles Of An Atlas Of The Given Size, Runs Of Free
+    //!        Pixels Merged Down The Rows They Repeat In; Together With The Hull
+    //!        Spans Of The Placed Images They Cover The Atlas Without Overlap
+    //! @param aAtlasWidth The Final Atlas Width, At Most The One Packed Into
+    //! @param aAtlasHeight The Final Atlas Height
+    //! @return The Free Rectangles
+    std::vector<Rect> FreeRects(int aAtlasWidth, int aAtlasHeight) const;
+
+    private:
+    //! @brief Whether The Pixels [aBegin, aEnd) Of An Occupancy Row Are All Free
+    bool IsFree(int aRow, int aBegin, int aEnd) const;
+
+    //! @brief Find Where A Span Can't Start In An Occupancy Row
+    //! @param aRow The Occupancy Row
+    //! @param aOffset Where The Span Starts In The Image
+    //! @param aLength The Span Length, At Least 1
+    //! @param aBlocked Set To A Bit Per Image Position x, Set If Pixels
+    //!        [x + aOffset, x + aOffset + aLength) Are Not All Free
+    //! @param aScratch A Row To Work In
+    //! @param aFirstWord The First Word Of aBlocked Wanted
+    //! @param aLastWord The Last Word Of aBlocked Wanted, The Others Are Left Undefined
+    void BlockedPositions(int aRow, int aOffset, int aLength, std::vector<uint64_t>& aBlocked,
+                          std::vector<uint64_t>& aScratch, int aFirstWord, int aLastWord) const;
+
+    //! @brief Set The Pixels [aBegin, aEnd) Of An Occupancy Row
+    void Occupy(int aRow, int aBegin, int aEnd);
+
+    //! @brief Add Rows To The Occupancy Bitmap Until It Has aRows
+    void Grow(int aRows);
+
+    private:
+    int                     iAtlasWidth;
+    int                     iWords;       // 64-bit words per occupancy row
+    std::vector<uint64_t>   iOccupied;    // a bit per pixel, set where a hull is; bits past the width set
+    std::vector<int>        iLongestRun;  // the longest free run per row, to skip rows a span can't fit in
+};
+
+#endif    // HULLPACKINGALGORITHM_H
+
+// End Of File
@@ -0,0 +1,66 @@
+//==============================================================================
+// Name         : image.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares Image Struct
+//==============================================================================
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <string>     // std::string
+#include <vector>     // std::vector
+#include <cstdint>    // uint8_t, uint32_t
+
+
+//==============================================================================
+//! Image Struct For Each Image On The Texture Atlas
+//==============================================================================
+struct Image
+{
+    //! @brief Constructor
+    //! @param aName The Image Name
+    //! @param aX The X Coordinate Of The Image Top-Left Point on Texture Atlas
+    //! @param aY The Y Coordinate Of The Image Top-Left Point on Texture Atlas
+    //! @param aWidth The Image Width
+    //! @param aHeight The Image Height
+    Image(std::string aName, int aX, int aY, int aWidth, int aHeight)
+        : name(aName), x(aX), y(aY), width(aWidth), height(aHeight), data(nullptr), palette(nullptr), bitDepth(8),
+          sourceWidth(aWidth), sourceHeight(aHeight), trimX(0), trimY(0), spans(nullptr)
+    {
+    };
+
+    //! @brief Constructor
+    //! @param aName The Image Name
+    //! @param aWidth The Image Width
+    //! @param aHeight The Image Height
+    //! @param aData The png image bytes
+    //! @param aChannels The png image Channels, 1 For Gray Or Palette Indices, 2 For Gray-Alpha
+    //! @param aPalette 256 RGBA Colors When aData Holds Palette Indices, Else nullptr
+    //! @param aBitDepth Bits Per Channel, 8 Or 16 (RGB Or RGBA Only)
+    Image(std::string aName, int aWidth, int aHeight, uint8_t* aData, int aChannels, uint32_t* aPalette = nullptr,
+          int aBitDepth = 8)
+        : name(aName), width(aWidth), height(aHeight), data(aData), channels(aChannels), palette(aPalette),
+          bitDepth(aBitDepth), sourceWidth(aWidth), sourceHeight(aHeight), trimX(0), trimY(0), spans(nullptr)
+    {
+    };
+
+    std::string name;
+    int         x;
+    int         y;
+    int         width;
+    int         height;
+    uint8_t*    data;    // png image bytes
+    int         channels;
+    uint32_t*   palette;    // RGBA colors, bytes in that order, the indices in data look up
+    int         bitDepth;   // 16 for big-endian 16-bit samples, as the .png stores them
+    int         sourceWidth;     // the width before transparent borders were trimmed
+    int         sourceHeight;    // the height before transparent borders were trimmed
+    int         trimX;           // where the trimmed pixels start in the untrimmed image
+    int         trimY;
+    const int*  spans;           // 2 per row, the [begin, end) pixels drawn; nullptr draws whole rows
+    std::vector<std::string> aliases;    // the names of identical images packed as this one
+};
+
+#endif    // IMAGE_H
+
+// End Of File
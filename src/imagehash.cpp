@@ -0,0 +1,177 @@
+//==============================================================================
+// Name         : imagehash.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements A Fast Non-Cryptographic Hash Of Decoded Image Bytes,
+//                To Find Identical Images, With Runtime CPU Dispatch
+//==============================================================================
+
+#include "imagehash.h"        // imagehash::Kernels
+#include <string.h>           // memcpy
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define HASH_X86
+    #include <immintrin.h>          // SSSE3, AVX2 intrinsics
+    #if defined(_MSC_VER)
+        #define HASH_TARGET(aIsa)
+    #else
+        #define HASH_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace imagehash
+{
+    using blitkernels::Isa;
+
+    //! Keys Xored Into The Bytes Before They Are Multiplied, One Per Accumulator
+    alignas(32) static const uint64_t kKeys[8] =
+    {
+        0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+        0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+    };
+
+    static const uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+    static const uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+
+
+    //==============================================================================
+    // Scalar Kernel, Also Used For The Last, Zero-Padded Stripe
+    //==============================================================================
+    static void AccumulateScalar(uint64_t* aAcc, const uint8_t* aData, size_t aStripes)
+    {
+        for (size_t s = 0; s < aStripes; ++s, aData += kStripeBytes)
+            for (int i = 0; i < 8; ++i)
+                {
+                // the bytes are added as they are, and the product of the two halves of their keyed value
+                uint64_t data;
+                memcpy(&data, aData + 8 * i, 8);
+                const uint64_t keyed = data ^ kKeys[i];
+                aAcc[i] += data + (keyed & 0xFFFFFFFFull) * (keyed >> 32);
+                }
+    }
+
+
+#if defined(HASH_X86)
+    //==============================================================================
+    // SSSE3 Kernel, A Stripe As 4 Vectors Of 2 Accumulators
+    //==============================================================================
+    HASH_TARGET("ssse3")
+    static void AccumulateSSSE3(uint64_t* aAcc, const uint8_t* aData, size_t aStripes)
+    {
+        __m128i acc[4], keys[4];
+        for (int j = 0; j < 4; ++j)
+            {
+            acc[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aAcc) + j);
+            keys[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(kKeys) + j);
+            }
+        for (size_t s = 0; s < aStripes; ++s, aData += kStripeBytes)
+            for (int j = 0; j < 4; ++j)
+                {
+                const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aData) + j);
+                const __m128i keyed = _mm_xor_si128(data, keys[j]);
+                const __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+                acc[j] = _mm_add_epi64(acc[j], _mm_add_epi64(data, product));
+                }
+        for (int j = 0; j < 4; ++j)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aAcc) + j, acc[j]);
+    }
+
+
+    //==============================================================================
+    // AVX2 Kernel, A Stripe As 2 Vectors Of 4 Accumulators
+    //==============================================================================
+    HASH_TARGET("avx2")
+    static void AccumulateAVX2(uint64_t* aAcc, const uint8_t* aData, size_t aStripes)
+    {
+        __m256i acc[2], keys[2];
+        for (int j = 0; j < 2; ++j)
+            {
+            acc[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aAcc) + j);
+            keys[j] = _mm256_load_si256(reinterpret_cast<const __m256i*>(kKeys) + j);
+            }
+        for (size_t s = 0; s < aStripes; ++s, aData += kStripeBytes)
+            for (int j = 0; j < 2; ++j)
+                {
+                const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aData) + j);
+                const __m256i keyed = _mm256_xor_si256(data, keys[j]);
+                const __m256i product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+                acc[j] = _mm256_add_epi64(acc[j], _mm256_add_epi64(data, product));
+                }
+        for (int j = 0; j < 2; ++j)
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(aAcc) + j, acc[j]);
+        _mm256_zeroupper();
+    }
+#endif    // HASH_X86
+
+
+    //==============================================================================
+    // Kernel Table, Narrowest Instruction Set First
+    //==============================================================================
+    static const Kernels kKernels[] =
+    {
+        { Isa::Scalar, "scalar", AccumulateScalar },
+#if defined(HASH_X86)
+        { Isa::SSSE3, "ssse3", AccumulateSSSE3 },
+        { Isa::AVX2, "avx2", AccumulateAVX2 },
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    //==============================================================================
+    const Kernels* ForIsa(Isa aIsa)
+    {
+        return blitkernels::FindForIsa(kKernels, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    //==============================================================================
+    const Kernels& Active()
+    {
+        static const Kernels& active = blitkernels::SelectForIsa(kKernels);
+        return active;
+    }
+
+
+    //==============================================================================
+    //! @brief Hash Some Bytes; Equal Bytes Always Hash The Same, Different Bytes
+    //!        Rarely Do, So Equal Hashes Still Need Comparing
+    //! @param aData The Bytes
+    //! @param aBytes How Many
+    //! @param aKernels The Kernels To Hash With
+    //! @return The Hash
+    //==============================================================================
+    uint64_t Hash(const uint8_t* aData, size_t aBytes, const Kernels& aKernels)
+    {
+        uint64_t acc[8] = {kKeys[0], kKeys[1], kKeys[2], kKeys[3], kKeys[4], kKeys[5], kKeys[6], kKeys[7]};
+        const size_t stripes = aBytes / kStripeBytes;
+        aKernels.accumulate(acc, aData, stripes);
+
+        // the last bytes are padded with zeros to a stripe, the length tells the padding apart
+        uint8_t last[kStripeBytes] = {};
+        memcpy(last, aData + stripes * kStripeBytes, aBytes - stripes * kStripeBytes);
+        AccumulateScalar(acc, last, 1);
+
+        // each accumulator is avalanched before it is folded in, so every input bit reaches every hash bit
+        uint64_t hash = aBytes * kPrime1;
+        for (int i = 0; i < 8; ++i)
+            {
+            uint64_t mixed = acc[i];
+            mixed ^= mixed >> 33;
+            mixed *= kPrime2;
+            mixed ^= mixed >> 29;
+            mixed *= kPrime1;
+            mixed ^= mixed >> 32;
+            hash = (hash ^ mixed) * kPrime1 + kPrime2;
+            }
+        return hash;
+    }
+}
+
+// End Of File
@@ -0,0 +1,53 @@
+//==============================================================================
+// Name         : imagehash.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares A Fast Non-Cryptographic Hash Of Decoded Image Bytes,
+//                To Find Identical Images, With Runtime CPU Dispatch
+//==============================================================================
+
+#ifndef IMAGEHASH_H
+#define IMAGEHASH_H
+
+#include <cstddef>            // size_t
+#include <cstdint>            // uint8_t, uint64_t
+#include "blitkernels.h"      // blitkernels::Isa
+
+namespace imagehash
+{
+    //! Bytes Taken By One Step Of The Accumulate Kernels
+    const size_t kStripeBytes = 64;
+
+    //! Accumulate Kernel: Mixes aStripes Stripes Of kStripeBytes Bytes Into 8 64-Bit
+    //! Accumulators, Each Fed By Its Own 8 Bytes Of Every Stripe; Every Kernel
+    //! Gives The Same Accumulators, So Hashes Don't Depend On The CPU
+    typedef void (*AccumulateKernel)(uint64_t* aAcc, const uint8_t* aData, size_t aStripes);
+
+    //! The Kernels Built For One Instruction Set Level
+    struct Kernels
+    {
+        blitkernels::Isa    isa;
+        const char*         name;
+        AccumulateKernel    accumulate;
+    };
+
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    const Kernels& Active();
+
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    const Kernels* ForIsa(blitkernels::Isa aIsa);
+
+    //! @brief Hash Some Bytes; Equal Bytes Always Hash The Same, Different Bytes
+    //!        Rarely Do, So Equal Hashes Still Need Comparing
+    //! @param aData The Bytes
+    //! @param aBytes How Many
+    //! @param aKernels The Kernels To Hash With
+    //! @return The Hash
+    uint64_t Hash(const uint8_t* aData, size_t aBytes, const Kernels& aKernels = Active());
+}
+
+#endif    // IMAGEHASH_H
+
+// End Of File
@@ -0,0 +1,157 @@
+//==============================================================================
+// Name         : imageslicer.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The Functions That Cut Decoded Images Into Smaller
+//                In-Memory Images, Such As The Tiles Of A Tilemap Sheet Or The
+//                Cells Of A Sprite Sheet
+//==============================================================================
+
+#include "imageslicer.h"      // imageslicer::Cut
+#include <algorithm>          // std::min
+#include <utility>            // std::pair
+#include <string.h>           // memcpy, memcmp
+
+namespace imageslicer
+{
+    //==============================================================================
+    //! @brief Split An Area Into A Grid Of Cells, Row By Row; The Cells Of The Last
+    //!        Column And Row Are Cut Short Where The Area Ends
+    //! @param aWidth The Area Width
+    //! @param aHeight The Area Height
+    //! @param aCellWidth The Cell Width, At Least 1
+    //! @param aCellHeight The Cell Height, At Least 1
+    //! @return The Cells
+    //==============================================================================
+    std::vector<Rect> Grid(int aWidth, int aHeight, int aCellWidth, int aCellHeight)
+    {
+        std::vector<Rect> cells;
+        for (int y = 0; y < aHeight; y += aCellHeight)
+            for (int x = 0; x < aWidth; x += aCellWidth)
+                cells.push_back(Rect(x, y, std::min(aCellWidth, aWidth - x), std::min(aCellHeight, aHeight - y)));
+        return cells;
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Runs Of Entries That Are Not Background
+    //! @param aBackground Per Row Or Column, Whether It Is All Background
+    //! @param aOffset Added To The Run Positions
+    //! @return [begin, end) Pairs
+    //==============================================================================
+    static std::vector<std::pair<int, int>> Runs(const std::vector<bool>& aBackground, int aOffset)
+    {
+        std::vector<std::pair<int, int>> runs;
+        const int count = static_cast<int>(aBackground.size());
+        for (int i = 0; i < count;)
+            {
+            if (aBackground[i])
+                {
+                ++i;
+                continue;
+                }
+            const int begin = i;
+            while (i < count && !aBackground[i])
+                ++i;
+            runs.push_back(std::make_pair(aOffset + begin, aOffset + i));
+            }
+        return runs;
+    }
+
+
+    //==============================================================================
+    //! @brief Split An Area Of A Sheet At Its Whole Rows And Columns Of Background,
+    //!        Then Split Each Part The Same Way, Until No Part Splits Any Further
+    //! @param aContent Per Sheet Pixel, Row By Row, Whether It Is Not Background
+    //! @param aSheetWidth The Sheet Width
+    //! @param aArea The Area To Split
+    //! @param aCells Gets The Parts That Don't Split, Cut Down To Their Content
+    //==============================================================================
+    static void Split(const std::vector<bool>& aContent, int aSheetWidth, const Rect& aArea, std::vector<Rect>& aCells)
+    {
+        std::vector<bool> backgroundRows(aArea.height, true), backgroundColumns(aArea.width, true);
+        for (int y = 0; y < aArea.height; ++y)
+            for (int x = 0; x < aArea.width; ++x)
+                if (aContent[static_cast<size_t>(aArea.y + y) * aSheetWidth + aArea.x + x])
+                    {
+                    backgroundRows[y] = false;
+                    backgroundColumns[x] = false;
+                    }
+
+        const std::vector<std::pair<int, int>> rows = Runs(backgroundRows, aArea.y);
+        const std::vector<std::pair<int, int>> columns = Runs(backgroundColumns, aArea.x);
+        if (rows.size() == 1 && columns.size() == 1)
+            {
+            // nothing left to split at, the content fills the runs edge to edge
+            aCells.push_back(Rect(columns[0].first, rows[0].first, columns[0].second - columns[0].first,
+                                  rows[0].second - rows[0].first));
+            return;
+            }
+
+        // sprites laid out unevenly share bands, so each crossing of bands is split again; empty ones vanish
+        for (const std::pair<int, int>& row : rows)
+            for (const std::pair<int, int>& column : columns)
+                Split(aContent, aSheetWidth,
+                      Rect(column.first, row.first, column.second - column.first, row.second - row.first), aCells);
+    }
+
+
+    //==============================================================================
+    //! @brief Find The Cells Of A Sprite Sheet Whose Sprites Are Set Apart By Whole
+    //!        Rows And Columns Of Background: The Color Of The Top-Left Pixel, Or
+    //!        Full Transparency; Cells With Nothing But Background Are Left Out
+    //! @param aImage The Sheet
+    //! @return The Cells, Row By Row
+    //==============================================================================
+    std::vector<Rect> SeparatedCells(const Image& aImage)
+    {
+        const size_t pixelBytes = static_cast<size_t>(aImage.channels) * (aImage.bitDepth / 8);
+        const bool hasAlpha = aImage.palette || aImage.channels == 2 || aImage.channels == 4;
+        const uint8_t* separator = aImage.data;
+
+        // one pass marks the content pixels, the splitting only looks at those
+        std::vector<bool> content(static_cast<size_t>(aImage.width) * aImage.height);
+        const uint8_t* pixel = aImage.data;
+        for (size_t i = 0; i < content.size(); ++i, pixel += pixelBytes)
+            {
+            bool background = memcmp(pixel, separator, pixelBytes) == 0;
+            if (!background && hasAlpha)
+                background = aImage.palette ? reinterpret_cast<const uint8_t*>(&aImage.palette[*pixel])[3] == 0
+                             : (aImage.bitDepth == 16) ? (pixel[pixelBytes - 2] | pixel[pixelBytes - 1]) == 0
+                             : pixel[pixelBytes - 1] == 0;
+            content[i] = !background;
+            }
+
+        std::vector<Rect> cells;
+        Split(content, aImage.width, Rect(0, 0, aImage.width, aImage.height), cells);
+        return cells;
+    }
+
+
+    //==============================================================================
+    //! @brief Copy A Rectangle Of An Image Into A New Image Of The Same Format, With
+    //!        Its Own Pixels And Palette, Which The Caller Deletes
+    //! @param aImage The Image
+    //! @param aRect The Rectangle, Inside The Image
+    //! @param aName The New Image's Name
+    //! @return The New Image
+    //==============================================================================
+    Image Cut(const Image& aImage, const Rect& aRect, const std::string& aName)
+    {
+        const size_t pixelBytes = static_cast<size_t>(aImage.channels) * (aImage.bitDepth / 8);
+        const size_t rowBytes = pixelBytes * aRect.width;
+        uint8_t* data = new uint8_t[rowBytes * aRect.height];
+        for (int y = 0; y < aRect.height; ++y)
+            memcpy(data + y * rowBytes,
+                   aImage.data + (static_cast<size_t>(aRect.y + y) * aImage.width + aRect.x) * pixelBytes, rowBytes);
+
+        uint32_t* palette = nullptr;
+        if (aImage.palette)
+            {
+            palette = new uint32_t[256];
+            memcpy(palette, aImage.palette, 256 * sizeof(uint32_t));
+            }
+        return Image(aName, aRect.width, aRect.height, data, aImage.channels, palette, aImage.bitDepth);
+    }
+}
+
+// End Of File
@@ -0,0 +1,46 @@
+//==============================================================================
+// Name         : imageslicer.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The Functions That Cut Decoded Images Into Smaller
+//                In-Memory Images, Such As The Tiles Of A Tilemap Sheet Or The
+//                Cells Of A Sprite Sheet
+//==============================================================================
+
+#ifndef IMAGESLICER_H
+#define IMAGESLICER_H
+
+#include <vector>     // std::vector
+#include <string>     // std::string
+#include "image.h"    // Image
+#include "rect.h"     // Rect
+
+namespace imageslicer
+{
+    //! @brief Split An Area Into A Grid Of Cells, Row By Row; The Cells Of The Last
+    //!        Column And Row Are Cut Short Where The Area Ends
+    //! @param aWidth The Area Width
+    //! @param aHeight The Area Height
+    //! @param aCellWidth The Cell Width, At Least 1
+    //! @param aCellHeight The Cell Height, At Least 1
+    //! @return The Cells
+    std::vector<Rect> Grid(int aWidth, int aHeight, int aCellWidth, int aCellHeight);
+
+    //! @brief Find The Cells Of A Sprite Sheet Whose Sprites Are Set Apart By Whole
+    //!        Rows And Columns Of Background: The Color Of The Top-Left Pixel, Or
+    //!        Full Transparency; Cells With Nothing But Background Are Left Out
+    //! @param aImage The Sheet
+    //! @return The Cells, Row By Row
+    std::vector<Rect> SeparatedCells(const Image& aImage);
+
+    //! @brief Copy A Rectangle Of An Image Into A New Image Of The Same Format, With
+    //!        Its Own Pixels And Palette, Which The Caller Deletes
+    //! @param aImage The Image
+    //! @param aRect The Rectangle, Inside The Image
+    //! @param aName The New Image's Name
+    //! @return The New Image
+    Image Cut(const Image& aImage, const Rect& aRect, const std::string& aName);
+}
+
+#endif    // IMAGESLICER_H
+
+// End Of File
@@ -0,0 +1,54 @@
+//==============================================================================
+// Name         : imagestreamwriter.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements ImageStreamWriter Class
+//==============================================================================
+
+#include "imagestreamwriter.h"    // ImageStreamWriter
+#include "pngstreamwriter.h"      // PNGStreamWriter
+#include "palettestreamwriter.h"  // PaletteStreamWriter
+#include "qoistreamwriter.h"      // QOIStreamWriter
+#include "texturestreamwriter.h"  // TextureStreamWriter
+
+
+//==============================================================================
+//! @brief Create The Writer For The Output Format In aOptions
+//! @param aFilename A File Name
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//! @param aThreadPool The Threads To Compress With
+//! @param aOptions The Output Format And Its Settings
+//! @param aChannels Channels Per Pixel Of The Rows, Below 4 For RGBA .png Output Only
+//! @param aBitDepth Bits Per Channel Of The Rows, 16 For RGBA .png Output Only
+//! @return The Writer, The File Is Created And Its Header Written
+//==============================================================================
+std::unique_ptr<ImageStreamWriter> ImageStreamWriter::Create(const char* aFilename, int aWidth, int aHeight,
+                                                             ThreadPool& aThreadPool, const AtlasOptions& aOptions,
+                                                             int aChannels, int aBitDepth)
+{
+    if (aOptions.outputFormat == OutputFormat::QOI)
+        return std::unique_ptr<ImageStreamWriter>(new QOIStreamWriter(aFilename, aWidth, aHeight));
+
+    if (aOptions.outputFormat == OutputFormat::DDS || aOptions.outputFormat == OutputFormat::KTX2)
+        {
+        const TextureStreamWriter::Container container = (aOptions.outputFormat == OutputFormat::DDS)
+                                                         ? TextureStreamWriter::Container::DDS
+                                                         : TextureStreamWriter::Container::KTX2;
+        return std::unique_ptr<ImageStreamWriter>(new TextureStreamWriter(aFilename, aWidth, aHeight, aThreadPool,
+                                                                          container, aOptions.textureFormat,
+                                                                          aOptions.encodeQuality, aOptions.dither,
+                                                                          aOptions.mipLevels,
+                                                                          aOptions.bgra, aOptions.pitchAlignment));
+        }
+
+    if (aOptions.paletteColors > 0)
+        return std::unique_ptr<ImageStreamWriter>(new PaletteStreamWriter(aFilename, aWidth, aHeight, aThreadPool,
+                                                                          aOptions.paletteColors,
+                                                                          aOptions.compression, aOptions.timeBudget));
+
+    return std::unique_ptr<ImageStreamWriter>(new PNGStreamWriter(aFilename, aWidth, aHeight, aThreadPool,
+                                                                  aOptions.compression, aOptions.timeBudget,
+                                                                  aChannels, aBitDepth));
+}
+
+// End Of File
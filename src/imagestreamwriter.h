@@ -0,0 +1,64 @@
+//==============================================================================
+// Name         : imagestreamwriter.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares ImageStreamWriter Class
+//==============================================================================
+
+#ifndef IMAGESTREAMWRITER_H
+#define IMAGESTREAMWRITER_H
+
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t
+#include <memory>     // std::unique_ptr
+#include "atlasoptions.h"    // AtlasOptions
+
+class ThreadPool;
+
+
+//==============================================================================
+//! ImageStreamWriter Class
+//! Writes An RGBA Image File A Run Of Rows At A Time, Top To Bottom; The
+//! Output Format Is Chosen By The Factory From The Options
+//==============================================================================
+class ImageStreamWriter
+{
+    public:
+    //! @brief Create The Writer For The Output Format In aOptions
+    //! @param aFilename A File Name
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aThreadPool The Threads To Compress With
+    //! @param aOptions The Output Format And Its Settings
+    //! @param aChannels Channels Per Pixel Of The Rows, Below 4 For RGBA .png Output Only
+    //! @param aBitDepth Bits Per Channel Of The Rows, 16 For RGBA .png Output Only
+    //! @return The Writer, The File Is Created And Its Header Written
+    static std::unique_ptr<ImageStreamWriter> Create(const char* aFilename, int aWidth, int aHeight,
+                                                     ThreadPool& aThreadPool, const AtlasOptions& aOptions,
+                                                     int aChannels = 4, int aBitDepth = 8);
+
+    //! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+    virtual ~ImageStreamWriter()
+    {
+    };
+
+    //! @brief Encode And Write The Next Rows
+    //! @param aRows The First Row, 4 Bytes Per Pixel Unless The Writer Was Created For Fewer
+    //!        Channels Or 16 Bits
+    //! @param aRowCount The Number Of Rows
+    //! @param aRowBytes The Distance Between Rows In Bytes
+    virtual void WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes) = 0;
+
+    //! @brief Write The End Of The File, After All Rows Are Written
+    virtual void Finish() = 0;
+
+    //! @brief Get The Size Level 0 Is Stored At, Larger Than The Image Where The Format Pads It
+    //! @param aWidth Holds The Image Width, Set To The Stored Width
+    //! @param aHeight Holds The Image Height, Set To The Stored Height
+    virtual void StoredSize(int& /*aWidth*/, int& /*aHeight*/) const
+    {
+    };
+};
+
+#endif    // IMAGESTREAMWRITER_H
+
+// End Of File
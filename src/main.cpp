@@ -8,11 +8,24 @@
 #include <string>              // std::string
 #include <iostream>            // std::cout
 #include <stdexcept>           // std::runtime_error, std::logic_error
-#include <dirent.h>            // DIR, dirent
+#include <cstdlib>             // std::strtoul, std::strtod
+#include <cctype>              // std::tolower
 #include "atlasgenerator.h"    // AtlasGenerator
+#include "atlasoptions.h"      // AtlasOptions
+#include "directoryscanner.h"  // directoryscanner::FindFiles
+#include "threadpool.h"        // ThreadPool
 
-//! Function To Get .png Files From Command Line Argument argv[1]
-std::vector<std::string> GetpngFiles(const char* aArgv1);
+//! Function To Print How To Run The Application
+void PrintUsage(const char* aArgv0);
+
+//! Function To Read The Options And The Image Folder From The Command Line
+void ParseArguments(int argc, char* argv[], AtlasOptions& aOptions, std::string& aFolder);
+
+//! Function To Get The Texture Atlas File Format From The Output File Extension
+OutputFormat GetOutputFormat(const std::string& aFile);
+
+//! Function To Get .png Files From The Image Folder
+std::vector<std::string> GetpngFiles(const AtlasOptions& aOptions);
 
 
 //==============================================================================
@@ -20,24 +33,26 @@ std::vector<std::string> GetpngFiles(const char* aArgv1);
 //==============================================================================
 int main(int argc, char* argv[])
 {
-    // argc should be 2: application executable name, path to the image folder
-    if (argc != 2)
+    // at least 2 arguments: application executable name, path to the image folder
+    if (argc < 2)
         {
         // tell the user how to run the application
-        std::cout << "App usage: " << argv[0] << " <image folder>" << std::endl;
-        std::cout << "If image folder path contains space, "
-                  << "please put the path in double quote." << std::endl;
+        PrintUsage(argv[0]);
         return 1;
         }
-    else    // argc is 2
+    else    // argc is 2 or more
         {
         try
             {
-            std::vector<std::string> pngList = GetpngFiles(argv[1]);
+            AtlasOptions options;
+            std::string folder;
+            ParseArguments(argc, argv, options, folder);
+
+            std::vector<std::string> pngList = GetpngFiles(options);
 
             if (pngList.size() != 0)
                 {
-                AtlasGenerator atlasGenerator(pngList);
+                AtlasGenerator atlasGenerator(pngList, options);
                 std::cout << "Start generating texture atlas..." << std::endl;
                 atlasGenerator.Run();
                 std::cout << "The texture atlas and it's metadata is successfully generated." << std::endl;
@@ -53,6 +68,11 @@ int main(int argc, char* argv[])
             std::cout << err.what() << std::endl;
             return 1;
             }
+        catch (const std::runtime_error& err)
+            {
+            std::cout << err.what() << std::endl;
+            return 1;
+            }
         }
 
     return 0;
@@ -60,42 +80,456 @@ int main(int argc, char* argv[])
 
 
 //==============================================================================
-//! @brief Get .png Files From Command Line Argument argv[1]
-//! @param aArgv1 Command Line Argument argv[1]
-//! @return A List Of .png Files With Path
+//! @brief Print How To Run The Application
+//! @param aArgv0 Command Line Argument argv[0]
 //==============================================================================
-std::vector<std::string> GetpngFiles(const char* aArgv1)
+void PrintUsage(const char* aArgv0)
 {
-    dirent* entry;
-    std::vector<std::string> fileList;
+    std::cout << "App usage: " << aArgv0 << " [options] <image folder>" << std::endl;
+    std::cout << "If image folder path contains space, "
+              << "please put the path in double quote." << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -j, --threads <count>    threads used for compositing and compression (default: one per core)" << std::endl;
+    std::cout << "  -r, --recursive          read the images in subfolders too, at any depth; metadata" << std::endl;
+    std::cout << "                           names are paths relative to the image folder" << std::endl;
+    std::cout << "  -o, --output <file>      the texture atlas file, .png, .qoi, .dds or .ktx2" << std::endl;
+    std::cout << "                           (default: texture_atlas.png); .qoi skips zlib, for atlases" << std::endl;
+    std::cout << "                           that are re-read right away; .dds and .ktx2 are uncompressed" << std::endl;
+    std::cout << "                           GPU textures with mip levels, uploaded without decoding" << std::endl;
+    std::cout << "  --mip-levels <count>     .dds/.ktx2 mip levels (default: the full chain)" << std::endl;
+    std::cout << "  --bgra                   store .dds/.ktx2 as BGRA8 instead of RGBA8" << std::endl;
+    std::cout << "  --pitch-alignment <bytes>" << std::endl;
+    std::cout << "                           pad .dds/.ktx2 with transparent columns so rows are a" << std::endl;
+    std::cout << "                           multiple of this many bytes, e.g. 256 for D3D12 uploads" << std::endl;
+    std::cout << "  --texture-format <rgba8|bc1|bc3|bc7|etc2-rgb|etc2-rgba|rgba4444|rgb565|rgba5551>" << std::endl;
+    std::cout << "                           .dds/.ktx2 texels: uncompressed (default), or 4x4 blocks" << std::endl;
+    std::cout << "                           encoded in memory, bc1 with 1-bit alpha, bc3 and bc7 full;" << std::endl;
+    std::cout << "                           etc2 for mobile GPUs, .ktx2 only, etc2-rgb drops alpha;" << std::endl;
+    std::cout << "                           or 16 bits per pixel, half the memory of rgba8" << std::endl;
+    std::cout << "  --block-quality <fast|normal|high>" << std::endl;
+    std::cout << "                           how hard bc/etc2 blocks are encoded (default: normal)" << std::endl;
+    std::cout << "  --dither <none|ordered|diffusion>" << std::endl;
+    std::cout << "                           how 16-bit texture formats hide banding (default: none)" << std::endl;
+    std::cout << "  --compose <sprites|bands|stream>" << std::endl;
+    std::cout << "                           draw image by image (default), or in row bands in" << std::endl;
+    std::cout << "                           memory order with non-temporal stores, for huge atlases;" << std::endl;
+    std::cout << "                           stream writes each band to the output file as soon as it" << std::endl;
+    std::cout << "                           is drawn, holding only a few bands in memory; any format," << std::endl;
+    std::cout << "                           but --palette still holds the whole atlas to pick colors;" << std::endl;
+    std::cout << "                           not with --huge-pages or --atlas-file, there is no atlas buffer" << std::endl;
+    std::cout << "  --compression <store|fast|default|max|exhaustive>" << std::endl;
+    std::cout << "                           how hard the .png is compressed: store and fast for quick" << std::endl;
+    std::cout << "                           iteration builds, max for a small release file, exhaustive" << std::endl;
+    std::cout << "                           tries every filter and several deflate settings per chunk" << std::endl;
+    std::cout << "  --time-budget <seconds>  stop the exhaustive search after this many seconds, more" << std::endl;
+    std::cout << "                           than 0, the rest is compressed as max (default: no limit)" << std::endl;
+    std::cout << "  --palette <colors>       write an indexed-color .png with 2 to 256 colors, exact if" << std::endl;
+    std::cout << "                           the atlas has that few, else quantized (default: RGBA)" << std::endl;
+    std::cout << "  --channels <rgba|auto>   auto writes the .png with the fewest channels that hold" << std::endl;
+    std::cout << "                           every image: rgb, gray-alpha, gray, or an alpha mask;" << std::endl;
+    std::cout << "                           uncovered areas of opaque atlases turn black (default: rgba)" << std::endl;
+    std::cout << "  --decoder <libpng|native>" << std::endl;
+    std::cout << "                           read 8-bit RGB/RGBA images with the faster in-tree decoder," << std::endl;
+    std::cout << "                           libpng still reads everything else (default: libpng)" << std::endl;
+    std::cout << "  --trim                   pack images without their fully transparent borders," << std::endl;
+    std::cout << "                           the metadata keeps their untrimmed size and offset" << std::endl;
+    std::cout << "  --pack <rects|hulls>     pack the image rectangles (default), or their convex hulls" << std::endl;
+    std::cout << "                           for irregular sprites, with meshes in the metadata" << std::endl;
+    std::cout << "  --hull-vertices <count>  the most vertices of each hull, 3 or more (default: 8)" << std::endl;
+    std::cout << "  --sheets <WxH|auto>      cut every image into sprites: a grid of W x H cells, or" << std::endl;
+    std::cout << "                           cells set apart by rows and columns of the top-left color" << std::endl;
+    std::cout << "                           or of transparency; empty cells are left out" << std::endl;
+    std::cout << "  --dedupe <none|sprites|tiles>" << std::endl;
+    std::cout << "                           sprites packs identical images once, the metadata lists" << std::endl;
+    std::cout << "                           every name at the same place; tiles cuts the images into" << std::endl;
+    std::cout << "                           tiles, packs each distinct tile once and writes a tile map" << std::endl;
+    std::cout << "                           per image (default: none)" << std::endl;
+    std::cout << "  --tile-size <pixels>     the tile width and height of --dedupe tiles (default: 16)" << std::endl;
+    std::cout << "  --huge-pages             back the atlas buffer with huge pages if available" << std::endl;
+    std::cout << "  --atlas-file <path>      compose the atlas in a memory-mapped scratch file," << std::endl;
+    std::cout << "                           for atlases larger than RAM; the path must not exist yet," << std::endl;
+    std::cout << "                           the file is created and removed when done" << std::endl;
+}
 
-    DIR* dir = opendir(aArgv1);
-    if (dir != nullptr)
+
+//==============================================================================
+//! @brief Read The Options And The Image Folder From The Command Line
+//! @param argc The Argument Count
+//! @param argv The Arguments
+//! @param aOptions Receives The Options
+//! @param aFolder Receives The Image Folder
+//==============================================================================
+void ParseArguments(int argc, char* argv[], AtlasOptions& aOptions, std::string& aFolder)
+{
+    for (int i = 1; i < argc; ++i)
         {
-        while ((entry = readdir(dir)) != nullptr)
+        const std::string arg = argv[i];
+
+        if (arg == "-j" || arg == "--threads")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a thread count!");
+
+            char* end = nullptr;
+            const unsigned long count = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || count == 0 || count > 1024)
+                throw std::invalid_argument(std::string(argv[i]) + " is not a valid thread count!");
+            aOptions.threadCount = static_cast<unsigned>(count);
+            }
+        else if (arg == "-r" || arg == "--recursive")
+            aOptions.recursive = true;
+        else if (arg == "-o" || arg == "--output")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a file name!");
+            aOptions.outputFile = argv[++i];
+            aOptions.outputFormat = GetOutputFormat(aOptions.outputFile);
+            }
+        else if (arg == "--mip-levels")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a level count!");
+
+            char* end = nullptr;
+            const unsigned long count = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || count == 0 || count > 32)
+                throw std::invalid_argument(std::string(argv[i]) + " is not a valid mip level count!");
+            aOptions.mipLevels = static_cast<int>(count);
+            }
+        else if (arg == "--bgra")
+            aOptions.bgra = true;
+        else if (arg == "--pitch-alignment")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a number of bytes!");
+
+            char* end = nullptr;
+            const unsigned long bytes = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || bytes == 0 || bytes > 65536 || (bytes & (bytes - 1)) != 0)
+                throw std::invalid_argument(std::string(argv[i]) + " is not a power of two up to 65536!");
+            aOptions.pitchAlignment = static_cast<unsigned>(bytes);
+            }
+        else if (arg == "--texture-format")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a format!");
+
+            const std::string format = argv[++i];
+            if (format == "rgba8")
+                aOptions.textureFormat = TextureFormat::RGBA8;
+            else if (format == "bc1")
+                aOptions.textureFormat = TextureFormat::BC1;
+            else if (format == "bc3")
+                aOptions.textureFormat = TextureFormat::BC3;
+            else if (format == "bc7")
+                aOptions.textureFormat = TextureFormat::BC7;
+            else if (format == "etc2-rgb")
+                aOptions.textureFormat = TextureFormat::ETC2RGB;
+            else if (format == "etc2-rgba")
+                aOptions.textureFormat = TextureFormat::ETC2RGBA;
+            else if (format == "rgba4444")
+                aOptions.textureFormat = TextureFormat::RGBA4444;
+            else if (format == "rgb565")
+                aOptions.textureFormat = TextureFormat::RGB565;
+            else if (format == "rgba5551")
+                aOptions.textureFormat = TextureFormat::RGBA5551;
+            else
+                throw std::invalid_argument(format + " is not a texture format, use rgba8, bc1, bc3, bc7, "
+                                            "etc2-rgb, etc2-rgba, rgba4444, rgb565 or rgba5551!");
+            }
+        else if (arg == "--block-quality")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a quality!");
+
+            const std::string quality = argv[++i];
+            if (quality == "fast")
+                aOptions.encodeQuality = EncodeQuality::Fast;
+            else if (quality == "normal")
+                aOptions.encodeQuality = EncodeQuality::Normal;
+            else if (quality == "high")
+                aOptions.encodeQuality = EncodeQuality::High;
+            else
+                throw std::invalid_argument(quality + " is not a block quality, use fast, normal or high!");
+            }
+        else if (arg == "--dither")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a mode!");
+
+            const std::string mode = argv[++i];
+            if (mode == "none")
+                aOptions.dither = DitherMode::None;
+            else if (mode == "ordered")
+                aOptions.dither = DitherMode::Ordered;
+            else if (mode == "diffusion")
+                aOptions.dither = DitherMode::Diffusion;
+            else
+                throw std::invalid_argument(mode + " is not a dither mode, use none, ordered or diffusion!");
+            }
+        else if (arg == "--compose")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a mode!");
+
+            const std::string mode = argv[++i];
+            if (mode == "sprites")
+                aOptions.composeMode = ComposeMode::Sprites;
+            else if (mode == "bands")
+                aOptions.composeMode = ComposeMode::Bands;
+            else if (mode == "stream")
+                aOptions.composeMode = ComposeMode::Stream;
+            else
+                throw std::invalid_argument(mode + " is not a compose mode, use sprites, bands or stream!");
+            }
+        else if (arg == "--compression")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a preset!");
+
+            const std::string preset = argv[++i];
+            if (preset == "store")
+                aOptions.compression = CompressionPreset::Store;
+            else if (preset == "fast")
+                aOptions.compression = CompressionPreset::Fast;
+            else if (preset == "default")
+                aOptions.compression = CompressionPreset::Default;
+            else if (preset == "max")
+                aOptions.compression = CompressionPreset::Max;
+            else if (preset == "exhaustive")
+                aOptions.compression = CompressionPreset::Exhaustive;
+            else
+                throw std::invalid_argument(preset + " is not a compression preset, "
+                                            "use store, fast, default, max or exhaustive!");
+            }
+        else if (arg == "--time-budget")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a number of seconds!");
+
+            char* end = nullptr;
+            const double seconds = std::strtod(argv[++i], &end);
+            if (*end != '\0' || end == argv[i] || !(seconds > 0))
+                throw std::invalid_argument(std::string(argv[i]) + " is not a valid time budget, give more than 0 seconds!");
+            aOptions.timeBudget = seconds;
+            }
+        else if (arg == "--palette")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a color count!");
+
+            char* end = nullptr;
+            const unsigned long colors = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || colors < 2 || colors > 256)
+                throw std::invalid_argument(std::string(argv[i]) + " is not a valid palette size, use 2 to 256!");
+            aOptions.paletteColors = static_cast<int>(colors);
+            }
+        else if (arg == "--channels")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a mode!");
+
+            const std::string mode = argv[++i];
+            if (mode == "rgba")
+                aOptions.channelMode = ChannelMode::RGBA;
+            else if (mode == "auto")
+                aOptions.channelMode = ChannelMode::Auto;
+            else
+                throw std::invalid_argument(mode + " is not a channel mode, use rgba or auto!");
+            }
+        else if (arg == "--decoder")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a decoder!");
+
+            const std::string decoder = argv[++i];
+            if (decoder == "libpng")
+                aOptions.nativeDecoder = false;
+            else if (decoder == "native")
+                aOptions.nativeDecoder = true;
+            else
+                throw std::invalid_argument(decoder + " is not a decoder, use libpng or native!");
+            }
+        else if (arg == "--trim")
+            aOptions.trim = true;
+        else if (arg == "--pack")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a mode!");
+
+            const std::string mode = argv[++i];
+            if (mode == "rects")
+                aOptions.packMode = PackMode::Rects;
+            else if (mode == "hulls")
+                aOptions.packMode = PackMode::Hulls;
+            else
+                throw std::invalid_argument(mode + " is not a pack mode, use rects or hulls!");
+            }
+        else if (arg == "--hull-vertices")
             {
-            if (entry->d_type == DT_REG)
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a vertex count!");
+
+            char* end = nullptr;
+            const unsigned long count = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || count < 3 || count > 1024)
+                throw std::invalid_argument(std::string(argv[i]) + " is not a valid vertex count, use 3 to 1024!");
+            aOptions.hullVertices = static_cast<int>(count);
+            }
+        else if (arg == "--sheets")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a cell size or auto!");
+
+            const std::string spec = argv[++i];
+            if (spec == "auto")
+                aOptions.sheetMode = SheetMode::Auto;
+            else
                 {
-                std::string fileName = entry->d_name;
-                std::string extension = ".png";
-                if (fileName.find(extension, fileName.length() - extension.length())
-                    != std::string::npos)
-                    {
-                    std::string filePathName;
-                    std::string path(aArgv1);
-                    filePathName = path + std::string("/") + fileName;
-                    fileList.push_back(filePathName);
-                    }
+                char* end = nullptr;
+                const unsigned long width = std::strtoul(spec.c_str(), &end, 10);
+                const unsigned long height = (*end == 'x') ? std::strtoul(end + 1, &end, 10) : 0;
+                if (*end != '\0' || width < 1 || width > 65535 || height < 1 || height > 65535)
+                    throw std::invalid_argument(spec + " is not a valid cell size, use e.g. 32x48, or auto!");
+                aOptions.sheetMode = SheetMode::Grid;
+                aOptions.cellWidth = static_cast<int>(width);
+                aOptions.cellHeight = static_cast<int>(height);
                 }
             }
-        closedir(dir);
-        }
-    else    // dir is nullptr
-        {
-        std::cout << "Please provide a valid directory" << std::endl;
-        std::exit(EXIT_FAILURE);
+        else if (arg == "--dedupe")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a mode!");
+
+            const std::string mode = argv[++i];
+            if (mode == "none")
+                aOptions.dedupe = DedupeMode::None;
+            else if (mode == "sprites")
+                aOptions.dedupe = DedupeMode::Sprites;
+            else if (mode == "tiles")
+                aOptions.dedupe = DedupeMode::Tiles;
+            else
+                throw std::invalid_argument(mode + " is not a dedupe mode, use none, sprites or tiles!");
+            }
+        else if (arg == "--tile-size")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a size!");
+
+            char* end = nullptr;
+            const unsigned long size = std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || size < 1 || size > 4096)
+                throw std::invalid_argument(std::string(argv[i]) + " is not a valid tile size, use 1 to 4096!");
+            aOptions.tileSize = static_cast<int>(size);
+            }
+        else if (arg == "--huge-pages")
+            aOptions.hugePages = true;
+        else if (arg == "--atlas-file")
+            {
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a file path!");
+            aOptions.atlasFile = argv[++i];
+            }
+        else if (!arg.empty() && arg[0] == '-')
+            throw std::invalid_argument("Unknown option " + arg + ", run without arguments for usage.");
+        else if (aFolder.empty())
+            aFolder = arg;
+        else
+            throw std::invalid_argument("Only one image folder can be given, got " + aFolder + " and " + arg + "!");
         }
 
+    if (aFolder.empty())
+        throw std::invalid_argument("Please provide an image folder.");
+    aOptions.imageFolder = aFolder;
+
+    // streaming never allocates the whole atlas, so the options for its buffer would do nothing
+    if (aOptions.composeMode == ComposeMode::Stream && aOptions.hugePages)
+        throw std::invalid_argument("--huge-pages doesn't apply to --compose stream, which has no atlas buffer!");
+    if (aOptions.composeMode == ComposeMode::Stream && !aOptions.atlasFile.empty())
+        throw std::invalid_argument("--atlas-file doesn't apply to --compose stream, which has no atlas buffer!");
+
+    // the other writers have no palette, they would quietly write full color
+    if (aOptions.paletteColors > 0 && aOptions.outputFormat != OutputFormat::PNG)
+        throw std::invalid_argument("--palette only applies to .png output!");
+
+    // .dds has no ETC2 formats, caught before any image is read rather than by the writer
+    if (aOptions.outputFormat == OutputFormat::DDS
+        && (aOptions.textureFormat == TextureFormat::ETC2RGB || aOptions.textureFormat == TextureFormat::ETC2RGBA))
+        throw std::invalid_argument("ETC2 textures can only be written as .ktx2!");
+
+    // nor compression presets or fewer channels, they store every texel as it is
+    const AtlasOptions defaults;
+    if (aOptions.compression != defaults.compression && aOptions.outputFormat != OutputFormat::PNG)
+        throw std::invalid_argument("--compression only applies to .png output!");
+    if (aOptions.timeBudget > 0 && aOptions.compression != CompressionPreset::Exhaustive)
+        throw std::invalid_argument("--time-budget only applies to --compression exhaustive!");
+    if (aOptions.channelMode != defaults.channelMode && aOptions.outputFormat != OutputFormat::PNG)
+        throw std::invalid_argument("--channels auto only applies to .png output!");
+
+    // mip levels, BGRA and row padding are texture container options
+    const bool texture = (aOptions.outputFormat == OutputFormat::DDS || aOptions.outputFormat == OutputFormat::KTX2);
+    if (aOptions.mipLevels != defaults.mipLevels && !texture)
+        throw std::invalid_argument("--mip-levels only applies to .dds and .ktx2 output!");
+    if (aOptions.bgra && !texture)
+        throw std::invalid_argument("--bgra only applies to .dds and .ktx2 output!");
+    if (aOptions.pitchAlignment != defaults.pitchAlignment && !texture)
+        throw std::invalid_argument("--pitch-alignment only applies to .dds and .ktx2 output!");
+    if (aOptions.textureFormat != defaults.textureFormat && !texture)
+        throw std::invalid_argument("--texture-format only applies to .dds and .ktx2 output!");
+
+    // and the block quality only to the block formats, BGRA only to RGBA8, dithering to the 16-bit ones
+    const bool blocks = aOptions.textureFormat == TextureFormat::BC1 || aOptions.textureFormat == TextureFormat::BC3
+                        || aOptions.textureFormat == TextureFormat::BC7 || aOptions.textureFormat == TextureFormat::ETC2RGB
+                        || aOptions.textureFormat == TextureFormat::ETC2RGBA;
+    if (aOptions.encodeQuality != defaults.encodeQuality && !blocks)
+        throw std::invalid_argument("--block-quality only applies to the bc and etc2 texture formats!");
+    if (aOptions.bgra && aOptions.textureFormat != TextureFormat::RGBA8)
+        throw std::invalid_argument("--bgra only applies to the rgba8 texture format!");
+    if (aOptions.dither != defaults.dither && aOptions.textureFormat != TextureFormat::RGBA4444
+        && aOptions.textureFormat != TextureFormat::RGB565 && aOptions.textureFormat != TextureFormat::RGBA5551)
+        throw std::invalid_argument("--dither only applies to the rgba4444, rgb565 and rgba5551 texture formats!");
+}
+
+
+//==============================================================================
+//! @brief Get The Texture Atlas File Format From The Output File Extension
+//! @param aFile The Output File Name
+//! @return The Format, Throws If The Extension Is Not A Supported One
+//==============================================================================
+OutputFormat GetOutputFormat(const std::string& aFile)
+{
+    const size_t dot = aFile.rfind('.');
+    std::string extension = (dot == std::string::npos) ? std::string() : aFile.substr(dot);
+    for (char& c : extension)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    if (extension == ".png")
+        return OutputFormat::PNG;
+    if (extension == ".qoi")
+        return OutputFormat::QOI;
+    if (extension == ".dds")
+        return OutputFormat::DDS;
+    if (extension == ".ktx2")
+        return OutputFormat::KTX2;
+
+    throw std::invalid_argument(aFile + " has no supported extension, use .png, .qoi, .dds or .ktx2!");
+}
+
+
+//==============================================================================
+//! @brief Get .png Files From The Image Folder, And With --recursive From Its
+//!        Subfolders, Listed In Parallel And Sorted By Name
+//! @param aOptions The Settings From The Command Line, With The Image Folder
+//! @return A List Of .png Files With Path
+//==============================================================================
+std::vector<std::string> GetpngFiles(const AtlasOptions& aOptions)
+{
+    ThreadPool threadPool(aOptions.threadCount);
+    std::vector<std::string> fileList =
+        directoryscanner::FindFiles(aOptions.imageFolder, ".png", aOptions.recursive, threadPool);
+
+    for (std::string& fileName : fileList)
+        fileName = aOptions.imageFolder + "/" + fileName;
     return fileList;
 }
 
@@ -0,0 +1,125 @@
+//==============================================================================
+// Name         : palettestreamwriter.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements PaletteStreamWriter Class
+//==============================================================================
+
+#include "palettestreamwriter.h"    // PaletteStreamWriter
+#include "colorquantizer.h"         // CountColors, BuildPalette, PaletteMapper
+#include "threadpool.h"             // ThreadPool
+#include <cstdio>                   // fopen, fclose
+#include <stdexcept>                // std::runtime_error, std::invalid_argument
+
+//! The Most Distinct Colors The Quantizer Works From; Images With More Are
+//! Counted Again With Low Bits Dropped Until They Fit
+static const size_t kHistogramColors = 1 << 16;
+
+
+//==============================================================================
+//! @brief Constructor, Creates The File; The Rest Is Written By Finish()
+//! @param aFilename A File Name
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//! @param aThreadPool The Threads To Map And Compress With
+//! @param aMaxColors The Most Palette Colors, 2 To 256
+//! @param aPreset How Hard To Compress
+//! @param aTimeBudget Seconds The Exhaustive Preset May Search For, 0 For No Limit
+//==============================================================================
+PaletteStreamWriter::PaletteStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                                         int aMaxColors, CompressionPreset aPreset, double aTimeBudget)
+    : iFilename(aFilename)
+    , iThreadPool(aThreadPool)
+    , iMaxColors(aMaxColors)
+    , iPreset(aPreset)
+    , iTimeBudget(aTimeBudget)
+    , iWidth(aWidth)
+    , iHeight(aHeight)
+    , iRowsWritten(0)
+    , iPalette(PaletteReport())
+{
+    if (aMaxColors < 2 || aMaxColors > 256)
+        throw std::invalid_argument("A .png palette holds 2 to 256 colors!");
+
+    // fail now rather than after the whole atlas is drawn
+    FILE* file = fopen(aFilename, "wb");
+    if (!file)
+        throw std::runtime_error(iFilename + " could not be opened for writing!");
+    fclose(file);
+
+    iPixels.reserve(4 * static_cast<size_t>(aWidth) * aHeight);
+}
+
+
+//==============================================================================
+//! @brief Keep The Next Rows
+//! @param aRows The First Row, 4 Bytes Per Pixel
+//! @param aRowCount The Number Of Rows
+//! @param aRowBytes The Distance Between Rows In Bytes
+//==============================================================================
+void PaletteStreamWriter::WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes)
+{
+    if (aRowCount > iHeight - iRowsWritten)
+        throw std::runtime_error("More rows than the height of " + iFilename + "!");
+
+    const size_t rowBytes = 4 * static_cast<size_t>(iWidth);
+    for (int y = 0; y < aRowCount; ++y)
+        iPixels.insert(iPixels.end(), aRows + y * aRowBytes, aRows + y * aRowBytes + rowBytes);
+    iRowsWritten += aRowCount;
+}
+
+
+//==============================================================================
+//! @brief Build The Palette And Write The Whole File, After All Rows Are Written
+//==============================================================================
+void PaletteStreamWriter::Finish()
+{
+    if (iRowsWritten != iHeight)
+        throw std::runtime_error("Not all rows of " + iFilename + " were written!");
+
+    // exact when the colors fit; otherwise the quantizer works from a histogram,
+    // coarsened until it is small enough
+    const size_t pixelCount = static_cast<size_t>(iWidth) * iHeight;
+    std::vector<colorquantizer::ColorCount> colors;
+    iPalette.exact = colorquantizer::CountColors(iPixels.data(), pixelCount, iMaxColors, 0, colors);
+    int dropped = 0;
+    while (!iPalette.exact
+           && !colorquantizer::CountColors(iPixels.data(), pixelCount, kHistogramColors, dropped, colors))
+        ++dropped;
+
+    const std::vector<uint32_t> palette = colorquantizer::BuildPalette(colors, iMaxColors);
+    iPalette.colors = static_cast<int>(palette.size());
+
+    // indices packed from the high bits, rows mapped in parallel
+    const colorquantizer::PaletteMapper mapper(palette);
+    const int bits = PNGStreamWriter::BitDepth(palette.size());
+    const size_t rowBytes = (static_cast<size_t>(iWidth) * bits + 7) / 8;
+    std::vector<uint8_t> indices(rowBytes * iHeight, 0);
+    iThreadPool.ParallelFor(iHeight, [&](size_t aRow)
+        {
+        const uint8_t* src = iPixels.data() + 4 * static_cast<size_t>(iWidth) * aRow;
+        uint8_t* dst = indices.data() + rowBytes * aRow;
+
+        // a pixel the same as the one before maps the same
+        uint32_t previous = 0;
+        uint8_t index = 0;
+        for (int x = 0; x < iWidth; ++x)
+            {
+            const uint32_t color = colorquantizer::PixelColor(src + 4 * x);
+            if (x == 0 || color != previous)
+                {
+                index = mapper.Map(color);
+                previous = color;
+                }
+            const size_t bit = static_cast<size_t>(x) * bits;
+            dst[bit / 8] |= static_cast<uint8_t>(index << (8 - bits - bit % 8));
+            }
+        });
+    std::vector<uint8_t>().swap(iPixels);
+
+    iWriter.reset(new PNGStreamWriter(iFilename.c_str(), iWidth, iHeight, iThreadPool, palette,
+                                      iPreset, iTimeBudget));
+    iWriter->WriteRows(indices.data(), iHeight, rowBytes);
+    iWriter->Finish();
+}
+
+// End Of File
@@ -0,0 +1,92 @@
+//==============================================================================
+// Name         : palettestreamwriter.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares PaletteStreamWriter Class
+//==============================================================================
+
+#ifndef PALETTESTREAMWRITER_H
+#define PALETTESTREAMWRITER_H
+
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t
+#include <memory>     // std::unique_ptr
+#include <string>     // std::string
+#include <vector>     // std::vector
+#include "atlasoptions.h"         // CompressionPreset
+#include "imagestreamwriter.h"    // ImageStreamWriter
+#include "pngstreamwriter.h"      // PNGStreamWriter
+
+class ThreadPool;
+
+
+//==============================================================================
+//! PaletteStreamWriter Class
+//! Writes An Indexed-Color .png: Up To 256 Colors In A PLTE Chunk, Their
+//! Alphas In tRNS, And 1 To 8 Bits Per Pixel. The Palette Depends On Every
+//! Pixel, So The Rows Are Kept Until Finish(), Which Counts The Colors, Uses
+//! Them As They Are If They Fit Or Quantizes Them If Not, Maps Each Row To
+//! Palette Indices On The Thread Pool And Compresses Them As PNGStreamWriter Does
+//==============================================================================
+class PaletteStreamWriter : public ImageStreamWriter
+{
+    public:
+    //! What The Palette Came To
+    struct PaletteReport
+    {
+        int         colors;      // palette colors written
+        bool        exact;       // the image had no more colors than the palette allows
+    };
+
+    //! @brief Constructor, Creates The File; The Rest Is Written By Finish()
+    //! @param aFilename A File Name
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aThreadPool The Threads To Map And Compress With
+    //! @param aMaxColors The Most Palette Colors, 2 To 256
+    //! @param aPreset How Hard To Compress
+    //! @param aTimeBudget Seconds The Exhaustive Preset May Search For, 0 For No Limit
+    PaletteStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool, int aMaxColors,
+                        CompressionPreset aPreset = CompressionPreset::Default, double aTimeBudget = 0);
+
+    //! @brief Keep The Next Rows
+    //! @param aRows The First Row, 4 Bytes Per Pixel
+    //! @param aRowCount The Number Of Rows
+    //! @param aRowBytes The Distance Between Rows In Bytes
+    void WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes);
+
+    //! @brief Build The Palette And Write The Whole File, After All Rows Are Written
+    void Finish();
+
+    //! @brief Get What The Palette Came To, After Finish()
+    const PaletteReport& Palette() const
+    {
+        return iPalette;
+    };
+
+    //! @brief Get The Writer That Compressed The Indices, After Finish()
+    const PNGStreamWriter* Writer() const
+    {
+        return iWriter.get();
+    };
+
+    private:
+    PaletteStreamWriter(const PaletteStreamWriter&);
+    PaletteStreamWriter& operator=(const PaletteStreamWriter&);
+
+    private:
+    std::string                 iFilename;
+    ThreadPool&                 iThreadPool;
+    int                         iMaxColors;
+    CompressionPreset           iPreset;
+    double                      iTimeBudget;
+    int                         iWidth;
+    int                         iHeight;
+    int                         iRowsWritten;
+    std::vector<uint8_t>        iPixels;      // the rows so far, RGBA
+    PaletteReport               iPalette;
+    std::unique_ptr<PNGStreamWriter> iWriter;
+};
+
+#endif    // PALETTESTREAMWRITER_H
+
+// End Of File
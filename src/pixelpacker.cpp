@@ -0,0 +1,323 @@
+//==============================================================================
+// Name         : pixelpacker.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The Kernels That Pack RGBA Rows Into 16-bit Pixels,
+//                With Ordered Or Error-Diffusion Dithering
+//==============================================================================
+
+#include "pixelpacker.h"     // pixelpacker::Kernels
+#include <algorithm>         // std::min, std::max
+#include <string.h>          // memcpy
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define PACK_X86
+    #include <immintrin.h>          // SSSE3, AVX2 intrinsics
+    #if defined(_MSC_VER)
+        #define PACK_TARGET(aIsa)
+    #else
+        #define PACK_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace pixelpacker
+{
+    using blitkernels::Isa;
+
+    //! 4x4 Bayer Matrix, Each Entry (2i + 1) * 255 / 32 So The Thresholds Center On 127
+    static const uint8_t kBayer[4][4] =
+    {
+        {   7, 135,  39, 167 },
+        { 199,  71, 231, 103 },
+        {  55, 183,  23, 151 },
+        { 247, 119, 215,  87 }
+    };
+
+
+    //==============================================================================
+    //! @brief Divide By 255, Rounding Down, For 0 <= aValue < 65535
+    //==============================================================================
+    static inline int Div255(int aValue)
+    {
+        return (aValue + 1 + (aValue >> 8)) >> 8;
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Multiplier That Expands A Quantized Channel Back To 8 Bits As
+    //!        (q * m + 64) >> 7; 0 For A Dropped Channel
+    //==============================================================================
+    static inline int ExpandMultiplier(int aBits)
+    {
+        return aBits ? (255 * 128 + ((1 << aBits) - 1) / 2) / ((1 << aBits) - 1) : 0;
+    }
+
+
+    //==============================================================================
+    //! @brief Quantize A Row One Pixel At A Time, Adding The Column's Threshold
+    //! @param aPixels The Row, RGBA
+    //! @param aCount The Number Of Pixels
+    //! @param aThresholds 4 Thresholds, One Per Pixel Column Modulo 4
+    //! @param aLayout Where Each Channel Goes
+    //! @param aDst Receives The Packed Pixels
+    //==============================================================================
+    static void PackOrderedScalar(const uint8_t* aPixels, int aCount, const uint8_t* aThresholds,
+                                  const Layout& aLayout, uint16_t* aDst)
+    {
+        for (int x = 0; x < aCount; ++x)
+            {
+            const uint8_t* pixel = aPixels + 4 * x;
+            unsigned packed = 0;
+            for (int c = 0; c < 4; ++c)
+                {
+                const int levels = (1 << aLayout.bits[c]) - 1;
+                packed += static_cast<unsigned>(Div255(pixel[c] * levels + aThresholds[x & 3])) << aLayout.shifts[c];
+                }
+            aDst[x] = static_cast<uint16_t>(packed);
+            }
+    }
+
+
+    //==============================================================================
+    //! @brief Quantize A Row Left To Right, Spreading Each Pixel's Error, One Channel At A Time
+    //! @param aPixels The Row, RGBA
+    //! @param aCount The Number Of Pixels
+    //! @param aErrors 4 Per Pixel In 1/16ths: This Row's On Entry, The Next Row's On Return
+    //! @param aLayout Where Each Channel Goes
+    //! @param aDst Receives The Packed Pixels
+    //==============================================================================
+    static void PackDiffusedScalar(const uint8_t* aPixels, int aCount, int16_t* aErrors,
+                                   const Layout& aLayout, uint16_t* aDst)
+    {
+        int levels[4], expand[4];
+        for (int c = 0; c < 4; ++c)
+            {
+            levels[c] = (1 << aLayout.bits[c]) - 1;
+            expand[c] = ExpandMultiplier(aLayout.bits[c]);
+            }
+
+        // per channel: the error carried right, and the next row's errors below-left and below
+        int carry[4] = {0, 0, 0, 0}, belowLeft[4] = {0, 0, 0, 0}, below[4] = {0, 0, 0, 0};
+        for (int x = 0; x < aCount; ++x)
+            {
+            const uint8_t* pixel = aPixels + 4 * x;
+            unsigned packed = 0;
+            for (int c = 0; c < 4; ++c)
+                {
+                const int value = std::min(255, std::max(0, pixel[c] + ((aErrors[4 * x + c] + carry[c] + 8) >> 4)));
+                const int quantized = Div255(value * levels[c] + 127);
+                const int error = value - ((quantized * expand[c] + 64) >> 7);
+                packed += static_cast<unsigned>(quantized) << aLayout.shifts[c];
+
+                // 7/16 right, 3/16 below-left, 5/16 below, 1/16 below-right
+                if (x > 0)
+                    aErrors[4 * (x - 1) + c] = static_cast<int16_t>(belowLeft[c] + 3 * error);
+                belowLeft[c] = below[c] + 5 * error;
+                below[c] = error;
+                carry[c] = 7 * error;
+                }
+            aDst[x] = static_cast<uint16_t>(packed);
+            }
+
+        if (aCount > 0)
+            for (int c = 0; c < 4; ++c)
+                aErrors[4 * (aCount - 1) + c] = static_cast<int16_t>(belowLeft[c]);
+    }
+
+
+#if defined(PACK_X86)
+    //==============================================================================
+    //! @brief Quantize A Row 4 Pixels At A Time, As 16-bit Channels
+    //==============================================================================
+    PACK_TARGET("ssse3")
+    static void PackOrderedSSSE3(const uint8_t* aPixels, int aCount, const uint8_t* aThresholds,
+                                 const Layout& aLayout, uint16_t* aDst)
+    {
+        const Layout& l = aLayout;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i levels = _mm_setr_epi16((1 << l.bits[0]) - 1, (1 << l.bits[1]) - 1, (1 << l.bits[2]) - 1,
+                                              (1 << l.bits[3]) - 1, (1 << l.bits[0]) - 1, (1 << l.bits[1]) - 1,
+                                              (1 << l.bits[2]) - 1, (1 << l.bits[3]) - 1);
+        const __m128i shifts = _mm_setr_epi16(static_cast<short>(1 << l.shifts[0]), static_cast<short>(1 << l.shifts[1]),
+                                              static_cast<short>(1 << l.shifts[2]), static_cast<short>(1 << l.shifts[3]),
+                                              static_cast<short>(1 << l.shifts[0]), static_cast<short>(1 << l.shifts[1]),
+                                              static_cast<short>(1 << l.shifts[2]), static_cast<short>(1 << l.shifts[3]));
+        const __m128i thresholdsLo = _mm_setr_epi16(aThresholds[0], aThresholds[0], aThresholds[0], aThresholds[0],
+                                                    aThresholds[1], aThresholds[1], aThresholds[1], aThresholds[1]);
+        const __m128i thresholdsHi = _mm_setr_epi16(aThresholds[2], aThresholds[2], aThresholds[2], aThresholds[2],
+                                                    aThresholds[3], aThresholds[3], aThresholds[3], aThresholds[3]);
+        // the low 16 bits of each 32-bit pixel
+        const __m128i gather = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+        int x = 0;
+        for (; x + 4 <= aCount; x += 4)
+            {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPixels + 4 * x));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), levels), thresholdsLo);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), levels), thresholdsHi);
+            lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+            // the channels don't overlap once shifted, so summing them packs the pixel;
+            // the top bit makes a lane negative, which leaves the low 16 bits of the sum right
+            lo = _mm_madd_epi16(_mm_mullo_epi16(lo, shifts), one);
+            hi = _mm_madd_epi16(_mm_mullo_epi16(hi, shifts), one);
+            const __m128i packed = _mm_shuffle_epi8(_mm_hadd_epi32(lo, hi), gather);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(aDst + x), packed);
+            }
+
+        PackOrderedScalar(aPixels + 4 * x, aCount - x, aThresholds, aLayout, aDst + x);
+    }
+
+
+    //==============================================================================
+    //! @brief Quantize A Row 8 Pixels At A Time, As 16-bit Channels
+    //==============================================================================
+    PACK_TARGET("avx2")
+    static void PackOrderedAVX2(const uint8_t* aPixels, int aCount, const uint8_t* aThresholds,
+                                const Layout& aLayout, uint16_t* aDst)
+    {
+        const Layout& l = aLayout;
+        const __m256i one = _mm256_set1_epi16(1);
+        const __m256i levels = _mm256_set1_epi64x(static_cast<int64_t>((1 << l.bits[0]) - 1)
+                                                  | static_cast<int64_t>((1 << l.bits[1]) - 1) << 16
+                                                  | static_cast<int64_t>((1 << l.bits[2]) - 1) << 32
+                                                  | static_cast<int64_t>((1 << l.bits[3]) - 1) << 48);
+        const __m256i shifts = _mm256_set1_epi64x(static_cast<int64_t>(1) << l.shifts[0]
+                                                  | static_cast<int64_t>(1) << (16 + l.shifts[1])
+                                                  | static_cast<int64_t>(1) << (32 + l.shifts[2])
+                                                  | static_cast<int64_t>(1) << (48 + l.shifts[3]));
+        // pixels 0..3 in one register and 4..7 in the other, so both take thresholds 0..3
+        const __m256i thresholds = _mm256_setr_epi16(aThresholds[0], aThresholds[0], aThresholds[0], aThresholds[0],
+                                                     aThresholds[1], aThresholds[1], aThresholds[1], aThresholds[1],
+                                                     aThresholds[2], aThresholds[2], aThresholds[2], aThresholds[2],
+                                                     aThresholds[3], aThresholds[3], aThresholds[3], aThresholds[3]);
+        const __m256i gather = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+        int x = 0;
+        for (; x + 8 <= aCount; x += 8)
+            {
+            const __m128i* src = reinterpret_cast<const __m128i*>(aPixels + 4 * x);
+            __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128(src));
+            __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128(src + 1));
+            lo = _mm256_add_epi16(_mm256_mullo_epi16(lo, levels), thresholds);
+            hi = _mm256_add_epi16(_mm256_mullo_epi16(hi, levels), thresholds);
+            lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, one), _mm256_srli_epi16(lo, 8)), 8);
+            hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, one), _mm256_srli_epi16(hi, 8)), 8);
+            lo = _mm256_madd_epi16(_mm256_mullo_epi16(lo, shifts), one);
+            hi = _mm256_madd_epi16(_mm256_mullo_epi16(hi, shifts), one);
+
+            // hadd works per lane, the pixels come out as 0 1 4 5 | 2 3 6 7
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_hadd_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+            packed = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(packed, gather), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aDst + x), _mm256_castsi256_si128(packed));
+            }
+
+        _mm256_zeroupper();
+        PackOrderedScalar(aPixels + 4 * x, aCount - x, aThresholds, aLayout, aDst + x);
+    }
+
+
+    //==============================================================================
+    //! @brief Quantize A Row Left To Right, Spreading Each Pixel's Error, The Four
+    //!        Channels Of A Pixel At Once
+    //==============================================================================
+    PACK_TARGET("ssse3")
+    static void PackDiffusedSSSE3(const uint8_t* aPixels, int aCount, int16_t* aErrors,
+                                  const Layout& aLayout, uint16_t* aDst)
+    {
+        const Layout& l = aLayout;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i max = _mm_set1_epi16(255);
+        const __m128i levels = _mm_setr_epi16((1 << l.bits[0]) - 1, (1 << l.bits[1]) - 1, (1 << l.bits[2]) - 1,
+                                              (1 << l.bits[3]) - 1, 0, 0, 0, 0);
+        const __m128i expand = _mm_setr_epi16(ExpandMultiplier(l.bits[0]), ExpandMultiplier(l.bits[1]),
+                                              ExpandMultiplier(l.bits[2]), ExpandMultiplier(l.bits[3]), 0, 0, 0, 0);
+        const __m128i shifts = _mm_setr_epi16(static_cast<short>(1 << l.shifts[0]), static_cast<short>(1 << l.shifts[1]),
+                                              static_cast<short>(1 << l.shifts[2]), static_cast<short>(1 << l.shifts[3]),
+                                              0, 0, 0, 0);
+
+        __m128i carry = zero, belowLeft = zero, below = zero;
+        for (int x = 0; x < aCount; ++x)
+            {
+            int32_t rgba;
+            memcpy(&rgba, aPixels + 4 * x, sizeof(rgba));
+            const __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(rgba), zero);
+            const __m128i incoming = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(aErrors + 4 * x));
+            __m128i value = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(incoming, carry), _mm_set1_epi16(8)), 4);
+            value = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(pixel, value), zero), max);
+
+            __m128i quantized = _mm_add_epi16(_mm_mullo_epi16(value, levels), _mm_set1_epi16(127));
+            quantized = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(quantized, one), _mm_srli_epi16(quantized, 8)), 8);
+            const __m128i restored = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(quantized, expand),
+                                                                  _mm_set1_epi16(64)), 7);
+            const __m128i error = _mm_sub_epi16(value, restored);
+
+            // 7/16 right, 3/16 below-left, 5/16 below, 1/16 below-right
+            if (x > 0)
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(aErrors + 4 * (x - 1)),
+                                 _mm_add_epi16(belowLeft, _mm_mullo_epi16(error, _mm_set1_epi16(3))));
+            belowLeft = _mm_add_epi16(below, _mm_mullo_epi16(error, _mm_set1_epi16(5)));
+            below = error;
+            carry = _mm_mullo_epi16(error, _mm_set1_epi16(7));
+
+            __m128i packed = _mm_madd_epi16(_mm_mullo_epi16(quantized, shifts), one);
+            packed = _mm_add_epi32(packed, _mm_shuffle_epi32(packed, _MM_SHUFFLE(1, 1, 1, 1)));
+            aDst[x] = static_cast<uint16_t>(_mm_cvtsi128_si32(packed));
+            }
+
+        if (aCount > 0)
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(aErrors + 4 * (aCount - 1)), belowLeft);
+    }
+#endif
+
+
+    //! The Kernels Per Instruction Set Level, Narrowest First; Diffusion Is Serial
+    //! Along The Row, So Wider Registers Don't Help It
+    static const Kernels kKernels[] =
+    {
+        { Isa::Scalar, "scalar", PackOrderedScalar, PackDiffusedScalar },
+#if defined(PACK_X86)
+        { Isa::SSSE3, "ssse3", PackOrderedSSSE3, PackDiffusedSSSE3 },
+        { Isa::AVX2, "avx2", PackOrderedAVX2, PackDiffusedSSSE3 },
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    //==============================================================================
+    const Kernels* ForIsa(Isa aIsa)
+    {
+        return blitkernels::FindForIsa(kKernels, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    //==============================================================================
+    const Kernels& Active()
+    {
+        static const Kernels& active = blitkernels::SelectForIsa(kKernels);
+        return active;
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Ordered Thresholds Of A Row: A 4x4 Bayer Matrix Row Scaled To 0..254
+    //! @param aY The Row
+    //! @return 4 Thresholds, One Per Pixel Column Modulo 4
+    //==============================================================================
+    const uint8_t* BayerRow(int aY)
+    {
+        return kBayer[aY & 3];
+    }
+}
+
+// End Of File
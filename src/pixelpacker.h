@@ -0,0 +1,60 @@
+//==============================================================================
+// Name         : pixelpacker.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The Kernels That Pack RGBA Rows Into 16-bit Pixels,
+//                With Ordered Or Error-Diffusion Dithering
+//==============================================================================
+
+#ifndef PIXELPACKER_H
+#define PIXELPACKER_H
+
+#include <cstdint>            // uint8_t, int16_t, uint16_t
+#include "blitkernels.h"      // blitkernels::Isa
+
+namespace pixelpacker
+{
+    //! Where Each Channel Goes In A 16-bit Pixel
+    struct Layout
+    {
+        uint8_t     bits[4];      // R, G, B, A; 0 drops the channel
+        uint8_t     shifts[4];    // the bit position of each channel's lowest bit
+    };
+
+    //! Ordered Kernel: Quantize Each Channel Of A Row After Adding A Threshold Per
+    //! Pixel Column, Repeating Every 4 Pixels; 127 Everywhere Rounds To Nearest
+    typedef void (*OrderedKernel)(const uint8_t* aPixels, int aCount, const uint8_t* aThresholds,
+                                  const Layout& aLayout, uint16_t* aDst);
+
+    //! Diffusion Kernel: Quantize A Row Left To Right, Spreading Each Pixel's Error
+    //! Floyd-Steinberg Style; aErrors Holds 4 Per Pixel In 1/16ths, The Row's Incoming
+    //! Errors On Entry And The Next Row's On Return
+    typedef void (*DiffusionKernel)(const uint8_t* aPixels, int aCount, int16_t* aErrors,
+                                    const Layout& aLayout, uint16_t* aDst);
+
+    //! The Kernels Built For One Instruction Set Level
+    struct Kernels
+    {
+        blitkernels::Isa    isa;
+        const char*         name;
+        OrderedKernel       packOrdered;
+        DiffusionKernel     packDiffused;
+    };
+
+    //! @brief Get The Kernels For The Best Instruction Set This CPU Supports
+    //! @return The Selected Kernels
+    const Kernels& Active();
+
+    //! @brief Get The Kernels For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Kernels, Or nullptr If This CPU Or Build Has None For aIsa
+    const Kernels* ForIsa(blitkernels::Isa aIsa);
+
+    //! @brief Get The Ordered Thresholds Of A Row: A 4x4 Bayer Matrix Row Scaled To 0..254
+    //! @param aY The Row
+    //! @return 4 Thresholds, One Per Pixel Column Modulo 4
+    const uint8_t* BayerRow(int aY);
+}
+
+#endif    // PIXELPACKER_H
+
+// End Of File
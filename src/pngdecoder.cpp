@@ -0,0 +1,252 @@
+//==============================================================================
+// Name         : pngdecoder.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements The In-Tree .png Decoder
+//==============================================================================
+
+#include "pngdecoder.h"    // TryReadPNG
+#include <cstdio>          // FILE, fopen, fread
+#include <cstring>         // memcmp
+#include <vector>          // std::vector
+#include <utility>         // std::pair, std::make_pair
+#include <zlib.h>          // inflate, crc32
+#include "pngfilters.h"    // pngfilters::Active
+
+
+namespace pngdecoder
+{
+    //! The Largest Width Or Height Read, libpng's Default User Limit
+    static const uint32_t kMaxSide = 1000000;
+
+    //! Deflate Expands Its Input At Most This Many Times, Which Bounds The Image Size
+    static const uint64_t kMaxDeflateRatio = 1032;
+
+    //==============================================================================
+    //! @brief Read A 32-bit Big-Endian Value, As .png Stores Them
+    //==============================================================================
+    static inline uint32_t GetBigEndian(const uint8_t* aSrc)
+    {
+        return (static_cast<uint32_t>(aSrc[0]) << 24) | (static_cast<uint32_t>(aSrc[1]) << 16)
+               | (static_cast<uint32_t>(aSrc[2]) << 8) | aSrc[3];
+    }
+
+
+    //==============================================================================
+    //! @brief Read A Whole File
+    //! @return False If It Could Not Be Read
+    //==============================================================================
+    static bool ReadFile(const char* aPath, std::vector<uint8_t>& aBytes)
+    {
+        FILE* file = fopen(aPath, "rb");
+        if (!file)
+            return false;
+
+        bool ok = fseek(file, 0, SEEK_END) == 0;
+        const long size = ok ? ftell(file) : -1;
+        ok = ok && size > 0 && fseek(file, 0, SEEK_SET) == 0;
+        if (ok)
+            {
+            aBytes.resize(static_cast<size_t>(size));
+            ok = fread(aBytes.data(), 1, aBytes.size(), file) == aBytes.size();
+            }
+
+        fclose(file);
+        return ok;
+    }
+
+
+    //==============================================================================
+    //! Inflates The Image Data Spread Over The IDAT Chunks, Piece By Piece
+    //==============================================================================
+    class IdatInflater
+    {
+        public:
+        //! @brief Constructor
+        //! @param aIdats The IDAT Chunks' Data, As Start And Size
+        explicit IdatInflater(const std::vector<std::pair<const uint8_t*, size_t>>& aIdats)
+            : iIdats(aIdats)
+            , iNextIdat(0)
+            , iStream(z_stream())
+        {
+            iReady = inflateInit(&iStream) == Z_OK;
+        };
+
+        //! @brief Destructor
+        ~IdatInflater()
+        {
+            if (iReady)
+                inflateEnd(&iStream);
+        };
+
+        //! @brief Inflate Exactly aSize Bytes To aDst
+        //! @return False If The Data Ends Early Or Is Damaged
+        bool Inflate(uint8_t* aDst, size_t aSize)
+        {
+            if (!iReady)
+                return false;
+
+            iStream.next_out = aDst;
+            iStream.avail_out = static_cast<uInt>(aSize);
+            while (iStream.avail_out != 0)
+                {
+                if (iStream.avail_in == 0)
+                    {
+                    if (iNextIdat == iIdats.size())
+                        return false;
+                    iStream.next_in = const_cast<Bytef*>(iIdats[iNextIdat].first);
+                    iStream.avail_in = static_cast<uInt>(iIdats[iNextIdat].second);
+                    ++iNextIdat;
+                    continue;
+                    }
+
+                const int result = inflate(&iStream, Z_NO_FLUSH);
+                if (result == Z_STREAM_END)
+                    return iStream.avail_out == 0;
+                if (result != Z_OK)
+                    return false;
+                }
+            return true;
+        };
+
+        //! @brief Inflate To The End Of The Stream, Which Checks Its Adler-32
+        //! @return False If There Is More Image Data, Or The Stream Ends Early Or Is Damaged
+        bool Finish()
+        {
+            if (!iReady)
+                return false;
+
+            uint8_t extra = 0;
+            for (;;)
+                {
+                if (iStream.avail_in == 0 && iNextIdat < iIdats.size())
+                    {
+                    iStream.next_in = const_cast<Bytef*>(iIdats[iNextIdat].first);
+                    iStream.avail_in = static_cast<uInt>(iIdats[iNextIdat].second);
+                    ++iNextIdat;
+                    }
+
+                iStream.next_out = &extra;
+                iStream.avail_out = 1;
+                const int result = inflate(&iStream, Z_NO_FLUSH);
+                if (result == Z_STREAM_END)
+                    return iStream.avail_out == 1;
+                if (result != Z_OK || iStream.avail_out == 0)
+                    return false;
+                }
+        };
+
+        private:
+        const std::vector<std::pair<const uint8_t*, size_t>>&   iIdats;
+        size_t                                                  iNextIdat;
+        z_stream                                                iStream;
+        bool                                                    iReady;
+    };
+
+
+    //==============================================================================
+    //! @brief Read .png File Without libpng, For The Common Case Only:
+    //!        8-bit RGB Or RGBA, Not Interlaced, No tRNS Chunk
+    //! @param aPath An Image File With Path
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aChannels The Channels Of The Image, 3 Or 4
+    //! @return The Pointer To The Image Data Bytes, Or nullptr If The File Is Not
+    //!         The Common Case, Is Over libpng's Size Limits Or Is Damaged; Read It
+    //!         With libpng Then, Which Also Reports The Errors
+    //==============================================================================
+    uint8_t* TryReadPNG(const char* aPath, int& aWidth, int& aHeight, int& aChannels)
+    {
+        static const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+
+        std::vector<uint8_t> file;
+        if (!ReadFile(aPath, file) || file.size() < 8 || memcmp(file.data(), signature, 8) != 0)
+            return nullptr;
+
+        // walk the chunks: IHDR first, then collect the IDATs until IEND
+        uint32_t width = 0, height = 0;
+        int channels = 0;
+        std::vector<std::pair<const uint8_t*, size_t>> idats;
+        bool ended = false;
+
+        for (size_t pos = 8; !ended;)
+            {
+            if (file.size() - pos < 12)
+                return nullptr;
+
+            const uint32_t size = GetBigEndian(&file[pos]);
+            const uint8_t* type = &file[pos + 4];
+            const uint8_t* data = type + 4;
+            if (size > file.size() - pos - 12)
+                return nullptr;
+
+            // critical chunks must be intact, ancillary ones are skipped unchecked like libpng does
+            const bool critical = (type[0] & 0x20) == 0;
+            if (critical && crc32(crc32(0, type, 4), data, size) != GetBigEndian(data + size))
+                return nullptr;
+
+            if (pos == 8)
+                {
+                // 8-bit RGB or RGBA, deflate, adaptive filtering, not interlaced
+                if (memcmp(type, "IHDR", 4) != 0 || size != 13)
+                    return nullptr;
+                width = GetBigEndian(data);
+                height = GetBigEndian(data + 4);
+                if (data[8] != 8 || (data[9] != 2 && data[9] != 6) || data[10] != 0 || data[11] != 0 || data[12] != 0)
+                    return nullptr;
+                if (width == 0 || height == 0 || width > kMaxSide || height > kMaxSide)
+                    return nullptr;
+                channels = (data[9] == 6) ? 4 : 3;
+                }
+            else if (memcmp(type, "IDAT", 4) == 0)
+                idats.push_back(std::make_pair(data, static_cast<size_t>(size)));
+            else if (memcmp(type, "IEND", 4) == 0)
+                ended = true;
+            else if (memcmp(type, "tRNS", 4) == 0 || critical)
+                return nullptr;    // libpng would add an alpha channel, or a chunk we don't know
+
+            pos += 12 + size;
+            }
+
+        // the IDATs must hold enough data for the size IHDR claims, before that much is allocated
+        const size_t rowBytes = static_cast<size_t>(width) * channels;
+        uint64_t idatBytes = 0;
+        for (const auto& idat : idats)
+            idatBytes += idat.second;
+        if (idats.empty() || (static_cast<uint64_t>(rowBytes) + 1) * height > idatBytes * kMaxDeflateRatio)
+            return nullptr;
+
+        // inflate row by row straight into the image, then unfilter in place
+        const pngfilters::Filters& filters = pngfilters::Active();
+        const pngfilters::UnfilterKernel* unfilter = (channels == 4) ? filters.unfilterRGBA : filters.unfilterRGB;
+        const std::vector<uint8_t> zeroRow(rowBytes, 0);
+
+        uint8_t* image = new uint8_t[rowBytes * height];
+        IdatInflater inflater(idats);
+        for (uint32_t y = 0; y < height; ++y)
+            {
+            uint8_t* row = image + y * rowBytes;
+            uint8_t filterType = 0;
+            if (!inflater.Inflate(&filterType, 1) || filterType >= pngfilters::kFilterCount
+                || !inflater.Inflate(row, rowBytes))
+                {
+                delete[] image;
+                return nullptr;
+                }
+            unfilter[filterType](row, y ? row - rowBytes : zeroRow.data(), rowBytes);
+            }
+
+        // the stream must end right after the last row, its checksum intact, as libpng requires
+        if (!inflater.Finish())
+            {
+            delete[] image;
+            return nullptr;
+            }
+
+        aWidth = static_cast<int>(width);
+        aHeight = static_cast<int>(height);
+        aChannels = channels;
+        return image;
+    }
+}
+
+// End Of File
@@ -0,0 +1,28 @@
+//==============================================================================
+// Name         : pngdecoder.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares The In-Tree .png Decoder
+//==============================================================================
+
+#ifndef PNGDECODER_H
+#define PNGDECODER_H
+
+#include <cstdint>    // uint8_t
+
+namespace pngdecoder
+{
+    //! @brief Read .png File Without libpng, For The Common Case Only:
+    //!        8-bit RGB Or RGBA, Not Interlaced, No tRNS Chunk
+    //! @param aPath An Image File With Path
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aChannels The Channels Of The Image, 3 Or 4
+    //! @return The Pointer To The Image Data Bytes, Or nullptr If The File Is Not
+    //!         The Common Case Or Is Damaged; Read It With libpng Then, Which Also
+    //!         Reports The Errors
+    uint8_t* TryReadPNG(const char* aPath, int& aWidth, int& aHeight, int& aChannels);
+}
+
+#endif    // PNGDECODER_H
+
+// End Of File
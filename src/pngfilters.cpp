@@ -0,0 +1,460 @@
+//==============================================================================
+// Name         : pngfilters.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements .png Row Filter And Unfilter Kernels With Runtime CPU Dispatch
+//==============================================================================
+
+#include "pngfilters.h"    // FilterKernel, Filters
+#include <algorithm>       // std::min, std::copy
+#include <cstdlib>         // std::abs
+#include <string.h>        // memcpy
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define FILTER_X86
+    #include <immintrin.h>          // SSSE3, AVX2 intrinsics
+    #if defined(_MSC_VER)
+        #define FILTER_TARGET(aIsa)
+    #else
+        #define FILTER_TARGET(aIsa) __attribute__((target(aIsa)))
+    #endif
+#endif
+
+
+namespace pngfilters
+{
+    using blitkernels::Isa;
+
+    //! Bytes Filtered Between Checks Against The Sum To Beat
+    static const size_t kBlockBytes = 256;
+
+
+    //==============================================================================
+    //! @brief Paeth Predictor From The .png Specification
+    //==============================================================================
+    static inline int Paeth(int aLeft, int aUp, int aUpLeft)
+    {
+        const int pa = std::abs(aUp - aUpLeft);
+        const int pb = std::abs(aLeft - aUpLeft);
+        const int pc = std::abs(aLeft + aUp - 2 * aUpLeft);
+        if (pa <= pb && pa <= pc)
+            return aLeft;
+        return (pb <= pc) ? aUp : aUpLeft;
+    }
+
+    //==============================================================================
+    //! @brief Predict A Byte From Its Left, Up And Up-Left Neighbours
+    //==============================================================================
+    template <int kType>
+    static inline int Predict(int aLeft, int aUp, int aUpLeft)
+    {
+        switch (kType)
+            {
+            case kSub: return aLeft;
+            case kUp: return aUp;
+            case kAverage: return (aLeft + aUp) >> 1;
+            case kPaeth: return Paeth(aLeft, aUp, aUpLeft);
+            default: return 0;
+            }
+    }
+
+    //==============================================================================
+    //! @brief Filter Bytes [aBegin, aEnd) Of A Row One At A Time
+    //! @return The Sum Of The Filtered Bytes As Signed Absolute Values
+    //==============================================================================
+    template <int kType>
+    static inline uint64_t FilterRange(uint8_t* aDst, const uint8_t* aRow, const uint8_t* aPrev,
+                                       size_t aPixelBytes, size_t aBegin, size_t aEnd)
+    {
+        unsigned sum = 0;
+        for (size_t i = aBegin; i < aEnd; ++i)
+            {
+            // the first pixel has nothing to its left
+            const int left = (i >= aPixelBytes) ? aRow[i - aPixelBytes] : 0;
+            const int upLeft = (i >= aPixelBytes) ? aPrev[i - aPixelBytes] : 0;
+            const uint8_t filtered = static_cast<uint8_t>(aRow[i] - Predict<kType>(left, aPrev[i], upLeft));
+            aDst[i] = filtered;
+            sum += (filtered < 128) ? filtered : 256 - filtered;
+            }
+        return sum;
+    }
+
+
+    //==============================================================================
+    // Scalar Kernels
+    //==============================================================================
+    template <int kType>
+    static uint64_t FilterScalar(uint8_t* aDst, const uint8_t* aRow, const uint8_t* aPrev,
+                                 size_t aRowBytes, size_t aPixelBytes, uint64_t aLimit)
+    {
+        uint64_t sum = FilterRange<kType>(aDst, aRow, aPrev, aPixelBytes, 0, std::min(aPixelBytes, aRowBytes));
+        for (size_t block = aPixelBytes; block < aRowBytes && sum < aLimit; block += kBlockBytes)
+            {
+            // the left neighbour exists from here on, so no per-byte check for it
+            const size_t end = std::min(block + kBlockBytes, aRowBytes);
+            unsigned blockSum = 0;
+            for (size_t i = block; i < end; ++i)
+                {
+                const int predicted = Predict<kType>(aRow[i - aPixelBytes], aPrev[i], aPrev[i - aPixelBytes]);
+                const uint8_t filtered = static_cast<uint8_t>(aRow[i] - predicted);
+                aDst[i] = filtered;
+                blockSum += (filtered < 128) ? filtered : 256 - filtered;
+                }
+            sum += blockSum;
+            }
+        return sum;
+    }
+
+
+#if defined(FILTER_X86)
+    //==============================================================================
+    //! @brief Predict 16 Bytes At Once, Paeth Is Worked Out In 16-bit Lanes
+    //==============================================================================
+    template <int kType>
+    FILTER_TARGET("ssse3")
+    static inline __m128i PredictSSSE3(__m128i aLeft, __m128i aUp, __m128i aUpLeft)
+    {
+        switch (kType)
+            {
+            case kSub: return aLeft;
+            case kUp: return aUp;
+            case kAverage:
+                // _mm_avg_epu8 rounds up, the filter rounds down
+                return _mm_sub_epi8(_mm_avg_epu8(aLeft, aUp),
+                                    _mm_and_si128(_mm_xor_si128(aLeft, aUp), _mm_set1_epi8(1)));
+            case kPaeth:
+                {
+                const __m128i zero = _mm_setzero_si128();
+                __m128i halves[2];
+                for (int h = 0; h < 2; ++h)
+                    {
+                    const __m128i a = h ? _mm_unpackhi_epi8(aLeft, zero) : _mm_unpacklo_epi8(aLeft, zero);
+                    const __m128i b = h ? _mm_unpackhi_epi8(aUp, zero) : _mm_unpacklo_epi8(aUp, zero);
+                    const __m128i c = h ? _mm_unpackhi_epi8(aUpLeft, zero) : _mm_unpacklo_epi8(aUpLeft, zero);
+                    const __m128i pa = _mm_sub_epi16(b, c);
+                    const __m128i pb = _mm_sub_epi16(a, c);
+                    const __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+                    const __m128i absA = _mm_abs_epi16(pa);
+                    const __m128i absB = _mm_abs_epi16(pb);
+
+                    // a where pa is the smallest, else b where pb is, else c
+                    const __m128i smallest = _mm_min_epi16(_mm_min_epi16(absA, absB), pc);
+                    const __m128i useA = _mm_cmpeq_epi16(absA, smallest);
+                    const __m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(absB, smallest));
+                    const __m128i useC = _mm_andnot_si128(_mm_or_si128(useA, useB), _mm_set1_epi16(-1));
+                    halves[h] = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a), _mm_and_si128(useB, b)),
+                                             _mm_and_si128(useC, c));
+                    }
+                return _mm_packus_epi16(halves[0], halves[1]);
+                }
+            default:
+                return _mm_setzero_si128();
+            }
+    }
+
+    //==============================================================================
+    // SSSE3 Kernels, 16 Bytes At A Time
+    //==============================================================================
+    template <int kType>
+    FILTER_TARGET("ssse3")
+    static uint64_t FilterSSSE3(uint8_t* aDst, const uint8_t* aRow, const uint8_t* aPrev,
+                                size_t aRowBytes, size_t aPixelBytes, uint64_t aLimit)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        uint64_t sum = FilterRange<kType>(aDst, aRow, aPrev, aPixelBytes, 0, std::min(aPixelBytes, aRowBytes));
+
+        size_t i = aPixelBytes;
+        while (i + 16 <= aRowBytes && sum < aLimit)
+            {
+            const size_t end = std::min(i + kBlockBytes, aRowBytes);
+            __m128i blockSum = zero;
+            for (; i + 16 <= end; i += 16)
+                {
+                const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aRow + i));
+                const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aRow + i - aPixelBytes));
+                const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPrev + i));
+                const __m128i upLeft = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPrev + i - aPixelBytes));
+                const __m128i filtered = _mm_sub_epi8(row, PredictSSSE3<kType>(left, up, upLeft));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(aDst + i), filtered);
+                blockSum = _mm_add_epi64(blockSum, _mm_sad_epu8(_mm_abs_epi8(filtered), zero));
+                }
+            sum += static_cast<uint64_t>(_mm_cvtsi128_si32(blockSum))
+                   + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(blockSum, 8)));
+            }
+
+        return sum + FilterRange<kType>(aDst, aRow, aPrev, aPixelBytes, i, aRowBytes);
+    }
+
+
+    //==============================================================================
+    //! @brief Predict 32 Bytes At Once, Paeth Is Worked Out In 16-bit Lanes
+    //==============================================================================
+    template <int kType>
+    FILTER_TARGET("avx2")
+    static inline __m256i PredictAVX2(__m256i aLeft, __m256i aUp, __m256i aUpLeft)
+    {
+        switch (kType)
+            {
+            case kSub: return aLeft;
+            case kUp: return aUp;
+            case kAverage:
+                return _mm256_sub_epi8(_mm256_avg_epu8(aLeft, aUp),
+                                       _mm256_and_si256(_mm256_xor_si256(aLeft, aUp), _mm256_set1_epi8(1)));
+            case kPaeth:
+                {
+                // unpack and pack both work within 128-bit lanes, so the byte order comes back intact
+                const __m256i zero = _mm256_setzero_si256();
+                __m256i halves[2];
+                for (int h = 0; h < 2; ++h)
+                    {
+                    const __m256i a = h ? _mm256_unpackhi_epi8(aLeft, zero) : _mm256_unpacklo_epi8(aLeft, zero);
+                    const __m256i b = h ? _mm256_unpackhi_epi8(aUp, zero) : _mm256_unpacklo_epi8(aUp, zero);
+                    const __m256i c = h ? _mm256_unpackhi_epi8(aUpLeft, zero) : _mm256_unpacklo_epi8(aUpLeft, zero);
+                    const __m256i pa = _mm256_sub_epi16(b, c);
+                    const __m256i pb = _mm256_sub_epi16(a, c);
+                    const __m256i pc = _mm256_abs_epi16(_mm256_add_epi16(pa, pb));
+                    const __m256i absA = _mm256_abs_epi16(pa);
+                    const __m256i absB = _mm256_abs_epi16(pb);
+
+                    const __m256i smallest = _mm256_min_epi16(_mm256_min_epi16(absA, absB), pc);
+                    const __m256i useA = _mm256_cmpeq_epi16(absA, smallest);
+                    const __m256i useB = _mm256_cmpeq_epi16(absB, smallest);
+                    halves[h] = _mm256_blendv_epi8(_mm256_blendv_epi8(c, b, useB), a, useA);
+                    }
+                return _mm256_packus_epi16(halves[0], halves[1]);
+                }
+            default:
+                return _mm256_setzero_si256();
+            }
+    }
+
+    //==============================================================================
+    // AVX2 Kernels, 32 Bytes At A Time
+    //==============================================================================
+    template <int kType>
+    FILTER_TARGET("avx2")
+    static uint64_t FilterAVX2(uint8_t* aDst, const uint8_t* aRow, const uint8_t* aPrev,
+                               size_t aRowBytes, size_t aPixelBytes, uint64_t aLimit)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        uint64_t sum = FilterRange<kType>(aDst, aRow, aPrev, aPixelBytes, 0, std::min(aPixelBytes, aRowBytes));
+
+        size_t i = aPixelBytes;
+        while (i + 32 <= aRowBytes && sum < aLimit)
+            {
+            const size_t end = std::min(i + kBlockBytes, aRowBytes);
+            __m256i blockSum = zero;
+            for (; i + 32 <= end; i += 32)
+                {
+                const __m256i row = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aRow + i));
+                const __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aRow + i - aPixelBytes));
+                const __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aPrev + i));
+                const __m256i upLeft = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aPrev + i - aPixelBytes));
+                const __m256i filtered = _mm256_sub_epi8(row, PredictAVX2<kType>(left, up, upLeft));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(aDst + i), filtered);
+                blockSum = _mm256_add_epi64(blockSum, _mm256_sad_epu8(_mm256_abs_epi8(filtered), zero));
+                }
+            const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(blockSum),
+                                               _mm256_extracti128_si256(blockSum, 1));
+            sum += static_cast<uint64_t>(_mm_cvtsi128_si32(half))
+                   + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(half, 8)));
+            }
+
+        // leave the upper halves clean for the SSE code that follows
+        _mm256_zeroupper();
+        return sum + FilterRange<kType>(aDst, aRow, aPrev, aPixelBytes, i, aRowBytes);
+    }
+#endif    // FILTER_X86
+
+
+    //==============================================================================
+    // Scalar Unfilter Kernels, For Any Pixel Size
+    //==============================================================================
+    template <int kType, size_t kPixelBytes>
+    static void UnfilterScalar(uint8_t* aRow, const uint8_t* aPrev, size_t aRowBytes)
+    {
+        // the first pixel has nothing to its left
+        for (size_t i = 0; i < kPixelBytes && i < aRowBytes; ++i)
+            aRow[i] = static_cast<uint8_t>(aRow[i] + Predict<kType>(0, aPrev[i], 0));
+        for (size_t i = kPixelBytes; i < aRowBytes; ++i)
+            aRow[i] = static_cast<uint8_t>(aRow[i] + Predict<kType>(aRow[i - kPixelBytes], aPrev[i],
+                                                                    aPrev[i - kPixelBytes]));
+    }
+
+    static void UnfilterNone(uint8_t*, const uint8_t*, size_t)
+    {
+    }
+
+
+#if defined(FILTER_X86)
+    //==============================================================================
+    //! @brief Load / Store One 3 Or 4 Byte Pixel Into The Low Bytes Of A Register
+    //==============================================================================
+    template <size_t kPixelBytes>
+    FILTER_TARGET("ssse3")
+    static inline __m128i LoadPixel(const uint8_t* aSrc)
+    {
+        int32_t value = 0;
+        memcpy(&value, aSrc, kPixelBytes);
+        return _mm_cvtsi32_si128(value);
+    }
+
+    template <size_t kPixelBytes>
+    FILTER_TARGET("ssse3")
+    static inline void StorePixel(uint8_t* aDst, __m128i aPixel)
+    {
+        const int32_t value = _mm_cvtsi128_si32(aPixel);
+        memcpy(aDst, &value, kPixelBytes);
+    }
+
+    //==============================================================================
+    // SSSE3 Unfilter Kernels: Up Does 16 Bytes At A Time; Sub, Average And Paeth
+    // Depend On The Pixel To The Left, So They Do One Whole Pixel At A Time
+    //==============================================================================
+    FILTER_TARGET("ssse3")
+    static void UnfilterUpSSSE3(uint8_t* aRow, const uint8_t* aPrev, size_t aRowBytes)
+    {
+        size_t i = 0;
+        for (; i + 16 <= aRowBytes; i += 16)
+            {
+            const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aRow + i));
+            const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPrev + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(aRow + i), _mm_add_epi8(row, up));
+            }
+        for (; i < aRowBytes; ++i)
+            aRow[i] = static_cast<uint8_t>(aRow[i] + aPrev[i]);
+    }
+
+    template <int kType, size_t kPixelBytes>
+    FILTER_TARGET("ssse3")
+    static void UnfilterPixelsSSSE3(uint8_t* aRow, const uint8_t* aPrev, size_t aRowBytes)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i left = zero;      // the decoded pixel to the left, 8-bit
+        __m128i upLeft = zero;    // the pixel above that one, 8-bit
+
+        for (size_t i = 0; i + kPixelBytes <= aRowBytes; i += kPixelBytes)
+            {
+            const __m128i up = LoadPixel<kPixelBytes>(aPrev + i);
+            __m128i predicted;
+            if (kType == kSub)
+                predicted = left;
+            else if (kType == kAverage)
+                predicted = _mm_sub_epi8(_mm_avg_epu8(left, up),
+                                         _mm_and_si128(_mm_xor_si128(left, up), _mm_set1_epi8(1)));
+            else
+                {
+                // Paeth in 16-bit lanes, the same selection as the filter side
+                const __m128i a = _mm_unpacklo_epi8(left, zero);
+                const __m128i b = _mm_unpacklo_epi8(up, zero);
+                const __m128i c = _mm_unpacklo_epi8(upLeft, zero);
+                const __m128i pa = _mm_sub_epi16(b, c);
+                const __m128i pb = _mm_sub_epi16(a, c);
+                const __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+                const __m128i absA = _mm_abs_epi16(pa);
+                const __m128i absB = _mm_abs_epi16(pb);
+
+                const __m128i smallest = _mm_min_epi16(_mm_min_epi16(absA, absB), pc);
+                const __m128i useA = _mm_cmpeq_epi16(absA, smallest);
+                const __m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(absB, smallest));
+                const __m128i useC = _mm_andnot_si128(_mm_or_si128(useA, useB), _mm_set1_epi16(-1));
+                const __m128i chosen = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a), _mm_and_si128(useB, b)),
+                                                    _mm_and_si128(useC, c));
+                predicted = _mm_packus_epi16(chosen, zero);
+                upLeft = up;
+                }
+
+            left = _mm_add_epi8(LoadPixel<kPixelBytes>(aRow + i), predicted);
+            StorePixel<kPixelBytes>(aRow + i, left);
+            }
+    }
+#endif    // FILTER_X86
+
+
+    //! The Filter Table, One Entry Per Isa That Has Its Own Kernels
+    static const Filters kFilters[] =
+    {
+        { Isa::Scalar, "scalar",
+          { FilterScalar<kNone>, FilterScalar<kSub>, FilterScalar<kUp>, FilterScalar<kAverage>, FilterScalar<kPaeth> },
+          { UnfilterNone, UnfilterScalar<kSub, 3>, UnfilterScalar<kUp, 3>, UnfilterScalar<kAverage, 3>,
+            UnfilterScalar<kPaeth, 3> },
+          { UnfilterNone, UnfilterScalar<kSub, 4>, UnfilterScalar<kUp, 4>, UnfilterScalar<kAverage, 4>,
+            UnfilterScalar<kPaeth, 4> } },
+#if defined(FILTER_X86)
+        // unfiltering is serial from pixel to pixel, wider registers don't help it
+        { Isa::SSSE3, "ssse3",
+          { FilterSSSE3<kNone>, FilterSSSE3<kSub>, FilterSSSE3<kUp>, FilterSSSE3<kAverage>, FilterSSSE3<kPaeth> },
+          { UnfilterNone, UnfilterPixelsSSSE3<kSub, 3>, UnfilterUpSSSE3, UnfilterPixelsSSSE3<kAverage, 3>,
+            UnfilterPixelsSSSE3<kPaeth, 3> },
+          { UnfilterNone, UnfilterPixelsSSSE3<kSub, 4>, UnfilterUpSSSE3, UnfilterPixelsSSSE3<kAverage, 4>,
+            UnfilterPixelsSSSE3<kPaeth, 4> } },
+        { Isa::AVX2, "avx2",
+          { FilterAVX2<kNone>, FilterAVX2<kSub>, FilterAVX2<kUp>, FilterAVX2<kAverage>, FilterAVX2<kPaeth> },
+          { UnfilterNone, UnfilterPixelsSSSE3<kSub, 3>, UnfilterUpSSSE3, UnfilterPixelsSSSE3<kAverage, 3>,
+            UnfilterPixelsSSSE3<kPaeth, 3> },
+          { UnfilterNone, UnfilterPixelsSSSE3<kSub, 4>, UnfilterUpSSSE3, UnfilterPixelsSSSE3<kAverage, 4>,
+            UnfilterPixelsSSSE3<kPaeth, 4> } },
+#endif
+    };
+
+
+    //==============================================================================
+    //! @brief Get The Filters For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Filters, Or nullptr If This CPU Or Build Has None For aIsa
+    //==============================================================================
+    const Filters* ForIsa(Isa aIsa)
+    {
+        return blitkernels::FindForIsa(kFilters, aIsa);
+    }
+
+
+    //==============================================================================
+    //! @brief Get The Filters For The Best Instruction Set This CPU Supports
+    //! @return The Selected Filters
+    //==============================================================================
+    const Filters& Active()
+    {
+        static const Filters& active = blitkernels::SelectForIsa(kFilters);
+        return active;
+    }
+
+
+    //==============================================================================
+    //! @brief Filter A Row With Every Filter Type And Keep The Cheapest By The
+    //!        Sum Of Absolute Values Heuristic, As libpng Does By Default
+    //! @param aFilters The Filter Kernels To Use
+    //! @param aRow The Row
+    //! @param aPrev The Row Above, All Zero For The First Row
+    //! @param aRowBytes The Row Size In Bytes
+    //! @param aPixelBytes Bytes Per Pixel, 1 To 4, The Distance To The Left Neighbour
+    //! @param aDst Receives The Filter Type Byte Then The Filtered Row
+    //! @param aScratch Room For aRowBytes Bytes
+    //==============================================================================
+    void FilterAdaptive(const Filters& aFilters, const uint8_t* aRow, const uint8_t* aPrev,
+                        size_t aRowBytes, size_t aPixelBytes, uint8_t* aDst, uint8_t* aScratch)
+    {
+        uint64_t bestSum = UINT64_MAX;
+        uint8_t* best = aDst + 1;
+        uint8_t* spare = aScratch;
+
+        for (int type = kNone; type < kFilterCount; ++type)
+            {
+            // the winner so far stays put, each candidate goes to the other row
+            uint8_t* out = (type == kNone) ? best : spare;
+            const uint64_t sum = aFilters.filter[type](out, aRow, aPrev, aRowBytes, aPixelBytes, bestSum);
+
+            if (sum < bestSum)
+                {
+                spare = (out == best) ? spare : best;
+                best = out;
+                bestSum = sum;
+                aDst[0] = static_cast<uint8_t>(type);
+                }
+            }
+
+        if (best != aDst + 1)
+            std::copy(best, best + aRowBytes, aDst + 1);
+    }
+}
+
+// End Of File
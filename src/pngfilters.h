@@ -0,0 +1,70 @@
+//==============================================================================
+// Name         : pngfilters.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares .png Row Filter And Unfilter Kernels With Runtime CPU Dispatch
+//==============================================================================
+
+#ifndef PNGFILTERS_H
+#define PNGFILTERS_H
+
+#include <cstddef>            // size_t
+#include <cstdint>            // uint8_t, uint64_t
+#include "blitkernels.h"      // blitkernels::Isa
+
+namespace pngfilters
+{
+    //! The .png Filter Types
+    enum FilterType
+    {
+        kNone,
+        kSub,
+        kUp,
+        kAverage,
+        kPaeth,
+        kFilterCount
+    };
+
+    //! Filter Kernel: Filters One Row Of aPixelBytes Byte Pixels Into aDst And Returns
+    //! The Sum Of The Filtered Bytes Taken As Signed Absolute Values, The Usual Cost
+    //! Estimate; May Give Up Early, Returning Something Not Below aLimit, Once The Row Can't Beat It
+    typedef uint64_t (*FilterKernel)(uint8_t* aDst, const uint8_t* aRow, const uint8_t* aPrev,
+                                     size_t aRowBytes, size_t aPixelBytes, uint64_t aLimit);
+
+    //! Unfilter Kernel: Turns One Filtered Row Back Into Pixels, In Place
+    typedef void (*UnfilterKernel)(uint8_t* aRow, const uint8_t* aPrev, size_t aRowBytes);
+
+    //! A Set Of Filter And Unfilter Kernels Built For One Instruction Set Level
+    struct Filters
+    {
+        blitkernels::Isa    isa;
+        const char*         name;
+        FilterKernel        filter[kFilterCount];          // any pixel size, indexed by FilterType
+        UnfilterKernel      unfilterRGB[kFilterCount];     // 3 bytes per pixel
+        UnfilterKernel      unfilterRGBA[kFilterCount];    // 4 bytes per pixel
+    };
+
+    //! @brief Get The Filters For The Best Instruction Set This CPU Supports
+    //! @return The Selected Filters
+    const Filters& Active();
+
+    //! @brief Get The Filters For A Given Instruction Set Level
+    //! @param aIsa The Instruction Set Level
+    //! @return The Filters, Or nullptr If This CPU Or Build Has None For aIsa
+    const Filters* ForIsa(blitkernels::Isa aIsa);
+
+    //! @brief Filter A Row With Every Filter Type And Keep The Cheapest By The
+    //!        Sum Of Absolute Values Heuristic, As libpng Does By Default
+    //! @param aFilters The Filter Kernels To Use
+    //! @param aRow The Row
+    //! @param aPrev The Row Above, All Zero For The First Row
+    //! @param aRowBytes The Row Size In Bytes
+    //! @param aPixelBytes Bytes Per Pixel, 1 To 4, The Distance To The Left Neighbour
+    //! @param aDst Receives The Filter Type Byte Then The Filtered Row
+    //! @param aScratch Room For aRowBytes Bytes
+    void FilterAdaptive(const Filters& aFilters, const uint8_t* aRow, const uint8_t* aPrev,
+                        size_t aRowBytes, size_t aPixelBytes, uint8_t* aDst, uint8_t* aScratch);
+}
+
+#endif    // PNGFILTERS_H
+
+// End Of File
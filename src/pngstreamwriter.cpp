@@ -0,0 +1,545 @@
+//==============================================================================
+// Name         : pngstreamwriter.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements PNGStreamWriter Class
+//==============================================================================
+
+#include "pngstreamwriter.h"    // PNGStreamWriter
+#include <algorithm>            // std::min, std::max
+#include <stdexcept>            // std::runtime_error, std::invalid_argument
+#include <zlib.h>               // deflate, crc32, adler32, adler32_combine
+#include "threadpool.h"         // ThreadPool
+#include "pngfilters.h"         // pngfilters::FilterAdaptive
+#include <cstdint>              // SIZE_MAX
+
+//! Filtered Bytes Per Chunk, Like pigz's Blocks: Big Enough That The Sync Flush
+//! And Restarted Matching Cost Little, Small Enough To Keep Every Thread Busy
+static const size_t kChunkBytes = 256 * 1024;
+
+//! Deflate's Window, The Most Of The Previous Chunk A Chunk Can Refer Back To
+static const size_t kWindowBytes = 32 * 1024;
+
+//! zlib Parameters For Deflating A Chunk
+struct DeflateParams
+{
+    int level;       // zlib compression level
+    int memLevel;    // zlib memory level, bigger is a little better and slower
+    int strategy;    // zlib strategy
+};
+
+//! The Parameter Sets, A Chunk Refers To One By Index
+static const DeflateParams kDeflateParams[] =
+{
+    { 0, 8, Z_DEFAULT_STRATEGY },    // stored blocks
+    { 1, 8, Z_RLE },                 // fastest, runs only
+    { 6, 8, Z_FILTERED },            // libpng's default
+    { 9, 9, Z_FILTERED },            // smallest for most filtered data
+    { 9, 9, Z_DEFAULT_STRATEGY },    // tried by the exhaustive search
+    { 9, 9, Z_HUFFMAN_ONLY }         // tried by the exhaustive search, wins on noise
+};
+
+//! The Parameter Set The Default Preset Uses, The Exhaustive Search Reports Against It
+static const int kDefaultParams = 2;
+
+//! The Parameter Sets The Exhaustive Search Tries, The First Is Its Fallback
+static const int kSearchParams[] = {3, 4, 5};
+
+//! Filtering Of A Chunk: One Filter Type For Every Row, Or This For A Choice Per Row
+static const int kAdaptive = -1;
+
+//! How A Compression Preset Filters And Deflates
+struct PresetSettings
+{
+    int     filtering;    // kAdaptive, or a filter type for every row
+    int     params;       // index into kDeflateParams
+    uint8_t zlibFlags;    // zlib header FLG byte, its FLEVEL matching the level
+};
+
+//! Settings Per CompressionPreset, In Enum Order
+static const PresetSettings kPresets[] =
+{
+    { pngfilters::kNone, 0, 0x01 },    // Store
+    { kAdaptive, 1, 0x01 },            // Fast
+    { kAdaptive, 2, 0x9C },            // Default, as libpng
+    { kAdaptive, 3, 0xDA },            // Max
+    { kAdaptive, 3, 0xDA }             // Exhaustive, per chunk where the search finds better
+};
+
+
+//==============================================================================
+//! @brief Filter Rows Into aDst, Each Row Led By Its Filter Type Byte
+//! @param aFiltering kAdaptive, Or The Filter Type For Every Row
+//! @param aRows The First Row, 1 To 4 Bytes Per Pixel Or Packed Palette Indices
+//! @param aRowCount The Number Of Rows
+//! @param aStride The Distance Between Rows In Bytes
+//! @param aFirstPrev The Row Above The First Row
+//! @param aRowBytes The Row Size In Bytes
+//! @param aPixelBytes Bytes Per Pixel, 1 For Palette Indices
+//! @param aDst Receives aRowCount * (aRowBytes + 1) Bytes
+//==============================================================================
+static void FilterRows(int aFiltering, const uint8_t* aRows, int aRowCount, size_t aStride,
+                       const uint8_t* aFirstPrev, size_t aRowBytes, size_t aPixelBytes, uint8_t* aDst)
+{
+    const pngfilters::Filters& filters = pngfilters::Active();
+    std::vector<uint8_t> scratch(aRowBytes);
+
+    for (int y = 0; y < aRowCount; ++y, aDst += aRowBytes + 1)
+        {
+        const uint8_t* row = aRows + y * aStride;
+        const uint8_t* prev = y ? row - aStride : aFirstPrev;
+        if (aFiltering == kAdaptive)
+            pngfilters::FilterAdaptive(filters, row, prev, aRowBytes, aPixelBytes, aDst, scratch.data());
+        else
+            {
+            aDst[0] = static_cast<uint8_t>(aFiltering);
+            filters.filter[aFiltering](aDst + 1, row, prev, aRowBytes, aPixelBytes, UINT64_MAX);
+            }
+        }
+}
+
+
+//==============================================================================
+//! @brief Raw Deflate, Ending On A Sync Flush
+//! @param aData The Bytes To Deflate
+//! @param aSize The Number Of Bytes
+//! @param aDictionary The Bytes Before aData In The Stream, Up To 32 KB
+//! @param aDictionarySize The Number Of Dictionary Bytes
+//! @param aParams The zlib Parameters
+//! @param aOut Receives The Deflated Bytes
+//==============================================================================
+static void DeflateRaw(const uint8_t* aData, size_t aSize, const uint8_t* aDictionary, size_t aDictionarySize,
+                       const DeflateParams& aParams, std::vector<uint8_t>& aOut)
+{
+    // raw deflate, the chunks are stitched under one zlib header
+    z_stream stream = z_stream();
+    if (deflateInit2(&stream, aParams.level, Z_DEFLATED, -15, aParams.memLevel, aParams.strategy) != Z_OK)
+        throw std::runtime_error("deflateInit2 failed!");
+
+    if (aDictionarySize != 0)
+        deflateSetDictionary(&stream, aDictionary, static_cast<uInt>(aDictionarySize));
+
+    // the bound leaves no room for the sync flush's empty stored block
+    aOut.resize(deflateBound(&stream, static_cast<uLong>(aSize)) + 16);
+
+    stream.next_in = const_cast<Bytef*>(aData);
+    stream.avail_in = static_cast<uInt>(aSize);
+    stream.next_out = aOut.data();
+    stream.avail_out = static_cast<uInt>(aOut.size());
+
+    // a sync flush ends on a byte boundary, so the next chunk's blocks can follow directly
+    const int result = deflate(&stream, Z_SYNC_FLUSH);
+    const bool done = (result == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+    aOut.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    if (!done)
+        throw std::runtime_error("deflate failed!");
+}
+
+
+//==============================================================================
+//! @brief Get The Last Up To 32 KB Of A Buffer, The Dictionary For What Follows It
+//==============================================================================
+static inline const uint8_t* Tail(const std::vector<uint8_t>& aBytes, size_t& aSize)
+{
+    aSize = std::min(aBytes.size(), kWindowBytes);
+    return aBytes.data() + aBytes.size() - aSize;
+}
+
+
+//==============================================================================
+//! @brief Write A 32-bit Value Big-Endian, As .png And zlib Store Them
+//==============================================================================
+static inline void PutBigEndian(uint8_t* aDst, uint32_t aValue)
+{
+    aDst[0] = static_cast<uint8_t>(aValue >> 24);
+    aDst[1] = static_cast<uint8_t>(aValue >> 16);
+    aDst[2] = static_cast<uint8_t>(aValue >> 8);
+    aDst[3] = static_cast<uint8_t>(aValue);
+}
+
+
+//==============================================================================
+//! @brief Constructor, Creates The File And Writes The Header
+//! @param aFilename A File Name
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//! @param aThreadPool The Threads To Compress With
+//! @param aPreset How Hard To Compress
+//! @param aTimeBudget Seconds The Exhaustive Preset May Search For, 0 For No Limit
+//! @param aChannels 4 For RGBA, 3 For RGB, 2 For Gray And Alpha, 1 For Gray
+//! @param aBitDepth Bits Per Channel, 8 Or 16; 16-bit Samples Are Big-Endian
+//==============================================================================
+PNGStreamWriter::PNGStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                                 CompressionPreset aPreset, double aTimeBudget, int aChannels, int aBitDepth)
+    : iFilename(aFilename)
+    , iFile(nullptr)
+    , iThreadPool(aThreadPool)
+    , iPreset(aPreset)
+    , iTimeBudget(aTimeBudget)
+    , iStart(std::chrono::steady_clock::now())
+    , iIndexed(false)
+    , iPixelBytes(aChannels * aBitDepth / 8)
+    , iRowBytes(iPixelBytes * static_cast<size_t>(aWidth))
+    , iHeight(aHeight)
+    , iRowsWritten(0)
+    , iPrevRow(iRowBytes, 0)
+    , iAdler(adler32(0, nullptr, 0))
+    , iReport(SearchReport())
+{
+    // the color type by channel count; the filters work on whole pixels of either depth
+    static const uint8_t colorTypes[5] = {0, 0, 4, 2, 6};
+    if (aChannels < 1 || aChannels > 4)
+        throw std::invalid_argument("A .png has 1 to 4 channels!");
+    if (aBitDepth != 8 && aBitDepth != 16)
+        throw std::invalid_argument("A .png is written with 8 or 16 bits per channel!");
+    Open(aWidth, aHeight, static_cast<uint8_t>(aBitDepth), colorTypes[aChannels]);
+}
+
+
+//==============================================================================
+//! @brief Constructor For An Indexed-Color .png, Creates The File And Writes The
+//!        Header, Palette And Transparency
+//! @param aFilename A File Name
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//! @param aThreadPool The Threads To Compress With
+//! @param aPalette 1 To 256 RGBA Colors, R In The Low Byte; Rows Are Then Palette
+//!        Indices Packed BitDepth() Bits Per Pixel, The Leftmost Pixel In The High Bits
+//! @param aPreset How Hard To Compress
+//! @param aTimeBudget Seconds The Exhaustive Preset May Search For, 0 For No Limit
+//==============================================================================
+PNGStreamWriter::PNGStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                                 const std::vector<uint32_t>& aPalette, CompressionPreset aPreset, double aTimeBudget)
+    : iFilename(aFilename)
+    , iFile(nullptr)
+    , iThreadPool(aThreadPool)
+    , iPreset(aPreset)
+    , iTimeBudget(aTimeBudget)
+    , iStart(std::chrono::steady_clock::now())
+    , iIndexed(true)
+    , iPixelBytes(1)
+    , iRowBytes((static_cast<size_t>(aWidth) * BitDepth(aPalette.size()) + 7) / 8)
+    , iHeight(aHeight)
+    , iRowsWritten(0)
+    , iPrevRow(iRowBytes, 0)
+    , iAdler(adler32(0, nullptr, 0))
+    , iReport(SearchReport())
+{
+    if (aPalette.empty() || aPalette.size() > 256)
+        throw std::invalid_argument("A .png palette holds 1 to 256 colors!");
+
+    Open(aWidth, aHeight, static_cast<uint8_t>(BitDepth(aPalette.size())), 3);
+
+    // PLTE holds RGB, tRNS the alphas up to the last translucent color
+    std::vector<uint8_t> colors, alphas;
+    for (uint32_t color : aPalette)
+        {
+        colors.push_back(static_cast<uint8_t>(color));
+        colors.push_back(static_cast<uint8_t>(color >> 8));
+        colors.push_back(static_cast<uint8_t>(color >> 16));
+        alphas.push_back(static_cast<uint8_t>(color >> 24));
+        }
+    while (!alphas.empty() && alphas.back() == 255)
+        alphas.pop_back();
+
+    try
+        {
+        WriteChunk("PLTE", colors.data(), colors.size());
+        if (!alphas.empty())
+            WriteChunk("tRNS", alphas.data(), alphas.size());
+        }
+    catch (...)
+        {
+        fclose(iFile);
+        throw;
+        }
+}
+
+
+//==============================================================================
+//! @brief Get The Bits Per Index For A Palette: The Fewest Of 1, 2, 4 And 8 That Fit
+//! @param aPaletteSize The Number Of Palette Colors
+//! @return The Bit Depth
+//==============================================================================
+int PNGStreamWriter::BitDepth(size_t aPaletteSize)
+{
+    int bits = 1;
+    while ((size_t(1) << bits) < aPaletteSize)
+        bits *= 2;
+    return bits;
+}
+
+
+//==============================================================================
+//! @brief Create The File And Write The Signature And Header
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//! @param aBitDepth Bits Per Channel Or Palette Index
+//! @param aColorType 6 For RGBA, 2 For RGB, 4 For Gray And Alpha, 0 For Gray, 3 For Palette Indices
+//==============================================================================
+void PNGStreamWriter::Open(int aWidth, int aHeight, uint8_t aBitDepth, uint8_t aColorType)
+{
+    iFile = fopen(iFilename.c_str(), "wb");
+    if (!iFile)
+        throw std::runtime_error(iFilename + " could not be opened for writing!");
+
+    static const uint8_t signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    if (fwrite(signature, 1, sizeof(signature), iFile) != sizeof(signature))
+        {
+        fclose(iFile);
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+        }
+
+    // deflate, adaptive filtering, not interlaced
+    uint8_t header[13];
+    PutBigEndian(header, static_cast<uint32_t>(aWidth));
+    PutBigEndian(header + 4, static_cast<uint32_t>(aHeight));
+    header[8] = aBitDepth;
+    header[9] = aColorType;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+
+    try
+        {
+        WriteChunk("IHDR", header, sizeof(header));
+        }
+    catch (...)
+        {
+        fclose(iFile);
+        throw;
+        }
+}
+
+
+//==============================================================================
+//! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+//==============================================================================
+PNGStreamWriter::~PNGStreamWriter()
+{
+    fclose(iFile);
+}
+
+
+//==============================================================================
+//! @brief Compress And Write The Next Rows
+//! @param aRows The First Row, aChannels Bytes Per Pixel Or Packed Palette Indices
+//! @param aRowCount The Number Of Rows
+//! @param aRowBytes The Distance Between Rows In Bytes
+//==============================================================================
+void PNGStreamWriter::WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes)
+{
+    if (aRowCount > iHeight - iRowsWritten)
+        throw std::runtime_error("More rows than the height of " + iFilename + "!");
+
+    const PresetSettings& settings = kPresets[static_cast<int>(iPreset)];
+    const int filtering = iIndexed ? pngfilters::kNone : settings.filtering;
+    const bool search = (iPreset == CompressionPreset::Exhaustive);
+    const int chunkRows = static_cast<int>(std::max<size_t>(1, kChunkBytes / (iRowBytes + 1)));
+
+    // two chunks per thread at a time keeps the threads busy and the buffers bounded
+    const int window = 2 * static_cast<int>(iThreadPool.ThreadCount());
+
+    for (int first = 0; first < aRowCount; first += chunkRows * window)
+        {
+        const int chunkCount = std::min(window, (aRowCount - first + chunkRows - 1) / chunkRows);
+        if (iChunks.size() < static_cast<size_t>(chunkCount))
+            iChunks.resize(chunkCount);
+
+        // filter: every row only needs itself and the raw row above
+        iThreadPool.ParallelFor(chunkCount, [&](size_t aChunk)
+            {
+            const int row = first + static_cast<int>(aChunk) * chunkRows;
+            const int rows = std::min(chunkRows, aRowCount - row);
+            const uint8_t* src = aRows + row * aRowBytes;
+            const uint8_t* firstPrev = row ? src - aRowBytes : iPrevRow.data();
+
+            Chunk& chunk = iChunks[aChunk];
+            if (search)
+                SearchChunk(chunk, src, rows, aRowBytes, firstPrev);
+            else
+                {
+                chunk.filtered.resize(rows * (iRowBytes + 1));
+                FilterRows(filtering, src, rows, aRowBytes, firstPrev, iRowBytes, iPixelBytes, chunk.filtered.data());
+                chunk.params = settings.params;
+                }
+
+            chunk.adler = adler32(adler32(0, nullptr, 0), chunk.filtered.data(),
+                                  static_cast<uInt>(chunk.filtered.size()));
+            });
+
+        // deflate: each chunk is primed with the filtered bytes just before it
+        iThreadPool.ParallelFor(chunkCount, [&](size_t aChunk)
+            {
+            Chunk& chunk = iChunks[aChunk];
+            size_t size = 0;
+            const uint8_t* dictionary = aChunk ? Tail(iChunks[aChunk - 1].filtered, size) : Tail(iDictionary, size);
+            DeflateRaw(chunk.filtered.data(), chunk.filtered.size(), dictionary, size,
+                       kDeflateParams[chunk.params], chunk.deflated);
+
+            // what the default preset would have written, primed the same way, for the report
+            if (search)
+                {
+                std::vector<uint8_t> deflated;
+                dictionary = aChunk ? Tail(iChunks[aChunk - 1].adaptive, size) : Tail(iDefaultDictionary, size);
+                DeflateRaw(chunk.adaptive.data(), chunk.adaptive.size(), dictionary, size,
+                           kDeflateParams[kDefaultParams], deflated);
+                chunk.defaultSize = deflated.size();
+                }
+            });
+
+        // write in order, the zlib header goes in front of the very first chunk
+        for (int i = 0; i < chunkCount; ++i)
+            {
+            Chunk& chunk = iChunks[i];
+            if (iRowsWritten == 0 && first == 0 && i == 0)
+                {
+                const uint8_t zlibHeader[2] = {0x78, settings.zlibFlags};
+                chunk.deflated.insert(chunk.deflated.begin(), zlibHeader, zlibHeader + 2);
+                if (search)
+                    chunk.defaultSize += 2;
+                }
+            WriteChunk("IDAT", chunk.deflated.data(), chunk.deflated.size());
+
+            iAdler = adler32_combine(iAdler, chunk.adler, static_cast<z_off_t>(chunk.filtered.size()));
+            KeepTail(iDictionary, chunk.filtered);
+
+            iReport.idatBytes += chunk.deflated.size();
+            ++iReport.chunks;
+            if (search)
+                {
+                KeepTail(iDefaultDictionary, chunk.adaptive);
+                iReport.defaultIdatBytes += chunk.defaultSize;
+                iReport.searchedChunks += chunk.searched ? 1 : 0;
+                }
+            }
+        }
+
+    // the caller may reuse its rows, keep the last one for filtering the next call's first
+    if (aRowCount > 0)
+        {
+        const uint8_t* last = aRows + (aRowCount - 1) * aRowBytes;
+        std::copy(last, last + iRowBytes, iPrevRow.begin());
+        iRowsWritten += aRowCount;
+        }
+}
+
+
+//==============================================================================
+//! @brief Write The End Of The File, After All Rows Are Written
+//==============================================================================
+void PNGStreamWriter::Finish()
+{
+    if (iRowsWritten != iHeight)
+        throw std::runtime_error("Not all rows of " + iFilename + " were written!");
+
+    // an empty final static block ends the deflate stream, zlib's checksum follows
+    uint8_t end[6] = {0x03, 0x00};
+    PutBigEndian(end + 2, iAdler);
+    WriteChunk("IDAT", end, sizeof(end));
+    WriteChunk("IEND", nullptr, 0);
+
+    if (fflush(iFile) != 0)
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+}
+
+
+//==============================================================================
+//! @brief Try Every Filtering With Every Searched zlib Parameter Set On A Chunk
+//!        And Keep The Smallest, Until The Time Budget Runs Out
+//! @param aChunk The Chunk, Receives The Filtered Bytes And Parameter Set To Use
+//! @param aRows The Chunk's First Row
+//! @param aRowCount The Number Of Rows
+//! @param aStride The Distance Between Rows In Bytes
+//! @param aFirstPrev The Row Above The First Row
+//==============================================================================
+void PNGStreamWriter::SearchChunk(Chunk& aChunk, const uint8_t* aRows, int aRowCount, size_t aStride,
+                                  const uint8_t* aFirstPrev) const
+{
+    // the default filtering is kept for the report, and is the fallback; palette
+    // indices are only ever left unfiltered, so for them only the deflate settings vary
+    const int first = iIndexed ? pngfilters::kNone : kAdaptive;
+    const int last = iIndexed ? pngfilters::kNone : pngfilters::kFilterCount - 1;
+    aChunk.adaptive.resize(aRowCount * (iRowBytes + 1));
+    FilterRows(first, aRows, aRowCount, aStride, aFirstPrev, iRowBytes, iPixelBytes, aChunk.adaptive.data());
+    aChunk.filtered = aChunk.adaptive;
+    aChunk.params = kSearchParams[0];
+    aChunk.searched = false;
+
+    // sizes are compared without a dictionary, which depends on the previous chunk's outcome;
+    // once the budget runs out the best so far is kept
+    std::vector<uint8_t> deflated;
+    size_t best = SIZE_MAX;
+    std::vector<uint8_t> candidate(aChunk.adaptive.size());
+
+    for (int filtering = first; filtering <= last; ++filtering)
+        {
+        if (filtering != first)
+            FilterRows(filtering, aRows, aRowCount, aStride, aFirstPrev, iRowBytes, iPixelBytes, candidate.data());
+        const std::vector<uint8_t>& data = (filtering == first) ? aChunk.adaptive : candidate;
+
+        for (int params : kSearchParams)
+            {
+            if (iTimeBudget > 0)
+                {
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - iStart;
+                if (elapsed.count() > iTimeBudget)
+                    return;
+                }
+
+            DeflateRaw(data.data(), data.size(), nullptr, 0, kDeflateParams[params], deflated);
+            if (deflated.size() < best)
+                {
+                best = deflated.size();
+                if (filtering != first)
+                    aChunk.filtered = candidate;
+                aChunk.params = params;
+                }
+            }
+        }
+
+    aChunk.searched = true;
+}
+
+
+//==============================================================================
+//! @brief Append The Tail Of aBytes To A Dictionary, Keeping Its Last 32 KB
+//! @param aDictionary The Dictionary
+//! @param aBytes The Bytes That Follow It In The Stream
+//==============================================================================
+void PNGStreamWriter::KeepTail(std::vector<uint8_t>& aDictionary, const std::vector<uint8_t>& aBytes)
+{
+    size_t size = 0;
+    const uint8_t* tail = Tail(aBytes, size);
+    aDictionary.insert(aDictionary.end(), tail, tail + size);
+    if (aDictionary.size() > kWindowBytes)
+        aDictionary.erase(aDictionary.begin(), aDictionary.end() - kWindowBytes);
+}
+
+
+//==============================================================================
+//! @brief Write A .png Chunk: Length, Type, Data And CRC
+//! @param aType The Four Letter Chunk Type
+//! @param aData The Chunk Data
+//! @param aSize The Chunk Data Size
+//==============================================================================
+void PNGStreamWriter::WriteChunk(const char* aType, const uint8_t* aData, size_t aSize)
+{
+    uint8_t head[8];
+    PutBigEndian(head, static_cast<uint32_t>(aSize));
+    std::copy(aType, aType + 4, head + 4);
+
+    uLong crc = crc32(0, head + 4, 4);
+    if (aSize != 0)
+        crc = crc32(crc, aData, static_cast<uInt>(aSize));
+    uint8_t tail[4];
+    PutBigEndian(tail, static_cast<uint32_t>(crc));
+
+    if (fwrite(head, 1, sizeof(head), iFile) != sizeof(head)
+        || (aSize != 0 && fwrite(aData, 1, aSize, iFile) != aSize)
+        || fwrite(tail, 1, sizeof(tail), iFile) != sizeof(tail))
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+}
+
+// End Of File
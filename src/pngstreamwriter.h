@@ -0,0 +1,159 @@
+//==============================================================================
+// Name         : pngstreamwriter.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares PNGStreamWriter Class
+//==============================================================================
+
+#ifndef PNGSTREAMWRITER_H
+#define PNGSTREAMWRITER_H
+
+#include <cstdio>     // FILE
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t, uint32_t
+#include <string>     // std::string
+#include <vector>     // std::vector
+#include <chrono>     // std::chrono::steady_clock
+#include "atlasoptions.h"         // CompressionPreset
+#include "imagestreamwriter.h"    // ImageStreamWriter
+
+class ThreadPool;
+
+
+//==============================================================================
+//! PNGStreamWriter Class
+//! Writes An RGBA, RGB, Gray Or Indexed-Color .png File, 8 Or 16 Bits Per
+//! Channel, A Run Of Rows At A
+//! Time, So The Image Never Has To Be In Memory As A Whole. Rows Are Filtered
+//! And Deflated In Independent Chunks Across The Thread Pool, Each Chunk Ending
+//! On A Sync Flush And Primed With The Tail Of The One Before, Then Stitched
+//! Into One zlib Stream
+//==============================================================================
+class PNGStreamWriter : public ImageStreamWriter
+{
+    public:
+    //! @brief Constructor, Creates The File And Writes The Header
+    //! @param aFilename A File Name
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aThreadPool The Threads To Compress With
+    //! @param aPreset How Hard To Compress
+    //! @param aTimeBudget Seconds The Exhaustive Preset May Search For, 0 For No Limit
+    //! @param aChannels 4 For RGBA, 3 For RGB, 2 For Gray And Alpha, 1 For Gray
+    //! @param aBitDepth Bits Per Channel, 8 Or 16; 16-bit Samples Are Big-Endian
+    PNGStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                    CompressionPreset aPreset = CompressionPreset::Default, double aTimeBudget = 0,
+                    int aChannels = 4, int aBitDepth = 8);
+
+    //! @brief Constructor For An Indexed-Color .png, Creates The File And Writes The
+    //!        Header, Palette And Transparency
+    //! @param aFilename A File Name
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aThreadPool The Threads To Compress With
+    //! @param aPalette 1 To 256 RGBA Colors, R In The Low Byte; Rows Are Then Palette
+    //!        Indices Packed BitDepth() Bits Per Pixel, The Leftmost Pixel In The High Bits
+    //! @param aPreset How Hard To Compress
+    //! @param aTimeBudget Seconds The Exhaustive Preset May Search For, 0 For No Limit
+    PNGStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                    const std::vector<uint32_t>& aPalette,
+                    CompressionPreset aPreset = CompressionPreset::Default, double aTimeBudget = 0);
+
+    //! @brief Get The Bits Per Index For A Palette: The Fewest Of 1, 2, 4 And 8 That Fit
+    //! @param aPaletteSize The Number Of Palette Colors
+    //! @return The Bit Depth
+    static int BitDepth(size_t aPaletteSize);
+
+    //! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+    ~PNGStreamWriter();
+
+    //! @brief Compress And Write The Next Rows
+    //! @param aRows The First Row, aChannels Bytes Per Pixel Or Packed Palette Indices
+    //! @param aRowCount The Number Of Rows
+    //! @param aRowBytes The Distance Between Rows In Bytes
+    void WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes);
+
+    //! @brief Write The End Of The File, After All Rows Are Written
+    void Finish();
+
+    //! What Was Written, And For The Exhaustive Preset What The Default Preset Would Have Written
+    struct SearchReport
+    {
+        uint64_t    idatBytes;           // compressed image data written
+        uint64_t    defaultIdatBytes;    // the same with the default preset, exhaustive preset only
+        int         chunks;              // chunks written
+        int         searchedChunks;      // chunks fully searched before the time budget ran out
+    };
+
+    //! @brief Get What Was Written So Far
+    const SearchReport& Report() const
+    {
+        return iReport;
+    };
+
+    private:
+    //! @brief Create The File And Write The Signature And Header
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aBitDepth Bits Per Channel Or Palette Index
+    //! @param aColorType 6 For RGBA, 2 For RGB, 4 For Gray And Alpha, 0 For Gray, 3 For Palette Indices
+    void Open(int aWidth, int aHeight, uint8_t aBitDepth, uint8_t aColorType);
+
+    //! One Run Of Rows Compressed As A Unit
+    struct Chunk
+    {
+        std::vector<uint8_t>    filtered;    // filter type byte + filtered row, per row
+        std::vector<uint8_t>    deflated;    // raw deflate blocks ending on a sync flush
+        uint32_t                adler;       // Adler-32 of the filtered bytes
+        int                     params;      // the zlib parameter set to deflate with
+        std::vector<uint8_t>    adaptive;    // exhaustive preset: the default filtering, for the report
+        size_t                  defaultSize; // exhaustive preset: the default preset's deflated size
+        bool                    searched;    // exhaustive preset: searched to the end
+    };
+
+    //! @brief Try Every Filtering With Every Searched zlib Parameter Set On A Chunk
+    //!        And Keep The Smallest, Until The Time Budget Runs Out
+    //! @param aChunk The Chunk, Receives The Filtered Bytes And Parameter Set To Use
+    //! @param aRows The Chunk's First Row
+    //! @param aRowCount The Number Of Rows
+    //! @param aStride The Distance Between Rows In Bytes
+    //! @param aFirstPrev The Row Above The First Row
+    void SearchChunk(Chunk& aChunk, const uint8_t* aRows, int aRowCount, size_t aStride,
+                     const uint8_t* aFirstPrev) const;
+
+    //! @brief Append The Tail Of aBytes To A Dictionary, Keeping Its Last 32 KB
+    //! @param aDictionary The Dictionary
+    //! @param aBytes The Bytes That Follow It In The Stream
+    static void KeepTail(std::vector<uint8_t>& aDictionary, const std::vector<uint8_t>& aBytes);
+
+    //! @brief Write A .png Chunk: Length, Type, Data And CRC
+    //! @param aType The Four Letter Chunk Type
+    //! @param aData The Chunk Data
+    //! @param aSize The Chunk Data Size
+    void WriteChunk(const char* aType, const uint8_t* aData, size_t aSize);
+
+    PNGStreamWriter(const PNGStreamWriter&);
+    PNGStreamWriter& operator=(const PNGStreamWriter&);
+
+    private:
+    std::string                 iFilename;
+    FILE*                       iFile;
+    ThreadPool&                 iThreadPool;
+    CompressionPreset           iPreset;
+    double                      iTimeBudget;    // seconds, 0 for no limit
+    std::chrono::steady_clock::time_point iStart;
+    bool                        iIndexed;       // palette indices, every row filtered with None as the spec advises
+    size_t                      iPixelBytes;    // the filters' distance to the left neighbour
+    size_t                      iRowBytes;
+    int                         iHeight;
+    int                         iRowsWritten;
+    std::vector<uint8_t>        iPrevRow;       // last row written, the Up/Average/Paeth reference
+    std::vector<uint8_t>        iDictionary;    // last 32 KB of filtered bytes written
+    std::vector<uint8_t>        iDefaultDictionary;    // the same for the default preset's filtering
+    std::vector<Chunk>          iChunks;        // reused between windows of chunks
+    uint32_t                    iAdler;         // Adler-32 of all filtered bytes so far
+    SearchReport                iReport;
+};
+
+#endif    // PNGSTREAMWRITER_H
+
+// End Of File
@@ -15,16 +15,114 @@
 
 namespace pngutilities
 {
+    //==============================================================================
+    //! @brief Build The 256 RGBA Colors Of A Palette Image From Its PLTE And tRNS Chunks
+    //! @param aPng The Read Struct, Past png_read_info
+    //! @param aInfo The Info Struct
+    //! @return The Colors, Which The Caller Deletes
+    //==============================================================================
+    static uint32_t* ReadPalette(png_structp aPng, png_infop aInfo)
+    {
+        png_colorp colors = nullptr;
+        png_bytep alphas = nullptr;
+        int colorCount = 0, alphaCount = 0;
+        png_get_PLTE(aPng, aInfo, &colors, &colorCount);
+        if (png_get_valid(aPng, aInfo, PNG_INFO_tRNS))
+            png_get_tRNS(aPng, aInfo, &alphas, &alphaCount, nullptr);
+
+        // indices past the PLTE chunk read as opaque black, as libpng expands them;
+        // the bytes go straight into the colors, RGBA in memory order
+        uint32_t* palette = new uint32_t[256];
+        uint8_t* rgba = reinterpret_cast<uint8_t*>(palette);
+        for (auto i = 0; i < 256; ++i, rgba += 4)
+            {
+            rgba[0] = i < colorCount ? colors[i].red : 0;
+            rgba[1] = i < colorCount ? colors[i].green : 0;
+            rgba[2] = i < colorCount ? colors[i].blue : 0;
+            rgba[3] = i < alphaCount ? alphas[i] : 0xFF;
+            }
+        return palette;
+    }
+
+
+    //==============================================================================
+    //! @brief Read The Header And Set Up The Transformations; libpng Errors Jump Back
+    //!        Here, So Nothing Is Allocated And Only The Given Outputs Are Written
+    //! @param aPng The Read Struct, Its Input Set Up
+    //! @param aInfo The Info Struct
+    //! @param aKeep16 Keep 16-bit Images 16-bit; Receives Whether This One Is
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aChannels The Channels Of The Image As Read
+    //! @param aColor The Stored PNG Color Type
+    //! @param aRowBytes The Bytes Per Row As Read
+    //! @return False If libpng Failed
+    //==============================================================================
+    static bool ReadInfo(png_structp aPng, png_infop aInfo, bool& aKeep16, int& aWidth, int& aHeight,
+                         int& aChannels, int& aColor, size_t& aRowBytes)
+    {
+        if (setjmp(png_jmpbuf(aPng)))
+            return false;
+
+        png_read_info(aPng, aInfo);
+        aWidth = png_get_image_width(aPng, aInfo);
+        aHeight = png_get_image_height(aPng, aInfo);
+
+        // bytes per channel and no more channels than stored: gray stays gray and
+        // palette images stay indices, the blit expands them; 16-bit images kept
+        // at 16 bits are RGB or RGBA, the only ones the 16-bit blit reads
+        aColor = png_get_color_type(aPng, aInfo);
+        aKeep16 = aKeep16 && png_get_bit_depth(aPng, aInfo) == 16;
+        if (aKeep16 && (aColor == PNG_COLOR_TYPE_GRAY || aColor == PNG_COLOR_TYPE_GRAY_ALPHA))
+            png_set_gray_to_rgb(aPng);
+        if (!aKeep16)
+            png_set_strip_16(aPng);
+        png_set_packing(aPng);
+        if (aColor == PNG_COLOR_TYPE_GRAY)
+            png_set_expand_gray_1_2_4_to_8(aPng);
+        if (aColor != PNG_COLOR_TYPE_PALETTE && png_get_valid(aPng, aInfo, PNG_INFO_tRNS))
+            png_set_tRNS_to_alpha(aPng);
+        png_set_interlace_handling(aPng);
+        png_read_update_info(aPng, aInfo);
+        aChannels = png_get_channels(aPng, aInfo);
+        aRowBytes = png_get_rowbytes(aPng, aInfo);
+        return true;
+    }
+
+
+    //==============================================================================
+    //! @brief Read Every Row Into The Given Row Pointers, Then The End Of The File;
+    //!        libpng Errors Jump Back Here, Which Only Writes Into The Rows
+    //! @param aPng The Read Struct, Past ReadInfo
+    //! @param aInfoEnd The End Info Struct
+    //! @param aRows One Pointer Per Row
+    //! @return False If libpng Failed, A Truncated Or Damaged File
+    //==============================================================================
+    static bool ReadRows(png_structp aPng, png_infop aInfoEnd, png_bytep* aRows)
+    {
+        if (setjmp(png_jmpbuf(aPng)))
+            return false;
+
+        png_read_image(aPng, aRows);
+        png_read_end(aPng, aInfoEnd);
+        return true;
+    }
+
+
     //==============================================================================
     //! @brief Read .png File 
     //! @param aPath An Image File With Path
     //! @param aWidth The Width Of The Image 
     //! @param aHeight The Height Of The Image
-    //! @param aChannels The Channels Of The Image
-    //! @param aChannels The PNG image Channels
+    //! @param aChannels The Channels Of The Image, Kept As Stored: 1 For Gray Or Palette
+    //!        Indices, 2 For Gray-Alpha, 3 For RGB, 4 For RGBA
+    //! @param aPalette Receives 256 RGBA Colors For A Palette Image, nullptr Otherwise
+    //! @param aBitDepth If Given, 16-bit Images Are Kept 16-bit, Big-Endian, As RGB Or RGBA,
+    //!        And This Receives 8 Or 16; Otherwise Every Image Is Read At 8 Bits
     //! @return The Pointer To The Image Data Bytes
     //==============================================================================
-    uint8_t* ReadPNG(const char* aPath, int& aWidth, int& aHeight, int& aChannels)
+    uint8_t* ReadPNG(const char* aPath, int& aWidth, int& aHeight, int& aChannels, uint32_t*& aPalette,
+                     int* aBitDepth)
     {
         // open file as binary
         FILE* file = fopen(aPath, "rb");
@@ -34,106 +132,73 @@ namespace pngutilities
         // header for testing if it is a png
         uint8_t header[8];
         // read the header
-        if (fread(header, 1, 8, file) <= 0)
+        if (fread(header, 1, 8, file) != 8)
+            {
+            fclose(file);
             throw std::runtime_error("Could not read file " + std::string(aPath) + "!");
+            }
 
         // Check png header
         if (png_sig_cmp(header, 0, 8))
+            {
+            fclose(file);
             throw std::invalid_argument(std::string(aPath) + " is not a .png file!");
+            }
 
-        // create png struct
+        // create png struct, png info struct and png end info struct
         png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-        if (!png)
-            throw std::runtime_error("png_create_read_struct failed!");
-
-        // create png info struct
-        png_infop info = png_create_info_struct(png);
-        if (!info)
-            throw std::runtime_error("png_create_info_struct failed!");
-
-        // create png end info struct
-        png_infop infoEnd = png_create_info_struct(png);
+        png_infop info = png ? png_create_info_struct(png) : nullptr;
+        png_infop infoEnd = info ? png_create_info_struct(png) : nullptr;
         if (!infoEnd)
-            throw std::runtime_error("png_create_info_struct failed!");
-
-        // set libpng error handling mechanism
-        if (setjmp(png_jmpbuf(png)))
-            throw std::runtime_error("Could not read file " + std::string(aPath) + "!");
+            {
+            png_destroy_read_struct(&png, &info, nullptr);
+            fclose(file);
+            throw std::runtime_error("png_create_read_struct failed!");
+            }
 
         // init png reading
         png_init_io(png, file);
         // let libpng know you already read the first 8 bytes
         png_set_sig_bytes(png, 8);
 
-        png_read_png(png, info, PNG_TRANSFORM_STRIP_16 | PNG_TRANSFORM_PACKING |
-                     PNG_TRANSFORM_EXPAND | PNG_TRANSFORM_GRAY_TO_RGB, nullptr);
-
-        aWidth = png_get_image_width(png, info);
-        aHeight = png_get_image_height(png, info);
-
-        const int color = png_get_color_type(png, info);
-        if (color != PNG_COLOR_TYPE_RGB && color != PNG_COLOR_TYPE_RGB_ALPHA)
-            throw std::invalid_argument(std::string(aPath) + " is not a RGB image!");
-        aChannels = (color == PNG_COLOR_TYPE_RGB_ALPHA?4:3);
-
-        // allocate the image as a big block
-        uint8_t* image = new uint8_t[aWidth * aHeight * aChannels];
-        png_bytep* rows = png_get_rows(png, info);
-        for (auto y = 0; y < aHeight; ++y)
-            memcpy(image + y * aWidth * aChannels, rows[y], aWidth * aChannels);
+        // libpng errors return false from the helpers, which set their own setjmp,
+        // so everything allocated here is freed before throwing
+        bool keep16 = (aBitDepth != nullptr);
+        int color = 0;
+        size_t rowBytes = 0;
+        const bool readInfo = ReadInfo(png, info, keep16, aWidth, aHeight, aChannels, color, rowBytes);
+
+        // read the rows straight into the image, allocated as a big block
+        uint8_t* image = nullptr;
+        png_bytep* rows = nullptr;
+        aPalette = nullptr;
+        if (readInfo && aChannels >= 1)
+            {
+            aPalette = (color == PNG_COLOR_TYPE_PALETTE) ? ReadPalette(png, info) : nullptr;
+            image = new uint8_t[rowBytes * aHeight];
+            rows = new png_bytep[aHeight];
+            for (auto y = 0; y < aHeight; ++y)
+                rows[y] = image + y * rowBytes;
+            }
 
+        const bool readRows = image && ReadRows(png, infoEnd, rows);
+        delete[] rows;
         png_destroy_read_struct(&png, &info, &infoEnd);
         fclose(file);
 
-        if (image == 0 || aChannels < 3)
+        if (!readRows)
             {
-            throw std::runtime_error("Something is wrong with " + std::string(aPath));
             delete[] image;
-            image = nullptr;
+            delete[] aPalette;
+            aPalette = nullptr;
+            throw std::runtime_error((readInfo && aChannels < 1) ? "Something is wrong with " + std::string(aPath)
+                                                                 : "Could not read file " + std::string(aPath) + "!");
             }
 
+        if (aBitDepth)
+            *aBitDepth = keep16 ? 16 : 8;
         return image;
     }
-
-
-    //==============================================================================
-    //! @brief Write .png File 
-    //! @param aFilename A File Name
-    //! @param aWidth The Width Of The Texture Atlas 
-    //! @param aHeight The Height Of The Texture Atlas 
-    //! @param aChannels The Channels Of The Texture Atlas
-    //! @param aData The Texture Atlas Data Bytes
-    //==============================================================================
-    void WritePNG(const char* aFilename, int aWidth, int aHeight, unsigned char* aData)
-    {
-        FILE* file = fopen(aFilename, "wb");
-        if (!file)
-            throw std::runtime_error(std::string(aFilename) + "could not be opened for writing!");
-
-        png_structp pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
-        if (!pngPtr)
-            throw std::runtime_error("png_create_write_struct failed!");
-
-        png_infop infoPtr = png_create_info_struct(pngPtr);
-        if (!infoPtr)
-            throw std::runtime_error("png_create_info_struct failed!");
-
-        png_init_io(pngPtr, file);
-        png_set_IHDR(pngPtr, infoPtr, aWidth, aHeight, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
-                     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-
-        png_byte** rowPtrs = new png_byte*[aHeight];
-        for (auto i = 0; i < aHeight; ++i)
-            rowPtrs[i] = aData + i * aWidth * 4;
-
-        png_set_rows(pngPtr, infoPtr, rowPtrs);
-        png_write_png(pngPtr, infoPtr, PNG_TRANSFORM_IDENTITY, nullptr);
-
-        png_destroy_write_struct(&pngPtr, &infoPtr);
-
-        fclose(file);
-        delete[] rowPtrs;
-    }
 }
 
 // End Of File
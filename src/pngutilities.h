@@ -3,7 +3,7 @@
 // Author       : Fei Liu (liu.s.fei@gmail.com)
 // Description  : Declares Utility Functions For Using libpng
 //==============================================================================
-#include <cstdint>    // uint8_t
+#include <cstdint>    // uint8_t, uint32_t
 
 namespace pngutilities
 {
@@ -11,18 +11,14 @@ namespace pngutilities
     //! @param aPath An Image File With Path
     //! @param aWidth The Width Of The Image 
     //! @param aHeight The Height Of The Image
-    //! @param aChannels The Channels Of The Image
-    //! @param aChannels The PNG image Channels
+    //! @param aChannels The Channels Of The Image, Kept As Stored: 1 For Gray Or Palette
+    //!        Indices, 2 For Gray-Alpha, 3 For RGB, 4 For RGBA
+    //! @param aPalette Receives 256 RGBA Colors For A Palette Image, nullptr Otherwise
+    //! @param aBitDepth If Given, 16-bit Images Are Kept 16-bit, Big-Endian, As RGB Or RGBA,
+    //!        And This Receives 8 Or 16; Otherwise Every Image Is Read At 8 Bits
     //! @return The Pointer To The Image Data Bytes
-    uint8_t* ReadPNG(const char* aPath, int& aWidth, int& aHeight, int& aChannels);
-
-    //! @brief Write .png File 
-    //! @param aFilename A File Name
-    //! @param aWidth The Width Of The Texture Atlas 
-    //! @param aHeight The Height Of The Texture Atlas 
-    //! @param aChannels The Channels Of The Texture Atlas
-    //! @param aData The Texture Atlas Data Bytes
-    void WritePNG(const char* aFilename, int aWidth, int aHeight, unsigned char* aData);
+    uint8_t* ReadPNG(const char* aPath, int& aWidth, int& aHeight, int& aChannels, uint32_t*& aPalette,
+                     int* aBitDepth = nullptr);
 }
 
 // End Of File
@@ -0,0 +1,225 @@
+//==============================================================================
+// Name         : qoistreamwriter.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements QOIStreamWriter Class
+//==============================================================================
+
+#include "qoistreamwriter.h"    // QOIStreamWriter
+#include <algorithm>            // std::max, std::fill
+#include <stdexcept>            // std::runtime_error
+#include <cstring>              // memcpy
+
+//! Encoded Bytes Collected Before They Are Written Out
+static const size_t kBufferBytes = 1024 * 1024;
+
+//! The Most Bytes One Pixel Encodes To, QOI_OP_RGBA
+static const size_t kMaxPixelBytes = 5;
+
+//! QOI Operation Tags
+static const uint8_t kOpIndex = 0x00;    // 6-bit index into the recently seen pixels
+static const uint8_t kOpDiff = 0x40;     // 2-bit difference per color channel
+static const uint8_t kOpLuma = 0x80;     // 6-bit green difference, 4-bit red/blue relative to it
+static const uint8_t kOpRun = 0xC0;      // 6-bit run length - 1, up to 62
+static const uint8_t kOpRGB = 0xFE;      // 8-bit color channels follow
+static const uint8_t kOpRGBA = 0xFF;     // 8-bit color and alpha channels follow
+
+//! The Longest Run One QOI_OP_RUN Holds, 63 And 64 Would Clash With QOI_OP_RGB(A)
+static const int kMaxRun = 62;
+
+
+//==============================================================================
+//! @brief Write A 32-bit Value Big-Endian, As .qoi Stores Them
+//==============================================================================
+static inline void PutBigEndian(uint8_t* aDst, uint32_t aValue)
+{
+    aDst[0] = static_cast<uint8_t>(aValue >> 24);
+    aDst[1] = static_cast<uint8_t>(aValue >> 16);
+    aDst[2] = static_cast<uint8_t>(aValue >> 8);
+    aDst[3] = static_cast<uint8_t>(aValue);
+}
+
+
+//==============================================================================
+//! @brief Constructor, Creates The File And Writes The Header
+//! @param aFilename A File Name
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//==============================================================================
+QOIStreamWriter::QOIStreamWriter(const char* aFilename, int aWidth, int aHeight)
+    : iFilename(aFilename)
+    , iFile(nullptr)
+    , iWidth(aWidth)
+    , iHeight(aHeight)
+    , iRowsWritten(0)
+    , iPrevious(0)
+    , iRun(0)
+    , iBuffer(std::max(kBufferBytes, kMaxPixelBytes * aWidth))
+{
+    // the encoder starts from opaque black and an index of transparent black
+    const uint8_t opaqueBlack[4] = {0, 0, 0, 255};
+    memcpy(&iPrevious, opaqueBlack, sizeof(iPrevious));
+    std::fill(iIndex, iIndex + 64, 0);
+
+    iFile = fopen(aFilename, "wb");
+    if (!iFile)
+        throw std::runtime_error(iFilename + " could not be opened for writing!");
+
+    // magic, width, height, 4 channels, sRGB with linear alpha
+    uint8_t header[14] = {'q', 'o', 'i', 'f'};
+    PutBigEndian(header + 4, static_cast<uint32_t>(aWidth));
+    PutBigEndian(header + 8, static_cast<uint32_t>(aHeight));
+    header[12] = 4;
+    header[13] = 0;
+
+    if (fwrite(header, 1, sizeof(header), iFile) != sizeof(header))
+        {
+        fclose(iFile);
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+        }
+}
+
+
+//==============================================================================
+//! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+//==============================================================================
+QOIStreamWriter::~QOIStreamWriter()
+{
+    fclose(iFile);
+}
+
+
+//==============================================================================
+//! @brief Encode And Write The Next Rows
+//! @param aRows The First Row, 4 Bytes Per Pixel
+//! @param aRowCount The Number Of Rows
+//! @param aRowBytes The Distance Between Rows In Bytes
+//==============================================================================
+void QOIStreamWriter::WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes)
+{
+    if (aRowCount > iHeight - iRowsWritten)
+        throw std::runtime_error("More rows than the height of " + iFilename + "!");
+
+    const size_t rowMaxBytes = kMaxPixelBytes * iWidth;
+    uint8_t* const begin = iBuffer.data();
+    uint8_t* out = begin;
+
+    for (int y = 0; y < aRowCount; ++y)
+        {
+        // a row always fits, flush before it might not
+        if (static_cast<size_t>(out - begin) + rowMaxBytes > iBuffer.size())
+            {
+            Write(begin, out - begin);
+            out = begin;
+            }
+
+        const uint8_t* pixel = aRows + y * aRowBytes;
+        for (int x = 0; x < iWidth; ++x, pixel += 4)
+            {
+            uint32_t value;
+            memcpy(&value, pixel, sizeof(value));
+
+            if (value == iPrevious)
+                {
+                if (++iRun == kMaxRun)
+                    {
+                    *out++ = static_cast<uint8_t>(kOpRun | (iRun - 1));
+                    iRun = 0;
+                    }
+                continue;
+                }
+
+            if (iRun != 0)
+                {
+                *out++ = static_cast<uint8_t>(kOpRun | (iRun - 1));
+                iRun = 0;
+                }
+
+            const int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) & 63;
+            if (iIndex[hash] == value)
+                *out++ = static_cast<uint8_t>(kOpIndex | hash);
+            else
+                {
+                iIndex[hash] = value;
+
+                uint8_t previous[4];
+                memcpy(previous, &iPrevious, sizeof(previous));
+
+                if (pixel[3] == previous[3])
+                    {
+                    // channel differences wrap around, as the decoder adds them modulo 256
+                    const int dr = static_cast<int8_t>(pixel[0] - previous[0]);
+                    const int dg = static_cast<int8_t>(pixel[1] - previous[1]);
+                    const int db = static_cast<int8_t>(pixel[2] - previous[2]);
+                    const int drdg = dr - dg;
+                    const int dbdg = db - dg;
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                        *out++ = static_cast<uint8_t>(kOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7)
+                        {
+                        *out++ = static_cast<uint8_t>(kOpLuma | (dg + 32));
+                        *out++ = static_cast<uint8_t>((drdg + 8) << 4 | (dbdg + 8));
+                        }
+                    else
+                        {
+                        *out++ = kOpRGB;
+                        *out++ = pixel[0];
+                        *out++ = pixel[1];
+                        *out++ = pixel[2];
+                        }
+                    }
+                else
+                    {
+                    *out++ = kOpRGBA;
+                    *out++ = pixel[0];
+                    *out++ = pixel[1];
+                    *out++ = pixel[2];
+                    *out++ = pixel[3];
+                    }
+                }
+
+            iPrevious = value;
+            }
+        }
+
+    Write(begin, out - begin);
+    iRowsWritten += aRowCount;
+}
+
+
+//==============================================================================
+//! @brief Write The End Of The File, After All Rows Are Written
+//==============================================================================
+void QOIStreamWriter::Finish()
+{
+    if (iRowsWritten != iHeight)
+        throw std::runtime_error("Not all rows of " + iFilename + " were written!");
+
+    // the last run, then the end marker: seven 0x00 and a 0x01
+    uint8_t end[9] = {0, 0, 0, 0, 0, 0, 0, 0, 1};
+    const uint8_t* first = end + 1;
+    if (iRun != 0)
+        {
+        end[0] = static_cast<uint8_t>(kOpRun | (iRun - 1));
+        first = end;
+        iRun = 0;
+        }
+    Write(first, end + sizeof(end) - first);
+
+    if (fflush(iFile) != 0)
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+}
+
+
+//==============================================================================
+//! @brief Write The Encoded Bytes Out
+//! @param aData The Bytes
+//! @param aSize The Number Of Bytes
+//==============================================================================
+void QOIStreamWriter::Write(const uint8_t* aData, size_t aSize)
+{
+    if (aSize != 0 && fwrite(aData, 1, aSize, iFile) != aSize)
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+}
+
+// End Of File
@@ -0,0 +1,69 @@
+//==============================================================================
+// Name         : qoistreamwriter.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares QOIStreamWriter Class
+//==============================================================================
+
+#ifndef QOISTREAMWRITER_H
+#define QOISTREAMWRITER_H
+
+#include <cstdio>     // FILE
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t, uint32_t, uint64_t
+#include <string>     // std::string
+#include <vector>     // std::vector
+#include "imagestreamwriter.h"    // ImageStreamWriter
+
+
+//==============================================================================
+//! QOIStreamWriter Class
+//! Writes An RGBA .qoi ("Quite OK Image") File A Run Of Rows At A Time. QOI
+//! Codes Each Pixel As A Run, A Recently Seen Color Or A Small Difference To
+//! The Previous One In A Single Pass With No Entropy Coder, So It Encodes
+//! And Decodes Far Faster Than .png For Atlases That Are Read Back Right Away
+//==============================================================================
+class QOIStreamWriter : public ImageStreamWriter
+{
+    public:
+    //! @brief Constructor, Creates The File And Writes The Header
+    //! @param aFilename A File Name
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    QOIStreamWriter(const char* aFilename, int aWidth, int aHeight);
+
+    //! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+    ~QOIStreamWriter();
+
+    //! @brief Encode And Write The Next Rows
+    //! @param aRows The First Row, 4 Bytes Per Pixel
+    //! @param aRowCount The Number Of Rows
+    //! @param aRowBytes The Distance Between Rows In Bytes
+    void WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes);
+
+    //! @brief Write The End Of The File, After All Rows Are Written
+    void Finish();
+
+    private:
+    //! @brief Write The Encoded Bytes Out
+    //! @param aData The Bytes
+    //! @param aSize The Number Of Bytes
+    void Write(const uint8_t* aData, size_t aSize);
+
+    QOIStreamWriter(const QOIStreamWriter&);
+    QOIStreamWriter& operator=(const QOIStreamWriter&);
+
+    private:
+    std::string                 iFilename;
+    FILE*                       iFile;
+    int                         iWidth;
+    int                         iHeight;
+    int                         iRowsWritten;
+    uint32_t                    iPrevious;    // previous pixel, RGBA in memory order
+    int                         iRun;         // repeats of iPrevious not yet written
+    uint32_t                    iIndex[64];   // recently seen pixels by hash
+    std::vector<uint8_t>        iBuffer;      // encoded bytes of one call
+};
+
+#endif    // QOISTREAMWRITER_H
+
+// End Of File
@@ -0,0 +1,34 @@
+//==============================================================================
+// Name         : rect.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares Rect Struct
+//==============================================================================
+
+#ifndef RECT_H
+#define RECT_H
+
+
+//==============================================================================
+//! Rect Struct, A Rectangular Area On The Texture Atlas
+//==============================================================================
+struct Rect
+{
+    //! @brief Constructor
+    //! @param aX The X Coordinate Of The Top-Left Point Of The Rectangle
+    //! @param aY The Y Coordinate Of The Top-Left Point Of The Rectangle
+    //! @param aWidth The Width Of The Rectangle
+    //! @param aHeight The Height Of The Rectangle
+    Rect(int aX, int aY, int aWidth, int aHeight)
+        : x(aX), y(aY), width(aWidth), height(aHeight)
+    {
+    };
+
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+#endif    // RECT_H
+
+// End Of File
@@ -0,0 +1,651 @@
+//==============================================================================
+// Name         : texturestreamwriter.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements TextureStreamWriter Class
+//==============================================================================
+
+#include "texturestreamwriter.h"    // TextureStreamWriter
+#include "blockencoder.h"           // EncodeBC1, EncodeBC3, EncodeBC7
+#include "etcencoder.h"             // EncodeETC2RGB, EncodeETC2RGBA
+#include "pixelpacker.h"            // pixelpacker::Active, BayerRow
+#include "threadpool.h"             // ThreadPool
+#include <algorithm>                // std::min, std::max, std::copy, std::fill
+#include <stdexcept>                // std::runtime_error, std::invalid_argument
+
+//! DXGI_FORMAT Values, For The .dds DX10 Header
+static const uint32_t kDXGIFormatRGBA8 = 28;    // DXGI_FORMAT_R8G8B8A8_UNORM
+static const uint32_t kDXGIFormatBGRA8 = 87;    // DXGI_FORMAT_B8G8R8A8_UNORM
+static const uint32_t kDXGIFormatBC1 = 71;      // DXGI_FORMAT_BC1_UNORM
+static const uint32_t kDXGIFormatBC3 = 77;      // DXGI_FORMAT_BC3_UNORM
+static const uint32_t kDXGIFormatBC7 = 98;      // DXGI_FORMAT_BC7_UNORM
+static const uint32_t kDXGIFormatRGBA4444 = 115;    // DXGI_FORMAT_B4G4R4A4_UNORM
+static const uint32_t kDXGIFormatRGB565 = 85;       // DXGI_FORMAT_B5G6R5_UNORM
+static const uint32_t kDXGIFormatRGBA5551 = 86;     // DXGI_FORMAT_B5G5R5A1_UNORM
+
+//! VkFormat Values, For The .ktx2 Header
+static const uint32_t kVkFormatRGBA8 = 37;      // VK_FORMAT_R8G8B8A8_UNORM
+static const uint32_t kVkFormatBGRA8 = 44;      // VK_FORMAT_B8G8R8A8_UNORM
+static const uint32_t kVkFormatBC1 = 133;       // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+static const uint32_t kVkFormatBC3 = 137;       // VK_FORMAT_BC3_UNORM_BLOCK
+static const uint32_t kVkFormatBC7 = 145;       // VK_FORMAT_BC7_UNORM_BLOCK
+static const uint32_t kVkFormatETC2RGB = 147;   // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+static const uint32_t kVkFormatETC2RGBA = 151;  // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+static const uint32_t kVkFormatRGBA4444 = 2;    // VK_FORMAT_R4G4B4A4_UNORM_PACK16
+static const uint32_t kVkFormatRGB565 = 4;      // VK_FORMAT_R5G6B5_UNORM_PACK16
+static const uint32_t kVkFormatRGBA5551 = 6;    // VK_FORMAT_R5G5B5A1_UNORM_PACK16
+
+//! Where RGBA4444, RGB565 And RGBA5551 Put Their Channels: .ktx2 Follows Vulkan And
+//! OpenGL ES, Red In The Top Bits; .dds Follows DXGI, Blue In The Bottom Bits And Alpha On Top
+static const pixelpacker::Layout kKTX2Layouts[3] =
+{
+    { {4, 4, 4, 4}, {12, 8, 4, 0} },
+    { {5, 6, 5, 0}, {11, 5, 0, 0} },
+    { {5, 5, 5, 1}, {11, 6, 1, 0} }
+};
+static const pixelpacker::Layout kDDSLayouts[3] =
+{
+    { {4, 4, 4, 4}, {8, 4, 0, 12} },
+    { {5, 6, 5, 0}, {11, 5, 0, 0} },
+    { {5, 5, 5, 1}, {10, 5, 0, 15} }
+};
+
+//! Bytes Before The Level Data Of A .dds File: Magic, Header, DX10 Header
+static const uint64_t kDDSDataOffset = 4 + 124 + 20;
+
+//! Bytes Of The .ktx2 Header And Index, Before The Level Index
+static const uint64_t kKTX2HeaderBytes = 80;
+
+//! Block Rows Of Level 0 Encoded Per Run, Per Thread
+static const int kBlockRowsPerThread = 2;
+
+
+//==============================================================================
+//! @brief Store A 32-bit Value Little-Endian, As .dds And .ktx2 Do
+//==============================================================================
+static inline void PutLittleEndian(uint8_t* aDst, uint32_t aValue)
+{
+    aDst[0] = static_cast<uint8_t>(aValue);
+    aDst[1] = static_cast<uint8_t>(aValue >> 8);
+    aDst[2] = static_cast<uint8_t>(aValue >> 16);
+    aDst[3] = static_cast<uint8_t>(aValue >> 24);
+}
+
+
+//==============================================================================
+//! @brief Store A 64-bit Value Little-Endian
+//==============================================================================
+static inline void PutLittleEndian64(uint8_t* aDst, uint64_t aValue)
+{
+    PutLittleEndian(aDst, static_cast<uint32_t>(aValue));
+    PutLittleEndian(aDst + 4, static_cast<uint32_t>(aValue >> 32));
+}
+
+
+//==============================================================================
+//! @brief Average 2x2 Pixels Into One For The Next Mip Level, Weighting The
+//!        Colors By Alpha So Transparent Neighbours Don't Darken Sprite Edges
+//! @param aRow0 The Upper Source Row, RGBA
+//! @param aRow1 The Lower Source Row, RGBA
+//! @param aSrcWidth The Source Width
+//! @param aDst The Destination Row, RGBA
+//! @param aDstWidth The Destination Width, Half The Source Width Rounded Down, At Least 1
+//==============================================================================
+static void Downsample(const uint8_t* aRow0, const uint8_t* aRow1, int aSrcWidth, uint8_t* aDst, int aDstWidth)
+{
+    for (int x = 0; x < aDstWidth; ++x, aDst += 4)
+        {
+        // an odd last column is dropped, a single column pairs with itself
+        const int left = 4 * std::min(2 * x, aSrcWidth - 1);
+        const int right = 4 * std::min(2 * x + 1, aSrcWidth - 1);
+        const uint8_t* pixels[4] = {aRow0 + left, aRow0 + right, aRow1 + left, aRow1 + right};
+
+        uint32_t alpha = 0;
+        uint32_t weighted[3] = {0, 0, 0};
+        uint32_t plain[3] = {0, 0, 0};
+        for (const uint8_t* pixel : pixels)
+            {
+            alpha += pixel[3];
+            for (int c = 0; c < 3; ++c)
+                {
+                weighted[c] += pixel[c] * pixel[3];
+                plain[c] += pixel[c];
+                }
+            }
+
+        for (int c = 0; c < 3; ++c)
+            aDst[c] = static_cast<uint8_t>(alpha ? (weighted[c] + alpha / 2) / alpha : (plain[c] + 2) / 4);
+        aDst[3] = static_cast<uint8_t>((alpha + 2) / 4);
+        }
+}
+
+
+//==============================================================================
+//! @brief Constructor, Creates The File And Writes The Header
+//! @param aFilename A File Name
+//! @param aWidth The Width Of The Image
+//! @param aHeight The Height Of The Image
+//! @param aThreadPool The Threads To Encode Blocks With
+//! @param aContainer The Texture File Format
+//! @param aFormat How The Texels Are Stored
+//! @param aQuality How Hard Block Formats Are Encoded
+//! @param aDither How 16-bit Formats Are Dithered
+//! @param aMipLevels The Number Of Levels, 0 For The Full Chain Down To 1x1
+//! @param aBGRA Store BGRA8 Instead Of RGBA8, Ignored By Block Formats
+//! @param aPitchAlignment If Not 0, Pad The Width With Transparent Columns So The
+//!        Row Pitch Of Level 0 Is A Multiple Of This Many Bytes, A Power Of Two
+//==============================================================================
+TextureStreamWriter::TextureStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                                         Container aContainer, TextureFormat aFormat, EncodeQuality aQuality,
+                                         DitherMode aDither, int aMipLevels, bool aBGRA, unsigned aPitchAlignment)
+    : iFilename(aFilename)
+    , iFile(nullptr)
+    , iThreadPool(aThreadPool)
+    , iContainer(aContainer)
+    , iFormat(aFormat)
+    , iQuality(aQuality)
+    , iDither(aDither)
+    , iBGRA(aBGRA && aFormat == TextureFormat::RGBA8)
+    , iPacked(aFormat == TextureFormat::RGBA4444 || aFormat == TextureFormat::RGB565
+              || aFormat == TextureFormat::RGBA5551)
+    , iLayout()
+    , iBlockSize((aFormat == TextureFormat::RGBA8 || iPacked) ? 1 : 4)
+    , iBlockBytes(aFormat == TextureFormat::RGBA8 ? 4 : iPacked ? 2
+                  : (aFormat == TextureFormat::BC1 || aFormat == TextureFormat::ETC2RGB) ? 8 : 16)
+    , iWidth(aWidth)
+    , iHeight(aHeight)
+    , iBandRows(0)
+{
+    if (aPitchAlignment & (aPitchAlignment - 1))
+        throw std::invalid_argument("The row pitch alignment must be a power of two!");
+    if (aContainer == Container::DDS && (aFormat == TextureFormat::ETC2RGB || aFormat == TextureFormat::ETC2RGBA))
+        throw std::invalid_argument("ETC2 textures can only be written as .ktx2!");
+
+    // pad in whole blocks, alignments below a block's bytes hold already;
+    // block formats also pad the height so level 0 is whole blocks, as Direct3D requires
+    const int pixelAlignment = iBlockSize * static_cast<int>(std::max(1u, aPitchAlignment / iBlockBytes));
+    const int width = (aWidth + pixelAlignment - 1) / pixelAlignment * pixelAlignment;
+    const int height = (aHeight + iBlockSize - 1) / iBlockSize * iBlockSize;
+
+    // the full chain halves the larger side down to 1, the smaller one stays at least 1
+    int levelCount = 1;
+    while ((std::max(width, height) >> levelCount) != 0)
+        ++levelCount;
+    if (aMipLevels > 0)
+        levelCount = std::min(levelCount, aMipLevels);
+
+    iLevels.resize(levelCount);
+    for (int i = 0; i < levelCount; ++i)
+        {
+        Level& level = iLevels[i];
+        level.width = std::max(1, width >> i);
+        level.height = std::max(1, height >> i);
+        level.rowsDone = 0;
+        if (i > 0)
+            level.pixels.resize(4 * static_cast<size_t>(level.width) * level.height);
+        if (i + 1 < levelCount)
+            level.pending.resize(4 * static_cast<size_t>(level.width));
+        if (iPacked && iDither == DitherMode::Diffusion)
+            level.errors.assign(4 * static_cast<size_t>(level.width), 0);
+        }
+
+    // .dds stores the levels largest first and back to back, .ktx2 smallest first after
+    // its descriptor, each aligned to the block bytes and 4; 16-bit levels can end half
+    // way through 4 bytes
+    uint64_t offset = kDDSDataOffset;
+    const uint64_t alignment = (iContainer == Container::KTX2) ? static_cast<uint64_t>(std::max(4, iBlockBytes)) : 1;
+    if (iContainer == Container::KTX2)
+        offset = kKTX2HeaderBytes + 24 * static_cast<uint64_t>(levelCount) + DescriptorBytes();
+    for (int i = 0; i < levelCount; ++i)
+        {
+        Level& level = iLevels[(iContainer == Container::DDS) ? i : levelCount - 1 - i];
+        offset = (offset + alignment - 1) / alignment * alignment;
+        level.offset = offset;
+        offset += LevelBytes(level);
+        }
+
+    iRow.assign(4 * static_cast<size_t>(width), 0);
+    iSwizzled.resize(iRow.size());
+    if (iPacked)
+        {
+        const int layout = static_cast<int>(aFormat) - static_cast<int>(TextureFormat::RGBA4444);
+        iLayout = (iContainer == Container::KTX2) ? kKTX2Layouts[layout] : kDDSLayouts[layout];
+        iPackedRow.resize(width);
+        }
+
+    // enough block rows of level 0 per run to keep every thread busy
+    if (iBlockSize > 1)
+        {
+        const int blockRows = std::max(4, kBlockRowsPerThread * static_cast<int>(iThreadPool.ThreadCount()));
+        iBand.resize(iRow.size() * iBlockSize * blockRows);
+        }
+
+    iFile = fopen(aFilename, "wb");
+    if (!iFile)
+        throw std::runtime_error(iFilename + " could not be opened for writing!");
+
+    try
+        {
+        if (iContainer == Container::DDS)
+            WriteDDSHeader();
+        else
+            WriteKTX2Header();
+        }
+    catch (...)
+        {
+        fclose(iFile);
+        throw;
+        }
+}
+
+
+//==============================================================================
+//! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+//==============================================================================
+TextureStreamWriter::~TextureStreamWriter()
+{
+    fclose(iFile);
+}
+
+
+//==============================================================================
+//! @brief Write The Next Rows Of Level 0 And Build The Smaller Levels From Them
+//! @param aRows The First Row, 4 Bytes Per Pixel
+//! @param aRowCount The Number Of Rows
+//! @param aRowBytes The Distance Between Rows In Bytes
+//==============================================================================
+void TextureStreamWriter::WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes)
+{
+    if (aRowCount > iHeight - iLevels[0].rowsDone)
+        throw std::runtime_error("More rows than the height of " + iFilename + "!");
+
+    // the padding columns stay zero, transparent black
+    for (int y = 0; y < aRowCount; ++y)
+        {
+        const uint8_t* row = aRows + y * aRowBytes;
+        std::copy(row, row + 4 * static_cast<size_t>(iWidth), iRow.begin());
+        TakeRow(iRow.data());
+        }
+}
+
+
+//==============================================================================
+//! @brief Pad Level 0 To Whole Blocks And Write The Smaller Levels, After All Rows Are Written
+//==============================================================================
+void TextureStreamWriter::Finish()
+{
+    if (iLevels[0].rowsDone != iHeight)
+        throw std::runtime_error("Not all rows of " + iFilename + " were written!");
+
+    std::fill(iRow.begin(), iRow.end(), 0);
+    while (iLevels[0].rowsDone < iLevels[0].height)
+        TakeRow(iRow.data());
+
+    for (size_t i = 1; i < iLevels.size(); ++i)
+        {
+        Level& level = iLevels[i];
+        if (iBlockSize > 1)
+            WriteBlocks(level.offset, level.pixels.data(), level.width, level.height);
+        else
+            WritePixels(level, 0, level.pixels.data(), level.height);
+        }
+
+    if (fflush(iFile) != 0)
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+}
+
+
+//==============================================================================
+//! @brief Take A Padded Row Of Level 0: Write It, Or Queue It For Block Encoding
+//! @param aRow The Row, RGBA
+//==============================================================================
+void TextureStreamWriter::TakeRow(const uint8_t* aRow)
+{
+    Level& base = iLevels[0];
+    if (iBlockSize == 1)
+        WritePixels(base, base.rowsDone, aRow, 1);
+    else
+        {
+        std::copy(aRow, aRow + iRow.size(), iBand.begin() + iBandRows * iRow.size());
+
+        // the height is whole blocks, so every run starts on a block row
+        if (++iBandRows * iRow.size() == iBand.size() || base.rowsDone + 1 == base.height)
+            {
+            const int firstRow = base.rowsDone + 1 - iBandRows;
+            const uint64_t pitch = LevelBytes(base) / (base.height / iBlockSize);
+            WriteBlocks(base.offset + firstRow / iBlockSize * pitch, iBand.data(), base.width, iBandRows);
+            iBandRows = 0;
+            }
+        }
+
+    AddRow(0, aRow);
+}
+
+
+//==============================================================================
+//! @brief Take A Row Of Level aLevel, Adding A Row To The Next Level Every Second Row
+//! @param aLevel The Level Index
+//! @param aRow The Row, RGBA
+//==============================================================================
+void TextureStreamWriter::AddRow(size_t aLevel, const uint8_t* aRow)
+{
+    Level& level = iLevels[aLevel];
+    const int row = level.rowsDone++;
+    if (aLevel + 1 == iLevels.size())
+        return;
+
+    // an odd last row is dropped, a single row pairs with itself
+    Level& next = iLevels[aLevel + 1];
+    const uint8_t* upper = nullptr;
+    if (row % 2 == 1)
+        upper = level.pending.data();
+    else if (level.height == 1)
+        upper = aRow;
+    else
+        {
+        std::copy(aRow, aRow + level.pending.size(), level.pending.begin());
+        return;
+        }
+
+    uint8_t* dst = next.pixels.data() + 4 * static_cast<size_t>(next.width) * next.rowsDone;
+    Downsample(upper, aRow, level.width, dst, next.width);
+    AddRow(aLevel + 1, dst);
+}
+
+
+//==============================================================================
+//! @brief Get The Stored Size Of A Level
+//! @param aLevel The Level
+//! @return The Size In Bytes
+//==============================================================================
+uint64_t TextureStreamWriter::LevelBytes(const Level& aLevel) const
+{
+    const uint64_t blocksWide = (aLevel.width + iBlockSize - 1) / iBlockSize;
+    const uint64_t blocksHigh = (aLevel.height + iBlockSize - 1) / iBlockSize;
+    return blocksWide * blocksHigh * iBlockBytes;
+}
+
+
+//==============================================================================
+//! @brief Get The Size Of The .ktx2 Data Format Descriptor, Which Has One Sample Per Channel
+//==============================================================================
+uint32_t TextureStreamWriter::DescriptorBytes() const
+{
+    // BC1 stores RGB with alpha present, BC3 and ETC2 RGBA alpha then color, BC7 and ETC2 RGB all in one
+    const uint32_t samples = (iFormat == TextureFormat::RGBA8) ? 4
+                             : iPacked ? ((iFormat == TextureFormat::RGB565) ? 3 : 4)
+                             : (iFormat == TextureFormat::BC3 || iFormat == TextureFormat::ETC2RGBA) ? 2 : 1;
+
+    // total size, basic block header, samples
+    return 4 + 24 + samples * 16;
+}
+
+
+//==============================================================================
+//! @brief Write The .dds Header With Its DX10 Extension
+//==============================================================================
+void TextureStreamWriter::WriteDDSHeader()
+{
+    const Level& base = iLevels[0];
+    const bool mipmapped = iLevels.size() > 1;
+
+    uint8_t header[kDDSDataOffset] = {'D', 'D', 'S', ' '};
+    uint8_t* dds = header + 4;
+
+    // DDS_HEADER: size, flags (caps, height, width, pitch or linear size, pixel format, mip count);
+    // block formats give the size of level 0 instead of the row pitch
+    const bool blocks = iBlockSize > 1;
+    PutLittleEndian(dds, 124);
+    PutLittleEndian(dds + 4, 0x1 | 0x2 | 0x4 | (blocks ? 0x80000 : 0x8) | 0x1000 | (mipmapped ? 0x20000 : 0));
+    PutLittleEndian(dds + 8, static_cast<uint32_t>(base.height));
+    PutLittleEndian(dds + 12, static_cast<uint32_t>(base.width));
+    PutLittleEndian(dds + 16, static_cast<uint32_t>(blocks ? LevelBytes(base) : iBlockBytes * base.width));
+    PutLittleEndian(dds + 24, static_cast<uint32_t>(iLevels.size()));
+
+    // DDS_PIXELFORMAT: size, DDPF_FOURCC, "DX10"
+    PutLittleEndian(dds + 72, 32);
+    PutLittleEndian(dds + 76, 0x4);
+    std::copy("DX10", "DX10" + 4, dds + 80);
+
+    // caps: texture, and complex mipmap when there are levels
+    PutLittleEndian(dds + 104, 0x1000 | (mipmapped ? 0x8 | 0x400000 : 0));
+
+    // DDS_HEADER_DXT10: format, 2D texture, no flags, 1 element, straight alpha
+    uint8_t* dx10 = header + 4 + 124;
+    static const uint32_t kDXGIFormats[] = {kDXGIFormatRGBA8, kDXGIFormatBC1, kDXGIFormatBC3, kDXGIFormatBC7, 0, 0,
+                                            kDXGIFormatRGBA4444, kDXGIFormatRGB565, kDXGIFormatRGBA5551};
+    PutLittleEndian(dx10, iBGRA ? kDXGIFormatBGRA8 : kDXGIFormats[static_cast<int>(iFormat)]);
+    PutLittleEndian(dx10 + 4, 3);
+    PutLittleEndian(dx10 + 12, 1);
+    PutLittleEndian(dx10 + 16, 1);
+
+    Write(0, header, sizeof(header));
+}
+
+
+//==============================================================================
+//! @brief Write The .ktx2 Header, Level Index And Data Format Descriptor
+//==============================================================================
+void TextureStreamWriter::WriteKTX2Header()
+{
+    const size_t levelIndexBytes = 24 * iLevels.size();
+    const uint32_t descriptorBytes = DescriptorBytes();
+    std::vector<uint8_t> header(kKTX2HeaderBytes + levelIndexBytes + descriptorBytes, 0);
+
+    static const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    std::copy(identifier, identifier + 12, header.begin());
+
+    // format, type size (1 for bytes and blocks alike, 2 for 16-bit pixels), width, height, depth 0, layers 0,
+    // 1 face, levels, no supercompression
+    static const uint32_t kVkFormats[] = {kVkFormatRGBA8, kVkFormatBC1, kVkFormatBC3, kVkFormatBC7,
+                                          kVkFormatETC2RGB, kVkFormatETC2RGBA, kVkFormatRGBA4444,
+                                          kVkFormatRGB565, kVkFormatRGBA5551};
+    uint8_t* fields = header.data() + 12;
+    PutLittleEndian(fields, iBGRA ? kVkFormatBGRA8 : kVkFormats[static_cast<int>(iFormat)]);
+    PutLittleEndian(fields + 4, iPacked ? 2 : 1);
+    PutLittleEndian(fields + 8, static_cast<uint32_t>(iLevels[0].width));
+    PutLittleEndian(fields + 12, static_cast<uint32_t>(iLevels[0].height));
+    PutLittleEndian(fields + 24, 1);
+    PutLittleEndian(fields + 28, static_cast<uint32_t>(iLevels.size()));
+
+    // index: the descriptor follows the level index, no key/value or global data
+    const uint32_t descriptorOffset = static_cast<uint32_t>(kKTX2HeaderBytes + levelIndexBytes);
+    PutLittleEndian(header.data() + 48, descriptorOffset);
+    PutLittleEndian(header.data() + 52, descriptorBytes);
+
+    for (size_t i = 0; i < iLevels.size(); ++i)
+        {
+        const Level& level = iLevels[i];
+        const uint64_t size = LevelBytes(level);
+        uint8_t* entry = header.data() + kKTX2HeaderBytes + 24 * i;
+        PutLittleEndian64(entry, level.offset);
+        PutLittleEndian64(entry + 8, size);
+        PutLittleEndian64(entry + 16, size);
+        }
+
+    // basic data format descriptor: version 2, the format's color model, BT.709 primaries,
+    // linear transfer as the UNORM format says, straight alpha, texel block size and bytes
+    static const uint32_t kModels[] = {1, 128, 130, 134, 161, 161, 1, 1, 1};    // RGBSDA, BC1A, BC3, BC7, ETC2 x2, RGBSDA x3
+    const uint32_t blockDimension = static_cast<uint32_t>(iBlockSize - 1);
+    uint8_t* dfd = header.data() + descriptorOffset;
+    PutLittleEndian(dfd, descriptorBytes);
+    PutLittleEndian(dfd + 8, 2 | (descriptorBytes - 4) << 16);
+    PutLittleEndian(dfd + 12, kModels[static_cast<int>(iFormat)] | 1 << 8 | 1 << 16);
+    PutLittleEndian(dfd + 16, blockDimension | blockDimension << 8);
+    PutLittleEndian(dfd + 20, static_cast<uint32_t>(iBlockBytes));
+
+    if (iFormat == TextureFormat::RGBA8)
+        {
+        // one sample per channel in byte order: 8 bits at its offset, 0..255
+        static const uint8_t rgbaChannels[4] = {0, 1, 2, 15};
+        static const uint8_t bgraChannels[4] = {2, 1, 0, 15};
+        const uint8_t* channels = iBGRA ? bgraChannels : rgbaChannels;
+        for (int i = 0; i < 4; ++i)
+            {
+            uint8_t* sample = dfd + 28 + 16 * i;
+            PutLittleEndian(sample, static_cast<uint32_t>(8 * i) | 7 << 16 | static_cast<uint32_t>(channels[i]) << 24);
+            PutLittleEndian(sample + 12, 255);
+            }
+        }
+    else if (iPacked)
+        {
+        // one sample per stored channel: its bits in the 16-bit pixel, 0..2^bits-1
+        static const uint8_t channels[4] = {0, 1, 2, 15};
+        uint8_t* sample = dfd + 28;
+        for (int c = 0; c < 4; ++c)
+            if (iLayout.bits[c])
+                {
+                PutLittleEndian(sample, static_cast<uint32_t>(iLayout.shifts[c]) | (iLayout.bits[c] - 1u) << 16
+                                        | static_cast<uint32_t>(channels[c]) << 24);
+                PutLittleEndian(sample + 12, (1u << iLayout.bits[c]) - 1);
+                sample += 16;
+                }
+        }
+    else
+        {
+        // one sample per block half or whole block: bit offset, bits - 1, channel, full range;
+        // BC1's channel 1 says alpha is present, BC3 stores alpha (15) then color (0),
+        // ETC2 alpha (15) then color (2)
+        struct Sample { uint32_t offset, bits, channel; };
+        static const Sample kBC1[] = {{0, 64, 1}};
+        static const Sample kBC3[] = {{0, 64, 15}, {64, 64, 0}};
+        static const Sample kBC7[] = {{0, 128, 0}};
+        static const Sample kETC2RGB[] = {{0, 64, 2}};
+        static const Sample kETC2RGBA[] = {{0, 64, 15}, {64, 64, 2}};
+        static const Sample* kSamples[] = {nullptr, kBC1, kBC3, kBC7, kETC2RGB, kETC2RGBA};
+        const Sample* samples = kSamples[static_cast<int>(iFormat)];
+        for (uint32_t i = 0; 28 + 16 * i < descriptorBytes; ++i)
+            {
+            uint8_t* sample = dfd + 28 + 16 * i;
+            PutLittleEndian(sample, samples[i].offset | (samples[i].bits - 1) << 16 | samples[i].channel << 24);
+            PutLittleEndian(sample + 12, 0xFFFFFFFF);
+            }
+        }
+
+    Write(0, header.data(), header.size());
+}
+
+
+//==============================================================================
+//! @brief Write Rows Of A Level, Swizzled To The Stored Channel Order Or Packed To 16 Bits
+//! @param aLevel The Level
+//! @param aFirstRow The Level Row Of The First Row
+//! @param aPixels The First Row, RGBA
+//! @param aRowCount The Number Of Rows
+//==============================================================================
+void TextureStreamWriter::WritePixels(Level& aLevel, int aFirstRow, const uint8_t* aPixels, int aRowCount)
+{
+    const size_t pitch = static_cast<size_t>(iBlockBytes) * aLevel.width;
+    const uint64_t offset = aLevel.offset + static_cast<uint64_t>(aFirstRow) * pitch;
+    if (iPacked)
+        {
+        // rows in order, so the diffused errors flow down the level
+        static const uint8_t kRound[4] = {127, 127, 127, 127};
+        const pixelpacker::Kernels& kernels = pixelpacker::Active();
+        for (int y = 0; y < aRowCount; ++y)
+            {
+            const uint8_t* row = aPixels + 4 * static_cast<size_t>(aLevel.width) * y;
+            if (iDither == DitherMode::Diffusion)
+                kernels.packDiffused(row, aLevel.width, aLevel.errors.data(), iLayout, iPackedRow.data());
+            else
+                kernels.packOrdered(row, aLevel.width,
+                                    (iDither == DitherMode::Ordered) ? pixelpacker::BayerRow(aFirstRow + y) : kRound,
+                                    iLayout, iPackedRow.data());
+
+            for (int x = 0; x < aLevel.width; ++x)
+                {
+                iSwizzled[2 * x] = static_cast<uint8_t>(iPackedRow[x]);
+                iSwizzled[2 * x + 1] = static_cast<uint8_t>(iPackedRow[x] >> 8);
+                }
+            Write(offset + y * pitch, iSwizzled.data(), pitch);
+            }
+        return;
+        }
+
+    if (!iBGRA)
+        {
+        Write(offset, aPixels, pitch * aRowCount);
+        return;
+        }
+
+    // swizzled a padded level 0 row at a time
+    const size_t bytes = pitch * aRowCount;
+    for (size_t done = 0; done < bytes; done += iSwizzled.size())
+        {
+        const size_t size = std::min(iSwizzled.size(), bytes - done);
+        const uint8_t* src = aPixels + done;
+        for (size_t i = 0; i < size; i += 4)
+            {
+            iSwizzled[i] = src[i + 2];
+            iSwizzled[i + 1] = src[i + 1];
+            iSwizzled[i + 2] = src[i];
+            iSwizzled[i + 3] = src[i + 3];
+            }
+        Write(offset + done, iSwizzled.data(), size);
+        }
+}
+
+
+//==============================================================================
+//! @brief Encode Rows As Blocks On The Thread Pool And Write Them At A File Offset,
+//!        Repeating The Last Row And Column To Fill Partial Blocks
+//! @param offset The File Offset
+//! @param aPixels The First Row, RGBA
+//! @param aWidth The Width Of The Rows
+//! @param aRowCount The Number Of Rows
+//==============================================================================
+void TextureStreamWriter::WriteBlocks(uint64_t aOffset, const uint8_t* aPixels, int aWidth, int aRowCount)
+{
+    typedef void (*Encoder)(const uint8_t*, uint8_t*, EncodeQuality);
+    static const Encoder kEncoders[] = {nullptr, blockencoder::EncodeBC1, blockencoder::EncodeBC3,
+                                        blockencoder::EncodeBC7, etcencoder::EncodeETC2RGB,
+                                        etcencoder::EncodeETC2RGBA};
+    const Encoder encode = kEncoders[static_cast<int>(iFormat)];
+
+    const int blocksWide = (aWidth + 3) / 4;
+    const int blocksHigh = (aRowCount + 3) / 4;
+    const size_t pitch = static_cast<size_t>(blocksWide) * iBlockBytes;
+    iBlocks.resize(pitch * blocksHigh);
+
+    iThreadPool.ParallelFor(blocksHigh, [&](size_t aBlockRow)
+        {
+        uint8_t pixels[64];
+        uint8_t* dst = iBlocks.data() + aBlockRow * pitch;
+        for (int bx = 0; bx < blocksWide; ++bx, dst += iBlockBytes)
+            {
+            for (int y = 0; y < 4; ++y)
+                {
+                const int sy = std::min(4 * static_cast<int>(aBlockRow) + y, aRowCount - 1);
+                for (int x = 0; x < 4; ++x)
+                    {
+                    const int sx = std::min(4 * bx + x, aWidth - 1);
+                    std::copy(aPixels + 4 * (static_cast<size_t>(sy) * aWidth + sx),
+                              aPixels + 4 * (static_cast<size_t>(sy) * aWidth + sx) + 4, pixels + 16 * y + 4 * x);
+                    }
+                }
+            encode(pixels, dst, iQuality);
+            }
+        });
+
+    Write(aOffset, iBlocks.data(), iBlocks.size());
+}
+
+
+//==============================================================================
+//! @brief Write Bytes At A File Offset
+//! @param aOffset The File Offset
+//! @param aData The Bytes
+//! @param aSize The Number Of Bytes
+//==============================================================================
+void TextureStreamWriter::Write(uint64_t aOffset, const uint8_t* aData, size_t aSize)
+{
+#if defined(_WIN32)
+    const bool positioned = _fseeki64(iFile, static_cast<__int64>(aOffset), SEEK_SET) == 0;
+#else
+    const bool positioned = fseeko(iFile, static_cast<off_t>(aOffset), SEEK_SET) == 0;
+#endif
+
+    if (!positioned || fwrite(aData, 1, aSize, iFile) != aSize)
+        throw std::runtime_error("Could not write file " + iFilename + "!");
+}
+
+// End Of File
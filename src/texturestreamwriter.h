@@ -0,0 +1,166 @@
+//==============================================================================
+// Name         : texturestreamwriter.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares TextureStreamWriter Class
+//==============================================================================
+
+#ifndef TEXTURESTREAMWRITER_H
+#define TEXTURESTREAMWRITER_H
+
+#include <cstdio>     // FILE
+#include <cstddef>    // size_t
+#include <cstdint>    // uint8_t, uint32_t, uint64_t
+#include <string>     // std::string
+#include <vector>     // std::vector
+#include "imagestreamwriter.h"    // ImageStreamWriter
+#include "atlasoptions.h"         // TextureFormat, EncodeQuality, DitherMode
+#include "pixelpacker.h"          // pixelpacker::Layout
+
+class ThreadPool;
+
+
+//==============================================================================
+//! TextureStreamWriter Class
+//! Writes The Texture Atlas As A GPU-Ready .dds Or .ktx2 Texture: RGBA8, BGRA8,
+//! Dithered 16-bit Pixels, BC1/BC3/BC7 Or (.ktx2 Only) ETC2 Blocks With A Mip
+//! Chain, Laid Out So The Runtime Can Map The File And Upload Each Level Without
+//! Decoding Or Swizzling. Level 0 Goes To The
+//! File A Run Of Rows At A Time, Block Formats Encode Each Run On The Thread Pool
+//! First; The Smaller Levels, A Third Of Its Size Together, Are Built Alongside
+//! In Memory And Written By Finish()
+//==============================================================================
+class TextureStreamWriter : public ImageStreamWriter
+{
+    public:
+    //! The Texture File Format
+    enum class Container
+    {
+        DDS,     // DirectDraw Surface with the DX10 header extension
+        KTX2     // Khronos texture 2.0, the levels stored smallest first
+    };
+
+    //! @brief Constructor, Creates The File And Writes The Header
+    //! @param aFilename A File Name
+    //! @param aWidth The Width Of The Image
+    //! @param aHeight The Height Of The Image
+    //! @param aThreadPool The Threads To Encode Blocks With
+    //! @param aContainer The Texture File Format
+    //! @param aFormat How The Texels Are Stored
+    //! @param aQuality How Hard Block Formats Are Encoded
+    //! @param aDither How 16-bit Formats Are Dithered
+    //! @param aMipLevels The Number Of Levels, 0 For The Full Chain Down To 1x1
+    //! @param aBGRA Store BGRA8 Instead Of RGBA8, Ignored By Block Formats
+    //! @param aPitchAlignment If Not 0, Pad The Width With Transparent Columns So The
+    //!        Row Pitch Of Level 0 Is A Multiple Of This Many Bytes, A Power Of Two
+    TextureStreamWriter(const char* aFilename, int aWidth, int aHeight, ThreadPool& aThreadPool,
+                        Container aContainer, TextureFormat aFormat, EncodeQuality aQuality,
+                        DitherMode aDither, int aMipLevels, bool aBGRA, unsigned aPitchAlignment);
+
+    //! @brief Destructor, Closes The File, Which Is Incomplete Unless Finish() Was Called
+    ~TextureStreamWriter();
+
+    //! @brief Write The Next Rows Of Level 0 And Build The Smaller Levels From Them
+    //! @param aRows The First Row, 4 Bytes Per Pixel
+    //! @param aRowCount The Number Of Rows
+    //! @param aRowBytes The Distance Between Rows In Bytes
+    void WriteRows(const uint8_t* aRows, int aRowCount, size_t aRowBytes);
+
+    //! @brief Pad Level 0 To Whole Blocks And Write The Smaller Levels, After All Rows Are Written
+    void Finish();
+
+    //! @brief Get The Size Level 0 Is Stored At, With The Pitch And Block Padding
+    //! @param aWidth Set To The Stored Width
+    //! @param aHeight Set To The Stored Height
+    void StoredSize(int& aWidth, int& aHeight) const
+    {
+        aWidth = iLevels[0].width;
+        aHeight = iLevels[0].height;
+    };
+
+    private:
+    //! One Mip Level
+    struct Level
+    {
+        int                     width;
+        int                     height;
+        uint64_t                offset;     // file offset of the level's first byte
+        std::vector<uint8_t>    pixels;     // RGBA, levels above 0 only
+        std::vector<uint8_t>    pending;    // the even row waiting for its odd partner
+        std::vector<int16_t>    errors;     // the next row's diffused errors, 16-bit formats only
+        int                     rowsDone;   // rows received so far
+    };
+
+    //! @brief Take A Padded Row Of Level 0: Write It, Or Queue It For Block Encoding
+    //! @param aRow The Row, RGBA
+    void TakeRow(const uint8_t* aRow);
+
+    //! @brief Take A Row Of Level aLevel, Adding A Row To The Next Level Every Second Row
+    //! @param aLevel The Level Index
+    //! @param aRow The Row, RGBA
+    void AddRow(size_t aLevel, const uint8_t* aRow);
+
+    //! @brief Get The Stored Size Of A Level
+    //! @param aLevel The Level
+    //! @return The Size In Bytes
+    uint64_t LevelBytes(const Level& aLevel) const;
+
+    //! @brief Get The Size Of The .ktx2 Data Format Descriptor, Which Has One Sample Per Channel
+    uint32_t DescriptorBytes() const;
+
+    //! @brief Write The .dds Header With Its DX10 Extension
+    void WriteDDSHeader();
+
+    //! @brief Write The .ktx2 Header, Level Index And Data Format Descriptor
+    void WriteKTX2Header();
+
+    //! @brief Write Rows Of A Level, Swizzled To The Stored Channel Order Or Packed To 16 Bits
+    //! @param aLevel The Level
+    //! @param aFirstRow The Level Row Of The First Row
+    //! @param aPixels The First Row, RGBA
+    //! @param aRowCount The Number Of Rows
+    void WritePixels(Level& aLevel, int aFirstRow, const uint8_t* aPixels, int aRowCount);
+
+    //! @brief Encode Rows As Blocks On The Thread Pool And Write Them At A File Offset,
+    //!        Repeating The Last Row And Column To Fill Partial Blocks
+    //! @param aOffset The File Offset
+    //! @param aPixels The First Row, RGBA
+    //! @param aWidth The Width Of The Rows
+    //! @param aRowCount The Number Of Rows
+    void WriteBlocks(uint64_t aOffset, const uint8_t* aPixels, int aWidth, int aRowCount);
+
+    //! @brief Write Bytes At A File Offset
+    //! @param aOffset The File Offset
+    //! @param aData The Bytes
+    //! @param aSize The Number Of Bytes
+    void Write(uint64_t aOffset, const uint8_t* aData, size_t aSize);
+
+    TextureStreamWriter(const TextureStreamWriter&);
+    TextureStreamWriter& operator=(const TextureStreamWriter&);
+
+    private:
+    std::string                 iFilename;
+    FILE*                       iFile;
+    ThreadPool&                 iThreadPool;
+    Container                   iContainer;
+    TextureFormat               iFormat;
+    EncodeQuality               iQuality;
+    DitherMode                  iDither;
+    bool                        iBGRA;
+    bool                        iPacked;     // a 16-bit format
+    pixelpacker::Layout         iLayout;     // where the channels go in a 16-bit pixel
+    int                         iBlockSize;  // texels per block side, 1 for uncompressed formats
+    int                         iBlockBytes; // bytes per block
+    int                         iWidth;      // the image width, without padding
+    int                         iHeight;     // the image height, without padding
+    std::vector<Level>          iLevels;     // level 0 is the padded image
+    std::vector<uint8_t>        iRow;        // a padded level 0 row, RGBA
+    std::vector<uint8_t>        iSwizzled;   // a row in the stored channel order, or packed
+    std::vector<uint16_t>       iPackedRow;  // a row of 16-bit pixels, 16-bit formats only
+    std::vector<uint8_t>        iBand;       // level 0 rows waiting to be encoded, block formats only
+    int                         iBandRows;   // rows in iBand
+    std::vector<uint8_t>        iBlocks;     // encoded blocks waiting to be written
+};
+
+#endif    // TEXTURESTREAMWRITER_H
+
+// End Of File
@@ -0,0 +1,159 @@
+//==============================================================================
+// Name         : threadpool.cpp
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Implements ThreadPool Class
+//==============================================================================
+
+#include "threadpool.h"    // ThreadPool
+#include <algorithm>       // std::find
+
+
+//! Set On Pool Threads While They Run A Task, Nested ParallelFor Calls Run Inline
+static thread_local bool tInsideTask = false;
+
+
+//==============================================================================
+//! @brief Constructor
+//! @param aThreadCount The Number Of Threads Including The Caller,
+//!        0 Uses One Thread Per Hardware Thread
+//==============================================================================
+ThreadPool::ThreadPool(unsigned aThreadCount)
+    : iStop(false)
+{
+    if (aThreadCount == 0)
+        aThreadCount = std::thread::hardware_concurrency();
+    if (aThreadCount == 0)
+        aThreadCount = 1;
+
+    // the calling thread is the last member of the pool
+    for (unsigned i = 1; i < aThreadCount; ++i)
+        iWorkers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+}
+
+
+//==============================================================================
+//! @brief Destructor, Joins The Worker Threads
+//==============================================================================
+ThreadPool::~ThreadPool()
+{
+        {
+        std::lock_guard<std::mutex> lock(iMutex);
+        iStop = true;
+        }
+    iWakeUp.notify_all();
+
+    for (std::thread& worker : iWorkers)
+        worker.join();
+}
+
+
+//==============================================================================
+//! @brief Run aTask(i) For Every i In [0, aCount) And Wait For All Of Them
+//! @param aCount The Number Of Tasks
+//! @param aTask The Task, Called With The Task Index
+//==============================================================================
+void ThreadPool::ParallelFor(size_t aCount, const std::function<void(size_t)>& aTask)
+{
+    if (aCount == 0)
+        return;
+
+    // nothing to share, or we are already on a pool thread: run inline
+    if (iWorkers.empty() || aCount == 1 || tInsideTask)
+        {
+        for (size_t i = 0; i < aCount; ++i)
+            aTask(i);
+        return;
+        }
+
+    Job job;
+    job.task = &aTask;
+    job.count = aCount;
+    job.next = 0;
+    job.workers = 0;
+
+        {
+        std::lock_guard<std::mutex> lock(iMutex);
+        iJobs.push_back(&job);
+        }
+    iWakeUp.notify_all();
+
+    RunTasks(job);
+
+    // no worker joins once the job is unlisted, then wait for the ones still on it
+    std::unique_lock<std::mutex> lock(iMutex);
+    iJobs.erase(std::find(iJobs.begin(), iJobs.end(), &job));
+    iJobDone.wait(lock, [&job] { return job.workers == 0; });
+
+    if (job.error)
+        std::rethrow_exception(job.error);
+}
+
+
+//==============================================================================
+//! @brief Take Task Indices Of A Job Until There Are None Left
+//! @param aJob The Job
+//==============================================================================
+void ThreadPool::RunTasks(Job& aJob)
+{
+    tInsideTask = true;
+
+    for (size_t i = aJob.next++; i < aJob.count; i = aJob.next++)
+        {
+        try
+            {
+            (*aJob.task)(i);
+            }
+        catch (...)
+            {
+            std::lock_guard<std::mutex> lock(iMutex);
+            if (!aJob.error)
+                aJob.error = std::current_exception();
+            aJob.next = aJob.count;    // skip the remaining tasks
+            }
+        }
+
+    tInsideTask = false;
+}
+
+
+//==============================================================================
+//! @brief Find The Running Job With Tasks Left And The Fewest Workers, iMutex Held
+//! @return The Job, Or nullptr If None Has Tasks Left
+//==============================================================================
+ThreadPool::Job* ThreadPool::PickJob() const
+{
+    Job* picked = nullptr;
+    for (Job* job : iJobs)
+        if (job->next < job->count && (!picked || job->workers < picked->workers))
+            picked = job;
+    return picked;
+}
+
+
+//==============================================================================
+//! @brief The Loop Each Worker Thread Runs Until The Pool Is Destroyed
+//==============================================================================
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+        {
+        Job* job = nullptr;
+            {
+            std::unique_lock<std::mutex> lock(iMutex);
+            iWakeUp.wait(lock, [&] { return iStop || (job = PickJob()) != nullptr; });
+            if (iStop)
+                return;
+            ++job->workers;
+            }
+
+        RunTasks(*job);
+
+            {
+            std::lock_guard<std::mutex> lock(iMutex);
+            --job->workers;
+            }
+        iJobDone.notify_all();
+        }
+}
+
+// End Of File
@@ -0,0 +1,86 @@
+//==============================================================================
+// Name         : threadpool.h
+// Author       : Fei Liu (liu.s.fei@gmail.com)
+// Description  : Declares ThreadPool Class
+//==============================================================================
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>                   // std::vector
+#include <thread>                   // std::thread
+#include <mutex>                    // std::mutex
+#include <condition_variable>       // std::condition_variable
+#include <functional>               // std::function
+#include <atomic>                   // std::atomic
+#include <exception>                // std::exception_ptr
+#include <cstddef>                  // size_t
+
+
+//==============================================================================
+//! ThreadPool Class
+//! A Fixed Set Of Worker Threads That Run Index Ranges In Parallel,
+//! The Calling Thread Takes Part In The Work Too; Several Threads May Run
+//! Jobs At Once, The Workers Spread Over Them
+//==============================================================================
+class ThreadPool
+{
+    public:
+    //! @brief Constructor
+    //! @param aThreadCount The Number Of Threads Including The Caller,
+    //!        0 Uses One Thread Per Hardware Thread
+    explicit ThreadPool(unsigned aThreadCount = 0);
+
+    //! @brief Destructor, Joins The Worker Threads
+    ~ThreadPool();
+
+    //! @brief Get The Number Of Threads Running Tasks, Including The Caller
+    unsigned ThreadCount() const
+    {
+        return static_cast<unsigned>(iWorkers.size()) + 1;
+    };
+
+    //! @brief Run aTask(i) For Every i In [0, aCount) And Wait For All Of Them,
+    //!        Indices Are Handed Out In Order; The First Exception Thrown By A Task
+    //!        Stops The Remaining Ones And Is Rethrown Here
+    //! @param aCount The Number Of Tasks
+    //! @param aTask The Task, Called With The Task Index
+    void ParallelFor(size_t aCount, const std::function<void(size_t)>& aTask);
+
+    private:
+    //! @brief The Loop Each Worker Thread Runs Until The Pool Is Destroyed
+    void WorkerLoop();
+
+    //! One ParallelFor Call, On The Stack Of Its Caller
+    struct Job
+    {
+        const std::function<void(size_t)>*     task;
+        size_t                                  count;
+        std::atomic<size_t>                     next;
+        unsigned                                workers;    // pool workers running its tasks
+        std::exception_ptr                      error;
+    };
+
+    //! @brief Take Task Indices Of A Job Until There Are None Left
+    //! @param aJob The Job
+    void RunTasks(Job& aJob);
+
+    //! @brief Find The Running Job With Tasks Left And The Fewest Workers, iMutex Held
+    //! @return The Job, Or nullptr If None Has Tasks Left
+    Job* PickJob() const;
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    private:
+    std::vector<std::thread>                iWorkers;
+    std::mutex                              iMutex;
+    std::condition_variable                 iWakeUp;
+    std::condition_variable                 iJobDone;
+    std::vector<Job*>                       iJobs;        // the running ParallelFor calls
+    bool                                    iStop;
+};
+
+#endif    // THREADPOOL_H
+
+// End Of File